@@ -0,0 +1,248 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * assemb_block.c - Implements the block moves of the code
+ * generator, ie the function declared at assemb_gen.h that
+ * expands the BLKCPY and BLKCLR quads, for both targets.
+ *
+ * A block of up to MAX_UNROLLED_BLOCK bytes is moved 16 bytes
+ * at a time through an SSE register, and what is left over
+ * through a general purpose one, 8 (on x86-64), 4, 2 and then
+ * 1 bytes at a time. A larger block is moved by rep movs or
+ * rep stos, whose fixed registers are saved around it.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "../front-end/front_end_header.h"
+#include "assemb_gen.h"
+#include "../front-end/parser/quads.h"
+#include "../front-end/parser/pheader_ast.h"
+#include "../front-end/lexer/lheader2.h"
+#include "./back_end_header.h"
+
+
+/* blocks of up to this many bytes are moved by unrolled moves, and
+larger ones by a rep movs or rep stos */
+#define MAX_UNROLLED_BLOCK 64
+
+
+/**
+ * blockOperand - Returns the operand that accesses a block offset bytes
+ * in: past the address held in a register, or into a variable.
+ */
+static char *blockOperand(astnode *node, long int offset) {
+    char *str_val = malloc(sizeof(char)*256);
+
+    if (node->nodetype == REG_TYPE) {
+        sprintf(str_val, "%ld(%s)", offset, node->reg_type.name);
+        return str_val;
+    }
+
+    /* a local is a displacement off of a register, and a global a label,
+    which on x86-64 is relative to the instruction pointer */
+    char *var = TARGET_IS_64 ? node2assemb64(node) : node2assemb(node);
+    char *rest;
+    long int displacement = strtol(var, &rest, 10);
+
+    if (rest != var)
+        sprintf(str_val, "%ld%s", displacement + offset, rest);
+    else if (!offset)
+        strcpy(str_val, var);
+    else if ((rest = strchr(var, '(')))
+        sprintf(str_val, "%.*s+%ld%s", (int) (rest - var), var, offset, rest);
+    else
+        sprintf(str_val, "%s+%ld", var, offset);
+    return str_val;
+}
+
+
+/**
+ * isAlignedBlock - Returns whether a block is known to be 16 byte aligned,
+ * as global arrays of at least 16 bytes are laid out.
+ */
+static _Bool isAlignedBlock(astnode *node) {
+    return node->nodetype == STABLE_VAR && node->stable_entry.var.storage_class == Extern &&
+           node->stable_entry.node->nodetype == ARRAY_TYPE &&
+           typeSize(node) >= 16;
+}
+
+
+/**
+ * scratchRegister - Returns a free general purpose register to move a
+ * block through. If it has to be accessed a byte at a time, on 32 bit x86
+ * that is one of %eax, %ebx, %ecx and %edx, the only ones with low bytes.
+ */
+static astnode *scratchRegister(_Bool low_byte) {
+    static char *low_byte_regs[] = {"%eax", "%ebx", "%ecx", "%edx"};
+    astnode *skipped[8], *reg;
+    int skipped_count = 0;
+
+    while ((reg = getRegister(NULL)) && low_byte && !TARGET_IS_64 && skipped_count < 8) {
+        _Bool has_low_byte = false;
+        for (int i = 0; i < 4; ++i)
+            has_low_byte |= !strcmp(reg->reg_type.name, low_byte_regs[i]);
+        if (has_low_byte)
+            break;
+        skipped[skipped_count++] = reg;
+    }
+
+    for (int i = 0; i < skipped_count; ++i)
+        freeRegister(skipped[i]);
+    return reg;
+}
+
+
+/**
+ * fillPattern - Returns the fill byte repeated over width bytes.
+ */
+static unsigned long long fillPattern(int fill, int width) {
+    unsigned long long pattern = 0;
+    for (int i = 0; i < width; ++i)
+        pattern = pattern << 8 | fill;
+    return pattern;
+}
+
+
+/**
+ * sizeSuffix - Returns the instruction suffix of an access of width bytes.
+ */
+static char *sizeSuffix(int width) {
+    switch (width) {
+        case 1:  return "b";
+        case 2:  return "w";
+        case 4:  return "l";
+        default: return "q";
+    }
+}
+
+
+/**
+ * generateUnrolledMove - Generates the unrolled moves of a block of size
+ * bytes, 16 bytes at a time through an SSE register and then through a
+ * general purpose register.
+ */
+static void generateUnrolledMove(Quad quad, long int size, FILE *body_output) {
+    _Bool is_copy = quad.opcode == BLKCPY;
+    int fill = is_copy ? 0 : quad.src1->num.val & 0xff;
+    long int offset = 0;
+
+    if (size >= 16) {
+        char *mov = isAlignedBlock(quad.result) && (!is_copy || isAlignedBlock(quad.src1)) ? "movdqa" : "movdqu";
+        astnode *xmm = getXmmRegister(NULL, Void);
+        char *vec = xmm->reg_type.name;
+
+        if (!is_copy && !fill)
+            fprintf(body_output, "        pxor    %s, %s\n", vec, vec);
+        else if (!is_copy) {
+            astnode *tmp = getRegister(NULL);
+            fprintf(body_output, "        movl    $%llu, %s\n", fillPattern(fill, 4), subRegister(tmp->reg_type.name, 4));
+            fprintf(body_output, "        movd    %s, %s\n", subRegister(tmp->reg_type.name, 4), vec);
+            fprintf(body_output, "        pshufd  $0, %s, %s\n", vec, vec);
+            freeRegister(tmp);
+        }
+
+        for (; offset + 16 <= size; offset += 16) {
+            if (is_copy)
+                fprintf(body_output, "        %s  %s, %s\n", mov, blockOperand(quad.src1, offset), vec);
+            fprintf(body_output, "        %s  %s, %s\n", mov, vec, blockOperand(quad.result, offset));
+        }
+        freeRegister(xmm);
+    }
+
+    /* a movq only takes a sign extended 32 bit immediate */
+    int max_width = TARGET_IS_64 && (is_copy || fill == 0 || fill == 0xff) ? 8 : 4;
+    astnode *reg = is_copy && offset < size ? scratchRegister(size % 4 != 0) : NULL;
+
+    for (int width = max_width; offset < size; width /= 2) {
+        for (; offset + width <= size; offset += width) {
+            char *sfx = sizeSuffix(width);
+
+            if (is_copy) {
+                char *part = subRegister(reg->reg_type.name, width);
+                fprintf(body_output, "        mov%s    %s, %s\n", sfx, blockOperand(quad.src1, offset), part);
+                fprintf(body_output, "        mov%s    %s, %s\n", sfx, part, blockOperand(quad.result, offset));
+            }
+            else if (width == 8)
+                fprintf(body_output, "        movq    $%d, %s\n", fill ? -1 : 0, blockOperand(quad.result, offset));
+            else
+                fprintf(body_output, "        mov%s    $%llu, %s\n", sfx, fillPattern(fill, width),
+                                        blockOperand(quad.result, offset));
+        }
+    }
+    freeRegister(reg);
+}
+
+
+/**
+ * generateRepMove - Generates the rep movs or rep stos of a block of size
+ * bytes, a word at a time, and of the bytes left over after the words.
+ */
+static void generateRepMove(Quad quad, long int size, FILE *body_output) {
+    _Bool is_copy = quad.opcode == BLKCPY;
+    int width = TARGET_IS_64 ? 8 : 4;
+    char *sfx = sizeSuffix(width);
+    char *si = TARGET_IS_64 ? "%rsi" : "%esi", *di = TARGET_IS_64 ? "%rdi" : "%edi";
+    char *cx = TARGET_IS_64 ? "%rcx" : "%ecx", *ax = TARGET_IS_64 ? "%rax" : "%eax";
+    char *saved[3] = {is_copy ? si : ax, di, cx};
+
+    for (int i = 0; i < 3; ++i)
+        fprintf(body_output, "        push%s   %s\n", sfx, saved[i]);
+
+    /* the addresses held in registers are moved over through the stack,
+    so that neither is overwritten by the other before it is read */
+    if (is_copy && quad.src1->nodetype == REG_TYPE)
+        fprintf(body_output, "        push%s   %s\n", sfx, quad.src1->reg_type.name);
+    if (quad.result->nodetype == REG_TYPE) {
+        fprintf(body_output, "        push%s   %s\n", sfx, quad.result->reg_type.name);
+        fprintf(body_output, "        pop%s    %s\n", sfx, di);
+    }
+    if (is_copy && quad.src1->nodetype == REG_TYPE)
+        fprintf(body_output, "        pop%s    %s\n", sfx, si);
+    if (is_copy && quad.src1->nodetype != REG_TYPE)
+        fprintf(body_output, "        lea%s    %s, %s\n", sfx, blockOperand(quad.src1, 0), si);
+    if (quad.result->nodetype != REG_TYPE)
+        fprintf(body_output, "        lea%s    %s, %s\n", sfx, blockOperand(quad.result, 0), di);
+
+    char *op = is_copy ? "movs" : "stos";
+    if (!is_copy) {
+        unsigned long long pattern = fillPattern(quad.src1->num.val & 0xff, width);
+        if (TARGET_IS_64)
+            fprintf(body_output, "        movabsq $%llu, %s\n", pattern, ax);
+        else
+            fprintf(body_output, "        movl    $%llu, %s\n", pattern, ax);
+    }
+    fprintf(body_output, "        mov%s    $%ld, %s\n", sfx, size / width, cx);
+    fprintf(body_output, "        rep %s%s\n", op, sfx);
+
+    for (int tail = width / 2; tail; tail /= 2)
+        if (size & tail)
+            fprintf(body_output, "        %s%s\n", op, sizeSuffix(tail));
+
+    for (int i = 2; i >= 0; --i)
+        fprintf(body_output, "        pop%s    %s\n", sfx, saved[i]);
+}
+
+
+/**
+ * generateBlockMove - Generates the copy (BLKCPY) of src2 bytes from src1
+ * to the quad's result, or the clear (BLKCLR) of them to the byte src1.
+ */
+void generateBlockMove(Quad quad, FILE *body_output) {
+    long int size = quad.src2->num.val;
+
+    if (size > MAX_UNROLLED_BLOCK)
+        generateRepMove(quad, size, body_output);
+    else if (size > 0)
+        generateUnrolledMove(quad, size, body_output);
+
+    freeRegister(quad.result);
+    if (quad.opcode == BLKCPY)
+        freeRegister(quad.src1);
+}
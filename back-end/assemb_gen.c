@@ -12,6 +12,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 
 
 #include "../front-end/front_end_header.h"
@@ -19,15 +20,58 @@
 #include "../front-end/parser/quads.h"
 #include "../front-end/lexer/lheader2.h"
 #include "./back_end_header.h"
-
+#include "./profile.h"
+#include "./block_layout.h"
+#include "./schedule.h"
+#include "./strength_reduce.h"
+#include "./frame_layout.h"
+#include "./call_graph.h"
+#include "../front-end/parser/symbol_table.h"
+
+
+/* the name of the function currently being translated */
+static char *cur_fnc_name = NULL;
+
+/* the registers a function has to preserve for its caller (%ebp only when
+it is allocatable), in the order that they are pushed */
+static char *callee_saved_32[] = {"%ebx", "%esi", "%edi", "%ebp"};
+#define CALLEE_SAVED_COUNT_32 4
+
+/* the registers a call may clobber, which are saved around it when live */
+static char *caller_saved_32[] = {"%eax", "%ecx", "%edx"};
+#define CALLER_SAVED_COUNT_32 3
+
+/* with -maccumulate-outgoing-args, the most bytes of arguments that a call
+of the current function stores at the bottom of its frame */
+static long int outgoing_args_size = 0;
+
+/* the string literals of the file, pooled by their contents: a hash table
+of them, and the order in which they were first used */
+#define STRLIT_POOL_SIZE 1021
+typedef struct PooledStrlit {
+    char *str;
+    int size;                           /* its length, as it may hold a NUL */
+    char *label;
+    struct PooledStrlit *next;          /* in its bucket */
+    struct PooledStrlit *next_in_order;
+} PooledStrlit;
+static PooledStrlit *strlit_pool[STRLIT_POOL_SIZE];
+static PooledStrlit *first_strlit = NULL, **last_strlit = &first_strlit;
+
+
+/* the assembly file, and the temporary files that make it up: the string
+literals and constants, and the functions, appended to as they are compiled */
+static FILE *output = NULL, *strlit_output = NULL, *body_output = NULL;
 
 /**
- * generateAssemb32 - Generates 32 bit x86 assembly code.
+ * beginAssemb - Sets up the generation of x86 assembly code, 32 bit or
+ * x86-64 depending on the target picked by the -m32/-m64 flags, before the
+ * file is parsed, so that each function can be compiled as soon as its
+ * definition is.
  */
-void generateAssemb32(char *output_file_name) {
+void beginAssemb(char *output_file_name) {
 
     // set up assembly file
-    FILE *output;
     if (output_file_name) {
         output = fopen(output_file_name, "w+");
         fprintf(output, "        .file   \"%s\"\n", output_file_name);
@@ -38,21 +82,49 @@ void generateAssemb32(char *output_file_name) {
     }
 
     // set up the temporary files that will make up the assembly file
-    FILE *strlit_output = fopen("stringlit_assemb_guycc.s", "w+");
+    strlit_output = fopen("stringlit_assemb_guycc.s", "w+");
     fprintf(strlit_output, "        .section  .rodata\n");
 
-    FILE *body_output = fopen("body_assemb_guycc.s", "w+");
+    body_output = fopen("body_assemb_guycc.s", "w+");
     // FILE *body_output = stdout;
 
-    /* because we do not have any initialized declarations, there won't be
-    a .data section, we can skip right ahead to .text section */
-    fprintf(body_output, "        .text\n");
+    if (be_flags.profile_mode == PROFILE_USE)
+        readProfile(be_flags.profile_file);
+}
 
-    // set up the global variables that will go in the .comm (bss) section
-    generateGlobalVarAssemb(body_output);
 
-    // translate the functions defined in the file from IR to assembly
-    generateFunctionsAssemb(body_output, strlit_output);
+/**
+ * compileFunction - Generates the assembly of a function once its
+ * definition has been parsed and its quads generated (its entry block is
+ * entry), appending it to the functions of the file, and then releases its
+ * quads, its tree and its scopes. A call to a static function that hasn't
+ * been generated yet saves the caller-saved registers as any other call.
+ */
+void compileFunction(astnode *fnc, BasicBlock *entry) {
+    addCallGraphFunction(entry->u_label);
+
+    generateFunctionAssemb(entry, body_output, strlit_output);
+    releaseFunction(fnc, entry, endFunctionNodes());
+
+}
+
+
+/**
+ * finishAssemb - Generates the rest of the assembly code once the whole
+ * file has been parsed: the global variables and the string literals,
+ * and puts the assembly file together.
+ */
+void finishAssemb() {
+
+    // the counters and the routine that dumps them for an instrumented build
+    if (be_flags.profile_mode == PROFILE_GENERATE)
+        generateProfileRuntime(body_output, strlit_output);
+
+    // the string literals used, once each
+    generateStrlitPool(strlit_output);
+
+    // the generated code never needs an executable stack
+    fprintf(body_output, "        .section .note.GNU-stack,\"\",@progbits\n");
 
     fseek(strlit_output, 0, SEEK_SET);
     fseek(body_output, 0, SEEK_SET);
@@ -62,7 +134,14 @@ void generateAssemb32(char *output_file_name) {
     while ((c = fgetc(strlit_output)) != EOF) 
         fputc(c, output);
 
-    // dump body_output to the output file
+    /* because we do not have any initialized declarations, there won't be
+    a .data section, we can skip right ahead to .text section */
+    fprintf(output, "        .text\n");
+
+    // set up the global variables that will go in the .comm (bss) section
+    generateGlobalVarAssemb(output);
+
+    // dump body_output, the functions, to the output file
     while ((c = fgetc(body_output)) != EOF) 
         fputc(c, output);
 
@@ -73,7 +152,7 @@ void generateAssemb32(char *output_file_name) {
 
 
 /**
- * generateGlobalVarAssemb - Generates the 32 bit x86 assembly
+ * generateGlobalVarAssemb - Generates the x86 assembly
  * for global variables that appear in the front-end's
  * symbol table.
  */
@@ -97,15 +176,20 @@ void generateGlobalVarAssemb(FILE *body_output) {
             if (cur_node->nodetype == STABLE_VAR) {
 
                 // get the size of the variable
-                astnode *size_node = evaluateSizeOf(cur_node);
+                long long size = typeSize(cur_node);
 
                 // get the alignment of the variable type
                 int align_size = getAlignment(cur_node->stable_entry.node);
 
+                /* arrays of 16 bytes or more are 16 byte aligned, as the x86-64
+                ABI asks, so that vectorized loops can access them with movdqa */
+                if (cur_node->stable_entry.node->nodetype == ARRAY_TYPE && size >= 16)
+                    align_size = 16;
+
                 // print the bss-ed variables to the assembly file
                 fprintf(body_output, "        .comm   %s,%llu,%d\n",
                                         cur_node->stable_entry.ident, 
-                                        size_node->num.val,
+                                        size,
                                         align_size);
 
             }
@@ -115,151 +199,397 @@ void generateGlobalVarAssemb(FILE *body_output) {
 
 
 /**
- * generateFunctionAssemb - Generates the 32 bit x86 assembly
- * for functions - this is done through a simple instruction
- * selector followed by a register allocator.
- * The IR is located in the bb_ll global struct, where each
- * node in the linked list is another defined function in the
- * source program.
+ * generateFunctionAssemb - Generates the x86 assembly
+ * for a function (whose entry block is entry) - this is done
+ * through a simple instruction selector followed by a register
+ * allocator.
  */
-void generateFunctionsAssemb(FILE *body_output, FILE *strlit_output) {
-    // go through every function 
-    BB_ll_node *cur_node = bb_ll.first;
-    while (cur_node) {
-
-        // declare the function variable 
-        fprintf(body_output, "        .globl  %s\n", cur_node->bb->u_label);
-        fprintf(body_output, "        .type   %s, @function\n", cur_node->bb->u_label);
-        fprintf(body_output, "%s:\n", cur_node->bb->u_label);
-        fprintf(body_output, "        pushl   %%ebp\n");
-        fprintf(body_output, "        movl    %%esp, %%ebp\n");
-
-        /* get the total size of the local variables */
-        int fnc_scope_size = evaluateLocalVars(cur_node->bb->u_label);
-        if (fnc_scope_size)
-            fprintf(body_output, "        subl    $%d, %%esp\n", fnc_scope_size);
-
-        Quad *last_quad = bbIR2Assemb(cur_node->bb, body_output, strlit_output, false, true);
-
-        if (!last_quad || (last_quad->opcode != RETURN)) {
-            fprintf(body_output, "        movl    $0, %%eax\n");
-            fprintf(body_output, "        leave\n");
-            fprintf(body_output, "        ret\n");
+void generateFunctionAssemb(BasicBlock *entry, FILE *body_output, FILE *strlit_output) {
+    cur_fnc_name = entry->u_label;
+
+    // the block layout weighs its edges by the profile's counts
+    if (be_flags.profile_mode == PROFILE_USE)
+        annotateProfile(entry, cur_fnc_name);
+
+    // declare the function variable, static ones aren't visible outside the file
+    astnode *fnc_node = searchStackScope(GENERAL_NAMESPACE, entry->u_label);
+    if (!fnc_node || fnc_node->stable_entry.fnc.storage_class != Static)
+        fprintf(body_output, "        .globl  %s\n", entry->u_label);
+    fprintf(body_output, "        .type   %s, @function\n", entry->u_label);
+    fprintf(body_output, "%s:\n", entry->u_label);
+
+    /* get the total size of the local variables */
+    int fnc_scope_size = evaluateLocalVars(entry->u_label);
+
+    /* the registers the prologue saves (and, without a frame pointer, the
+    locals' offsets) depend on the whole body, so it is generated first */
+    char *fnc_text;
+    size_t fnc_size;
+    FILE *fnc_output = open_memstream(&fnc_text, &fnc_size);
+    resetUsedRegisters();
+    outgoing_args_size = 0;
+    if (TARGET_IS_64)
+        beginFunction64();
+
+    /* emit the blocks in layout order, each one knowing which block
+    follows it so that it can fall through into it. The blocks that
+    fall off the end of the function generate their own return. */
+    int block_count;
+    BasicBlock **layout = layoutBasicBlocks(entry, &block_count);
+    for (int i = 0; i < block_count; ++i) {
+        if (!be_flags.schedule) {
+            bbIR2Assemb(layout[i], i+1 < block_count ? layout[i+1] : NULL,
+                        fnc_output, strlit_output, i == 0);
+            continue;
         }
-        fprintf(body_output, "        .size   %s, .-%s\n", cur_node->bb->u_label, cur_node->bb->u_label);
-        cur_node = cur_node->next;
-    }
 
+        /* the block's instructions are reordered once all of them are known */
+        char *block_text;
+        size_t block_size;
+        FILE *block_output = open_memstream(&block_text, &block_size);
+        bbIR2Assemb(layout[i], i+1 < block_count ? layout[i+1] : NULL,
+                    block_output, strlit_output, i == 0);
+        fclose(block_output);
+        scheduleBlockAssemb(block_text, fnc_output);
+        free(block_text);
+    }
+    free(layout);
+
+    fclose(fnc_output);
+    if (TARGET_IS_64) {
+        // only the callee-saved registers that the body was handed are saved
+        char *saved_regs[CALLEE_SAVED_COUNT_64];
+        int saved_count = usedCalleeSaved64(saved_regs);
+        generateFramedBody(fnc_text, fnc_scope_size, 0, saved_regs, saved_count, body_output);
+    }
+    else {
+        recordClobbers(entry->u_label, fnc_text);
+
+        // only the callee-saved registers that the body was handed are saved
+        char *saved_regs[CALLEE_SAVED_COUNT_32];
+        int saved_count = 0;
+        for (int i = 0; i < CALLEE_SAVED_COUNT_32; ++i)
+            if (wasRegisterUsed(callee_saved_32[i]))
+                saved_regs[saved_count++] = callee_saved_32[i];
+
+        if (OMIT_FRAME_POINTER)
+            generateFramelessBody(fnc_text, fnc_scope_size, outgoing_args_size,
+                                  saved_regs, saved_count, body_output);
+        else
+            generateFramedBody(fnc_text, fnc_scope_size, outgoing_args_size,
+                               saved_regs, saved_count, body_output);
+    }
+    free(fnc_text);
 
+    fprintf(body_output, "        .size   %s, .-%s\n", entry->u_label, entry->u_label);
 }
 
 
 /**
  * evaluateLocalVars - Evaluates how much space all the local variables
- * of a function will take. This is done by iterating through the 
- * function's symbol table and summing the sizeof each local variable.
+ * of a function will take, giving each one its offset within the stack
+ * frame. The layout itself, of the function's scope and every block scope
+ * within it, is done by layoutStackFrame.
  */
 long int evaluateLocalVars(char *fnc_name) {
-    long int total_sum = 0;
-
     astnode *fnc_node = searchStackScope(GENERAL_NAMESPACE, fnc_name);
     if (!fnc_node) {
         fprintf(stderr, "Internal compiler error: finding function in global scope.\n");
         return -1;
     }
 
-    SymbolTable **tables = fnc_node->stable_entry.fnc.function_body->compound_stmt.scope_layer->tables;
-    astnode *tmp;
-    for (int i = 0 ; i < 3; ++i) {
-        for (int j=0; j<tables[i]->size; ++j) {
-            if (tables[i]->data[j]) {
-                // evaluate the size of the current local variable
-                tmp = evaluateSizeOf(tables[i]->data[j]);
+    return layoutStackFrame(fnc_node->stable_entry.fnc.function_body, 0);
+}
 
-                // update the total local storage size
-                total_sum += tmp->num.val;
 
-                // set the offset for the current local variable
-                tables[i]->data[j]->stable_entry.var.offset_within_stack_frame = -total_sum;
-            }
+/**
+ * condJumpName - Returns the jcc mnemonic of a conditional branch quad.
+ * The branch quads compare src1 against src2 with cmpl src2, src1. A
+ * floating point compare sets the flags like an unsigned compare does.
+ */
+static char *condJumpName(enum QuadOpcode op, _Bool float_flags) {
+    if (float_flags) {
+        switch (op) {
+            case BRLT:  return "jb";
+            case BRLE:  return "jbe";
+            case BRGT:  return "ja";
+            case BRGE:  return "jae";
+            default:    break;
         }
     }
 
-    return total_sum;
+    switch (op) {
+        case BRLT:  return "jl";
+        case BRLE:  return "jle";
+        case BRGT:  return "jg";
+        case BRGE:  return "jge";
+        case BREQ:  return "je";
+        case BRNEQ: return "jne";
+        default:    return "jmp";
+    }
+}
+
+
+/**
+ * condJump2Assemb - Generates the jump to target_bb taken on the condition
+ * of the branch opcode op, where other_bb is where control goes otherwise.
+ * 
+ * After a floating point compare, the unordered result of a NaN operand
+ * also sets the zero flag, so an equality is checked with the parity flag
+ * too: it jumps away first when the compare was unordered.
+ */
+static void condJump2Assemb(enum QuadOpcode op, BasicBlock *target_bb, BasicBlock *other_bb, 
+                                                _Bool float_flags, FILE *body_output) {
+    if (float_flags && op == BREQ)
+        fprintf(body_output, "        jp      %s\n", other_bb->u_label);
+    else if (float_flags && op == BRNEQ)
+        fprintf(body_output, "        jp      %s\n", target_bb->u_label);
+
+    fprintf(body_output, "        %-7s %s\n", condJumpName(op, float_flags), target_bb->u_label);
 }
 
 
 /**
- * funcIR2Assemb - Generates assembly for the basic block and
- * all the blocks that flow from it.
+ * condBranch2Assemb - Generates the jumps of a conditional branch quad,
+ * falling through into whichever arm is laid out right after the block.
+ * float_flags tells whether the flags come from a floating point compare.
  */
-Quad *bbIR2Assemb(BasicBlock *bb, FILE *body_output, FILE *strlit_output, _Bool in_conditional_arm, _Bool is_fnc) {
+static void condBranch2Assemb(Quad *quad, BasicBlock *layout_next, _Bool float_flags, FILE *body_output) {
+    BasicBlock *then_bb = quad->src1->bb_type.bb;
+    BasicBlock *else_bb = quad->src2->bb_type.bb;
+
+    if (then_bb == layout_next)
+        condJump2Assemb(invertCondBranch(quad->opcode), else_bb, then_bb, float_flags, body_output);
+    else if (else_bb == layout_next)
+        condJump2Assemb(quad->opcode, then_bb, else_bb, float_flags, body_output);
+    else {
+        condJump2Assemb(quad->opcode, then_bb, else_bb, float_flags, body_output);
+        fprintf(body_output, "        jmp     %s\n", else_bb->u_label);
+    }
+}
 
-    // checks whether the block has already been seen and translated
-    if (!bb || bb->translated)
-        return NULL;
 
-    if (!is_fnc)
+/**
+ * bbIR2Assemb - Generates assembly for a basic block. The block laid
+ * out right after it is layout_next (NULL for the function's last block),
+ * and control that leaves the block for any other block jumps there.
+ */
+void bbIR2Assemb(BasicBlock *bb, BasicBlock *layout_next, FILE *body_output, FILE *strlit_output, _Bool is_fnc) {
+
+    if (!is_fnc) {
+        // align loop headers, as they are the target of every iteration's jump
+        if (bb->loop_header)
+            fprintf(body_output, "        .p2align 4,,10\n");
         fprintf(body_output, "%s:\n", bb->u_label);
+    }
 
-    // a instructor selector, with a window size of 1 quad
-    QuadLLNode *last_node = NULL;
-    QuadLLNode *cur_node = bb->quads_ll;
+    if (be_flags.profile_mode == PROFILE_GENERATE)
+        generateProfileCounterIncr(newProfileCounter(cur_fnc_name, bb), body_output);
+
+    /* a instructor selector, with a window size of 1 quad. The quad before
+    it is only looked at to know whether a floating point compare set the flags */
+    Quad *last_quad = NULL, *prev_quad = NULL;
+    for (int i = 0; i < bb->quad_count; ++i) {
+        prev_quad = last_quad;
+        last_quad = &bb->quads[i];
+        _Bool is_last = (i + 1 == bb->quad_count);
+
+        if (isCondBranch(last_quad->opcode))
+            condBranch2Assemb(last_quad, is_last ? layout_next : NULL, 
+                              prev_quad && isFloatCompare(prev_quad->opcode), body_output);
+        else if (last_quad->opcode == BR && is_last && last_quad->src1->bb_type.bb == layout_next)
+            ;   /* falls through into its target */
+        else if (isBlockMove(last_quad->opcode))
+            generateBlockMove(*last_quad, body_output);
+        else if (isSSEQuad(last_quad, prev_quad))
+            instructorSelectorSSE(*last_quad, body_output, strlit_output);
+        else if (TARGET_IS_64)
+            instructorSelector64(*last_quad, body_output, strlit_output);
+        else
+            instructorSelector(*last_quad, body_output, strlit_output);
+    }
 
-    // run through quads
-    while (cur_node) {
-        instructorSelector(cur_node->quad, body_output, strlit_output);
+    if (last_quad && (isCondBranch(last_quad->opcode) || last_quad->opcode == BR))
+        return;
 
-        last_node = cur_node;
-        cur_node = cur_node->next;
+    /* a block without a terminating branch flows into bb->next, 
+    unless it returned */
+    if (bb->next && (!last_quad || last_quad->opcode != RETURN)) {
+        if (bb->next != layout_next)
+            fprintf(body_output, "        jmp     %s\n", bb->next->u_label);
     }
-    Quad *last_quad = &last_node->quad;
+    /* falling off the end of the function returns from it */
+    else if (!last_quad || last_quad->opcode != RETURN || !last_quad->src1) {
+        fprintf(body_output, "        movl    $0, %%eax\n");
+        generateEpilogue(body_output);
+    }
+}
 
-    /* turn on flag that tells recursive logic that this 
-    block has already been seen and translated. */
-    bb->translated = true;
 
-    // continue running down the basic block linked-list/ chain!
-    if (last_quad && (
-        last_quad->opcode == BRLE || last_quad->opcode == BRGE ||
-        last_quad->opcode == BRLT || last_quad->opcode == BRGT ||
-        last_quad->opcode == BRNEQ || last_quad->opcode == BREQ) ) {
+/**
+ * generateEpilogue - Generates the assembly that tears down the
+ * current function's stack frame and returns from it.
+ */
+void generateEpilogue(FILE *body_output) {
+    if (TARGET_IS_64) {
+        generateEpilogue64(body_output);
+        return;
+    }
 
-        Quad *new_last_quad1 = bbIR2Assemb(last_quad->src1->bb_type.bb, body_output, strlit_output, true, false);
-        if (new_last_quad1 && new_last_quad1->opcode == BR && 
-        new_last_quad1->src1->bb_type.bb == last_quad->src2->bb_type.bb) {
-            return bbIR2Assemb(last_quad->src2->bb_type.bb, body_output, strlit_output, false, false);
-        }
-        else {
-            Quad *new_last_quad2 = bbIR2Assemb(last_quad->src2->bb_type.bb, body_output, strlit_output, true, false);
-            if (new_last_quad2 && new_last_quad2->opcode == BR) {
-                if (new_last_quad1 && new_last_quad1->opcode == BR && 
-                        new_last_quad1->src1->bb_type.bb == new_last_quad2->src1->bb_type.bb) 
-                {
-                    return bbIR2Assemb(new_last_quad1->src1->bb_type.bb, body_output, strlit_output, in_conditional_arm, false);
-                }
-                else if (in_conditional_arm) {
-                    return new_last_quad2;
-                }
-                else {
-                    return bbIR2Assemb(new_last_quad2->src1->bb_type.bb,body_output, strlit_output, false, false);
-                }
-            }
+    fprintf(body_output, "        leave\n");
+    fprintf(body_output, "        ret\n");
+}
+
+
+/**
+ * generateConstDivide - Generates a signed division (or modulo) of src1 by
+ * the constant divisor d without an idiv: powers of two are shifted, and
+ * other divisors are multiplied by their magic number in %edx:%eax, which
+ * are saved around it when they are live. A power of two is shifted in
+ * %eax and %edx the same way when there are no two free registers for it.
+ */
+static void generateConstDivide(Quad quad, long long d, FILE *body_output) {
+    _Bool is_modulo = quad.opcode == MODL;
+    _Bool is_pow2 = isPowerOfTwoDivisor(d);
+
+    if (is_pow2) {
+        astnode *tmp = getRegister(NULL), *bias = getRegister(NULL);
+        if (tmp && bias) {
+            fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(tmp));
+            generatePow2Divide(node2assemb(tmp), node2assemb(bias), d, is_modulo, 32, body_output);
+            fprintf(body_output, "        movl    %s, %s\n", node2assemb(tmp), node2assemb(quad.result));
+            freeRegister(bias);
+            freeRegister(tmp);
+            return;
         }
+        freeRegister(tmp);
+        freeRegister(bias);
+    }
+
+    char *result_reg = quad.result->nodetype == REG_TYPE ? quad.result->reg_type.name : "";
+    char *value_reg = is_modulo || is_pow2 ? "%eax" : "%edx";
+    _Bool save_eax = isRegisterLive("%eax") && strcmp(result_reg, "%eax");
+    _Bool save_edx = isRegisterLive("%edx") && strcmp(result_reg, "%edx");
+
+    if (save_eax)
+        fprintf(body_output, "        pushl   %%eax\n");
+    if (save_edx)
+        fprintf(body_output, "        pushl   %%edx\n");
+
+    if (is_pow2) {
+        fprintf(body_output, "        movl    %s, %%eax\n", node2assemb(quad.src1));
+        generatePow2Divide("%eax", "%edx", d, is_modulo, 32, body_output);
     }
-    else if (in_conditional_arm && bb->next) {
-        return bbIR2Assemb(bb->next, body_output, strlit_output, true, false);
+    else {
+        fprintf(body_output, "        pushl   %s\n", node2assemb(quad.src1));
+        generateMagicDivide(d, is_modulo, 32, body_output);
     }
-    else if(!in_conditional_arm && bb->next) {
-        return bbIR2Assemb(bb->next, body_output, strlit_output, false, false);
+    if (strcmp(result_reg, value_reg))
+        fprintf(body_output, "        movl    %s, %s\n", value_reg, node2assemb(quad.result));
+
+    if (save_edx)
+        fprintf(body_output, "        popl    %%edx\n");
+    if (save_eax)
+        fprintf(body_output, "        popl    %%eax\n");
+}
+
+
+/**
+ * generateDivide - Generates a signed division (or modulo) by a divisor
+ * that isn't strength reduced, with an idivl. The dividend is sign extended
+ * into %edx:%eax, so those are saved when live, and the divisor waits on
+ * the stack, as it could have been given either of them.
+ */
+static void generateDivide(Quad quad, FILE *body_output) {
+    char *result_reg = quad.result->nodetype == REG_TYPE ? quad.result->reg_type.name : "";
+    _Bool save_eax = isRegisterLive("%eax") && strcmp(result_reg, "%eax");
+    _Bool save_edx = isRegisterLive("%edx") && strcmp(result_reg, "%edx");
+
+    if (save_eax)
+        fprintf(body_output, "        pushl   %%eax\n");
+    if (save_edx)
+        fprintf(body_output, "        pushl   %%edx\n");
+
+    fprintf(body_output, "        pushl   %s\n", node2assemb(quad.src2));
+    fprintf(body_output, "        movl    %s, %%eax\n", node2assemb(quad.src1));
+    fprintf(body_output, "        cltd\n");
+    fprintf(body_output, "        idivl   (%%esp)\n");
+    fprintf(body_output, "        addl    $4, %%esp\n");
+
+    char *value_reg = quad.opcode == MODL ? "%edx" : "%eax";
+    if (strcmp(result_reg, value_reg))
+        fprintf(body_output, "        movl    %s, %s\n", value_reg, node2assemb(quad.result));
+
+    if (save_edx)
+        fprintf(body_output, "        popl    %%edx\n");
+    if (save_eax)
+        fprintf(body_output, "        popl    %%eax\n");
+}
+
+
+/**
+ * lowByteRegister - Returns the name of the low byte of a 32 bit register,
+ * or NULL for %esi and %edi, whose low bytes only exist on x86-64.
+ */
+static char *lowByteRegister(char *reg) {
+    static char *regs[] = {"%eax", "%ebx", "%ecx", "%edx"};
+    static char *low_bytes[] = {"%al", "%bl", "%cl", "%dl"};
+
+    for (int i = 0; i < 4; ++i)
+        if (!strcmp(reg, regs[i]))
+            return low_bytes[i];
+    return NULL;
+}
+
+
+/**
+ * generateSetcc - Generates the assembly that stores the flags' condition
+ * (set_op is the setcc testing it) into the result as a 0 or 1. The setcc
+ * needs a register with a low byte: the result's own, a free one, or else
+ * %eax, saved around it.
+ */
+static void generateSetcc(char *set_op, astnode *result, FILE *body_output) {
+    if (result->nodetype == REG_TYPE && lowByteRegister(result->reg_type.name)) {
+        char *low_byte = lowByteRegister(result->reg_type.name);
+        fprintf(body_output, "        %-7s %s\n", set_op, low_byte);
+        fprintf(body_output, "        movzbl  %s, %s\n", low_byte, result->reg_type.name);
+        return;
     }
-    else if (in_conditional_arm && last_quad && last_quad->opcode == BR) {
-        return last_quad;
+
+    // skip over any free %esi and %edi, handing them back afterwards
+    astnode *skipped[2], *reg;
+    int skipped_count = 0;
+    while ((reg = getRegister(NULL)) && !lowByteRegister(reg->reg_type.name) && skipped_count < 2)
+        skipped[skipped_count++] = reg;
+    for (int i = 0; i < skipped_count; ++i)
+        freeRegister(skipped[i]);
+
+    if (reg && lowByteRegister(reg->reg_type.name)) {
+        fprintf(body_output, "        %-7s %s\n", set_op, lowByteRegister(reg->reg_type.name));
+        fprintf(body_output, "        movzbl  %s, %s\n", lowByteRegister(reg->reg_type.name), reg->reg_type.name);
+        fprintf(body_output, "        movl    %s, %s\n", reg->reg_type.name, node2assemb(result));
+        freeRegister(reg);
     }
-    else if (!in_conditional_arm && last_quad && last_quad->opcode == BR) {
-        return bbIR2Assemb(last_quad->src1->bb_type.bb, body_output, strlit_output, false, false);
+    else {
+        freeRegister(reg);
+        fprintf(body_output, "        pushl   %%eax\n");
+        fprintf(body_output, "        %-7s %%al\n", set_op);
+        fprintf(body_output, "        movzbl  %%al, %%eax\n");
+        fprintf(body_output, "        movl    %%eax, %s\n", node2assemb(result));
+        fprintf(body_output, "        popl    %%eax\n");
     }
-    return last_quad;
+}
+
+
+/**
+ * argumentOffset - Returns how many bytes the first count arguments of
+ * a function call take on the stack (floats are promoted to doubles).
+ */
+static int argumentOffset(astnode *call, int count) {
+    int offset = 0;
+    for (int i = 0; i < count; ++i)
+        offset += exprFloatClass(call->fnc.arguments[i]->arg.expr) ? DATATYPE_DOUBLE : DATATYPE_INTEGER_SIZE;
+    return offset;
 }
 
 
@@ -268,14 +598,21 @@ Quad *bbIR2Assemb(BasicBlock *bb, FILE *body_output, FILE *strlit_output, _Bool
  * more assembly instructions for it.
  */
 void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
-    static int func_arg_count = 0;
-
-    /* check if one of the sources is a string literal, if so add it to the string literal
-    output that will get concatinated with the whole file, later */
+    /* the registers live across each call being set up, innermost last,
+    and the bytes of arguments pushed for it, or the call itself when its
+    arguments are stored into the outgoing argument area instead */
+    static char *saved_xmm[64][8];
+    static int saved_xmm_count[64];
+    static char *saved_gp[64][CALLER_SAVED_COUNT_32];
+    static int saved_gp_count[64];
+    static int pushed_args[64];
+    static astnode *stored_args_call[64];
+    static int call_depth = 0;
+
+    /* check if one of the sources is a string literal, if so use the label of its contents
+    in the string literal pool, which gets concatinated with the whole file, later */
     if (quad.src1 && quad.src1->nodetype == STRLIT_TYPE) {
-        quad.src1->strlit.memlbl = getStrlitName();
-        fprintf(strlit_output, "%s:\n", quad.src1->strlit.memlbl);
-        fprintf(strlit_output, "        .string \"%s\"\n", quad.src1->strlit.str);
+        quad.src1->strlit.memlbl = getStrlitLabel(quad.src1->strlit.str, quad.src1->strlit.str_size);
 
         // add the quad getting the string literal from the other-place-in-memory
         astnode *tmp = getRegister(NULL);
@@ -285,10 +622,7 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
         // quad.src1->reg_type.name = tmp->reg_type.name;
     }
     if (quad.src2 && quad.src2->nodetype == STRLIT_TYPE) {
-        quad.src2->strlit.memlbl = getStrlitName();
-        fprintf(strlit_output, "%s:\n", quad.src2->strlit.memlbl);
-        fprintf(strlit_output, "        .string \"%s\"\n", quad.src1->strlit.str);
-
+        quad.src2->strlit.memlbl = getStrlitLabel(quad.src2->strlit.str, quad.src2->strlit.str_size);
 
         // add the quad getting the string literal from the other-place-in-memory
         astnode *tmp = getRegister(NULL);
@@ -297,8 +631,8 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
     }
 
 
-    if (quad.result)
-        getRegister(quad.result);
+    getResultRegister(&quad);
+    long long const_val;
     
     if (quad.opcode == MOVL) {
         fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(quad.result));
@@ -337,6 +671,16 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
         fprintf(body_output, "        movl    %s, %s\n", node2assemb(tmp), node2assemb(quad.result));   
         freeRegister(tmp);
     }
+    else if (quad.opcode == MULL && (isIntConstant(quad.src2, &const_val) || 
+                                     isIntConstant(quad.src1, &const_val))) {
+        // multiplications by a constant become shifts and lea's where they can
+        astnode *tmp = getRegister(NULL);
+        astnode *factor = quad.src2->nodetype == NUM_TYPE ? quad.src1 : quad.src2;
+        fprintf(body_output, "        movl    %s, %s\n", node2assemb(factor), node2assemb(tmp));
+        generateConstMultiply(node2assemb(tmp), const_val, 32, body_output);
+        fprintf(body_output, "        movl    %s, %s\n", node2assemb(tmp), node2assemb(quad.result));
+        freeRegister(tmp);
+    }
     else if (quad.opcode == MULL) {
         astnode *tmp = getRegister(NULL);
         fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(tmp));        
@@ -361,77 +705,23 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
             fprintf(body_output, "        ret\n");
         }
     }
-    else if (quad.opcode == DIVL) {
-        // move src1 into eax
-        fprintf(body_output, "        pushl   %%eax\n");
-        fprintf(body_output, "        movl %s, %%eax\n", node2assemb(quad.src1));
-
-        // make sure edx is all 0s
-        fprintf(body_output, "        pushl %%edx\n");
-        fprintf(body_output, "        xor %%edx, %%edx\n");
-
-        // do the godforsaken divide operation already
-        fprintf(body_output, "        idiv    %s\n", node2assemb(quad.src2));
-        fprintf(body_output, "        movl    %%eax, %s\n", node2assemb(quad.result));
-    
-        // return whatever was pushed back into eax and edx
-        fprintf(body_output, "        movl    %%esp, %%edx\n");
-        fprintf(body_output, "        addl $4, %%esp\n");
-        fprintf(body_output, "        movl    %%esp, %%eax\n");
-        fprintf(body_output, "        addl $4, %%esp\n");
-    }
-    else if (quad.opcode == MODL) {
-        // move src1 into eax
-        fprintf(body_output, "        pushl   %%eax\n");
-        fprintf(body_output, "        movl %s, %%eax\n", node2assemb(quad.src1));
-
-        // make sure edx is all 0s
-        fprintf(body_output, "        pushl %%edx\n");
-        fprintf(body_output, "        xor %%edx, %%edx\n");
-
-        // do the godforsaken divide operation already
-        fprintf(body_output, "        idiv    %s\n", node2assemb(quad.src2));
-        fprintf(body_output, "        movl    %%edx, %s\n", node2assemb(quad.result));
-    
-        // return whatever was pushed back into eax and edx
-        fprintf(body_output, "        movl    %%esp, %%edx\n");
-        fprintf(body_output, "        addl    $4, %%esp\n");
-        fprintf(body_output, "        movl    %%esp, %%eax\n");
-        fprintf(body_output, "        addl    $4, %%esp\n");
+    else if ((quad.opcode == DIVL || quad.opcode == MODL) &&
+             isIntConstant(quad.src2, &const_val) && isReducibleDivisor(const_val)) {
+        generateConstDivide(quad, const_val, body_output);
+    }
+    else if (quad.opcode == DIVL || quad.opcode == MODL) {
+        generateDivide(quad, body_output);
     }
     else if (quad.opcode == NEG) {
         fprintf(body_output, "        negl    %s\n", node2assemb(quad.src1));
         fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(quad.result));
     }
     else if (quad.opcode == LOG_NEG_EXPR) {
-        fprintf(body_output, "        testl   %s, %s\n", node2assemb(quad.src1), node2assemb(quad.src1));
-        
-        if (!strcmp(quad.src1->ident.str, "%eax")) {
-            fprintf(body_output, "        sete    %%al\n");
-            fprintf(body_output, "        movzbl  %%al, %s\n", node2assemb(quad.src1));
-        }
-        else if (!strcmp(quad.src1->ident.str, "%ebx")) {
-            fprintf(body_output, "        sete    %%bl\n");
-            fprintf(body_output, "        movzbl  %%bl, %s\n", node2assemb(quad.src1));
-        }
-        else if (!strcmp(quad.src1->ident.str, "%ecx")) {
-            fprintf(body_output, "        sete    %%cl\n");
-            fprintf(body_output, "        movzbl  %%cl, %s\n", node2assemb(quad.src1));
-        }
-        else if (!strcmp(quad.src1->ident.str, "%edx")) {
-            fprintf(body_output, "        sete    %%dl\n");
-            fprintf(body_output, "        movzbl  %%dl, %s\n", node2assemb(quad.src1));
-        }
-        else if (!strcmp(quad.src1->ident.str, "%edi")) {
-            fprintf(body_output, "        sete    %%dil\n");
-            fprintf(body_output, "        movzbl  %%dil, %s\n", node2assemb(quad.src1));
-        }
-        else if (!strcmp(quad.src1->ident.str, "%esi")) {
-            fprintf(body_output, "        sete    %%sil\n");
-            fprintf(body_output, "        movzbl  %%sil, %s\n", node2assemb(quad.src1));
-        }
-
-        fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(quad.result));
+        astnode *tmp = getRegister(NULL);
+        fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(tmp));
+        fprintf(body_output, "        testl   %s, %s\n", node2assemb(tmp), node2assemb(tmp));
+        freeRegister(tmp);
+        generateSetcc("sete", quad.result, body_output);
     }
     else if (quad.opcode == STORE) {
         fprintf(body_output, "        movl    %s, (%s)\n", node2assemb(quad.src1), node2assemb(quad.src2));
@@ -450,22 +740,101 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
         else
             fprintf(body_output, "        leal    %s, %s\n", node2assemb(quad.src1), node2assemb(quad.result));
     }
+    else if (quad.opcode == ARG && stored_args_call[call_depth-1]) {
+        int offset = argumentOffset(stored_args_call[call_depth-1], quad.src1->num.val - 1);
+
+        if (isXmmRegister(quad.src2))
+            fprintf(body_output, "        mov%s   %s, %d(%%esp)\n", floatSuffix(quad.src2->reg_type.float_type),
+                    node2assemb(quad.src2), offset);
+        else if (quad.src2->nodetype == STABLE_VAR) {  /* no memory to memory moves */
+            astnode *tmp = getRegister(NULL);
+            fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src2), node2assemb(tmp));
+            fprintf(body_output, "        movl    %s, %d(%%esp)\n", node2assemb(tmp), offset);
+            freeRegister(tmp);
+        }
+        else
+            fprintf(body_output, "        movl    %s, %d(%%esp)\n", node2assemb(quad.src2), offset);
+    }
+    else if (quad.opcode == ARG && isXmmRegister(quad.src2)) {
+        int float_type = quad.src2->reg_type.float_type;
+        int size = float_type == Float ? DATATYPE_FLOAT : DATATYPE_DOUBLE;
+
+        fprintf(body_output, "        subl    $%d, %%esp\n", size);
+        fprintf(body_output, "        mov%s   %s, (%%esp)\n", floatSuffix(float_type), node2assemb(quad.src2));
+        pushed_args[call_depth-1] += size;
+    }
     else if (quad.opcode == ARG) {
         fprintf(body_output, "        pushl   %s\n", node2assemb(quad.src2));
-        func_arg_count += 1;
+        pushed_args[call_depth-1] += 4;
     }
     else if (quad.opcode == CALL) {
         fprintf(body_output, "        call    %s\n", node2assemb(quad.src1));
+        call_depth--;
 
         // shift the stack pointer back to place before the function arguments
-        if (func_arg_count) {
-            fprintf(body_output, "        addl    $%d, %%esp\n", func_arg_count*4);
-            func_arg_count = 0;
+        if (pushed_args[call_depth])
+            fprintf(body_output, "        addl    $%d, %%esp\n", pushed_args[call_depth]);
+
+        /* a floating point value is returned on top of the x87 stack, and is
+        moved into its SSE register through memory */
+        int float_type = calleeFloatType(quad.src1);
+        char *x87_sfx = float_type == Float ? "s" : "l";
+        if (float_type && quad.result && quad.result->nodetype == REG_TYPE) {
+            fprintf(body_output, "        subl    $8, %%esp\n");
+            fprintf(body_output, "        fstp%s   (%%esp)\n", x87_sfx);
+            fprintf(body_output, "        mov%s   (%%esp), %s\n", floatSuffix(float_type), node2assemb(quad.result));
+            fprintf(body_output, "        addl    $8, %%esp\n");
         }
-
-        if (quad.result) {
+        else if (float_type && quad.result)
+            fprintf(body_output, "        fstp%s   %s\n", x87_sfx, node2assemb(quad.result));
+        else if (float_type)
+            fprintf(body_output, "        fstp    %%st(0)\n");
+        else if (quad.result) {
             fprintf(body_output, "        movl    %%eax, %s\n", node2assemb(quad.result));
         }
+
+        for (int i = saved_xmm_count[call_depth]-1; i >= 0; --i) {
+            fprintf(body_output, "        movsd   (%%esp), %s\n", saved_xmm[call_depth][i]);
+            fprintf(body_output, "        addl    $8, %%esp\n");
+        }
+        for (int i = saved_gp_count[call_depth]-1; i >= 0; --i)
+            fprintf(body_output, "        popl    %s\n", saved_gp[call_depth][i]);
+    }
+    else if (quad.opcode == ARGBEGIN) {
+        /* only the caller-saved registers holding a value are pushed, and
+        of those, only the ones that an internal callee writes to */
+        saved_gp_count[call_depth] = 0;
+        for (int i = 0; i < CALLER_SAVED_COUNT_32; ++i) {
+            if (isRegisterLive(caller_saved_32[i]) && callMayClobber(quad.src2->fnc.ident, caller_saved_32[i])) {
+                fprintf(body_output, "        pushl   %s\n", caller_saved_32[i]);
+                saved_gp[call_depth][saved_gp_count[call_depth]++] = caller_saved_32[i];
+            }
+        }
+
+        // the SSE registers are all caller-saved
+        saved_xmm_count[call_depth] = 0;
+        for (int i = 0; i < xmm_collector.size; ++i) {
+            if (!xmm_collector.available[i]) {
+                fprintf(body_output, "        subl    $8, %%esp\n");
+                fprintf(body_output, "        movsd   %s, (%%esp)\n", xmm_collector.names[i]);
+                saved_xmm[call_depth][saved_xmm_count[call_depth]++] = xmm_collector.names[i];
+            }
+        }
+
+        /* the arguments of an outermost call that has nothing to save are
+        stored right where it finds them, at the bottom of the frame. Any call
+        nested in them pushes its own below, so as not to overwrite them. */
+        pushed_args[call_depth] = 0;
+        stored_args_call[call_depth] = NULL;
+        if (be_flags.accumulate_args && call_depth == 0 &&
+            !saved_gp_count[call_depth] && !saved_xmm_count[call_depth]) {
+            stored_args_call[call_depth] = quad.src2;
+
+            int size = argumentOffset(quad.src2, quad.src2->fnc.arg_count);
+            if (size > outgoing_args_size)
+                outgoing_args_size = size;
+        }
+        call_depth++;
     }
     else if (quad.opcode == CMP) {
         astnode *new_reg1, *new_reg2;
@@ -494,24 +863,6 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
     else if (quad.opcode == BR) {
         fprintf(body_output, "        jmp     %s\n", node2assemb(quad.src1));
     }
-    else if (quad.opcode == BRNEQ) {
-        fprintf(body_output, "        je      %s\n", node2assemb(quad.src2));
-    }
-    else if (quad.opcode == BREQ) {
-        fprintf(body_output, "        jne     %s\n", node2assemb(quad.src2));
-    }
-    else if (quad.opcode == BRLT) {
-        fprintf(body_output, "        jge     %s\n", node2assemb(quad.src2));
-    }
-    else if (quad.opcode == BRLE) {
-        fprintf(body_output, "        jg     %s\n", node2assemb(quad.src2));
-    }
-    else if (quad.opcode == BRGT) {
-        fprintf(body_output, "        jle     %s\n", node2assemb(quad.src2));
-    }
-    else if (quad.opcode == BRGE) {
-        fprintf(body_output, "        jl     %s\n", node2assemb(quad.src2));
-    }
     else if (quad.opcode == CC_LT || quad.opcode == CC_GT ||
             quad.opcode == CC_EQ || quad.opcode == CC_NEQ ||
             quad.opcode == CC_GE || quad.opcode == CC_LE) {
@@ -526,36 +877,38 @@ void instructorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
             case CC_LE: strcpy(set_op, "setle"); break;
         }
 
-        astnode *new_reg1 = getRegister(NULL);
-        if (!strcmp(new_reg1->ident.str, "%eax")) {
-            fprintf(body_output, "        %s      %%al\n", set_op);
-            fprintf(body_output, "        movzbl  %%al, %s\n", node2assemb(quad.result));
-        }
-        else if (!strcmp(new_reg1->ident.str, "%ebx")) {
-            fprintf(body_output, "        %s      %%bl\n", set_op);
-            fprintf(body_output, "        movzbl  %%bl, %s\n", node2assemb(quad.result));
-        }
-        else if (!strcmp(new_reg1->ident.str, "%ecx")) {
-            fprintf(body_output, "        %s      %%cl\n", set_op);
-            fprintf(body_output, "        movzbl  %%cl, %s\n", node2assemb(quad.result));
-        }
-        else if (!strcmp(new_reg1->ident.str, "%edx")) {
-            fprintf(body_output, "        %s      %%dl\n", set_op);
-            fprintf(body_output, "        movzbl  %%dl, %s\n", node2assemb(quad.result));
+        generateSetcc(set_op, quad.result, body_output);
+    }
+    else if (isCondMove(quad.opcode)) {
+        char *cmov_op;
+        switch(quad.opcode) {
+            case CMOV_LT:  cmov_op = "cmovl";  break;
+            case CMOV_GT:  cmov_op = "cmovg";  break;
+            case CMOV_EQ:  cmov_op = "cmove";  break;
+            case CMOV_NEQ: cmov_op = "cmovne"; break;
+            case CMOV_GE:  cmov_op = "cmovge"; break;
+            default:       cmov_op = "cmovle"; break;
         }
-        else if (!strcmp(new_reg1->ident.str, "%edi")) {
-            fprintf(body_output, "        %s      %%dil\n", set_op);
-            fprintf(body_output, "        movzbl  %%dil, %s\n", node2assemb(quad.result));
+
+        // the moves leave the flags of the compare before alone
+        astnode *tmp = quad.result->nodetype == REG_TYPE ? quad.result : getRegister(NULL);
+        astnode *picked = quad.src1;
+        if (quad.src1->nodetype != REG_TYPE) {
+            picked = getRegister(NULL);
+            fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src1), node2assemb(picked));
         }
-        else if (!strcmp(new_reg1->ident.str, "%esi")) {
-            fprintf(body_output, "        %s      %%sil\n", set_op);
-            fprintf(body_output, "        movzbl  %%sil, %s\n", node2assemb(quad.result));
+
+        fprintf(body_output, "        movl    %s, %s\n", node2assemb(quad.src2), node2assemb(tmp));
+        fprintf(body_output, "        %-7s %s, %s\n", cmov_op, node2assemb(picked), node2assemb(tmp));
+        if (tmp != quad.result) {
+            fprintf(body_output, "        movl    %s, %s\n", node2assemb(tmp), node2assemb(quad.result));
+            freeRegister(tmp);
         }
-        freeRegister(new_reg1);
+        if (picked != quad.src1)
+            freeRegister(picked);
     }
 
     // stuff not worth implementing
-    else if (quad.opcode == ARGBEGIN) {}
     else if (quad.opcode == PLPL)   {}
     else if (quad.opcode == MINMIN) {}
     else if (quad.opcode == LOGO)   {}
@@ -636,6 +989,9 @@ char *node2assemb(astnode *node) {
         if (node->stable_entry.var.storage_class == Extern) {
             sprintf(str_val, "%s", node->stable_entry.ident);
         }
+        else if (OMIT_FRAME_POINTER) {  /* rewritten once the stack depth is known */
+            sprintf(str_val, "%d(%s)", node->stable_entry.var.offset_within_stack_frame, FRAME_PLACEHOLDER);
+        }
         else {  /* it is a local variables */
             sprintf(str_val, "%d(%%ebp)", node->stable_entry.var.offset_within_stack_frame);
         }
@@ -676,8 +1032,10 @@ int getAlignment(astnode *node) {
         else    /* some error, so just default to regular int align */
             return DATATYPE_INTEGER_ALIGN;
     }   
-    else if (node->nodetype == PTR_TYPE || node->nodetype == ARRAY_TYPE)
+    else if (node->nodetype == PTR_TYPE)
         return DATATYPE_POINTER_ALIGN;
+    else if (node->nodetype == ARRAY_TYPE || node->nodetype == STABLE_SU_TAG)
+        return typeAlign(node); /* kept in the node once computed */
     else if (node->nodetype == SCALAR_TYPE) {
         switch(node->scalar_type.type) {
             case Int: return DATATYPE_INTEGER_ALIGN;
@@ -715,4 +1073,105 @@ char *getStrlitName() {
     ++val;
 
     return str_val; 
+}
+
+
+/**
+ * getStrlitLabel - Returns the label of a string literal's contents, which
+ * is the same for every occurrence of them in the file.
+ */
+char *getStrlitLabel(char *str, int size) {
+    PooledStrlit **slot = &strlit_pool[sTableHash(str, STRLIT_POOL_SIZE)];
+    while (*slot && ((*slot)->size != size || memcmp((*slot)->str, str, size)))
+        slot = &(*slot)->next;
+
+    if (!*slot) {
+        *slot = calloc(1, sizeof(PooledStrlit));
+        (*slot)->str = str;
+        (*slot)->size = size;
+        (*slot)->label = getStrlitName();
+        *last_strlit = *slot;
+        last_strlit = &(*slot)->next_in_order;
+    }
+    return (*slot)->label;
+}
+
+
+/**
+ * hasEmbeddedNul - Returns whether a string literal has a NUL before its
+ * end: a NUL character, or an octal or hex escape that is kept as it is
+ * and whose value is 0.
+ */
+static _Bool hasEmbeddedNul(PooledStrlit *strlit) {
+    for (int i = 0; i < strlit->size; ++i) {
+        if (!strlit->str[i])
+            return true;
+        if (strlit->str[i] != '\\' || i + 1 == strlit->size)
+            continue;
+
+        int j = i + 1, val = 0;
+        if (strlit->str[j] >= '0' && strlit->str[j] <= '7') {
+            for (; j < strlit->size && j < i + 4 && strlit->str[j] >= '0' && strlit->str[j] <= '7'; ++j)
+                val |= strlit->str[j] - '0';
+            if (!val)
+                return true;
+        }
+        else if (strlit->str[j] == 'x') {
+            for (++j; j < strlit->size && isxdigit(strlit->str[j]); ++j)
+                val |= strlit->str[j] != '0';
+            if (j > i + 2 && !val)
+                return true;
+        }
+        ++i;    /* the escaped character isn't the start of another escape */
+    }
+    return false;
+}
+
+
+/**
+ * generateStrlitSection - Generates the pooled string literals that do or
+ * don't have an embedded NUL, with a NUL character written as \000.
+ */
+static void generateStrlitSection(FILE *strlit_output, _Bool with_nul) {
+    for (PooledStrlit *strlit = first_strlit; strlit; strlit = strlit->next_in_order) {
+        if (hasEmbeddedNul(strlit) != with_nul)
+            continue;
+
+        fprintf(strlit_output, "%s:\n", strlit->label);
+        fprintf(strlit_output, "        .string \"");
+        for (int i = 0; i < strlit->size; ++i) {
+            if (strlit->str[i])
+                fputc(strlit->str[i], strlit_output);
+            else
+                fprintf(strlit_output, "\\000");
+        }
+        fprintf(strlit_output, "\"\n");
+    }
+}
+
+
+/**
+ * generateStrlitPool - Generates the string literals of the file, each
+ * once, into the mergeable string section, where the linker also folds
+ * together the copies of them (and the suffixes of longer ones) in the
+ * other files. The linker splits that section at every NUL, so a literal
+ * with a NUL inside of it goes in .rodata instead, as gcc does.
+ */
+void generateStrlitPool(FILE *strlit_output) {
+    _Bool merged = false, with_nul = false;
+    for (PooledStrlit *strlit = first_strlit; strlit; strlit = strlit->next_in_order) {
+        if (hasEmbeddedNul(strlit))
+            with_nul = true;
+        else
+            merged = true;
+    }
+
+    if (merged) {
+        fprintf(strlit_output, "        .section  .rodata.str1.1,\"aMS\",@progbits,1\n");
+        generateStrlitSection(strlit_output, false);
+    }
+    if (with_nul) {
+        fprintf(strlit_output, "        .section  .rodata\n");
+        generateStrlitSection(strlit_output, true);
+    }
 }
\ No newline at end of file
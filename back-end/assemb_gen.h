@@ -8,6 +8,8 @@
 
 #include <stdio.h>
 
+#include "./back_end_header.h"
+
 #ifndef TARGET_CODE_GEN
 #define TARGET_CODE_GEN
 
@@ -15,64 +17,61 @@ struct astnode;
 struct BasicBlock;
 struct Quad;
 
-/* pick the assembly type to convert to - should be compiler parameter. */
-//#define TARGET_CODE_64
-#define TARGET_CODE_32
-
-/* sizeof operator constants */
-#ifdef TARGET_CODE_64
+/* sizeof operator constants. The target is picked at run time by the
+-m32/-m64 flags, so the sizes that differ between the two are expressions. */
 #define DATATYPE_CHAR_SIZE 1
 #define DATATYPE_SHORT_SIZE 2
 #define DATATYPE_INTEGER_SIZE 4
-#define DATATYPE_LONG 8
+#define DATATYPE_LONG (TARGET_IS_64 ? 8 : 4)
 #define DATATYPE_LONGLONG 8
-#define DATATYPE_POINTER 8
+#define DATATYPE_POINTER (TARGET_IS_64 ? 8 : 4)
 #define DATATYPE_FLOAT 4
 #define DATATYPE_DOUBLE 8
-#define DATATYPE_LONGDOUBLE 16
+#define DATATYPE_LONGDOUBLE (TARGET_IS_64 ? 16 : 12)
 
 #define DATATYPE_CHAR_ALIGN 1
 #define DATATYPE_SHORT_ALIGN 2
 #define DATATYPE_INTEGER_ALIGN 4
-#define DATATYPE_LONG_ALIGN 8
-#define DATATYPE_LONGLONG_ALIGN 8
-#define DATATYPE_POINTER_ALIGN 8
+#define DATATYPE_LONG_ALIGN (TARGET_IS_64 ? 8 : 4)
+#define DATATYPE_LONGLONG_ALIGN (TARGET_IS_64 ? 8 : 4)
+#define DATATYPE_POINTER_ALIGN (TARGET_IS_64 ? 8 : 4)
 #define DATATYPE_FLOAT_ALIGN 4
-#define DATATYPE_DOUBLE_ALIGN 8
-#define DATATYPE_LONGDOUBLE_ALIGN 8
-#endif
+#define DATATYPE_DOUBLE_ALIGN (TARGET_IS_64 ? 8 : 4)
+#define DATATYPE_LONGDOUBLE_ALIGN (TARGET_IS_64 ? 16 : 4)
 
-#ifdef TARGET_CODE_32
-#define DATATYPE_CHAR_SIZE 1
-#define DATATYPE_SHORT_SIZE 2
-#define DATATYPE_INTEGER_SIZE 4
-#define DATATYPE_LONG 4 
-#define DATATYPE_LONGLONG 8
-#define DATATYPE_POINTER 4
-#define DATATYPE_FLOAT 4
-#define DATATYPE_DOUBLE 8
-#define DATATYPE_LONGDOUBLE 12
+/* the number of callee-saved registers on x86-64 (%rbx, %r12-%r15) */
+#define CALLEE_SAVED_COUNT_64 5
+
+
+/**
+ * beginAssemb - Sets up the generation of x86 assembly code, 32 bit or
+ * x86-64 depending on the target picked by the -m32/-m64 flags, before the
+ * file is parsed, so that each function can be compiled as soon as its
+ * definition is.
+ */
+void beginAssemb(char *output_file_name);
 
-#define DATATYPE_CHAR_ALIGN 1
-#define DATATYPE_SHORT_ALIGN 2
-#define DATATYPE_INTEGER_ALIGN 4
-#define DATATYPE_LONG_ALIGN 4 
-#define DATATYPE_LONGLONG_ALIGN 4
-#define DATATYPE_POINTER_ALIGN 4
-#define DATATYPE_FLOAT_ALIGN 4
-#define DATATYPE_DOUBLE_ALIGN 4
-#define DATATYPE_LONGDOUBLE_ALIGN 4
-#endif
+
+/**
+ * compileFunction - Generates the assembly of a function once its
+ * definition has been parsed and its quads generated (its entry block is
+ * entry), appending it to the functions of the file, and then releases its
+ * quads, its tree and its scopes. A call to a static function that hasn't
+ * been generated yet saves the caller-saved registers as any other call.
+ */
+void compileFunction(struct astnode *fnc, struct BasicBlock *entry);
 
 
 /**
- * generateAssemb32 - Generates 32 bit x86 assembly code.
+ * finishAssemb - Generates the rest of the assembly code once the whole
+ * file has been parsed: the global variables and the string literals,
+ * and puts the assembly file together.
  */
-void generateAssemb32(char *output_file_name);
+void finishAssemb();
 
 
 /**
- * generateGlobalVarAssemb - Generates the 32 bit x86 assembly
+ * generateGlobalVarAssemb - Generates the x86 assembly
  * for global variables that appear in the front-end's
  * symbol table.
  */
@@ -80,29 +79,36 @@ void generateGlobalVarAssemb(FILE *output);
 
 
 /**
- * generateFunctionAssemb - Generates the 32 bit x86 assembly
- * for functions - this is done through a simple instruction
- * selector followed by a register allocator.
- * The IR is located in the bb_ll global struct, where each
- * node in the linked list is another defined function in the
- * source program.
+ * generateFunctionAssemb - Generates the x86 assembly
+ * for a function (whose entry block is entry) - this is done
+ * through a simple instruction selector followed by a register
+ * allocator.
  */
-void generateFunctionsAssemb(FILE *body_output, FILE *strlit_output);
+void generateFunctionAssemb(struct BasicBlock *entry, FILE *body_output, FILE *strlit_output);
 
 
 /**
  * evaluateLocalVars - Evaluates how much space all the local variables
- * of a function will take. This is done by iterating through the 
- * function's symbol table and summing the sizeof each local variable.
+ * of a function will take, giving each one its offset within the stack
+ * frame. The layout itself, of the function's scope and every block scope
+ * within it, is done by layoutStackFrame.
  */
 long int evaluateLocalVars(char *fnc_name);
 
 
 /**
- * funcIR2Assemb - Generates assembly for the basic block and
- * all the blocks that flow from it.
+ * bbIR2Assemb - Generates assembly for a basic block. The block laid
+ * out right after it is layout_next (NULL for the function's last block),
+ * and control that leaves the block for any other block jumps there.
  */
-struct Quad *bbIR2Assemb(struct BasicBlock *bb, FILE *body_output, FILE *strlit_output, _Bool is_conditional_arm, _Bool is_fnc);
+void bbIR2Assemb(struct BasicBlock *bb, struct BasicBlock *layout_next, FILE *body_output, FILE *strlit_output, _Bool is_fnc);
+
+
+/**
+ * generateEpilogue - Generates the assembly that tears down the
+ * current function's stack frame and returns from it.
+ */
+void generateEpilogue(FILE *body_output);
 
 
 /**
@@ -131,4 +137,123 @@ int getAlignment(struct astnode *node);
 char *getStrlitName();
 
 
+/**
+ * getStrlitLabel - Returns the label of a string literal's contents (size
+ * characters of str), which is the same for every occurrence of them in
+ * the file.
+ */
+char *getStrlitLabel(char *str, int size);
+
+
+/**
+ * generateStrlitPool - Generates the string literals of the file, each
+ * once, into the mergeable string section (.rodata.str1.1), or .rodata for
+ * the ones with an embedded NUL, after the functions that use them were
+ * generated.
+ */
+void generateStrlitPool(FILE *strlit_output);
+
+
+/******* X86-64 TARGET ********/
+/* The x86-64 System V target, implemented in assemb_gen64.c. The shared
+functions above call into these when -m64 is given. */
+
+/**
+ * beginFunction64 - Resets the state of the calls being set up, at the
+ * start of a function's body.
+ */
+void beginFunction64();
+
+
+/**
+ * usedCalleeSaved64 - Sets saved_regs to the callee-saved registers that
+ * the current function's body was handed, in the order that they are
+ * pushed, and returns how many of them there are.
+ */
+int usedCalleeSaved64(char **saved_regs);
+
+
+/**
+ * generateEpilogue64 - Generates the assembly that tears down the stack
+ * frame and returns, popping the callee-saved registers that the function
+ * used once generateFramedBody knows them.
+ */
+void generateEpilogue64(FILE *body_output);
+
+
+/**
+ * instructorSelector64 - Looks at a quad and generates one or
+ * more x86-64 assembly instructions for it.
+ */
+void instructorSelector64(struct Quad quad, FILE *body_output, FILE *strlit_output);
+
+
+/**
+ * node2assemb64 - Prints out the x86-64 assembly meaning of an ast node.
+ */
+char *node2assemb64(struct astnode *node);
+
+
+/**
+ * subRegister - Returns the name of the lower size bytes of a 64 bit register
+ * (or of a 32 bit one).
+ */
+char *subRegister(char *reg, int size);
+
+
+/******* SSE2 FLOATING POINT ********/
+/* Floats and doubles are computed in the SSE registers on both targets,
+implemented in assemb_sse.c. Only the calling conventions differ: x86-64
+passes and returns them in %xmm registers, while 32 bit x86 passes them on
+the stack and returns them on top of the x87 stack. */
+
+/**
+ * isSSEQuad - Returns whether a quad is translated by instructorSelectorSSE.
+ * That is every floating point quad, the setcc reading the flags of a
+ * floating point compare (the quad before it, prev), and the return of a
+ * floating point value.
+ */
+_Bool isSSEQuad(struct Quad *quad, struct Quad *prev);
+
+
+/**
+ * instructorSelectorSSE - Looks at a floating point quad and generates one
+ * or more SSE2 instructions for it. Constants are placed in .rodata.
+ */
+void instructorSelectorSSE(struct Quad quad, FILE *body_output, FILE *strlit_output);
+
+
+/**
+ * getResultRegister - Gives the result of a quad a register of the class
+ * its value needs: an SSE register for floating point values, and a
+ * general purpose register otherwise.
+ */
+void getResultRegister(struct Quad *quad);
+
+
+/**
+ * calleeFloatType - Returns the floating type (Float or Double) that the
+ * called function returns, or Void when it returns an integer.
+ */
+int calleeFloatType(struct astnode *callee);
+
+
+/**
+ * floatSuffix - Returns the SSE2 instruction suffix of a floating type.
+ */
+char *floatSuffix(int float_type);
+
+
+/******* BLOCK MOVES ********/
+/* Struct assignments and memcpy and memset calls of a constant size are
+BLKCPY and BLKCLR quads, expanded inline on both targets by assemb_block.c:
+unrolled moves for small blocks, and rep movs/stos for larger ones. */
+
+/**
+ * generateBlockMove - Generates the copy (BLKCPY) of src2 bytes from src1
+ * to the quad's result, or the clear (BLKCLR) of them to the byte src1.
+ */
+void generateBlockMove(struct Quad quad, FILE *body_output);
+
+
 #endif
\ No newline at end of file
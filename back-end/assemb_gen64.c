@@ -0,0 +1,718 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * assemb_gen64.c - Implements the x86-64 target of the
+ * code generator, ie the x86-64 functions declared at
+ * assemb_gen.h.
+ *
+ * Registers always hold full 64 bit values: a variable is
+ * sign-extended as it is loaded into a register, and only
+ * its own size is written back when it is stored. Function
+ * calls follow the System V convention, passing the first
+ * six arguments in registers and the rest on the stack.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "../front-end/front_end_header.h"
+#include "assemb_gen.h"
+#include "../front-end/parser/quads.h"
+#include "../front-end/parser/pheader_ast.h"
+#include "../front-end/lexer/lheader2.h"
+#include "./back_end_header.h"
+#include "./strength_reduce.h"
+
+
+/* the 64, 32, 16 and 8 bit names of every allocatable register */
+static char *sub_registers[][4] = {
+    {"%rax", "%eax",  "%ax",   "%al"},
+    {"%rbx", "%ebx",  "%bx",   "%bl"},
+    {"%rcx", "%ecx",  "%cx",   "%cl"},
+    {"%rdx", "%edx",  "%dx",   "%dl"},
+    {"%rsi", "%esi",  "%si",   "%sil"},
+    {"%rdi", "%edi",  "%di",   "%dil"},
+    {"%r8",  "%r8d",  "%r8w",  "%r8b"},
+    {"%r9",  "%r9d",  "%r9w",  "%r9b"},
+    {"%r10", "%r10d", "%r10w", "%r10b"},
+    {"%r11", "%r11d", "%r11w", "%r11b"},
+    {"%r12", "%r12d", "%r12w", "%r12b"},
+    {"%r13", "%r13d", "%r13w", "%r13b"},
+    {"%r14", "%r14d", "%r14w", "%r14b"},
+    {"%r15", "%r15d", "%r15w", "%r15b"}
+};
+
+/* the registers that carry the first six integer arguments of a call */
+static char *arg_registers[] = {"%rdi", "%rsi", "%rdx", "%rcx", "%r8", "%r9"};
+#define ARG_REGISTER_COUNT 6
+
+/* and the ones that carry the first eight floating point arguments */
+static char *float_arg_registers[] = {"%xmm0", "%xmm1", "%xmm2", "%xmm3", 
+                                      "%xmm4", "%xmm5", "%xmm6", "%xmm7"};
+#define FLOAT_ARG_REGISTER_COUNT 8
+
+/* the callee-saved registers, in the order that they are pushed */
+static char *callee_saved[] = {"%rbx", "%r12", "%r13", "%r14", "%r15"};
+
+/* number of 8 byte slots pushed since the last 16 byte aligned point
+of the frame, needed to keep the stack aligned at calls */
+static int push_depth = 0;
+
+/* the calls whose arguments are being pushed, innermost last */
+#define MAX_CALL_NESTING 64
+#define MAX_CALL_ARGS 64
+static struct PendingCall {
+    int arg_count;
+    int padding;                /* 8 byte slots added to align the call */
+    int saved_count;            /* live caller-saved registers pushed */
+    char *saved[32];
+    int float_count;            /* arguments that are doubles */
+    _Bool is_float[MAX_CALL_ARGS];
+} pending_calls[MAX_CALL_NESTING];
+static int pending_call_count = 0;
+
+
+/**
+ * subRegister - Returns the name of the lower size bytes of a 64 bit register
+ * (or of a 32 bit one).
+ */
+char *subRegister(char *reg, int size) {
+    int col = size == 8 ? 0 : size == 4 ? 1 : size == 2 ? 2 : 3;
+
+    for (int i = 0; i < sizeof(sub_registers)/sizeof(sub_registers[0]); ++i)
+        if (!strcmp(sub_registers[i][0], reg) || !strcmp(sub_registers[i][1], reg))
+            return sub_registers[i][col];
+    return reg;
+}
+
+
+/**
+ * sizeSuffix - Returns the instruction suffix of an access of size bytes.
+ */
+static char *sizeSuffix(int size) {
+    switch (size) {
+        case 1:  return "b";
+        case 2:  return "w";
+        case 4:  return "l";
+        default: return "q";
+    }
+}
+
+
+/**
+ * operandSize - Returns how many bytes an operand takes in memory. Only
+ * variables have a size of their own, anything else is a full register.
+ */
+static int operandSize(astnode *node) {
+    if (node->nodetype != STABLE_VAR)
+        return 8;
+
+    astnode *type = node->stable_entry.node;
+    if (type->nodetype == ARRAY_TYPE)
+        return 8;
+
+    long long size = typeSize(type);
+    if (size < 0 || size > 8)
+        return 8;
+    return size;
+}
+
+
+/**
+ * isImmediate - Returns whether a node is a constant that fits in the
+ * sign-extended 32 bit immediate field of an instruction.
+ */
+static _Bool isImmediate(astnode *node) {
+    if (node->nodetype == CHRLIT_TYPE)
+        return true;
+    if (node->nodetype != NUM_TYPE || !(node->num.types & NUMMASK_INTGR))
+        return false;
+
+    long long val = (long long) node->num.val;
+    return val >= -2147483648LL && val <= 2147483647LL;
+}
+
+
+/**
+ * loadOperand - Generates the assembly that loads an operand into the
+ * 64 bit register reg, sign-extending variables narrower than it.
+ */
+static void loadOperand(astnode *src, char *reg, FILE *body_output) {
+    if (src->nodetype == REG_TYPE) {
+        if (strcmp(src->reg_type.name, reg))
+            fprintf(body_output, "        movq    %s, %s\n", src->reg_type.name, reg);
+    }
+    else if (src->nodetype == NUM_TYPE || src->nodetype == CHRLIT_TYPE) {
+        if (isImmediate(src))
+            fprintf(body_output, "        movq    %s, %s\n", node2assemb64(src), reg);
+        else
+            fprintf(body_output, "        movabsq %s, %s\n", node2assemb64(src), reg);
+    }
+    else if (src->nodetype == STABLE_VAR && src->stable_entry.node->nodetype == ARRAY_TYPE) {
+        fprintf(body_output, "        leaq    %s, %s\n", node2assemb64(src), reg);
+    }
+    else {
+        switch (operandSize(src)) {
+            case 1:  fprintf(body_output, "        movsbq  %s, %s\n", node2assemb64(src), reg); break;
+            case 2:  fprintf(body_output, "        movswq  %s, %s\n", node2assemb64(src), reg); break;
+            case 4:  fprintf(body_output, "        movslq  %s, %s\n", node2assemb64(src), reg); break;
+            default: fprintf(body_output, "        movq    %s, %s\n", node2assemb64(src), reg); break;
+        }
+    }
+}
+
+
+/**
+ * storeOperand - Generates the assembly that stores the 64 bit register
+ * reg into the operand des, writing only as many bytes as des has.
+ */
+static void storeOperand(char *reg, astnode *des, FILE *body_output) {
+    if (des->nodetype == REG_TYPE) {
+        if (strcmp(des->reg_type.name, reg))
+            fprintf(body_output, "        movq    %s, %s\n", reg, des->reg_type.name);
+        return;
+    }
+
+    int size = operandSize(des);
+    fprintf(body_output, "        mov%s    %s, %s\n", sizeSuffix(size),
+                                subRegister(reg, size), node2assemb64(des));
+}
+
+
+/**
+ * sourceOperand - Returns an operand that an instruction can read src
+ * from: its register, an immediate, or a temporary register that src is
+ * loaded into. The temporary is stored in tmp, for the caller to free.
+ */
+static char *sourceOperand(astnode *src, astnode **tmp, FILE *body_output) {
+    *tmp = NULL;
+    if (src->nodetype == REG_TYPE)
+        return src->reg_type.name;
+    if (isImmediate(src))
+        return node2assemb64(src);
+
+    *tmp = getRegister(NULL);
+    loadOperand(src, (*tmp)->reg_type.name, body_output);
+    return (*tmp)->reg_type.name;
+}
+
+
+/**
+ * workRegister - Returns the register a quad computes its result in,
+ * which is the result itself when it was given a register. Otherwise a
+ * temporary is stored in tmp, for the caller to free.
+ */
+static char *workRegister(astnode *result, astnode **tmp) {
+    *tmp = NULL;
+    if (result && result->nodetype == REG_TYPE)
+        return result->reg_type.name;
+
+    *tmp = getRegister(NULL);
+    return (*tmp)->reg_type.name;
+}
+
+
+/**
+ * beginFunction64 - Resets the state of the calls being set up, at the
+ * start of a function's body.
+ */
+void beginFunction64() {
+    push_depth = 0;
+    pending_call_count = 0;
+}
+
+
+/**
+ * usedCalleeSaved64 - Sets saved_regs to the callee-saved registers that
+ * the current function's body was handed, in the order that they are
+ * pushed, and returns how many of them there are.
+ */
+int usedCalleeSaved64(char **saved_regs) {
+    int saved_count = 0;
+    for (int i = 0; i < CALLEE_SAVED_COUNT_64; ++i)
+        if (wasRegisterUsed(callee_saved[i]))
+            saved_regs[saved_count++] = callee_saved[i];
+    return saved_count;
+}
+
+
+/**
+ * generateEpilogue64 - Generates the assembly that tears down the stack
+ * frame and returns. The callee-saved registers that the function used are
+ * popped before the leave, by generateFramedBody, once they are known.
+ */
+void generateEpilogue64(FILE *body_output) {
+    fprintf(body_output, "        leave\n");
+    fprintf(body_output, "        ret\n");
+}
+
+
+/**
+ * generateCallSetup - Generates the assembly at the start of a function
+ * call's argument list: the live caller-saved registers are pushed, and
+ * the stack is padded so that it is aligned once the arguments that do
+ * not fit in registers have been pushed.
+ */
+static void generateCallSetup(int arg_count, FILE *body_output) {
+    struct PendingCall *call = &pending_calls[pending_call_count++];
+    call->arg_count = arg_count;
+    call->saved_count = 0;
+    call->float_count = 0;
+    memset(call->is_float, false, sizeof(call->is_float));
+
+    for (int i = 0; i < reg_collector.size; ++i) {
+        char *reg = reg_collector.names[i];
+        _Bool is_callee_saved = false;
+        for (int j = 0; j < CALLEE_SAVED_COUNT_64; ++j)
+            if (!strcmp(reg, callee_saved[j]))
+                is_callee_saved = true;
+
+        if (!reg_collector.available[i] && !is_callee_saved) {
+            fprintf(body_output, "        pushq   %s\n", reg);
+            call->saved[call->saved_count++] = reg;
+            push_depth++;
+        }
+    }
+
+    // all of the SSE registers are caller-saved
+    for (int i = 0; i < xmm_collector.size; ++i) {
+        if (!xmm_collector.available[i]) {
+            fprintf(body_output, "        subq    $8, %%rsp\n");
+            fprintf(body_output, "        movsd   %s, (%%rsp)\n", xmm_collector.names[i]);
+            call->saved[call->saved_count++] = xmm_collector.names[i];
+            push_depth++;
+        }
+    }
+
+    int stack_args = arg_count > ARG_REGISTER_COUNT ? arg_count - ARG_REGISTER_COUNT : 0;
+    call->padding = (push_depth + stack_args) % 2;
+    if (call->padding) {
+        fprintf(body_output, "        subq    $8, %%rsp\n");
+        push_depth++;
+    }
+}
+
+
+/**
+ * generateFloatArgCall - Generates the call of generateCall when some of
+ * the arguments are doubles. Those go in the %xmm registers, and use up
+ * their own argument registers, so the arguments left on the stack are
+ * not necessarily the last ones. 
+ * 
+ * The register arguments are loaded from their pushed slots, and then the
+ * stack arguments are copied down over them, into the order and the
+ * alignment that the callee expects. The slots are all popped after the call.
+ */
+static void generateFloatArgCall(struct PendingCall *call, Quad quad, FILE *body_output) {
+    int stack_args[MAX_CALL_ARGS];
+    int stack_count = 0, int_count = 0, float_count = 0;
+
+    for (int i = 0; i < call->arg_count; ++i) {
+        if (call->is_float[i] && float_count < FLOAT_ARG_REGISTER_COUNT)
+            fprintf(body_output, "        movsd   %d(%%rsp), %s\n", i*8, float_arg_registers[float_count++]);
+        else if (!call->is_float[i] && int_count < ARG_REGISTER_COUNT)
+            fprintf(body_output, "        movq    %d(%%rsp), %s\n", i*8, arg_registers[int_count++]);
+        else
+            stack_args[stack_count++] = i;
+    }
+
+    // the slots are already on the stack, the alignment can only be fixed under them
+    int realign = push_depth % 2;
+    if (realign)
+        fprintf(body_output, "        subq    $8, %%rsp\n");
+
+    /* the k'th stack argument's slot is never below k, so copying them in
+    order never overwrites one that is yet to be copied */
+    for (int k = 0; k < stack_count; ++k) {
+        int from = (stack_args[k] + realign)*8;
+        if (from == k*8)
+            continue;
+        fprintf(body_output, "        movq    %d(%%rsp), %%rax\n", from);
+        fprintf(body_output, "        movq    %%rax, %d(%%rsp)\n", k*8);
+    }
+
+    // a variadic callee reads the number of vector registers used from %al
+    fprintf(body_output, "        movl    $%d, %%eax\n", float_count);
+    fprintf(body_output, "        call    %s\n", node2assemb(quad.src1));
+
+    int stack_slots = call->arg_count + call->padding;
+    fprintf(body_output, "        addq    $%d, %%rsp\n", (stack_slots + realign)*8);
+    push_depth -= stack_slots;
+}
+
+
+/**
+ * generateCall - Generates the assembly of a call whose arguments were
+ * all pushed, last to first. The first six are popped into the argument
+ * registers, and the rest are already where the callee expects them.
+ */
+static void generateCall(Quad quad, FILE *body_output) {
+    struct PendingCall *call = &pending_calls[--pending_call_count];
+
+    if (call->float_count)
+        generateFloatArgCall(call, quad, body_output);
+    else {
+        int reg_args = call->arg_count < ARG_REGISTER_COUNT ? call->arg_count : ARG_REGISTER_COUNT;
+        for (int i = 0; i < reg_args; ++i)
+            fprintf(body_output, "        popq    %s\n", arg_registers[i]);
+        push_depth -= reg_args;
+
+        // a variadic callee reads the number of vector registers used from %al
+        fprintf(body_output, "        xorl    %%eax, %%eax\n");
+        fprintf(body_output, "        call    %s\n", node2assemb(quad.src1));
+
+        int stack_slots = call->arg_count - reg_args + call->padding;
+        if (stack_slots)
+            fprintf(body_output, "        addq    $%d, %%rsp\n", stack_slots*8);
+        push_depth -= stack_slots;
+    }
+
+    // a floating point value is returned in %xmm0
+    int float_type = calleeFloatType(quad.src1);
+    if (quad.result && float_type && quad.result->nodetype == REG_TYPE) {
+        if (strcmp(quad.result->reg_type.name, "%xmm0"))
+            fprintf(body_output, "        movaps  %%xmm0, %s\n", quad.result->reg_type.name);
+    }
+    else if (quad.result && float_type)
+        fprintf(body_output, "        mov%s   %%xmm0, %s\n", floatSuffix(float_type), node2assemb64(quad.result));
+    else if (quad.result)
+        storeOperand("%rax", quad.result, body_output);
+
+    for (int i = call->saved_count-1; i >= 0; --i) {
+        if (!strncmp(call->saved[i], "%xmm", strlen("%xmm"))) {
+            fprintf(body_output, "        movsd   (%%rsp), %s\n", call->saved[i]);
+            fprintf(body_output, "        addq    $8, %%rsp\n");
+        }
+        else
+            fprintf(body_output, "        popq    %s\n", call->saved[i]);
+    }
+    push_depth -= call->saved_count;
+}
+
+
+/**
+ * generateDivide - Generates a signed division of src1 by src2, storing
+ * the quotient (or the remainder for a modulo) into the result. The
+ * dividend has to be in %rdx:%rax, so those are saved when live. A
+ * constant divisor is multiplied by its magic number, in the same registers.
+ */
+static void generateDivide(Quad quad, _Bool is_modulo, FILE *body_output) {
+    char *result_reg = quad.result->nodetype == REG_TYPE ? quad.result->reg_type.name : "";
+    _Bool save_rax = isRegisterLive("%rax") && strcmp(result_reg, "%rax");
+    _Bool save_rdx = isRegisterLive("%rdx") && strcmp(result_reg, "%rdx");
+
+    if (save_rax)
+        fprintf(body_output, "        pushq   %%rax\n");
+    if (save_rdx)
+        fprintf(body_output, "        pushq   %%rdx\n");
+
+    /* a constant divisor is multiplied by its magic number instead, which
+    leaves the quotient in %rdx and the remainder in %rax */
+    long long divisor;
+    if (isIntConstant(quad.src2, &divisor) && isReducibleDivisor(divisor)) {
+        if (quad.src1->nodetype == REG_TYPE || isImmediate(quad.src1))
+            fprintf(body_output, "        pushq   %s\n", node2assemb64(quad.src1));
+        else {
+            loadOperand(quad.src1, "%rax", body_output);
+            fprintf(body_output, "        pushq   %%rax\n");
+        }
+        generateMagicDivide(divisor, is_modulo, 64, body_output);
+        storeOperand(is_modulo ? "%rax" : "%rdx", quad.result, body_output);
+        if (save_rdx)
+            fprintf(body_output, "        popq    %%rdx\n");
+        if (save_rax)
+            fprintf(body_output, "        popq    %%rax\n");
+        return;
+    }
+
+    // the divisor waits on the stack, as any free register could be %rax or %rdx
+    if (quad.src2->nodetype == REG_TYPE || isImmediate(quad.src2))
+        fprintf(body_output, "        pushq   %s\n", node2assemb64(quad.src2));
+    else {
+        loadOperand(quad.src2, "%rax", body_output);
+        fprintf(body_output, "        pushq   %%rax\n");
+    }
+
+    loadOperand(quad.src1, "%rax", body_output);
+    fprintf(body_output, "        cqto\n");
+    fprintf(body_output, "        idivq   (%%rsp)\n");
+    fprintf(body_output, "        addq    $8, %%rsp\n");
+
+    /* the result was given neither of the saved registers, so it
+    survives them being restored */
+    storeOperand(is_modulo ? "%rdx" : "%rax", quad.result, body_output);
+    if (save_rdx)
+        fprintf(body_output, "        popq    %%rdx\n");
+    if (save_rax)
+        fprintf(body_output, "        popq    %%rax\n");
+}
+
+
+/**
+ * instructorSelector64 - Looks at a quad and generates one or
+ * more x86-64 assembly instructions for it.
+ */
+void instructorSelector64(Quad quad, FILE *body_output, FILE *strlit_output) {
+
+    /* string literals are pooled into the mergeable string section, and
+    referred to relative to the instruction pointer */
+    if (quad.src1 && quad.src1->nodetype == STRLIT_TYPE) {
+        quad.src1->strlit.memlbl = getStrlitLabel(quad.src1->strlit.str, quad.src1->strlit.str_size);
+
+        astnode *tmp = getRegister(NULL);
+        fprintf(body_output, "        leaq    %s(%%rip), %s\n", quad.src1->strlit.memlbl, node2assemb64(tmp));
+        quad.src1 = tmp;
+    }
+    if (quad.src2 && quad.src2->nodetype == STRLIT_TYPE) {
+        quad.src2->strlit.memlbl = getStrlitLabel(quad.src2->strlit.str, quad.src2->strlit.str_size);
+
+        astnode *tmp = getRegister(NULL);
+        fprintf(body_output, "        leaq    %s(%%rip), %s\n", quad.src2->strlit.memlbl, node2assemb64(tmp));
+        quad.src2 = tmp;
+    }
+
+    getResultRegister(&quad);
+
+    astnode *work_tmp = NULL, *src_tmp = NULL;
+    long long const_val;
+
+    if (quad.opcode == MOVB || quad.opcode == MOVW ||
+            quad.opcode == MOVL || quad.opcode == MOVQ) {
+        if (quad.result->nodetype == REG_TYPE)
+            loadOperand(quad.src1, quad.result->reg_type.name, body_output);
+        else if (quad.src1->nodetype == REG_TYPE)
+            storeOperand(quad.src1->reg_type.name, quad.result, body_output);
+        else if (isImmediate(quad.src1)) {
+            int size = operandSize(quad.result);
+            fprintf(body_output, "        mov%s    %s, %s\n", sizeSuffix(size),
+                                        node2assemb64(quad.src1), node2assemb64(quad.result));
+        }
+        else {
+            char *work = workRegister(NULL, &work_tmp);
+            loadOperand(quad.src1, work, body_output);
+            storeOperand(work, quad.result, body_output);
+        }
+    }
+    else if ((quad.opcode == MULL || quad.opcode == MULQ) &&
+             ((isIntConstant(quad.src2, &const_val) && isImmediate(quad.src2)) ||
+              (isIntConstant(quad.src1, &const_val) && isImmediate(quad.src1)))) {
+        // multiplications by a constant become shifts and lea's where they can
+        astnode *factor = quad.src2->nodetype == NUM_TYPE && isImmediate(quad.src2) ? quad.src1 : quad.src2;
+        char *work = workRegister(quad.result, &work_tmp);
+        loadOperand(factor, work, body_output);
+        generateConstMultiply(work, const_val, 64, body_output);
+        storeOperand(work, quad.result, body_output);
+    }
+    else if (quad.opcode == ADDL || quad.opcode == ADDQ ||
+             quad.opcode == SUBL || quad.opcode == SUBQ ||
+             quad.opcode == MULL || quad.opcode == MULQ ||
+             quad.opcode == ANDL || quad.opcode == ANDQ ||
+             quad.opcode == ORL  || quad.opcode == ORQ  ||
+             quad.opcode == XORL || quad.opcode == XORQ) {
+        char *op;
+        switch (quad.opcode) {
+            case ADDL: case ADDQ: op = "addq "; break;
+            case SUBL: case SUBQ: op = "subq "; break;
+            case MULL: case MULQ: op = "imulq"; break;
+            case ANDL: case ANDQ: op = "andq "; break;
+            case ORL:  case ORQ:  op = "orq  "; break;
+            default:              op = "xorq "; break;
+        }
+
+        char *work = workRegister(quad.result, &work_tmp);
+        char *src2 = sourceOperand(quad.src2, &src_tmp, body_output);
+        loadOperand(quad.src1, work, body_output);
+        fprintf(body_output, "        %s   %s, %s\n", op, src2, work);
+        storeOperand(work, quad.result, body_output);
+    }
+    else if ((quad.opcode == DIVL || quad.opcode == DIVQ ||
+              quad.opcode == MODL || quad.opcode == MODQ) &&
+             isIntConstant(quad.src2, &const_val) && isPowerOfTwoDivisor(const_val) &&
+             isReducibleDivisor(const_val)) {
+        // dividing by a power of two is a shift
+        astnode *bias_tmp = getRegister(NULL);
+        char *work = workRegister(quad.result, &work_tmp);
+        loadOperand(quad.src1, work, body_output);
+        generatePow2Divide(work, bias_tmp->reg_type.name, const_val,
+                           quad.opcode == MODL || quad.opcode == MODQ, 64, body_output);
+        storeOperand(work, quad.result, body_output);
+        freeRegister(bias_tmp);
+    }
+    else if (quad.opcode == DIVL || quad.opcode == DIVQ) {
+        generateDivide(quad, false, body_output);
+    }
+    else if (quad.opcode == MODL || quad.opcode == MODQ) {
+        generateDivide(quad, true, body_output);
+    }
+    else if (quad.opcode == NEG || quad.opcode == COMPLL || quad.opcode == COMPLQ) {
+        char *work = workRegister(quad.result, &work_tmp);
+        loadOperand(quad.src1, work, body_output);
+        fprintf(body_output, "        %s    %s\n", quad.opcode == NEG ? "negq" : "notq", work);
+        storeOperand(work, quad.result, body_output);
+    }
+    else if (quad.opcode == LOG_NEG_EXPR) {
+        char *work = workRegister(quad.result, &work_tmp);
+        loadOperand(quad.src1, work, body_output);
+        fprintf(body_output, "        testq   %s, %s\n", work, work);
+        fprintf(body_output, "        sete    %s\n", subRegister(work, 1));
+        fprintf(body_output, "        movzbl  %s, %s\n", subRegister(work, 1), subRegister(work, 4));
+        storeOperand(work, quad.result, body_output);
+    }
+    else if (quad.opcode == RETURN) {
+        if (quad.src1) {
+            loadOperand(quad.src1, "%rax", body_output);
+            generateEpilogue64(body_output);
+        }
+    }
+    else if (quad.opcode == STORE) {
+        /* the quads do not carry the pointee's type yet, so as on the 32 bit
+        target a dereference accesses an int */
+        char *value = sourceOperand(quad.src1, &src_tmp, body_output);
+        if (src_tmp || quad.src1->nodetype == REG_TYPE)
+            value = subRegister(value, DATATYPE_INTEGER_SIZE);
+
+        char *addr = sourceOperand(quad.src2, &work_tmp, body_output);
+        fprintf(body_output, "        movl    %s, (%s)\n", value, addr);
+    }
+    else if (quad.opcode == LOAD) {
+        char *addr = sourceOperand(quad.src1, &src_tmp, body_output);
+        char *work = workRegister(quad.result, &work_tmp);
+        fprintf(body_output, "        movslq  (%s), %s\n", addr, work);
+        storeOperand(work, quad.result, body_output);
+    }
+    else if (quad.opcode == LEA) {
+        char *work = workRegister(quad.result, &work_tmp);
+        fprintf(body_output, "        leaq    %s, %s\n", node2assemb64(quad.src1), work);
+        storeOperand(work, quad.result, body_output);
+    }
+    else if (quad.opcode == ARGBEGIN) {
+        generateCallSetup(quad.src1->num.val, body_output);
+    }
+    else if (quad.opcode == ARG && isXmmRegister(quad.src2)) {
+        struct PendingCall *call = &pending_calls[pending_call_count-1];
+        call->is_float[quad.src1->num.val - 1] = true;
+        call->float_count++;
+
+        fprintf(body_output, "        subq    $8, %%rsp\n");
+        fprintf(body_output, "        movsd   %s, (%%rsp)\n", quad.src2->reg_type.name);
+        push_depth++;
+    }
+    else if (quad.opcode == ARG) {
+        if (quad.src2->nodetype == REG_TYPE || isImmediate(quad.src2))
+            fprintf(body_output, "        pushq   %s\n", node2assemb64(quad.src2));
+        else {
+            char *value = sourceOperand(quad.src2, &src_tmp, body_output);
+            fprintf(body_output, "        pushq   %s\n", value);
+        }
+        push_depth++;
+    }
+    else if (quad.opcode == CALL) {
+        generateCall(quad, body_output);
+    }
+    else if (quad.opcode == CMP) {
+        char *left = workRegister(quad.src1->nodetype == REG_TYPE ? quad.src1 : NULL, &work_tmp);
+        loadOperand(quad.src1, left, body_output);
+        char *right = sourceOperand(quad.src2, &src_tmp, body_output);
+        fprintf(body_output, "        cmpq    %s, %s\n", right, left);
+    }
+    else if (quad.opcode == BR) {
+        fprintf(body_output, "        jmp     %s\n", node2assemb(quad.src1));
+    }
+    else if (quad.opcode == CC_LT || quad.opcode == CC_GT ||
+            quad.opcode == CC_EQ || quad.opcode == CC_NEQ ||
+            quad.opcode == CC_GE || quad.opcode == CC_LE) {
+        char *set_op;
+        switch(quad.opcode) {
+            case CC_LT:  set_op = "setl "; break;
+            case CC_GT:  set_op = "setg "; break;
+            case CC_EQ:  set_op = "sete "; break;
+            case CC_NEQ: set_op = "setne"; break;
+            case CC_GE:  set_op = "setge"; break;
+            default:     set_op = "setle"; break;
+        }
+
+        char *work = workRegister(quad.result, &work_tmp);
+        fprintf(body_output, "        %s   %s\n", set_op, subRegister(work, 1));
+        fprintf(body_output, "        movzbl  %s, %s\n", subRegister(work, 1), subRegister(work, 4));
+        if (quad.result)
+            storeOperand(work, quad.result, body_output);
+    }
+    else if (isCondMove(quad.opcode)) {
+        char *cmov_op;
+        switch(quad.opcode) {
+            case CMOV_LT:  cmov_op = "cmovlq";  break;
+            case CMOV_GT:  cmov_op = "cmovgq";  break;
+            case CMOV_EQ:  cmov_op = "cmoveq";  break;
+            case CMOV_NEQ: cmov_op = "cmovneq"; break;
+            case CMOV_GE:  cmov_op = "cmovgeq"; break;
+            default:       cmov_op = "cmovleq"; break;
+        }
+
+        // cmov has no immediate form, and the moves leave the flags alone
+        char *work = workRegister(quad.result, &work_tmp);
+        char *picked;
+        if (quad.src1->nodetype == REG_TYPE)
+            picked = quad.src1->reg_type.name;
+        else {
+            src_tmp = getRegister(NULL);
+            picked = src_tmp->reg_type.name;
+            loadOperand(quad.src1, picked, body_output);
+        }
+
+        loadOperand(quad.src2, work, body_output);
+        fprintf(body_output, "        %-7s %s, %s\n", cmov_op, picked, work);
+        storeOperand(work, quad.result, body_output);
+    }
+
+    // stuff not worth implementing, same as on the 32 bit target
+    else if (quad.opcode == PLPL)   {}
+    else if (quad.opcode == MINMIN) {}
+    else if (quad.opcode == LOGO)   {}
+    else if (quad.opcode == LOGN)   {}
+    else if (quad.opcode == COMMA)  {}
+    else if (quad.opcode == SHL_OP) {}
+    else if (quad.opcode == SHR_OP) {}
+
+    freeRegister(work_tmp);
+    freeRegister(src_tmp);
+
+    // at every quad, attempt to free the temporary registers
+    freeRegister(quad.src1);
+    freeRegister(quad.src2);
+}
+
+
+/**
+ * node2assemb64 - Prints out the x86-64 assembly meaning of an ast node.
+ * Global variables are addressed relative to the instruction pointer, so
+ * that the output can be linked into a position independent executable.
+ */
+char *node2assemb64(astnode *node) {
+    if (node->nodetype == NUM_TYPE && (node->num.types & NUMMASK_INTGR)) {
+        char *str_val = malloc(sizeof(char)*32);
+        sprintf(str_val, "$%lld", (long long) node->num.val);
+        return str_val;
+    }
+    else if (node->nodetype == STABLE_VAR && node->stable_entry.var.storage_class == Extern) {
+        char *str_val = malloc(sizeof(char)*256);
+        sprintf(str_val, "%s(%%rip)", node->stable_entry.ident);
+        return str_val;
+    }
+    else if (node->nodetype == STABLE_VAR) {
+        char *str_val = malloc(sizeof(char)*32);
+        sprintf(str_val, "%d(%%rbp)", node->stable_entry.var.offset_within_stack_frame);
+        return str_val;
+    }
+    else if (node->nodetype == IDENT_TYPE) {
+        char *str_val = malloc(sizeof(char)*256);
+        sprintf(str_val, "%s(%%rip)", node->ident.str);
+        return str_val;
+    }
+
+    return node2assemb(node);
+}
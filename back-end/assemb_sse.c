@@ -0,0 +1,534 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * assemb_sse.c - Implements the floating point part of
+ * the code generator, ie the SSE2 functions declared at
+ * assemb_gen.h. They are shared by both targets.
+ *
+ * Floats and doubles are held in the SSE registers, whose
+ * nodes remember which of the two they hold. Floating point
+ * constants are placed in .rodata, as SSE2 instructions have
+ * no immediate operands.
+ *
+ * The vector quads of vectorized loops are translated here
+ * as well, into the packed integer SSE2 instructions.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#include "../front-end/front_end_header.h"
+#include "assemb_gen.h"
+#include "../front-end/parser/quads.h"
+#include "../front-end/parser/pheader_ast.h"
+#include "../front-end/lexer/lheader2.h"
+#include "./back_end_header.h"
+
+
+/**
+ * floatSuffix - Returns the SSE2 instruction suffix of a floating type.
+ */
+char *floatSuffix(int float_type) {
+    return float_type == Float ? "ss" : "sd";
+}
+
+
+/**
+ * calleeFloatType - Returns the floating type (Float or Double) that the
+ * called function returns, or Void when it returns an integer.
+ */
+int calleeFloatType(astnode *callee) {
+    if (callee->nodetype != STABLE_FNC_DECLARATOR &&
+        callee->nodetype != STABLE_FNC_DEFINITION)
+        return Void;
+    return typeFloatClass(callee->stable_entry.fnc.return_type);
+}
+
+
+/**
+ * quadFloatType - Returns the floating type that a floating point quad
+ * operates on. The conversions operate on their floating side.
+ */
+static int quadFloatType(enum QuadOpcode op) {
+    switch (op) {
+        case MOVSS: case ADDSS: case SUBSS: case MULSS: case DIVSS:
+        case NEGSS: case CVTSI2SS: case CVTTSS2SI: case CVTSS2SD: case UCOMISS:
+            return Float;
+        default:
+            return Double;
+    }
+}
+
+
+/**
+ * resultFloatType - Returns the floating type of a quad's result, or Void
+ * if the result is an integer.
+ */
+static int resultFloatType(Quad *quad) {
+    switch (quad->opcode) {
+        case CVTTSS2SI: case CVTTSD2SI:
+            return Void;
+        case CVTSS2SD:
+            return Double;
+        case CVTSD2SS:
+            return Float;
+        case CALL:
+            return calleeFloatType(quad->src1);
+        default:
+            return isFloatOpcode(quad->opcode) ? quadFloatType(quad->opcode) : Void;
+    }
+}
+
+
+/**
+ * getResultRegister - Gives the result of a quad a register of the class
+ * its value needs: an SSE register for floating point values, and a
+ * general purpose register otherwise.
+ */
+void getResultRegister(Quad *quad) {
+    if (!quad->result)
+        return;
+
+    int float_type = resultFloatType(quad);
+    if (isVectorOpcode(quad->opcode) && quad->opcode != VHADDD)
+        getXmmRegister(quad->result, Void);
+    else if (float_type)
+        getXmmRegister(quad->result, float_type);
+    else
+        getRegister(quad->result);
+}
+
+
+/**
+ * isSSEQuad - Returns whether a quad is translated by instructorSelectorSSE.
+ * That is every floating point quad, the setcc reading the flags of a
+ * floating point compare (the quad before it, prev), and the return of a
+ * floating point value, as well as the vector quads.
+ */
+_Bool isSSEQuad(Quad *quad, Quad *prev) {
+    if (isFloatOpcode(quad->opcode) || isVectorOpcode(quad->opcode))
+        return true;
+
+    if (quad->opcode == RETURN)
+        return isXmmRegister(quad->src1);
+
+    return prev && isFloatCompare(prev->opcode) && (
+            quad->opcode == CC_LT || quad->opcode == CC_GT ||
+            quad->opcode == CC_EQ || quad->opcode == CC_NEQ ||
+            quad->opcode == CC_GE || quad->opcode == CC_LE);
+}
+
+
+/**
+ * rodataOperand - Returns the operand that addresses a label in .rodata.
+ */
+static char *rodataOperand(char *label) {
+    char *str_val = malloc(sizeof(char)*32);
+    if (TARGET_IS_64)
+        sprintf(str_val, "%s(%%rip)", label);
+    else
+        sprintf(str_val, "%s", label);
+    return str_val;
+}
+
+
+/**
+ * floatConstant - Places a constant into .rodata as a float_type, and
+ * returns the operand that reads it.
+ */
+static char *floatConstant(astnode *node, int float_type, FILE *strlit_output) {
+    double val = node->num.types & NUMMASK_INTGR ? (double) (long long) node->num.val
+                                                 : node->num.d_val;
+    char *label = getStrlitName();
+
+    if (float_type == Float) {
+        float f_val = val;
+        unsigned int bits;
+        memcpy(&bits, &f_val, sizeof(bits));
+
+        fprintf(strlit_output, "        .align  4\n");
+        fprintf(strlit_output, "%s:\n", label);
+        fprintf(strlit_output, "        .long   %u\n", bits);
+    }
+    else {
+        unsigned long long bits;
+        memcpy(&bits, &val, sizeof(bits));
+
+        fprintf(strlit_output, "        .align  8\n");
+        fprintf(strlit_output, "%s:\n", label);
+        fprintf(strlit_output, "        .long   %u\n", (unsigned int) bits);
+        fprintf(strlit_output, "        .long   %u\n", (unsigned int) (bits >> 32));
+    }
+    return rodataOperand(label);
+}
+
+
+/**
+ * signMask - Places the 16 byte mask of the sign bits of a float_type
+ * vector into .rodata, and returns the operand that reads it.
+ */
+static char *signMask(int float_type, FILE *strlit_output) {
+    char *label = getStrlitName();
+
+    fprintf(strlit_output, "        .align  16\n");
+    fprintf(strlit_output, "%s:\n", label);
+    for (int i = 0; i < 4; ++i) {
+        if (float_type == Float || i % 2)
+            fprintf(strlit_output, "        .long   %u\n", 0x80000000u);
+        else
+            fprintf(strlit_output, "        .long   0\n");
+    }
+    return rodataOperand(label);
+}
+
+
+/**
+ * floatOperand - Returns an operand that an SSE2 instruction can read a
+ * float_type value from: its register, a variable, or a constant in .rodata.
+ */
+static char *floatOperand(astnode *node, int float_type, FILE *strlit_output) {
+    if (node->nodetype == NUM_TYPE)
+        return floatConstant(node, float_type, strlit_output);
+    return TARGET_IS_64 ? node2assemb64(node) : node2assemb(node);
+}
+
+
+/**
+ * loadFloat - Generates the assembly that loads a float_type operand
+ * into the SSE register reg.
+ */
+static void loadFloat(astnode *src, char *reg, int float_type, FILE *body_output, FILE *strlit_output) {
+    if (src->nodetype == REG_TYPE) {
+        if (strcmp(src->reg_type.name, reg))
+            fprintf(body_output, "        movaps  %s, %s\n", src->reg_type.name, reg);
+    }
+    else
+        fprintf(body_output, "        mov%s   %s, %s\n", floatSuffix(float_type),
+                                    floatOperand(src, float_type, strlit_output), reg);
+}
+
+
+/**
+ * storeFloat - Generates the assembly that stores the SSE register reg
+ * into the float_type operand des.
+ */
+static void storeFloat(char *reg, astnode *des, int float_type, FILE *body_output) {
+    if (des->nodetype == REG_TYPE) {
+        if (strcmp(des->reg_type.name, reg))
+            fprintf(body_output, "        movaps  %s, %s\n", reg, des->reg_type.name);
+    }
+    else
+        fprintf(body_output, "        mov%s   %s, %s\n", floatSuffix(float_type), reg,
+                                    TARGET_IS_64 ? node2assemb64(des) : node2assemb(des));
+}
+
+
+/**
+ * workXmm - Returns the SSE register a quad computes its result in, which
+ * is the result itself when it was given a register. Otherwise a temporary
+ * is stored in tmp, for the caller to free.
+ */
+static char *workXmm(astnode *result, int float_type, astnode **tmp) {
+    *tmp = NULL;
+    if (result && result->nodetype == REG_TYPE)
+        return result->reg_type.name;
+
+    *tmp = getXmmRegister(NULL, float_type);
+    return (*tmp)->reg_type.name;
+}
+
+
+/**
+ * floatSetcc - Generates the assembly that sets the result to whether the
+ * flags of a floating point compare hold the condition of the setcc quad.
+ *
+ * The compare sets the flags like an unsigned compare does, plus the
+ * parity flag for the unordered result of a NaN operand. As testing two
+ * conditions takes two setcc's and the 32 bit target has no byte register
+ * for %esi and %edi, the result is built with cmov instead.
+ */
+static void floatSetcc(Quad quad, FILE *body_output) {
+    char *sfx = TARGET_IS_64 ? "q" : "l";
+    char *cond;
+    switch (quad.opcode) {
+        case CC_GT:  cond = "a";  break;
+        case CC_GE:  cond = "ae"; break;
+        case CC_LT:  cond = "b";  break;
+        case CC_LE:  cond = "be"; break;
+        case CC_EQ:  cond = "e";  break;
+        default:     cond = "ne"; break;
+    }
+
+    char *result = quad.result->reg_type.name;
+    astnode *one = getRegister(NULL);
+
+    // mov leaves the flags alone, unlike xor
+    fprintf(body_output, "        mov%s    $0, %s\n", sfx, result);
+    fprintf(body_output, "        mov%s    $1, %s\n", sfx, one->reg_type.name);
+    fprintf(body_output, "        cmov%-3s %s, %s\n", cond, one->reg_type.name, result);
+
+    // unordered compares equal to nothing, and unequal to everything
+    if (quad.opcode == CC_EQ) {
+        fprintf(body_output, "        mov%s    $0, %s\n", sfx, one->reg_type.name);
+        fprintf(body_output, "        cmovp   %s, %s\n", one->reg_type.name, result);
+    }
+    else if (quad.opcode == CC_NEQ)
+        fprintf(body_output, "        cmovp   %s, %s\n", one->reg_type.name, result);
+
+    freeRegister(one);
+}
+
+
+/**
+ * floatReturn - Generates the return of the floating point value in an
+ * SSE register. x86-64 returns it in %xmm0, while 32 bit x86 returns it
+ * on top of the x87 stack, which is only reached through memory.
+ */
+static void floatReturn(astnode *value, FILE *body_output) {
+    int float_type = value->reg_type.float_type;
+
+    if (TARGET_IS_64) {
+        if (strcmp(value->reg_type.name, "%xmm0"))
+            fprintf(body_output, "        movaps  %s, %%xmm0\n", value->reg_type.name);
+    }
+    else {
+        fprintf(body_output, "        subl    $8, %%esp\n");
+        fprintf(body_output, "        mov%s   %s, (%%esp)\n", floatSuffix(float_type), value->reg_type.name);
+        fprintf(body_output, "        fld%s    (%%esp)\n", float_type == Float ? "s" : "l");
+    }
+    generateEpilogue(body_output);
+}
+
+
+/**
+ * vectorOperand - Returns the operand of the 4 ints that a vector load or
+ * store accesses: at the address in a register, or in a vector variable.
+ */
+static char *vectorOperand(astnode *addr) {
+    if (addr->nodetype != REG_TYPE)
+        return TARGET_IS_64 ? node2assemb64(addr) : node2assemb(addr);
+
+    char *str_val = malloc(sizeof(char)*32);
+    sprintf(str_val, "(%s)", addr->reg_type.name);
+    return str_val;
+}
+
+
+/**
+ * vectorConstant - Places 4 copies of an int constant into .rodata, 16
+ * byte aligned, and returns the operand that reads them.
+ */
+static char *vectorConstant(astnode *node, FILE *strlit_output) {
+    char *label = getStrlitName();
+
+    fprintf(strlit_output, "        .align  16\n");
+    fprintf(strlit_output, "%s:\n", label);
+    for (int i = 0; i < 4; ++i)
+        fprintf(strlit_output, "        .long   %u\n", (unsigned int) node->num.val);
+    return rodataOperand(label);
+}
+
+
+/**
+ * vectorMultiply - Generates the multiplication of the 4 ints of the SSE
+ * register work by those of src. SSE2 only multiplies the even ints into
+ * 64 bit products (pmuludq), so without SSE4.1's pmulld the odd ints are
+ * shuffled into even places and multiplied separately, and the low halves
+ * of the products are put back together.
+ */
+static void vectorMultiply(char *work, char *src, FILE *body_output) {
+    if (be_flags.sse41) {
+        fprintf(body_output, "        pmulld  %s, %s\n", src, work);
+        return;
+    }
+
+    astnode *odd = getXmmRegister(NULL, Void), *src_odd = getXmmRegister(NULL, Void);
+    char *odd_reg = odd->reg_type.name, *src_odd_reg = src_odd->reg_type.name;
+
+    fprintf(body_output, "        pshufd  $0xf5, %s, %s\n", work, odd_reg);
+    fprintf(body_output, "        pmuludq %s, %s\n", src, work);
+    fprintf(body_output, "        pshufd  $0xf5, %s, %s\n", src, src_odd_reg);
+    fprintf(body_output, "        pmuludq %s, %s\n", src_odd_reg, odd_reg);
+    fprintf(body_output, "        pshufd  $0x08, %s, %s\n", work, work);
+    fprintf(body_output, "        pshufd  $0x08, %s, %s\n", odd_reg, odd_reg);
+    fprintf(body_output, "        punpckldq %s, %s\n", odd_reg, work);
+
+    freeRegister(odd);
+    freeRegister(src_odd);
+}
+
+
+/**
+ * vectorSelector - Generates the packed SSE2 instructions of a vector quad.
+ */
+static void vectorSelector(Quad quad, FILE *body_output, FILE *strlit_output) {
+    char *result = quad.result && quad.result->nodetype == REG_TYPE ? quad.result->reg_type.name : NULL;
+    char *mnemonic;
+
+    switch (quad.opcode) {
+        case VLOADU: case VLOADA:
+            fprintf(body_output, "        %s  %s, %s\n", quad.opcode == VLOADA ? "movdqa" : "movdqu",
+                                    vectorOperand(quad.src1), result);
+            break;
+
+        case VSTOREU: case VSTOREA:
+            fprintf(body_output, "        %s  %s, %s\n", quad.opcode == VSTOREA ? "movdqa" : "movdqu",
+                                    quad.src1->reg_type.name, vectorOperand(quad.src2));
+            break;
+
+        case VZERO:
+            fprintf(body_output, "        pxor    %s, %s\n", result, result);
+            break;
+
+        case VSPLAT:
+            if (quad.src1->nodetype == NUM_TYPE) {
+                fprintf(body_output, "        movdqa  %s, %s\n", vectorConstant(quad.src1, strlit_output), result);
+                break;
+            }
+            fprintf(body_output, "        movd    %s, %s\n",
+                                    TARGET_IS_64 ? node2assemb64(quad.src1) : node2assemb(quad.src1), result);
+            fprintf(body_output, "        pshufd  $0, %s, %s\n", result, result);
+            break;
+
+        case VHADDD: {
+            /* add the high half onto the low half, and then the odd int onto
+            the even one, which leaves the sum in the two lowest ints */
+            char *vec = quad.src1->reg_type.name;
+            astnode *tmp = getXmmRegister(NULL, Void);
+
+            fprintf(body_output, "        pshufd  $0x4e, %s, %s\n", vec, tmp->reg_type.name);
+            fprintf(body_output, "        paddd   %s, %s\n", tmp->reg_type.name, vec);
+            fprintf(body_output, "        pshufd  $0xb1, %s, %s\n", vec, tmp->reg_type.name);
+            fprintf(body_output, "        paddd   %s, %s\n", tmp->reg_type.name, vec);
+            if (TARGET_IS_64) {
+                fprintf(body_output, "        movq    %s, %s\n", vec, result);
+                fprintf(body_output, "        sarq    $32, %s\n", result);
+            }
+            else
+                fprintf(body_output, "        movd    %s, %s\n", vec, result);
+            freeRegister(tmp);
+            break;
+        }
+
+        default:
+            if (strcmp(quad.src1->reg_type.name, result))
+                fprintf(body_output, "        movdqa  %s, %s\n", quad.src1->reg_type.name, result);
+
+            if (quad.opcode == VMULD) {
+                vectorMultiply(result, quad.src2->reg_type.name, body_output);
+                break;
+            }
+
+            switch (quad.opcode) {
+                case VADDD: mnemonic = "paddd"; break;
+                case VSUBD: mnemonic = "psubd"; break;
+                case VANDD: mnemonic = "pand "; break;
+                case VORD:  mnemonic = "por  "; break;
+                default:    mnemonic = "pxor "; break;
+            }
+            fprintf(body_output, "        %s   %s, %s\n", mnemonic, quad.src2->reg_type.name, result);
+            break;
+    }
+}
+
+
+/**
+ * instructorSelectorSSE - Looks at a floating point quad and generates one
+ * or more SSE2 instructions for it. Constants are placed in .rodata.
+ */
+void instructorSelectorSSE(Quad quad, FILE *body_output, FILE *strlit_output) {
+    getResultRegister(&quad);
+
+    if (isVectorOpcode(quad.opcode)) {
+        vectorSelector(quad, body_output, strlit_output);
+        freeRegister(quad.src1);
+        freeRegister(quad.src2);
+        return;
+    }
+
+    int float_type = quadFloatType(quad.opcode);
+    char *sfx = floatSuffix(float_type);
+    char mnemonic[16];
+    astnode *work_tmp = NULL, *src_tmp = NULL;
+
+    if (quad.opcode == MOVSS || quad.opcode == MOVSD) {
+        if (quad.result->nodetype == REG_TYPE)
+            loadFloat(quad.src1, quad.result->reg_type.name, float_type, body_output, strlit_output);
+        else {
+            char *work = quad.src1->nodetype == REG_TYPE ? quad.src1->reg_type.name
+                                                         : workXmm(NULL, float_type, &work_tmp);
+            loadFloat(quad.src1, work, float_type, body_output, strlit_output);
+            storeFloat(work, quad.result, float_type, body_output);
+        }
+    }
+    else if (quad.opcode == ADDSS || quad.opcode == ADDSD ||
+             quad.opcode == SUBSS || quad.opcode == SUBSD ||
+             quad.opcode == MULSS || quad.opcode == MULSD ||
+             quad.opcode == DIVSS || quad.opcode == DIVSD) {
+        switch (quad.opcode) {
+            case ADDSS: case ADDSD: sprintf(mnemonic, "add%s", sfx); break;
+            case SUBSS: case SUBSD: sprintf(mnemonic, "sub%s", sfx); break;
+            case MULSS: case MULSD: sprintf(mnemonic, "mul%s", sfx); break;
+            default:                sprintf(mnemonic, "div%s", sfx); break;
+        }
+
+        char *work = workXmm(quad.result, float_type, &work_tmp);
+        loadFloat(quad.src1, work, float_type, body_output, strlit_output);
+        fprintf(body_output, "        %-7s %s, %s\n", mnemonic,
+                                floatOperand(quad.src2, float_type, strlit_output), work);
+        storeFloat(work, quad.result, float_type, body_output);
+    }
+    else if (quad.opcode == NEGSS || quad.opcode == NEGSD) {
+        char *work = workXmm(quad.result, float_type, &work_tmp);
+        loadFloat(quad.src1, work, float_type, body_output, strlit_output);
+        fprintf(body_output, "        xorp%s   %s, %s\n", float_type == Float ? "s" : "d",
+                                signMask(float_type, strlit_output), work);
+        storeFloat(work, quad.result, float_type, body_output);
+    }
+    else if (quad.opcode == CVTSI2SS || quad.opcode == CVTSI2SD) {
+        char *work = workXmm(quad.result, float_type, &work_tmp);
+
+        // cvtsi2s? only writes the low element, so clear the rest to break the dependency
+        fprintf(body_output, "        pxor    %s, %s\n", work, work);
+        fprintf(body_output, "        cvtsi2%s%s %s, %s\n", sfx, TARGET_IS_64 ? "q" : "l",
+                                quad.src1->reg_type.name, work);
+        storeFloat(work, quad.result, float_type, body_output);
+    }
+    else if (quad.opcode == CVTTSS2SI || quad.opcode == CVTTSD2SI) {
+        /* the front end converts into temporaries, which are registers.
+        Truncating towards zero is what C's conversion does */
+        sprintf(mnemonic, "cvtt%s2si", sfx);
+        fprintf(body_output, "        %-9s %s, %s\n", mnemonic,
+                                floatOperand(quad.src1, float_type, strlit_output), quad.result->reg_type.name);
+    }
+    else if (quad.opcode == CVTSS2SD || quad.opcode == CVTSD2SS) {
+        int result_type = float_type == Float ? Double : Float;
+        char *work = workXmm(quad.result, result_type, &work_tmp);
+        fprintf(body_output, "        cvt%s2%s %s, %s\n", sfx, floatSuffix(result_type),
+                                floatOperand(quad.src1, float_type, strlit_output), work);
+        storeFloat(work, quad.result, result_type, body_output);
+    }
+    else if (quad.opcode == UCOMISS || quad.opcode == UCOMISD) {
+        char *left = workXmm(quad.src1->nodetype == REG_TYPE ? quad.src1 : NULL, float_type, &src_tmp);
+        loadFloat(quad.src1, left, float_type, body_output, strlit_output);
+        fprintf(body_output, "        ucomi%s %s, %s\n", sfx,
+                                floatOperand(quad.src2, float_type, strlit_output), left);
+    }
+    else if (quad.opcode == RETURN) {
+        floatReturn(quad.src1, body_output);
+    }
+    else    /* a setcc of a floating point compare */
+        floatSetcc(quad, body_output);
+
+    freeRegister(work_tmp);
+    freeRegister(src_tmp);
+
+    // at every quad, attempt to free the temporary registers
+    freeRegister(quad.src1);
+    freeRegister(quad.src2);
+}
@@ -15,24 +15,47 @@
 #include "back_end_header.h"
 #include "../front-end/front_end_header.h"
 #include "../front-end/parser/pheader_ast.h"
+#include "./schedule.h"
 
 
-/* initialize the global registerCollection struct */
+/* initialize the global registerCollection structs with the general
+purpose and SSE registers of the target picked by the -m32/-m64 flags */
 void initializeRegisterCollection() {
-    reg_collector.size = 6;
-    reg_collector.names = malloc(sizeof(char *)*reg_collector.size);
-    reg_collector.available = malloc(sizeof(_Bool)*reg_collector.size);
+    static char *names_32[] = {"%eax", "%ebx", "%ecx", "%edx", "%edi", "%esi", "%ebp"};
 
-    reg_collector.names[0] = "%eax";
-    reg_collector.names[1] = "%ebx";
-    reg_collector.names[2] = "%ecx";
-    reg_collector.names[3] = "%edx";
-    reg_collector.names[4] = "%edi";
-    reg_collector.names[5] = "%esi";
-    // reg_collector.names[6] = "es";  /* only a 16 bit register */
+    /* the caller-saved registers come first, so that the callee-saved
+    ones are only handed out when an expression needs that many */
+    static char *names_64[] = {"%rax", "%rcx", "%rdx", "%rsi", "%rdi", "%r8", "%r9",
+                               "%r10", "%r11", "%rbx", "%r12", "%r13", "%r14", "%r15"};
 
-    for (int i = 0; i < reg_collector.size; ++i)
+    if (TARGET_IS_64) {
+        reg_collector.size = sizeof(names_64)/sizeof(char *);
+        reg_collector.names = names_64;
+    }
+    else {
+        /* %ebp, the last of them, is only free without a frame pointer */
+        reg_collector.size = sizeof(names_32)/sizeof(char *) - (OMIT_FRAME_POINTER ? 0 : 1);
+        reg_collector.names = names_32;
+    }
+    reg_collector.available = malloc(sizeof(_Bool)*reg_collector.size);
+    reg_collector.used = malloc(sizeof(_Bool)*reg_collector.size);
+
+    for (int i = 0; i < reg_collector.size; ++i) {
         reg_collector.available[i] = true;
+        reg_collector.used[i] = false;
+    }
+
+    /* every SSE register is caller-saved, and x86-64 has twice as many */
+    static char *xmm_names[] = {"%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm4", "%xmm5", 
+                                "%xmm6", "%xmm7", "%xmm8", "%xmm9", "%xmm10", "%xmm11",
+                                "%xmm12", "%xmm13", "%xmm14", "%xmm15"};
+
+    xmm_collector.size = TARGET_IS_64 ? 16 : 8;
+    xmm_collector.names = xmm_names;
+    xmm_collector.available = malloc(sizeof(_Bool)*xmm_collector.size);
+
+    for (int i = 0; i < xmm_collector.size; ++i)
+        xmm_collector.available[i] = true;
 }
 
 /**
@@ -48,10 +71,12 @@ astnode *getRegister(astnode *node) {
     for (int i = 0; i < reg_collector.size; ++i) {
         if (reg_collector.available[i] == true) {
             reg_collector.available[i] = false;
+            reg_collector.used[i] = true;
             
             if (node) {
                 node->nodetype = REG_TYPE;
                 node->reg_type.name = reg_collector.names[i];
+                node->reg_type.float_type = Void;
                 return node; 
             }
             else
@@ -62,6 +87,41 @@ astnode *getRegister(astnode *node) {
 }
 
 
+/**
+ * getXmmRegister - Gets a free SSE register from the collection for a
+ * value of the floating type float_type (Float or Double).
+ */
+astnode *getXmmRegister(astnode *node, int float_type) {
+    if (node && (
+            node->nodetype == REG_TYPE || 
+            node->nodetype == STABLE_VAR) )
+        return node;
+
+    for (int i = 0; i < xmm_collector.size; ++i) {
+        if (xmm_collector.available[i] == true) {
+            xmm_collector.available[i] = false;
+
+            if (!node)
+                node = newNode_reg(xmm_collector.names[i]);
+            node->nodetype = REG_TYPE;
+            node->reg_type.name = xmm_collector.names[i];
+            node->reg_type.float_type = float_type;
+            return node;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * isXmmRegister - Returns whether a node was given an SSE register.
+ */
+_Bool isXmmRegister(astnode *node) {
+    return node && node->nodetype == REG_TYPE && 
+           !strncmp(node->reg_type.name, "%xmm", strlen("%xmm"));
+}
+
+
 /**
  * freeReigster - Frees up a register from the register Collection
  * struct that was previously taken.
@@ -72,18 +132,100 @@ void freeRegister(astnode *node) {
 
     char *name = node->reg_type.name;
 
-    if (!strcmp(name, "%eax"))
-        reg_collector.available[0] = true;
-    else if (!strcmp(name, "%ebx"))
-        reg_collector.available[1] = true;
-    else if (!strcmp(name, "%ecx"))
-        reg_collector.available[2] = true;
-    else if (!strcmp(name, "%edx"))
-        reg_collector.available[3] = true;        
-    else if (!strcmp(name, "%edi"))
-        reg_collector.available[4] = true;
-    else if (!strcmp(name, "%esi"))
-        reg_collector.available[5] = true;
-    // else if (!strcmp(name, "es"))
-    //     reg_collector.available[6] = true;   
+    for (int i = 0; i < reg_collector.size; ++i) {
+        if (!strcmp(name, reg_collector.names[i])) {
+            reg_collector.available[i] = true;
+            return;
+        }
+    }
+
+    for (int i = 0; i < xmm_collector.size; ++i) {
+        if (!strcmp(name, xmm_collector.names[i])) {
+            xmm_collector.available[i] = true;
+            return;
+        }
+    }
+}
+
+
+/**
+ * isRegisterLive - Returns whether a general purpose register
+ * is currently handed out.
+ */
+_Bool isRegisterLive(char *reg) {
+    for (int i = 0; i < reg_collector.size; ++i)
+        if (!strcmp(reg_collector.names[i], reg))
+            return !reg_collector.available[i];
+    return false;
+}
+
+
+/**
+ * resetUsedRegisters - Forgets which general purpose registers were handed
+ * out, at the start of a function.
+ */
+void resetUsedRegisters() {
+    for (int i = 0; i < reg_collector.size; ++i)
+        reg_collector.used[i] = false;
+}
+
+
+/**
+ * wasRegisterUsed - Returns whether a general purpose register was handed
+ * out since the last resetUsedRegisters.
+ */
+_Bool wasRegisterUsed(char *reg) {
+    for (int i = 0; i < reg_collector.size; ++i)
+        if (!strcmp(reg_collector.names[i], reg))
+            return reg_collector.used[i];
+    return false;
+}
+
+
+/**
+ * parseBackEndFlag - Parses a single back-end command line flag (such as
+ * -fprofile-use=file or -m64) into the global BackEndFlags struct. Returns false
+ * if the flag is not one that the back-end knows.
+ */
+_Bool parseBackEndFlag(char *flag) {
+    if (!strcmp(flag, "-fprofile-generate")) {
+        be_flags.profile_mode = PROFILE_GENERATE;
+        be_flags.profile_file = DEFAULT_PROFILE_FILE;
+    }
+    else if (!strncmp(flag, "-fprofile-generate=", strlen("-fprofile-generate="))) {
+        be_flags.profile_mode = PROFILE_GENERATE;
+        be_flags.profile_file = flag + strlen("-fprofile-generate=");
+    }
+    else if (!strcmp(flag, "-fprofile-use")) {
+        be_flags.profile_mode = PROFILE_USE;
+        be_flags.profile_file = DEFAULT_PROFILE_FILE;
+    }
+    else if (!strncmp(flag, "-fprofile-use=", strlen("-fprofile-use="))) {
+        be_flags.profile_mode = PROFILE_USE;
+        be_flags.profile_file = flag + strlen("-fprofile-use=");
+    }
+    else if (!strcmp(flag, "-m32"))
+        be_flags.target = TARGET_X86_32;
+    else if (!strcmp(flag, "-m64"))
+        be_flags.target = TARGET_X86_64;
+    else if (!strcmp(flag, "-ftree-vectorize"))
+        be_flags.vectorize = true;
+    else if (!strcmp(flag, "-msse4.1"))
+        be_flags.sse41 = true;
+    else if (!strcmp(flag, "-fschedule-insns"))
+        be_flags.schedule = true;
+    else if (!strncmp(flag, "-mtune=", strlen("-mtune=")) && lookupTuning(flag + strlen("-mtune=")) >= 0)
+        be_flags.tuning = lookupTuning(flag + strlen("-mtune="));
+    else if (!strcmp(flag, "-fif-conversion"))
+        be_flags.if_conversion = true;
+    else if (!strcmp(flag, "-fomit-frame-pointer"))
+        be_flags.omit_frame_pointer = true;
+    else if (!strcmp(flag, "-maccumulate-outgoing-args"))
+        be_flags.accumulate_args = true;
+    else if (!strcmp(flag, "-fno-builtin"))
+        be_flags.no_builtin = true;
+    else
+        return false;
+
+    return true;
 }
\ No newline at end of file
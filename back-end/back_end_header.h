@@ -26,15 +26,18 @@ and will be used once. Therefore in the instructor selector we will
 free each register quad source. */ 
 
 /* a struct holding the names of all regsiters, how many there
-are, and if they are available or not. */
+are, if they are available or not, and (for the general purpose
+ones) if they were handed out since the start of the current function. */
 typedef struct registerCollection {
     int size;
     char **names;
     _Bool *available;
+    _Bool *used;
 } registerCollection;
 
 
-/* initialize the global registerCollection struct */
+/* initialize the global registerCollection structs with the general
+purpose and SSE registers of the target picked by the -m32/-m64 flags */
 void initializeRegisterCollection();
 
 
@@ -45,6 +48,19 @@ void initializeRegisterCollection();
 struct astnode *getRegister(struct astnode *node);
 
 
+/**
+ * getXmmRegister - Gets a free SSE register from the collection for a
+ * value of the floating type float_type (Float or Double).
+ */
+struct astnode *getXmmRegister(struct astnode *node, int float_type);
+
+
+/**
+ * isXmmRegister - Returns whether a node was given an SSE register.
+ */
+_Bool isXmmRegister(struct astnode *node);
+
+
 /**
  * freeReigster - Frees up a register from the register Collection
  * struct that was previously taken.
@@ -52,7 +68,78 @@ struct astnode *getRegister(struct astnode *node);
 void freeRegister(struct astnode *name);
 
 
+/**
+ * isRegisterLive - Returns whether a general purpose register
+ * is currently handed out.
+ */
+_Bool isRegisterLive(char *reg);
+
+
+/**
+ * resetUsedRegisters - Forgets which general purpose registers were handed
+ * out, at the start of a function.
+ */
+void resetUsedRegisters();
+
+
+/**
+ * wasRegisterUsed - Returns whether a general purpose register was handed
+ * out since the last resetUsedRegisters.
+ */
+_Bool wasRegisterUsed(char *reg);
+
+
 EXTERN_VAR registerCollection reg_collector;    /* global register collection */
+EXTERN_VAR registerCollection xmm_collector;    /* global SSE register collection */
+
+
+/******* COMMAND LINE FLAGS ********/
+/* Profile-guided optimization happens over two compiles: an instrumented
+build counts how many times each basic block runs and dumps the counts
+when the program exits, and a later build reads the counts back in. */
+enum ProfileMode { NO_PROFILE = 0, PROFILE_GENERATE, PROFILE_USE };
+
+#define DEFAULT_PROFILE_FILE "guycc.prof"
+
+/* The architecture the assembly is generated for. 32 bit x86 is the
+default, and -m64 switches to x86-64 with the System V calling convention. */
+enum TargetArch { TARGET_X86_32 = 0, TARGET_X86_64 };
+
+#define TARGET_IS_64 (be_flags.target == TARGET_X86_64)
+
+/* whether the 32 bit functions address their locals off %esp, leaving
+%ebp free to be allocated. x86-64 always keeps its frame pointer. */
+#define OMIT_FRAME_POINTER (be_flags.omit_frame_pointer && !TARGET_IS_64)
+
+/* what the locals are addressed relative to, when the frame pointer is
+omitted, until generateFramelessBody rewrites them relative to %esp */
+#define FRAME_PLACEHOLDER "%fp"
+
+/* the flags given to the compiler that change the generated code */
+typedef struct BackEndFlags {
+    enum ProfileMode profile_mode;
+    char *profile_file;         /* file the profile is written to/read from */
+    enum TargetArch target;
+    _Bool vectorize;            /* -ftree-vectorize: vectorize simple loops */
+    _Bool sse41;                /* -msse4.1: SSE4.1 instructions may be used */
+    _Bool schedule;             /* -fschedule-insns: list schedule each block */
+    int tuning;                 /* -mtune=name: the latencies scheduled for */
+    _Bool if_conversion;        /* -fif-conversion: cmov instead of branches */
+    _Bool omit_frame_pointer;   /* -fomit-frame-pointer: %ebp is allocatable */
+    _Bool accumulate_args;      /* -maccumulate-outgoing-args: movl, not pushl, arguments */
+    _Bool no_builtin;           /* -fno-builtin: memcpy and memset are always called */
+} BackEndFlags;
+
+
+/**
+ * parseBackEndFlag - Parses a single back-end command line flag (such as
+ * -fprofile-use=file or -m64) into the global BackEndFlags struct. Returns false
+ * if the flag is not one that the back-end knows.
+ */
+_Bool parseBackEndFlag(char *flag);
+
+
+EXTERN_VAR BackEndFlags be_flags;               /* global back-end flags */
 
 
 
@@ -0,0 +1,363 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * block_layout.c - Implements the functions associated with
+ * basic block placement, ie the functions declared at
+ * block_layout.h.
+ *
+ * Every function of the block placement works on the array of
+ * blocks returned by collectBasicBlocks, so that blocks can be
+ * referred to by their index member.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../front-end/front_end_header.h"
+#include "../front-end/parser/quads.h"
+#include "./block_layout.h"
+
+
+/* functions that never return, calls to which mark a block as cold */
+static char *noreturn_fncs[] = {"exit", "_exit", "abort", "__assert_fail", NULL};
+
+
+/**
+ * markBackEdges - Depth-first search from the block at index ind, marking
+ * every edge into a block that is still on the search stack as a back edge.
+ */
+static void markBackEdges(BasicBlock **blocks, int ind, char *state, _Bool *back_edge) {
+    BasicBlock *succs[MAX_SUCCESSORS];
+    int succ_count = getSuccessors(blocks[ind], succs, MAX_SUCCESSORS);
+
+    state[ind] = 1;     /* on the search stack */
+    for (int i = 0; i < succ_count; ++i) {
+        int succ_ind = succs[i]->index;
+        if (state[succ_ind] == 1)
+            back_edge[ind*MAX_SUCCESSORS + i] = true;
+        else if (state[succ_ind] == 0)
+            markBackEdges(blocks, succ_ind, state, back_edge);
+    }
+    state[ind] = 2;     /* done */
+}
+
+
+/**
+ * findLoops - Finds the natural loops of the function whose blocks are
+ * in the array blocks (as returned by collectBasicBlocks), marking each
+ * loop header and the loop depth of each block. The back edges are
+ * marked in back_edge, at index from*MAX_SUCCESSORS + successor index.
+ */
+void findLoops(BasicBlock **blocks, int count, _Bool *back_edge) {
+    char *state = calloc(count, sizeof(char));
+    memset(back_edge, 0, sizeof(_Bool)*count*MAX_SUCCESSORS);
+    markBackEdges(blocks, 0, state, back_edge);
+    free(state);
+
+    // predecessor lists, to walk a loop body up from its back edges
+    int *pred_count = calloc(count, sizeof(int));
+    BasicBlock ***preds = malloc(sizeof(BasicBlock **)*count);
+    BasicBlock *succs[MAX_SUCCESSORS];
+    for (int i = 0; i < count; ++i) {
+        blocks[i]->loop_depth = 0;
+        blocks[i]->loop_header = false;
+        int succ_count = getSuccessors(blocks[i], succs, MAX_SUCCESSORS);
+        for (int j = 0; j < succ_count; ++j)
+            pred_count[succs[j]->index]++;
+    }
+    for (int i = 0; i < count; ++i) {
+        preds[i] = malloc(sizeof(BasicBlock *)*(pred_count[i] + 1));
+        pred_count[i] = 0;
+    }
+    for (int i = 0; i < count; ++i) {
+        int succ_count = getSuccessors(blocks[i], succs, MAX_SUCCESSORS);
+        for (int j = 0; j < succ_count; ++j)
+            preds[succs[j]->index][pred_count[succs[j]->index]++] = blocks[i];
+    }
+
+    /* the body of a loop is its header, along with every block that reaches
+    one of the header's back edges without passing through the header */
+    _Bool *in_loop = malloc(sizeof(_Bool)*count);
+    int *worklist = malloc(sizeof(int)*count);
+    for (int header = 0; header < count; ++header) {
+        int work_size = 0;
+        memset(in_loop, 0, sizeof(_Bool)*count);
+        in_loop[header] = true;
+
+        for (int i = 0; i < count; ++i) {
+            int succ_count = getSuccessors(blocks[i], succs, MAX_SUCCESSORS);
+            for (int j = 0; j < succ_count; ++j) {
+                if (!back_edge[i*MAX_SUCCESSORS + j] || succs[j]->index != header)
+                    continue;
+
+                blocks[header]->loop_header = true;
+                if (!in_loop[i]) {
+                    in_loop[i] = true;
+                    worklist[work_size++] = i;
+                }
+            }
+        }
+        if (!blocks[header]->loop_header)
+            continue;
+
+        while (work_size) {
+            int cur = worklist[--work_size];
+            for (int j = 0; j < pred_count[cur]; ++j) {
+                int pred = preds[cur][j]->index;
+                if (!in_loop[pred]) {
+                    in_loop[pred] = true;
+                    worklist[work_size++] = pred;
+                }
+            }
+        }
+
+        for (int i = 0; i < count; ++i)
+            if (in_loop[i])
+                blocks[i]->loop_depth++;
+    }
+
+    for (int i = 0; i < count; ++i)
+        free(preds[i]);
+    free(preds);
+    free(pred_count);
+    free(in_loop);
+    free(worklist);
+}
+
+
+/**
+ * isColdBlock - Returns whether a block is unlikely to ever run, which is
+ * the case for a block that calls a function that never returns (such as
+ * exit or abort).
+ */
+_Bool isColdBlock(BasicBlock *bb) {
+    for (int i = 0; i < bb->quad_count; ++i) {
+        Quad *quad = &bb->quads[i];
+        if (quad->opcode != CALL || !quad->src1)
+            continue;
+
+        char *callee = NULL;
+        if (quad->src1->nodetype == IDENT_TYPE)
+            callee = quad->src1->ident.str;
+        else if (quad->src1->nodetype == STABLE_FNC_DECLARATOR ||
+                 quad->src1->nodetype == STABLE_FNC_DEFINITION ||
+                 quad->src1->nodetype == STABLE_IDENT_TYPE)
+            callee = quad->src1->stable_entry.ident;
+
+        for (int j = 0; callee && noreturn_fncs[j]; ++j)
+            if (!strcmp(callee, noreturn_fncs[j]))
+                return true;
+    }
+    return false;
+}
+
+
+/**
+ * isReturnBlock - Returns whether a block returns from the function.
+ */
+static _Bool isReturnBlock(BasicBlock *bb) {
+    Quad *last_quad = getLastQuad(bb);
+    return last_quad && last_quad->opcode == RETURN;
+}
+
+
+/**
+ * staticArmProbability - Estimates the probability that a two way branch
+ * at the end of bb is taken into the arm arm, rather than into other.
+ * The first heuristic that tells the two arms apart decides.
+ */
+static double staticArmProbability(BasicBlock *bb, BasicBlock *arm, BasicBlock *other,
+                                   _Bool arm_back_edge, _Bool other_back_edge) {
+    if (arm_back_edge != other_back_edge)
+        return arm_back_edge ? PROB_LOOP_BACK_EDGE : 1 - PROB_LOOP_BACK_EDGE;
+
+    _Bool arm_exits = arm->loop_depth < bb->loop_depth;
+    _Bool other_exits = other->loop_depth < bb->loop_depth;
+    if (arm_exits != other_exits)
+        return arm_exits ? PROB_LOOP_EXIT : 1 - PROB_LOOP_EXIT;
+
+    _Bool arm_cold = isColdBlock(arm), other_cold = isColdBlock(other);
+    if (arm_cold != other_cold)
+        return arm_cold ? PROB_COLD_BLOCK : 1 - PROB_COLD_BLOCK;
+
+    _Bool arm_returns = isReturnBlock(arm), other_returns = isReturnBlock(other);
+    if (arm_returns != other_returns)
+        return arm_returns ? PROB_RETURN_BLOCK : 1 - PROB_RETURN_BLOCK;
+
+    return 0.5;
+}
+
+
+/**
+ * branchProbability - Estimates the probability that control flows from
+ * the end of bb into its successor at index succ_ind.
+ *
+ * A block that was annotated with a profile uses its measured edge
+ * counts, and the static heuristics are used otherwise.
+ */
+double branchProbability(BasicBlock *bb, int succ_ind, _Bool *back_edge) {
+    BasicBlock *succs[MAX_SUCCESSORS];
+    int succ_count = getSuccessors(bb, succs, MAX_SUCCESSORS);
+
+    if (succ_count == 1)
+        return 1;
+    if (succ_count != 2)
+        return 1.0 / succ_count;
+
+    if (bb->exec_count >= 0 && bb->edge_count[0] >= 0 && bb->edge_count[1] >= 0) {
+        long long total = bb->edge_count[0] + bb->edge_count[1];
+        return total ? (double) bb->edge_count[succ_ind] / total : 0.5;
+    }
+
+    int other_ind = 1 - succ_ind;
+    return staticArmProbability(bb, succs[succ_ind], succs[other_ind],
+                                back_edge[bb->index*MAX_SUCCESSORS + succ_ind],
+                                back_edge[bb->index*MAX_SUCCESSORS + other_ind]);
+}
+
+
+/**
+ * blockFrequency - Returns how often a block runs, relative to its
+ * function's entry. Without a profile, every loop level multiplies it.
+ */
+static double blockFrequency(BasicBlock *bb) {
+    if (bb->exec_count >= 0)
+        return bb->exec_count;
+
+    double freq = 1;
+    for (int i = 0; i < bb->loop_depth; ++i)
+        freq *= LOOP_FREQ_SCALE;
+    return freq;
+}
+
+
+/**
+ * compareEdges - qsort comparator that orders edges from the heaviest to
+ * the lightest, breaking ties by the depth-first order of the blocks.
+ */
+static int compareEdges(const void *a, const void *b) {
+    const LayoutEdge *e1 = a, *e2 = b;
+    if (e1->weight != e2->weight)
+        return e1->weight < e2->weight ? 1 : -1;
+    if (e1->from != e2->from)
+        return e1->from - e2->from;
+    return e1->to - e2->to;
+}
+
+
+/**
+ * layoutBasicBlocks - Orders the basic blocks of the function starting
+ * at entry for emission, and returns the newly allocated ordering with
+ * its length stored in count. The entry block always comes first.
+ *
+ * This is Pettis-Hansen bottom-up chaining: edges are visited from the
+ * heaviest to the lightest, and an edge joins two chains of blocks when
+ * it runs from the tail of one to the head of the other, making it a
+ * fall-through. The chains are then placed hottest-connection first,
+ * with chains holding cold blocks pushed to the end of the function.
+ */
+BasicBlock **layoutBasicBlocks(BasicBlock *entry, int *count) {
+    BasicBlock **blocks = collectBasicBlocks(entry, count);
+    int n = *count;
+
+    _Bool *back_edge = malloc(sizeof(_Bool)*n*MAX_SUCCESSORS);
+    findLoops(blocks, n, back_edge);
+
+    // weigh every edge of the CFG
+    int edge_count = 0;
+    LayoutEdge *edges = malloc(sizeof(LayoutEdge)*n*MAX_SUCCESSORS);
+    BasicBlock *succs[MAX_SUCCESSORS];
+    for (int i = 0; i < n; ++i) {
+        int succ_count = getSuccessors(blocks[i], succs, MAX_SUCCESSORS);
+        double freq = blockFrequency(blocks[i]);
+        for (int j = 0; j < succ_count; ++j) {
+            edges[edge_count].from = i;
+            edges[edge_count].to = succs[j]->index;
+            edges[edge_count].weight = freq * branchProbability(blocks[i], j, back_edge);
+            edge_count++;
+        }
+    }
+    qsort(edges, edge_count, sizeof(LayoutEdge), compareEdges);
+
+    /* every block starts out as its own chain, named by the block's
+    index. A chain is a linked list through chain_next. */
+    int *chain_of = malloc(sizeof(int)*n);
+    int *chain_next = malloc(sizeof(int)*n);
+    int *chain_head = malloc(sizeof(int)*n);
+    int *chain_tail = malloc(sizeof(int)*n);
+    for (int i = 0; i < n; ++i) {
+        chain_of[i] = chain_head[i] = chain_tail[i] = i;
+        chain_next[i] = -1;
+    }
+
+    for (int i = 0; i < edge_count; ++i) {
+        int from = edges[i].from, to = edges[i].to;
+        int from_chain = chain_of[from], to_chain = chain_of[to];
+
+        if (from_chain == to_chain || chain_tail[from_chain] != from ||
+                chain_head[to_chain] != to || to == 0)
+            continue;
+
+        chain_next[from] = to;
+        chain_tail[from_chain] = chain_tail[to_chain];
+        for (int b = to; b != -1; b = chain_next[b])
+            chain_of[b] = from_chain;
+    }
+
+    /* a chain is cold if any of its blocks is, or if the profile
+    shows that none of its blocks ever ran */
+    _Bool *cold = calloc(n, sizeof(_Bool));
+    for (int c = 0; c < n; ++c) {
+        if (chain_of[c] != c)
+            continue;
+
+        _Bool all_unexecuted = true;
+        for (int b = chain_head[c]; b != -1; b = chain_next[b]) {
+            if (isColdBlock(blocks[b]))
+                cold[c] = true;
+            if (blocks[b]->exec_count != 0)
+                all_unexecuted = false;
+        }
+        if (all_unexecuted)
+            cold[c] = true;
+    }
+
+    /* place the entry chain first, then keep placing the chain reached
+    by the heaviest edge out of what has been placed so far */
+    BasicBlock **layout = malloc(sizeof(BasicBlock *)*n);
+    _Bool *placed = calloc(n, sizeof(_Bool));
+    int layout_size = 0;
+    int cur_chain = chain_of[0];
+
+    while (cur_chain != -1) {
+        placed[cur_chain] = true;
+        for (int b = chain_head[cur_chain]; b != -1; b = chain_next[b])
+            layout[layout_size++] = blocks[b];
+
+        cur_chain = -1;
+        for (int i = 0; i < edge_count && cur_chain == -1; ++i) {
+            int to_chain = chain_of[edges[i].to];
+            if (placed[chain_of[edges[i].from]] && !placed[to_chain] && !cold[to_chain])
+                cur_chain = to_chain;
+        }
+        for (int pass = 0; pass < 2 && cur_chain == -1; ++pass)
+            for (int c = 0; c < n && cur_chain == -1; ++c)
+                if (chain_of[c] == c && !placed[c] && cold[c] == pass)
+                    cur_chain = c;
+    }
+
+    free(back_edge);
+    free(edges);
+    free(chain_of);
+    free(chain_next);
+    free(chain_head);
+    free(chain_tail);
+    free(cold);
+    free(placed);
+    free(blocks);
+    return layout;
+}
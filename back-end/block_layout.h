@@ -0,0 +1,75 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * block_layout.h - Declares the functions associated with
+ * basic block placement: finding the loops of a function,
+ * estimating how often each CFG edge is taken, and ordering
+ * the blocks so that the hot edges become fall-throughs.
+ */
+
+#ifndef BLOCK_LAYOUT
+#define BLOCK_LAYOUT
+
+struct BasicBlock;
+
+
+/* Static branch probabilities, used when there is no profile. These
+   follow the Ball-Larus heuristics: loops usually iterate, blocks that
+   return or exit the program are usually not branched into. */
+#define PROB_LOOP_BACK_EDGE 0.88
+#define PROB_LOOP_EXIT      0.20
+#define PROB_COLD_BLOCK     0.05
+#define PROB_RETURN_BLOCK   0.28
+
+/* how many times a loop body is assumed to run per entry into the loop */
+#define LOOP_FREQ_SCALE 8.0
+
+
+/* An edge of the CFG between the blocks at indices from and to of the
+   collectBasicBlocks array, weighted by how often it is taken. */
+typedef struct LayoutEdge {
+    int from, to;
+    double weight;
+} LayoutEdge;
+
+
+/**
+ * findLoops - Finds the natural loops of the function whose blocks are
+ * in the array blocks (as returned by collectBasicBlocks), marking each
+ * loop header and the loop depth of each block. The back edges are
+ * marked in back_edge, at index from*MAX_SUCCESSORS + successor index.
+ */
+void findLoops(struct BasicBlock **blocks, int count, _Bool *back_edge);
+
+
+/**
+ * branchProbability - Estimates the probability that control flows from
+ * the end of bb into its successor at index succ_ind.
+ */
+double branchProbability(struct BasicBlock *bb, int succ_ind, _Bool *back_edge);
+
+
+/**
+ * isColdBlock - Returns whether a block is unlikely to ever run, which is
+ * the case for a block that calls a function that never returns (such as
+ * exit or abort).
+ */
+_Bool isColdBlock(struct BasicBlock *bb);
+
+
+/**
+ * layoutBasicBlocks - Orders the basic blocks of the function starting
+ * at entry for emission, and returns the newly allocated ordering with
+ * its length stored in count. The entry block always comes first.
+ *
+ * This is Pettis-Hansen bottom-up chaining: edges are visited from the
+ * heaviest to the lightest, and an edge joins two chains of blocks when
+ * it runs from the tail of one to the head of the other, making it a
+ * fall-through. The chains are then placed hottest-connection first,
+ * with chains holding cold blocks pushed to the end of the function.
+ */
+struct BasicBlock **layoutBasicBlocks(struct BasicBlock *entry, int *count);
+
+
+#endif
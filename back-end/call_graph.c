@@ -0,0 +1,181 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * call_graph.c - Implements the functions declared in
+ * the header file 'call_graph.h'.
+ *
+ * A call to an internal function follows a convention of its own: the
+ * caller only saves the caller-saved registers that the function (or
+ * anything it calls) actually writes to, rather than every live one.
+ * The functions are generated as their definitions are parsed, so a
+ * call to a static function that comes further down in the file is
+ * treated as a call to any other function, clobbering all of them.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../front-end/front_end_header.h"
+#include "../front-end/parser/pheader_ast.h"
+#include "../front-end/parser/symbol_table.h"
+#include "../front-end/parser/quads.h"
+#include "./back_end_header.h"
+#include "./call_graph.h"
+
+
+/* a function defined in the translation unit */
+typedef struct CallGraphNode {
+    char *name;
+    _Bool is_static;
+    _Bool clobbers_known;       /* whether its assembly was generated */
+    unsigned int clobbers;      /* bit i is reg_collector.names[i] */
+} CallGraphNode;
+
+static CallGraphNode *call_graph = NULL;
+static int call_graph_size = 0, call_graph_capacity = 0;
+
+
+/**
+ * functionName - Returns the name of a function that a quad operand names,
+ * or NULL if it isn't a function.
+ */
+static char *functionName(astnode *node) {
+    if (!node)
+        return NULL;
+    if (node->nodetype == IDENT_TYPE)
+        return node->ident.str;
+    if (node->nodetype == STABLE_FNC_DECLARATOR || node->nodetype == STABLE_FNC_DEFINITION)
+        return node->stable_entry.ident;
+    return NULL;
+}
+
+
+/**
+ * findFunction - Returns the call graph node of the function called name,
+ * or NULL if it isn't defined in the translation unit.
+ */
+static CallGraphNode *findFunction(char *name) {
+    for (int i = 0; name && i < call_graph_size; ++i)
+        if (!strcmp(call_graph[i].name, name))
+            return &call_graph[i];
+    return NULL;
+}
+
+
+/**
+ * isStaticFunction - Returns whether name is declared in the global scope
+ * as a static function.
+ */
+static _Bool isStaticFunction(char *name) {
+    astnode *fnc = sTableLookUp(scope_stack.global_scope->tables[GENERAL_NAMESPACE], name);
+    return fnc && (fnc->nodetype == STABLE_FNC_DECLARATOR || fnc->nodetype == STABLE_FNC_DEFINITION) &&
+           fnc->stable_entry.fnc.storage_class == Static;
+}
+
+
+/**
+ * addCallGraphFunction - Adds a function defined in the translation unit
+ * to the call graph, once its definition has been parsed.
+ */
+void addCallGraphFunction(char *name) {
+    if (call_graph_size == call_graph_capacity) {
+        call_graph_capacity = call_graph_capacity ? 2*call_graph_capacity : 16;
+        call_graph = realloc(call_graph, sizeof(CallGraphNode) * call_graph_capacity);
+    }
+
+    CallGraphNode *fnc = &call_graph[call_graph_size++];
+    fnc->name = name;
+    fnc->is_static = isStaticFunction(name);
+    fnc->clobbers_known = false;
+    fnc->clobbers = ~0u;
+}
+
+
+/**
+ * isInternalFunction - Returns whether a function is defined in the file
+ * and static, so that every direct call to it is one to its own code.
+ */
+_Bool isInternalFunction(char *name) {
+    CallGraphNode *fnc = findFunction(name);
+    return fnc && fnc->is_static;
+}
+
+
+/**
+ * mentionsRegister - Returns whether assembly text names the 32 bit
+ * register reg, or its 16 or 8 bit parts.
+ */
+static _Bool mentionsRegister(char *text, char *reg) {
+    char part[8];
+
+    if (strstr(text, reg))
+        return true;
+
+    sprintf(part, "%%%s", reg + 2);             /* %eax -> %ax */
+    if (strstr(text, part))
+        return true;
+
+    if (strchr("abcd", reg[2]) && reg[3] == 'x') {
+        sprintf(part, "%%%cl", reg[2]);
+        if (strstr(text, part))
+            return true;
+        sprintf(part, "%%%ch", reg[2]);
+        if (strstr(text, part))
+            return true;
+    }
+    return false;
+}
+
+
+/**
+ * recordClobbers - Records the general purpose registers that the 32 bit
+ * assembly of a function (text) writes to, including the ones that the
+ * functions it calls may clobber.
+ */
+void recordClobbers(char *name, char *text) {
+    CallGraphNode *fnc = findFunction(name);
+    if (!fnc)
+        return;
+
+    /* a register the function only reads is counted too, it is rare enough
+    for a function to read one without ever writing it */
+    fnc->clobbers = 0;
+    for (int i = 0; i < reg_collector.size; ++i)
+        if (mentionsRegister(text, reg_collector.names[i]))
+            fnc->clobbers |= 1u << i;
+
+    char callee[256];
+    for (char *call = strstr(text, " call "); call; call = strstr(call + 1, " call ")) {
+        if (sscanf(call, " call %255s", callee) != 1)
+            continue;
+
+        CallGraphNode *callee_fnc = findFunction(callee);
+        if (callee_fnc && isInternalFunction(callee) && callee_fnc->clobbers_known)
+            fnc->clobbers |= callee_fnc->clobbers;
+        else
+            fnc->clobbers = ~0u;
+    }
+    fnc->clobbers_known = true;
+}
+
+
+/**
+ * callMayClobber - Returns whether a call to callee may change the value
+ * of reg. Only a call to an internal function whose clobbers were recorded
+ * is known to leave any of the caller-saved registers alone.
+ */
+_Bool callMayClobber(astnode *callee, char *reg) {
+    char *name = functionName(callee);
+    CallGraphNode *fnc = findFunction(name);
+    if (!fnc || !isInternalFunction(name) || !fnc->clobbers_known)
+        return true;
+
+    for (int i = 0; i < reg_collector.size; ++i)
+        if (!strcmp(reg_collector.names[i], reg))
+            return (fnc->clobbers >> i) & 1;
+    return true;
+}
@@ -0,0 +1,49 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * call_graph.h - Declares the functions associated with
+ * the call graph of the translation unit: which of its
+ * functions are internal (every direct call to them is to
+ * code generated here), and which registers a call to an
+ * internal function may clobber.
+ */
+
+#ifndef CALL_GRAPH
+#define CALL_GRAPH
+
+struct astnode;
+struct BasicBlock;
+
+
+/**
+ * addCallGraphFunction - Adds a function defined in the translation unit
+ * to the call graph, once its definition has been parsed.
+ */
+void addCallGraphFunction(char *name);
+
+
+/**
+ * isInternalFunction - Returns whether a function is defined in the file
+ * and static, so that every direct call to it is one to its own code.
+ */
+_Bool isInternalFunction(char *name);
+
+
+/**
+ * recordClobbers - Records the general purpose registers that the 32 bit
+ * assembly of a function (text) writes to, including the ones that the
+ * functions it calls may clobber.
+ */
+void recordClobbers(char *name, char *text);
+
+
+/**
+ * callMayClobber - Returns whether a call to callee may change the value
+ * of reg. Only a call to an internal function whose clobbers were recorded
+ * is known to leave any of the caller-saved registers alone.
+ */
+_Bool callMayClobber(struct astnode *callee, char *reg);
+
+
+#endif
@@ -0,0 +1,420 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * frame_layout.c - Implements the functions declared in
+ * the header file 'frame_layout.h'.
+ *
+ * The scopes of a function body form a tree, and only the variables of
+ * one path down it (from the function's scope to the innermost block being
+ * run) are alive at once. So each scope's variables are laid out right
+ * below those of its enclosing scopes, and the frame is as deep as the
+ * deepest path, rather than the sum of every variable:
+ *
+ *      int a;              a at -4
+ *      if (...) {
+ *          double d;       d at -16 (-4, rounded down to 8, minus 8)
+ *      } else {
+ *          int b, c;       b and c at -8 and -12
+ *      }
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../front-end/front_end_header.h"
+#include "../front-end/lexer/lheader2.h"
+#include "../front-end/parser/pheader_ast.h"
+#include "../front-end/parser/symbol_table.h"
+#include "../front-end/parser/quads.h"
+#include "./assemb_gen.h"
+#include "./back_end_header.h"
+#include "./frame_layout.h"
+
+
+/* a local variable waiting to be given its slot */
+typedef struct FrameSlot {
+    astnode *var;
+    long int size;
+    int align;
+} FrameSlot;
+
+
+/**
+ * slotAlignment - Returns the alignment of a local variable of the given
+ * type in the stack frame. Scalars are aligned to their size, even where
+ * the ABI allows less (doubles on 32 bit x86), arrays of at least 16 bytes
+ * to 16 so that vector instructions may access them, and arrays and structs
+ * otherwise to their most aligned element.
+ */
+int slotAlignment(astnode *type) {
+    int align;
+
+    switch (type->nodetype) {
+        case ARRAY_TYPE:
+            if (typeSize(type) >= MAX_SLOT_ALIGN)
+                return MAX_SLOT_ALIGN;
+            return slotAlignment(type->arr.ptr->ptr.pointee);
+        case STABLE_SU_TAG:
+            align = 1;
+            for (int i = 0; type->stable_entry.sutag.su_table && i < type->stable_entry.sutag.su_table->size; ++i) {
+                astnode *memb = type->stable_entry.sutag.su_table->data[i];
+                if (memb && memb->nodetype == STABLE_SU_MEMB && slotAlignment(memb->stable_entry.node) > align)
+                    align = slotAlignment(memb->stable_entry.node);
+            }
+            return align;
+        case SCALAR_TYPE:
+        case PTR_TYPE:
+            align = getAlignment(type);
+            if (align < 1)
+                align = DATATYPE_INTEGER_ALIGN;
+
+            // a power of two sized scalar can always be naturally aligned
+            long int size = typeSize(type);
+            if (size <= MAX_SLOT_ALIGN && !(size & (size - 1)) && size > align)
+                align = size;
+            return align;
+        default:
+            return DATATYPE_POINTER_ALIGN;
+    }
+}
+
+
+/**
+ * compareSlots - Orders the slots by decreasing alignment, then decreasing
+ * size, and then by name, so that the layout doesn't depend on the order of
+ * the symbol table's hash table.
+ */
+static int compareSlots(const void *a, const void *b) {
+    const FrameSlot *slot_a = a, *slot_b = b;
+
+    if (slot_a->align != slot_b->align)
+        return slot_b->align - slot_a->align;
+    if (slot_a->size != slot_b->size)
+        return slot_b->size > slot_a->size ? 1 : -1;
+    return strcmp(slot_a->var->stable_entry.ident, slot_b->var->stable_entry.ident);
+}
+
+
+/**
+ * layoutScopeVars - Gives the variables of a scope their slots, starting
+ * depth bytes below the frame pointer. Returns the depth below them.
+ */
+static long int layoutScopeVars(ScopeStackLayer *scope, long int depth) {
+    if (!scope)
+        return depth;
+
+    SymbolTable *table = scope->tables[GENERAL_NAMESPACE];
+    FrameSlot *slots = malloc(sizeof(FrameSlot) * (table->size + 1));
+    int slot_count = 0;
+
+    for (int i = 0; i < table->size; ++i) {
+        astnode *var = table->data[i];
+        if (!var || var->nodetype != STABLE_VAR || var->stable_entry.var.storage_class == Extern)
+            continue;
+
+        slots[slot_count].var = var;
+        slots[slot_count].size = typeSize(var);
+        slots[slot_count].align = slotAlignment(var->stable_entry.node);
+        ++slot_count;
+    }
+
+    /* with the most aligned variables first, the padding is only ever
+    needed between the enclosing scopes' variables and these */
+    qsort(slots, slot_count, sizeof(FrameSlot), compareSlots);
+    for (int i = 0; i < slot_count; ++i) {
+        depth = (depth + slots[i].size + slots[i].align - 1) / slots[i].align * slots[i].align;
+        slots[i].var->stable_entry.var.offset_within_stack_frame = -depth;
+    }
+
+    free(slots);
+    return depth;
+}
+
+
+/**
+ * layoutStmt - Lays out the variables of the scopes within a statement,
+ * below the depth bytes taken by the scopes enclosing it. Returns the
+ * deepest that any of them reaches.
+ */
+static long int layoutStmt(astnode *node, long int depth) {
+    long int deepest = depth, reached;
+
+    if (!node)
+        return depth;
+
+    switch (node->nodetype) {
+        case COMPOUND_STMT:
+            depth = layoutScopeVars(node->compound_stmt.scope_layer, depth);
+            deepest = depth;
+
+            // the blocks nested one after another are never active at the same time
+            for (AstnodeLinkedListNode *cur = node->compound_stmt.astnode_ll ?
+                    node->compound_stmt.astnode_ll->first : NULL; cur; cur = cur->next) {
+                reached = layoutStmt(cur->node, depth);
+                if (reached > deepest)
+                    deepest = reached;
+            }
+            return deepest;
+        case CONDITIONAL_STMT:
+            deepest = layoutStmt(node->conditional_stmt.if_node, depth);
+            reached = layoutStmt(node->conditional_stmt.else_node, depth);
+            return reached > deepest ? reached : deepest;
+        case WHILE_STMT:
+            return layoutStmt(node->while_stmt.stmt, depth);
+        case DO_WHILE_STMT:
+            return layoutStmt(node->do_while_stmt.stmt, depth);
+        case FOR_STMT:
+            return layoutStmt(node->for_stmt.stmt, depth);
+        case SWITCH_STMT:
+            return layoutStmt(node->switch_stmt.stmt, depth);
+        case STABLE_STMT_LABEL:
+            return layoutStmt(node->stable_entry.node, depth);
+        default:
+            return depth;
+    }
+}
+
+
+/**
+ * layoutStackFrame - Sets the frame pointer offsets of the local variables
+ * of every scope in a function's body, under the frame_base bytes right
+ * below the frame pointer. Each scope's variables are placed below those of
+ * the scopes enclosing it, largest alignment first, so that sibling scopes
+ * (such as an if and its else) overlap. Returns the size of the frame.
+ */
+long int layoutStackFrame(astnode *fnc_body, long int frame_base) {
+    long int deepest = layoutStmt(fnc_body, frame_base);
+
+    // keep the stack pointer word aligned
+    deepest = (deepest + DATATYPE_POINTER - 1) / DATATYPE_POINTER * DATATYPE_POINTER;
+    return deepest - frame_base;
+}
+
+
+/* the stack depth known at a label of a frameless function */
+typedef struct LabelDepth {
+    char *name;
+    long int depth;
+} LabelDepth;
+
+
+/**
+ * splitInstr - Splits a line of assembly into its mnemonic and its first
+ * operand (either may come back empty), returning whether it is a label.
+ */
+static _Bool splitInstr(char *line, char *mnemonic, char *operand) {
+    mnemonic[0] = operand[0] = '\0';
+
+    int len = strlen(line);
+    if (len && line[0] != ' ' && line[len-1] == ':') {
+        strncpy(mnemonic, line, len - 1 < 63 ? len - 1 : 63);
+        mnemonic[len - 1 < 63 ? len - 1 : 63] = '\0';
+        return true;
+    }
+
+    sscanf(line, " %63s %63[^,]", mnemonic, operand);
+    return false;
+}
+
+
+/**
+ * espAdjustment - Returns how many bytes an instruction takes the stack
+ * pointer further down (negative for up), not counting calls, whose
+ * arguments the caller pops itself.
+ */
+static long int espAdjustment(char *line, char *mnemonic, char *operand) {
+    if (!strcmp(mnemonic, "pushl"))
+        return 4;
+    if (!strcmp(mnemonic, "popl"))
+        return -4;
+
+    char *dest = strrchr(line, ',');
+    if (operand[0] != '$' || !dest || strcmp(dest, ", %esp"))
+        return 0;
+    if (!strcmp(mnemonic, "subl"))
+        return strtol(operand + 1, NULL, 10);
+    if (!strcmp(mnemonic, "addl"))
+        return -strtol(operand + 1, NULL, 10);
+    return 0;
+}
+
+
+/**
+ * findLabel - Returns the entry of a label in labels, adding it (with an
+ * unknown depth, -1) if it isn't there yet.
+ */
+static LabelDepth *findLabel(LabelDepth *labels, int *label_count, char *name) {
+    for (int i = 0; i < *label_count; ++i)
+        if (!strcmp(labels[i].name, name))
+            return &labels[i];
+
+    labels[*label_count].name = strdup(name);
+    labels[*label_count].depth = -1;
+    return &labels[(*label_count)++];
+}
+
+
+/**
+ * walkStackDepths - Goes over the lines of a function in order, setting the
+ * depth of each one (how far below the frame the stack pointer is before it
+ * runs). A label is as deep as the jumps to it, or the code falling into it.
+ * Returns whether the depth of any label was learned along the way.
+ */
+static _Bool walkStackDepths(char **lines, int line_count, long int *depths,
+                             LabelDepth *labels, int *label_count) {
+    char mnemonic[64], operand[64];
+    long int depth = 0;
+    _Bool reachable = true, learned = false;
+
+    for (int i = 0; i < line_count; ++i) {
+        if (splitInstr(lines[i], mnemonic, operand)) {
+            LabelDepth *label = findLabel(labels, label_count, mnemonic);
+            if (label->depth < 0 && reachable) {
+                label->depth = depth;
+                learned = true;
+            }
+            depth = label->depth < 0 ? 0 : label->depth;
+            reachable = true;
+        }
+        depths[i] = depth;
+
+        if (mnemonic[0] == 'j' && reachable) {
+            LabelDepth *label = findLabel(labels, label_count, operand);
+            if (label->depth < 0) {
+                label->depth = depth;
+                learned = true;
+            }
+        }
+        if (!strcmp(mnemonic, "jmp") || !strcmp(mnemonic, "ret"))
+            reachable = false;
+
+        depth += espAdjustment(lines[i], mnemonic, operand);
+    }
+    return learned;
+}
+
+
+/**
+ * generateFramedBody - Generates a function with a frame pointer, out of
+ * the assembly of its blocks (body): the frame_size bytes of locals are
+ * allocated under the frame pointer, the saved_count callee-saved registers
+ * it used are pushed under them (then popped back before each leave), and
+ * the outgoing_size bytes of its calls' stored arguments go at the very
+ * bottom. On x86-64 the locals are padded so that the stack stays 16 byte
+ * aligned under the registers.
+ */
+void generateFramedBody(char *body, long int frame_size, long int outgoing_size,
+                        char **saved_regs, int saved_count, FILE *body_output) {
+    char suffix = TARGET_IS_64 ? 'q' : 'l';
+    char *frame_reg = TARGET_IS_64 ? "%rbp" : "%ebp";
+    char *stack_reg = TARGET_IS_64 ? "%rsp" : "%esp";
+    long int saved_size = (TARGET_IS_64 ? 8 : 4) * saved_count;
+
+    if (TARGET_IS_64)
+        frame_size = (frame_size + saved_size + 15) / 16 * 16 - saved_size;
+
+    fprintf(body_output, "        push%c   %s\n", suffix, frame_reg);
+    fprintf(body_output, "        mov%c    %s, %s\n", suffix, stack_reg, frame_reg);
+    if (frame_size)
+        fprintf(body_output, "        sub%c    $%ld, %s\n", suffix, frame_size, stack_reg);
+    for (int i = 0; i < saved_count; ++i)
+        fprintf(body_output, "        push%c   %s\n", suffix, saved_regs[i]);
+    if (outgoing_size)
+        fprintf(body_output, "        sub%c    $%ld, %s\n", suffix, outgoing_size, stack_reg);
+
+    char mnemonic[64], operand[64];
+    for (char *line = strtok(body, "\n"); line; line = strtok(NULL, "\n")) {
+        splitInstr(line, mnemonic, operand);
+        if (!strcmp(mnemonic, "leave") && saved_count) {
+            // the stack may still hold arguments, so the saved registers are found off the frame pointer
+            fprintf(body_output, "        lea%c    -%ld(%s), %s\n", suffix, frame_size + saved_size, frame_reg, stack_reg);
+            for (int i = saved_count-1; i >= 0; --i)
+                fprintf(body_output, "        pop%c    %s\n", suffix, saved_regs[i]);
+        }
+        fprintf(body_output, "%s\n", line);
+    }
+}
+
+
+/**
+ * generateFramelessBody - Generates a 32 bit function without a frame
+ * pointer, out of the assembly of its blocks (body), whose locals are still
+ * addressed off FRAME_PLACEHOLDER. Each of them is rewritten relative to
+ * %esp, as deep below it as the pushes and stack adjustments before it took
+ * the stack, and each leave into popping the frame_size bytes of the frame
+ * (and the outgoing_size bytes of stored arguments under it) and the
+ * saved_count callee-saved registers (%ebp among them) it used. So a
+ * function that has no locals and uses none of them gets no prologue at all.
+ */
+void generateFramelessBody(char *body, long int frame_size, long int outgoing_size,
+                           char **saved_regs, int saved_count, FILE *body_output) {
+    int line_count = 0;
+    for (char *cur = body; *cur; ++cur)
+        if (*cur == '\n')
+            ++line_count;
+
+    char **lines = malloc(sizeof(char *) * (line_count + 1));
+    long int *depths = malloc(sizeof(long int) * (line_count + 1));
+    LabelDepth *labels = malloc(sizeof(LabelDepth) * (line_count + 1));
+    int label_count = 0;
+
+    /* the placeholder points 4 bytes below the return address, where the
+    frame pointer would have been saved. The registers are pushed from
+    there down, and the locals go under them, as far down again as keeps
+    the slots at the alignment they were laid out for. */
+    long int saved_size = 4*saved_count;
+    long int locals_gap = saved_count ? (saved_size - 4 + 7) / 8 * 8 : 0;
+    long int alloc_size = (frame_size ? frame_size + 4 + locals_gap - saved_size : 0) + outgoing_size;
+
+    line_count = 0;
+    for (char *line = strtok(body, "\n"); line; line = strtok(NULL, "\n"))
+        lines[line_count++] = line;
+
+    // a block laid out before the jumps into it is only known on a later pass
+    while (walkStackDepths(lines, line_count, depths, labels, &label_count))
+        ;
+
+    for (int i = 0; i < saved_count; ++i)
+        fprintf(body_output, "        pushl   %s\n", saved_regs[i]);
+    if (alloc_size)
+        fprintf(body_output, "        subl    $%ld, %%esp\n", alloc_size);
+
+    char mnemonic[64], operand[64];
+    for (int i = 0; i < line_count; ++i) {
+        splitInstr(lines[i], mnemonic, operand);
+
+        if (!strcmp(mnemonic, "leave")) {
+            if (alloc_size + depths[i])
+                fprintf(body_output, "        addl    $%ld, %%esp\n", alloc_size + depths[i]);
+            for (int j = saved_count-1; j >= 0; --j)
+                fprintf(body_output, "        popl    %s\n", saved_regs[j]);
+            continue;
+        }
+
+        // rewrite each N(placeholder) as an offset off %esp
+        char *cur = lines[i], *slot;
+        while ((slot = strstr(cur, "(" FRAME_PLACEHOLDER ")"))) {
+            char *num = slot;
+            while (num > cur && (isdigit(num[-1]) || num[-1] == '-'))
+                --num;
+
+            // the locals are below the saved registers, the parameters above them
+            long int offset = strtol(num, NULL, 10);
+            offset += saved_size + alloc_size + depths[i] - 4 - (offset < 0 ? locals_gap : 0);
+            fprintf(body_output, "%.*s%ld(%%esp)", (int) (num - cur), cur, offset);
+            cur = slot + strlen("(" FRAME_PLACEHOLDER ")");
+        }
+        fprintf(body_output, "%s\n", cur);
+    }
+
+    for (int i = 0; i < label_count; ++i)
+        free(labels[i].name);
+    free(labels);
+    free(depths);
+    free(lines);
+}
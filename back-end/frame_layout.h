@@ -0,0 +1,73 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * frame_layout.h - Declares the functions associated with
+ * laying out the local variables of a function's stack
+ * frame: every block scope's variables get a slot, aligned
+ * to their type and packed by alignment, and the variables
+ * of blocks that are never active together share slots. It
+ * also wraps a 32 bit function's body in its prologue and
+ * epilogue, once the registers it used are known.
+ */
+
+#ifndef FRAME_LAYOUT
+#define FRAME_LAYOUT
+
+#include <stdio.h>
+
+struct astnode;
+
+
+/* the largest alignment given to a stack slot, that of an SSE register */
+#define MAX_SLOT_ALIGN 16
+
+
+/**
+ * slotAlignment - Returns the alignment of a local variable of the given
+ * type in the stack frame. Scalars are aligned to their size, even where
+ * the ABI allows less (doubles on 32 bit x86), arrays of at least 16 bytes
+ * to 16 so that vector instructions may access them, and arrays and structs
+ * otherwise to their most aligned element.
+ */
+int slotAlignment(struct astnode *type);
+
+
+/**
+ * layoutStackFrame - Sets the frame pointer offsets of the local variables
+ * of every scope in a function's body, under the frame_base bytes right
+ * below the frame pointer. Each scope's variables are placed below those of
+ * the scopes enclosing it, largest alignment first, so that sibling scopes
+ * (such as an if and its else) overlap. Returns the size of the frame.
+ */
+long int layoutStackFrame(struct astnode *fnc_body, long int frame_base);
+
+
+/**
+ * generateFramedBody - Generates a function with a frame pointer, out of
+ * the assembly of its blocks (body): the frame_size bytes of locals are
+ * allocated under the frame pointer, the saved_count callee-saved registers
+ * it used are pushed under them (then popped back before each leave), and
+ * the outgoing_size bytes of its calls' stored arguments go at the very
+ * bottom. On x86-64 the locals are padded so that the stack stays 16 byte
+ * aligned under the registers.
+ */
+void generateFramedBody(char *body, long int frame_size, long int outgoing_size,
+                        char **saved_regs, int saved_count, FILE *body_output);
+
+
+/**
+ * generateFramelessBody - Generates a 32 bit function without a frame
+ * pointer, out of the assembly of its blocks (body), whose locals are still
+ * addressed off FRAME_PLACEHOLDER. Each of them is rewritten relative to
+ * %esp, as deep below it as the pushes and stack adjustments before it took
+ * the stack, and each leave into popping the frame_size bytes of the frame
+ * (and the outgoing_size bytes of stored arguments under it) and the
+ * saved_count callee-saved registers (%ebp among them) it used. So a
+ * function that has no locals and uses none of them gets no prologue at all.
+ */
+void generateFramelessBody(char *body, long int frame_size, long int outgoing_size,
+                           char **saved_regs, int saved_count, FILE *body_output);
+
+
+#endif
@@ -0,0 +1,405 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * profile.c - Implements the functions associated with
+ * profile-guided optimization, ie the functions declared
+ * at profile.h.
+ *
+ * The profile file is plain text, one basic block per line:
+ *      <function name>/<basic block label> <execution count>
+ * Every translation unit of an instrumented program appends its
+ * own lines when the program exits, so running the program many
+ * times accumulates counts that readProfile sums back up.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../front-end/front_end_header.h"
+#include "../front-end/parser/quads.h"
+#include "../front-end/lexer/lheader2.h"
+#include "./back_end_header.h"
+#include "./profile.h"
+
+
+/* the blocks that were given a counter in this translation unit */
+static char **counter_names = NULL;
+static int counter_count = 0;
+static int counter_capacity = 0;
+
+/* the profile that was read in by readProfile */
+static ProfileTable profile_table = {0, 0, NULL};
+
+
+/**
+ * profileKey - Creates the key of a basic block in the profile.
+ */
+static char *profileKey(char *fnc_name, BasicBlock *bb) {
+    char *key = malloc(strlen(fnc_name) + strlen(bb->u_label) + 2);
+    sprintf(key, "%s/%s", fnc_name, bb->u_label);
+    return key;
+}
+
+
+/**
+ * newProfileCounter - Reserves a new execution counter for the basic
+ * block bb of the function fnc_name, and returns the counter's index.
+ */
+int newProfileCounter(char *fnc_name, BasicBlock *bb) {
+    if (counter_count == counter_capacity) {
+        counter_capacity = counter_capacity ? counter_capacity*2 : 64;
+        counter_names = realloc(counter_names, sizeof(char *)*counter_capacity);
+    }
+
+    counter_names[counter_count] = profileKey(fnc_name, bb);
+    return counter_count++;
+}
+
+
+/**
+ * generateProfileCounterIncr - Generates the assembly that increments
+ * the 64 bit execution counter at the index counter_ind.
+ *
+ * This is placed at the head of a basic block, where the flags are
+ * never live, so the add with carry is free to clobber them.
+ */
+void generateProfileCounterIncr(int counter_ind, FILE *body_output) {
+    if (TARGET_IS_64) {
+        fprintf(body_output, "        addq    $1, %s+%d(%%rip)\n", PROFILE_COUNTERS, counter_ind*8);
+        return;
+    }
+
+    fprintf(body_output, "        addl    $1, %s+%d\n", PROFILE_COUNTERS, counter_ind*8);
+    fprintf(body_output, "        adcl    $0, %s+%d\n", PROFILE_COUNTERS, counter_ind*8 + 4);
+}
+
+
+/**
+ * generateProfileStrings - Generates the names of the counters and the
+ * strings that the dump routine passes to fopen and fprintf.
+ */
+static void generateProfileStrings(FILE *strlit_output) {
+    for (int i = 0; i < counter_count; ++i) {
+        fprintf(strlit_output, ".LPN%d:\n", i);
+        fprintf(strlit_output, "        .string \"%s\"\n", counter_names[i]);
+    }
+    fprintf(strlit_output, ".LPFILE:\n");
+    fprintf(strlit_output, "        .string \"%s\"\n", be_flags.profile_file);
+    fprintf(strlit_output, ".LPMODE:\n");
+    fprintf(strlit_output, "        .string \"a\"\n");
+    fprintf(strlit_output, ".LPFMT:\n");
+    fprintf(strlit_output, "        .string \"%%s %%llu\\n\"\n");
+}
+
+
+/**
+ * generateProfileRuntime64 - The x86-64 version of generateProfileRuntime.
+ * The table of names holds addresses, so it goes in .data.rel.ro for the
+ * dynamic linker to relocate in a position independent executable.
+ */
+static void generateProfileRuntime64(FILE *body_output, FILE *strlit_output) {
+    generateProfileStrings(strlit_output);
+
+    fprintf(body_output, "        .section .data.rel.ro,\"aw\"\n");
+    fprintf(body_output, "        .align  8\n");
+    fprintf(body_output, "%s:\n", PROFILE_NAMES);
+    for (int i = 0; i < counter_count; ++i)
+        fprintf(body_output, "        .quad   .LPN%d\n", i);
+
+    fprintf(body_output, "        .section .init_array,\"aw\"\n");
+    fprintf(body_output, "        .align  8\n");
+    fprintf(body_output, "        .quad   %s\n", PROFILE_INIT);
+    fprintf(body_output, "        .text\n");
+
+    fprintf(body_output, "        .local  %s\n", PROFILE_COUNTERS);
+    fprintf(body_output, "        .comm   %s,%d,8\n", PROFILE_COUNTERS, counter_count*8);
+
+    fprintf(body_output, "        .type   %s, @function\n", PROFILE_INIT);
+    fprintf(body_output, "%s:\n", PROFILE_INIT);
+    fprintf(body_output, "        pushq   %%rbp\n");
+    fprintf(body_output, "        movq    %%rsp, %%rbp\n");
+    fprintf(body_output, "        leaq    %s(%%rip), %%rdi\n", PROFILE_DUMP);
+    fprintf(body_output, "        call    atexit\n");
+    fprintf(body_output, "        popq    %%rbp\n");
+    fprintf(body_output, "        ret\n");
+    fprintf(body_output, "        .size   %s, .-%s\n", PROFILE_INIT, PROFILE_INIT);
+
+    // %rbx is the counter index and %r12 the file, both kept across calls
+    fprintf(body_output, "        .type   %s, @function\n", PROFILE_DUMP);
+    fprintf(body_output, "%s:\n", PROFILE_DUMP);
+    fprintf(body_output, "        pushq   %%rbp\n");
+    fprintf(body_output, "        movq    %%rsp, %%rbp\n");
+    fprintf(body_output, "        pushq   %%rbx\n");
+    fprintf(body_output, "        pushq   %%r12\n");
+    fprintf(body_output, "        leaq    .LPMODE(%%rip), %%rsi\n");
+    fprintf(body_output, "        leaq    .LPFILE(%%rip), %%rdi\n");
+    fprintf(body_output, "        call    fopen\n");
+    fprintf(body_output, "        testq   %%rax, %%rax\n");
+    fprintf(body_output, "        je      .LPDONE\n");
+    fprintf(body_output, "        movq    %%rax, %%r12\n");
+    fprintf(body_output, "        xorl    %%ebx, %%ebx\n");
+    fprintf(body_output, ".LPLOOP:\n");
+    fprintf(body_output, "        cmpl    $%d, %%ebx\n", counter_count);
+    fprintf(body_output, "        jge     .LPCLOSE\n");
+    fprintf(body_output, "        leaq    %s(%%rip), %%rax\n", PROFILE_NAMES);
+    fprintf(body_output, "        movq    (%%rax,%%rbx,8), %%rdx\n");
+    fprintf(body_output, "        leaq    %s(%%rip), %%rax\n", PROFILE_COUNTERS);
+    fprintf(body_output, "        movq    (%%rax,%%rbx,8), %%rcx\n");
+    fprintf(body_output, "        leaq    .LPFMT(%%rip), %%rsi\n");
+    fprintf(body_output, "        movq    %%r12, %%rdi\n");
+    fprintf(body_output, "        xorl    %%eax, %%eax\n");
+    fprintf(body_output, "        call    fprintf\n");
+    fprintf(body_output, "        incl    %%ebx\n");
+    fprintf(body_output, "        jmp     .LPLOOP\n");
+    fprintf(body_output, ".LPCLOSE:\n");
+    fprintf(body_output, "        movq    %%r12, %%rdi\n");
+    fprintf(body_output, "        call    fclose\n");
+    fprintf(body_output, ".LPDONE:\n");
+    fprintf(body_output, "        popq    %%r12\n");
+    fprintf(body_output, "        popq    %%rbx\n");
+    fprintf(body_output, "        popq    %%rbp\n");
+    fprintf(body_output, "        ret\n");
+    fprintf(body_output, "        .size   %s, .-%s\n", PROFILE_DUMP, PROFILE_DUMP);
+}
+
+
+/**
+ * generateProfileRuntime - Generates the counter array, the table of
+ * block names, and the routines that register an atexit handler at
+ * startup and dump the counters into the profile file at exit.
+ */
+void generateProfileRuntime(FILE *body_output, FILE *strlit_output) {
+    if (!counter_count)
+        return;
+    if (TARGET_IS_64) {
+        generateProfileRuntime64(body_output, strlit_output);
+        return;
+    }
+
+    // the names of the counters and the strings the dump routine uses
+    generateProfileStrings(strlit_output);
+
+    fprintf(strlit_output, "        .align  4\n");
+    fprintf(strlit_output, "%s:\n", PROFILE_NAMES);
+    for (int i = 0; i < counter_count; ++i)
+        fprintf(strlit_output, "        .long   .LPN%d\n", i);
+
+    // the counters themselves live in the bss
+    fprintf(body_output, "        .local  %s\n", PROFILE_COUNTERS);
+    fprintf(body_output, "        .comm   %s,%d,8\n", PROFILE_COUNTERS, counter_count*8);
+
+    // have the init routine run before main
+    fprintf(body_output, "        .section .init_array,\"aw\"\n");
+    fprintf(body_output, "        .align  4\n");
+    fprintf(body_output, "        .long   %s\n", PROFILE_INIT);
+    fprintf(body_output, "        .text\n");
+
+    // the init routine registers the dump routine to run at exit
+    fprintf(body_output, "        .type   %s, @function\n", PROFILE_INIT);
+    fprintf(body_output, "%s:\n", PROFILE_INIT);
+    fprintf(body_output, "        pushl   %%ebp\n");
+    fprintf(body_output, "        movl    %%esp, %%ebp\n");
+    fprintf(body_output, "        pushl   $%s\n", PROFILE_DUMP);
+    fprintf(body_output, "        call    atexit\n");
+    fprintf(body_output, "        leave\n");
+    fprintf(body_output, "        ret\n");
+    fprintf(body_output, "        .size   %s, .-%s\n", PROFILE_INIT, PROFILE_INIT);
+
+    // the dump routine appends a line per counter to the profile file
+    fprintf(body_output, "        .type   %s, @function\n", PROFILE_DUMP);
+    fprintf(body_output, "%s:\n", PROFILE_DUMP);
+    fprintf(body_output, "        pushl   %%ebp\n");
+    fprintf(body_output, "        movl    %%esp, %%ebp\n");
+    fprintf(body_output, "        pushl   %%ebx\n");
+    fprintf(body_output, "        pushl   %%esi\n");
+    fprintf(body_output, "        pushl   $.LPMODE\n");
+    fprintf(body_output, "        pushl   $.LPFILE\n");
+    fprintf(body_output, "        call    fopen\n");
+    fprintf(body_output, "        addl    $8, %%esp\n");
+    fprintf(body_output, "        testl   %%eax, %%eax\n");
+    fprintf(body_output, "        je      .LPDONE\n");
+    fprintf(body_output, "        movl    %%eax, %%esi\n");
+    fprintf(body_output, "        xorl    %%ebx, %%ebx\n");
+    fprintf(body_output, ".LPLOOP:\n");
+    fprintf(body_output, "        cmpl    $%d, %%ebx\n", counter_count);
+    fprintf(body_output, "        jge     .LPCLOSE\n");
+    fprintf(body_output, "        pushl   %s+4(,%%ebx,8)\n", PROFILE_COUNTERS);
+    fprintf(body_output, "        pushl   %s(,%%ebx,8)\n", PROFILE_COUNTERS);
+    fprintf(body_output, "        pushl   %s(,%%ebx,4)\n", PROFILE_NAMES);
+    fprintf(body_output, "        pushl   $.LPFMT\n");
+    fprintf(body_output, "        pushl   %%esi\n");
+    fprintf(body_output, "        call    fprintf\n");
+    fprintf(body_output, "        addl    $20, %%esp\n");
+    fprintf(body_output, "        incl    %%ebx\n");
+    fprintf(body_output, "        jmp     .LPLOOP\n");
+    fprintf(body_output, ".LPCLOSE:\n");
+    fprintf(body_output, "        pushl   %%esi\n");
+    fprintf(body_output, "        call    fclose\n");
+    fprintf(body_output, "        addl    $4, %%esp\n");
+    fprintf(body_output, ".LPDONE:\n");
+    fprintf(body_output, "        popl    %%esi\n");
+    fprintf(body_output, "        popl    %%ebx\n");
+    fprintf(body_output, "        leave\n");
+    fprintf(body_output, "        ret\n");
+    fprintf(body_output, "        .size   %s, .-%s\n", PROFILE_DUMP, PROFILE_DUMP);
+}
+
+
+/**
+ * profileTableSlot - Returns the slot of the profile table that holds
+ * key, or the empty slot it should be inserted into.
+ */
+static ProfileEntry *profileTableSlot(ProfileTable *table, char *key) {
+    int ind = sTableHash(key, table->size);
+
+    // linear probing
+    while (table->data[ind].key && strcmp(table->data[ind].key, key))
+        ind = (ind+1) % table->size;
+
+    return &table->data[ind];
+}
+
+
+/**
+ * profileTableAdd - Adds count to the entry of key in the profile table,
+ * growing the table to keep it at most half full.
+ */
+static void profileTableAdd(ProfileTable *table, char *key, long long count) {
+    if (table->filled >= table->size/2) {
+        ProfileEntry *old_data = table->data;
+        int old_size = table->size;
+
+        table->size = old_size ? old_size*2 + 1 : 97;
+        table->data = calloc(table->size, sizeof(ProfileEntry));
+        table->filled = 0;
+
+        for (int i = 0; i < old_size; ++i)
+            if (old_data[i].key)
+                profileTableAdd(table, old_data[i].key, old_data[i].count);
+        free(old_data);
+    }
+
+    ProfileEntry *slot = profileTableSlot(table, key);
+    if (slot->key)
+        slot->count += count;
+    else {
+        slot->key = key;
+        slot->count = count;
+        table->filled++;
+    }
+}
+
+
+/**
+ * readProfile - Reads the profile file written by an instrumented build
+ * into the global profile table. Counts from repeated runs are summed.
+ */
+void readProfile(char *file_name) {
+    FILE *profile = fopen(file_name, "r");
+    if (!profile) {
+        fprintf(stderr, "Warning: unable to open profile '%s', "
+                        "compiling without it.\n", file_name);
+        return;
+    }
+
+    char key[LINESIZE+1];
+    long long count;
+    while (fscanf(profile, "%1024s %lld", key, &count) == 2)
+        profileTableAdd(&profile_table, strdup(key), count);
+
+    fclose(profile);
+}
+
+
+/**
+ * lookUpProfile - Returns the execution count of a basic block,
+ * or -1 if the block does not appear in the profile.
+ */
+static long long lookUpProfile(char *fnc_name, BasicBlock *bb) {
+    if (!profile_table.filled)
+        return -1;
+
+    char *key = profileKey(fnc_name, bb);
+    ProfileEntry *slot = profileTableSlot(&profile_table, key);
+    free(key);
+
+    return slot->key ? slot->count : -1;
+}
+
+
+/**
+ * annotateProfile - Annotates the CFG of the function starting at entry
+ * with the block execution counts from the profile, and derives from
+ * them the number of times each edge between blocks was taken.
+ *
+ * Only blocks are counted, so an edge count is exact when its target
+ * has no other predecessor. The rest of a block's count is then split
+ * among its remaining edges in proportion to their targets' counts.
+ * Edge counts are kept for the first two successors of each block,
+ * which for a conditional branch are its then and else arms.
+ */
+void annotateProfile(BasicBlock *entry, char *fnc_name) {
+    // a function missing from the profile keeps all its counts unknown
+    if (lookUpProfile(fnc_name, entry) < 0)
+        return;
+
+    int block_count;
+    BasicBlock **blocks = collectBasicBlocks(entry, &block_count);
+    int *pred_count = calloc(block_count, sizeof(int));
+
+    for (int i = 0; i < block_count; ++i) {
+        blocks[i]->exec_count = lookUpProfile(fnc_name, blocks[i]);
+        if (blocks[i]->exec_count < 0)   /* created after profiling, never ran */
+            blocks[i]->exec_count = 0;
+    }
+
+    // count predecessors, to know which edge counts are exact
+    BasicBlock *succs[MAX_SUCCESSORS];
+    for (int i = 0; i < block_count; ++i) {
+        int succ_count = getSuccessors(blocks[i], succs, MAX_SUCCESSORS);
+        for (int j = 0; j < succ_count; ++j)
+            pred_count[succs[j]->index]++;
+    }
+
+    for (int i = 0; i < block_count; ++i) {
+        BasicBlock *bb = blocks[i];
+        int succ_count = getSuccessors(bb, succs, MAX_SUCCESSORS);
+        if (succ_count > 2)
+            succ_count = 2;
+
+        long long known_sum = 0, unknown_succ_sum = 0;
+        int unknown = 0;
+        for (int j = 0; j < succ_count; ++j) {
+            if (pred_count[succs[j]->index] == 1) {
+                bb->edge_count[j] = succs[j]->exec_count;
+                known_sum += bb->edge_count[j];
+            }
+            else {
+                bb->edge_count[j] = -1;
+                unknown_succ_sum += succs[j]->exec_count;
+                unknown++;
+            }
+        }
+
+        long long remaining = bb->exec_count - known_sum;
+        if (remaining < 0)
+            remaining = 0;
+
+        for (int j = 0; j < succ_count; ++j) {
+            if (bb->edge_count[j] >= 0)
+                continue;
+            if (unknown_succ_sum)
+                bb->edge_count[j] = remaining * succs[j]->exec_count / unknown_succ_sum;
+            else
+                bb->edge_count[j] = remaining / unknown;
+        }
+    }
+
+    free(pred_count);
+    free(blocks);
+}
+
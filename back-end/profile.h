@@ -0,0 +1,78 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * profile.h - Declares the functions associated with
+ * profile-guided optimization: instrumenting basic blocks
+ * with execution counters, and reading the resulting
+ * profile back in to annotate the CFG.
+ */
+
+#include <stdio.h>
+
+#ifndef PROFILE_GEN
+#define PROFILE_GEN
+
+struct BasicBlock;
+
+
+/* symbol names of the instrumentation data and routines. They are never
+   made global, so each translation unit gets its own copy. */
+#define PROFILE_COUNTERS "__guycc_prof_counters"
+#define PROFILE_NAMES    "__guycc_prof_names"
+#define PROFILE_DUMP     "__guycc_prof_dump"
+#define PROFILE_INIT     "__guycc_prof_init"
+
+
+/* One entry of the profile read in by readProfile. The key is the
+   function name and the basic block label, as in "main/BB_4". */
+typedef struct ProfileEntry {
+    char *key;
+    long long count;
+} ProfileEntry;
+
+typedef struct ProfileTable {
+    int size;               /* number of spaces for entries */
+    int filled;             /* number of entries in table   */
+    ProfileEntry *data;     /* open addressing hash table   */
+} ProfileTable;
+
+
+/**
+ * newProfileCounter - Reserves a new execution counter for the basic
+ * block bb of the function fnc_name, and returns the counter's index.
+ */
+int newProfileCounter(char *fnc_name, struct BasicBlock *bb);
+
+
+/**
+ * generateProfileCounterIncr - Generates the assembly that increments
+ * the 64 bit execution counter at the index counter_ind.
+ */
+void generateProfileCounterIncr(int counter_ind, FILE *body_output);
+
+
+/**
+ * generateProfileRuntime - Generates the counter array, the table of
+ * block names, and the routines that register an atexit handler at
+ * startup and dump the counters into the profile file at exit.
+ */
+void generateProfileRuntime(FILE *body_output, FILE *strlit_output);
+
+
+/**
+ * readProfile - Reads the profile file written by an instrumented build
+ * into the global profile table. Counts from repeated runs are summed.
+ */
+void readProfile(char *file_name);
+
+
+/**
+ * annotateProfile - Annotates the CFG of the function starting at entry
+ * with the block execution counts from the profile, and derives from
+ * them the number of times each edge between blocks was taken.
+ */
+void annotateProfile(struct BasicBlock *entry, char *fnc_name);
+
+
+#endif
@@ -0,0 +1,572 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * schedule.c - Implements the functions declared in
+ * the header file 'schedule.h'.
+ *
+ * The instruction selectors print each quad's instructions in order, so
+ * a load is used by the very next instruction and nothing is done while
+ * an imul or idiv runs. The scheduler reads a basic block's assembly back
+ * in, splits it into regions between barriers, builds a dependence graph
+ * over each region (registers, flags and memory) and list schedules it:
+ * cycle by cycle, the instructions whose operands are ready are issued,
+ * the ones heading the longest chain of latencies first.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include "../front-end/front_end_header.h"
+#include "./back_end_header.h"
+#include "./schedule.h"
+
+
+/* the -mtune microarchitectures, with generic (the default) first */
+static SchedTuning tunings[] = {
+    /*  name       width alu imul idiv load fadd fmul fdiv cvt valu vmul vmulld */
+    { "generic",    4,   1,   3,  26,   5,   4,   4,  14,   5,   1,   5,   10 },
+    { "skylake",    4,   1,   3,  26,   5,   4,   4,  13,   5,   1,   5,   10 },
+    { "znver2",     5,   1,   3,  29,   4,   3,   3,  13,   4,   1,   3,    4 },
+    { "atom",       2,   1,   3,  25,   3,   3,   5,  27,   4,   1,   5,   11 },
+};
+
+#define TUNING_COUNT (sizeof(tunings) / sizeof(tunings[0]))
+
+/* the most operands an instruction takes */
+#define MAX_OPERANDS 3
+
+/* the general purpose registers, in the order of their encoding */
+#define REG_AX  0
+#define REG_DX  2
+#define REG_SP  4
+
+/* any two accesses of at least this many bytes apart don't overlap */
+#define MAX_ACCESS_SIZE 16
+
+
+static void parseOperand(char *op, MachineInstr *instr, _Bool read, _Bool write, _Bool pure_write);
+static int registerId(char *reg, _Bool *partial);
+static _Bool mayAlias(char *mem1, char *mem2);
+static int classLatency(char *mnemonic, MachineInstr *instr);
+static _Bool isBarrierMnemonic(char *mnemonic);
+static _Bool startsWith(char *str, char *prefix);
+static _Bool isSizedMnemonic(char *mnemonic, char *base);
+static void scheduleRegion(MachineInstr *instrs, int count, FILE *body_output);
+
+
+/**
+ * lookupTuning - Returns the index in the tuning table of the
+ * microarchitecture called name, or -1 if there is none.
+ */
+int lookupTuning(char *name) {
+    for (int i = 0; i < (int) TUNING_COUNT; ++i)
+        if (!strcmp(tunings[i].name, name))
+            return i;
+    return -1;
+}
+
+
+/**
+ * parseMachineInstr - Fills in a machine instruction from a line of the
+ * generated assembly. Lines that are not understood are made barriers.
+ */
+void parseMachineInstr(char *line, MachineInstr *instr) {
+    memset(instr, 0, sizeof(MachineInstr));
+    instr->text = line;
+
+    // labels and directives
+    char *start = line;
+    while (isspace(*start))
+        ++start;
+    if (!*start || *start == '.' || line[strlen(line)-1] == ':') {
+        instr->barrier = true;
+        return;
+    }
+
+    char mnemonic[16];
+    int len = 0;
+    while (start[len] && !isspace(start[len]) && len < 15) {
+        mnemonic[len] = start[len];
+        ++len;
+    }
+    mnemonic[len] = '\0';
+    if (isBarrierMnemonic(mnemonic)) {
+        instr->barrier = true;
+        return;
+    }
+
+    // split the operands at the commas outside of parentheses
+    char buf[128], *ops[MAX_OPERANDS + 1];
+    int op_count = 0, depth = 0;
+    strncpy(buf, start + len, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    char *cur = buf;
+    while (isspace(*cur))
+        ++cur;
+    if (*cur)
+        ops[op_count++] = cur;
+    for (; *cur; ++cur) {
+        if (*cur == '(')
+            ++depth;
+        else if (*cur == ')')
+            --depth;
+        else if (*cur == ',' && !depth) {
+            *cur = '\0';
+            if (op_count == MAX_OPERANDS) {
+                instr->barrier = true;
+                return;
+            }
+            ops[op_count++] = cur + 1;
+        }
+    }
+    for (int i = 0; i < op_count; ++i) {
+        while (isspace(*ops[i]))
+            ++ops[i];
+        char *end = ops[i] + strlen(ops[i]);
+        while (end > ops[i] && isspace(end[-1]))
+            *--end = '\0';
+    }
+
+    _Bool is_cmp = startsWith(mnemonic, "cmp") || startsWith(mnemonic, "test") ||
+                   startsWith(mnemonic, "ucomis") || startsWith(mnemonic, "comis");
+    _Bool is_lea = startsWith(mnemonic, "lea");
+    _Bool xmm_dst = op_count && startsWith(ops[op_count-1], "%xmm");
+
+    /* the instructions that overwrite their destination without reading it.
+    A scalar SSE move between two registers keeps the destination's upper half. */
+    _Bool scalar_move = !strcmp(mnemonic, "movss") || !strcmp(mnemonic, "movsd");
+    _Bool pure_write = is_lea || startsWith(mnemonic, "cvtt") || startsWith(mnemonic, "pshufd") ||
+                       (startsWith(mnemonic, "mov") && !scalar_move) ||
+                       (scalar_move && op_count == 2 && !(ops[0][0] == '%' && xmm_dst));
+
+    // zeroing idioms, such as xorl %eax, %eax, don't depend on the register
+    if (op_count == 2 && !strcmp(ops[0], ops[1]) && ops[0][0] == '%' &&
+        (startsWith(mnemonic, "xor") || startsWith(mnemonic, "pxor") || startsWith(mnemonic, "sub")))
+        pure_write = true;
+
+    if (op_count == 0) {
+        /* sign extending %eax into %edx, or within %eax */
+        if (!strcmp(mnemonic, "cltd") || !strcmp(mnemonic, "cqto") || !strcmp(mnemonic, "cdq")) {
+            instr->reads |= 1u << REG_AX;
+            instr->writes |= 1u << REG_DX;
+        }
+        else if (!strcmp(mnemonic, "cltq") || !strcmp(mnemonic, "cwtl")) {
+            instr->reads |= 1u << REG_AX;
+            instr->writes |= 1u << REG_AX;
+        }
+        else {
+            instr->barrier = true;
+            return;
+        }
+    }
+    else if (op_count == 1) {
+        if (startsWith(mnemonic, "idiv") || startsWith(mnemonic, "div") ||
+            startsWith(mnemonic, "imul") || startsWith(mnemonic, "mul")) {
+            parseOperand(ops[0], instr, true, false, false);
+            instr->reads |= (1u << REG_AX) | (1u << REG_DX);
+            instr->writes |= (1u << REG_AX) | (1u << REG_DX);
+        }
+        else if (startsWith(mnemonic, "set"))
+            parseOperand(ops[0], instr, false, true, true);
+        else if (startsWith(mnemonic, "inc") || startsWith(mnemonic, "dec") ||
+                 startsWith(mnemonic, "neg") || startsWith(mnemonic, "not"))
+            parseOperand(ops[0], instr, true, true, false);
+        else {
+            instr->barrier = true;
+            return;
+        }
+    }
+    else {
+        // every operand but the last is a source
+        for (int i = 0; i < op_count - 1; ++i) {
+            if (is_lea)
+                parseOperand(ops[i], instr, false, false, false);
+            else
+                parseOperand(ops[i], instr, true, false, false);
+        }
+
+        // the destination of a three operand instruction isn't a source
+        if (is_cmp)
+            parseOperand(ops[op_count-1], instr, true, false, false);
+        else
+            parseOperand(ops[op_count-1], instr, !pure_write && op_count == 2, true,
+                         pure_write || op_count == 3);
+    }
+
+    // a memory operand whose form isn't known could be anything
+    if (instr->barrier)
+        return;
+
+    instr->reads_flags = startsWith(mnemonic, "set") || startsWith(mnemonic, "cmov") ||
+                         startsWith(mnemonic, "adc") || startsWith(mnemonic, "sbb");
+
+    /* the moves, conversions and vector instructions leave the flags alone,
+    as do the SSE instructions other than the compares */
+    instr->writes_flags = !(startsWith(mnemonic, "mov") || is_lea || startsWith(mnemonic, "set") ||
+                            startsWith(mnemonic, "cmov") || startsWith(mnemonic, "cvt") ||
+                            mnemonic[0] == 'p' || startsWith(mnemonic, "not") ||
+                            !strcmp(mnemonic, "cltd") || !strcmp(mnemonic, "cqto") ||
+                            !strcmp(mnemonic, "cdq") || !strcmp(mnemonic, "cltq") ||
+                            !strcmp(mnemonic, "cwtl") || (xmm_dst && !is_cmp));
+
+    instr->latency = classLatency(mnemonic, instr);
+}
+
+
+/**
+ * parseOperand - Adds the registers and memory an operand of an
+ * instruction reads and writes to it. A register that is only partly
+ * written (%al, %ax) keeps the rest of its old value, so is also read.
+ */
+static void parseOperand(char *op, MachineInstr *instr, _Bool read, _Bool write, _Bool pure_write) {
+    // immediates
+    if (op[0] == '$')
+        return;
+
+    if (op[0] == '%') {
+        _Bool partial = false;
+        int id = registerId(op, &partial);
+        if (id < 0) {
+            instr->barrier = true;
+            return;
+        }
+        if (read || (write && (!pure_write || partial)))
+            instr->reads |= 1u << id;
+        if (write)
+            instr->writes |= 1u << id;
+        return;
+    }
+
+    // a memory operand: the registers of its address are read
+    char *paren = strchr(op, '(');
+    if (paren) {
+        for (char *reg = strchr(paren, '%'); reg; reg = strchr(reg + 1, '%')) {
+            _Bool partial;
+            int id = registerId(reg, &partial);
+            if (id >= 0)
+                instr->reads |= 1u << id;
+            else if (!strncmp(reg, FRAME_PLACEHOLDER, strlen(FRAME_PLACEHOLDER)))
+                instr->reads |= 1u << REG_SP;   /* becomes an offset off %esp */
+            else if (strncmp(reg, "%rip", 4)) {
+                instr->barrier = true;
+                return;
+            }
+        }
+    }
+
+    if (!read && !write)
+        return;
+    if (strlen(op) >= MAX_MEM_OPERAND) {
+        instr->barrier = true;
+        return;
+    }
+    strcpy(instr->mem, op);
+    if (read || (write && !pure_write))
+        instr->reads_mem = true;
+    if (write)
+        instr->writes_mem = true;
+}
+
+
+/**
+ * registerId - Returns the id (see schedule.h) of the register named at
+ * the start of reg, or -1 for an unknown one. partial is set when the
+ * name is that of only the low 8 or 16 bits of the register.
+ */
+static int registerId(char *reg, _Bool *partial) {
+    static char *names[16][4] = {
+        {"rax", "eax", "ax", "al"},      {"rcx", "ecx", "cx", "cl"},
+        {"rdx", "edx", "dx", "dl"},      {"rbx", "ebx", "bx", "bl"},
+        {"rsp", "esp", "sp", "spl"},     {"rbp", "ebp", "bp", "bpl"},
+        {"rsi", "esi", "si", "sil"},     {"rdi", "edi", "di", "dil"},
+        {"r8", "r8d", "r8w", "r8b"},     {"r9", "r9d", "r9w", "r9b"},
+        {"r10", "r10d", "r10w", "r10b"}, {"r11", "r11d", "r11w", "r11b"},
+        {"r12", "r12d", "r12w", "r12b"}, {"r13", "r13d", "r13w", "r13b"},
+        {"r14", "r14d", "r14w", "r14b"}, {"r15", "r15d", "r15w", "r15b"},
+    };
+    static char *high_names[] = {"ah", "ch", "dh", "bh"};
+
+    char name[8];
+    int len = 0;
+    ++reg;  // skip the %
+    while (isalnum(reg[len]) && len < 7) {
+        name[len] = reg[len];
+        ++len;
+    }
+    name[len] = '\0';
+
+    *partial = false;
+    if (!strncmp(name, "xmm", 3) && isdigit(name[3]))
+        return 16 + atoi(name + 3);
+
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            if (!strcmp(names[i][j], name)) {
+                *partial = j >= 2;
+                return i;
+            }
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (!strcmp(high_names[i], name)) {
+            *partial = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+/**
+ * mayAlias - Returns whether two memory operands could overlap. Slots of
+ * the stack frame and global symbols are told apart by their offsets and
+ * names; an address in any other register could point anywhere.
+ */
+static _Bool mayAlias(char *mem1, char *mem2) {
+    char sym[2][64];
+    long offset[2];
+    _Bool frame[2];
+    char *mems[2] = {mem1, mem2};
+
+    for (int i = 0; i < 2; ++i) {
+        char *paren = strchr(mems[i], '(');
+        int sym_len = 0;
+        char *cur = mems[i];
+
+        // the symbol, if any, and the displacement
+        if (*cur != '-' && !isdigit(*cur) && cur != paren) {
+            while (*cur && *cur != '+' && *cur != '-' && cur != paren && sym_len < 63)
+                sym[i][sym_len++] = *cur++;
+        }
+        sym[i][sym_len] = '\0';
+        offset[i] = (*cur == '+' || *cur == '-' || isdigit(*cur)) ? strtol(cur, NULL, 10) : 0;
+
+        frame[i] = false;
+        if (paren) {
+            // without a frame pointer, %ebp is just another register
+            if ((!strcmp(paren, "(%ebp)") && !OMIT_FRAME_POINTER) || !strcmp(paren, "(%rbp)") ||
+                !strcmp(paren, "(" FRAME_PLACEHOLDER ")"))
+                frame[i] = true;
+            else if (strcmp(paren, "(%rip)"))
+                return true;
+        }
+        if (frame[i] == (sym_len != 0))
+            return true;
+    }
+
+    // the stack frame and the globals don't overlap, nor do two globals
+    if (frame[0] != frame[1] || strcmp(sym[0], sym[1]))
+        return false;
+
+    return labs(offset[0] - offset[1]) < MAX_ACCESS_SIZE;
+}
+
+
+/**
+ * classLatency - Returns the latency of an instruction under
+ * the -mtune microarchitecture, going by its mnemonic.
+ */
+static int classLatency(char *mnemonic, MachineInstr *instr) {
+    SchedTuning *tune = &tunings[be_flags.tuning];
+    int latency;
+
+    if (isSizedMnemonic(mnemonic, "idiv") || isSizedMnemonic(mnemonic, "div"))
+        latency = tune->idiv;
+    else if (isSizedMnemonic(mnemonic, "imul") || isSizedMnemonic(mnemonic, "mul"))
+        latency = tune->imul;
+    else if (startsWith(mnemonic, "cvt"))
+        latency = tune->cvt;
+    else if (startsWith(mnemonic, "adds") || startsWith(mnemonic, "subs") ||
+             startsWith(mnemonic, "ucomis") || startsWith(mnemonic, "comis") ||
+             startsWith(mnemonic, "mins") || startsWith(mnemonic, "maxs"))
+        latency = tune->fp_add;
+    else if (startsWith(mnemonic, "muls"))
+        latency = tune->fp_mul;
+    else if (startsWith(mnemonic, "divs"))
+        latency = tune->fp_div;
+    else if (!strcmp(mnemonic, "pmulld"))
+        latency = tune->vec_mulld;
+    else if (!strcmp(mnemonic, "pmuludq"))
+        latency = tune->vec_mul;
+    else if (mnemonic[0] == 'p')
+        latency = tune->vec_alu;
+    else
+        latency = tune->alu;
+
+    // loads come out of the cache before the instruction can start
+    if (instr->reads_mem)
+        latency += tune->load;
+
+    return latency;
+}
+
+
+/**
+ * isBarrierMnemonic - Returns whether an instruction is one that nothing
+ * is moved across: control flow, the stack pointer's pushes and pops, the
+ * string instructions, whose operands are implicit, and the x87 
+ * instructions, whose register stack isn't modeled.
+ */
+static _Bool isBarrierMnemonic(char *mnemonic) {
+    return mnemonic[0] == 'j' || mnemonic[0] == 'f' || startsWith(mnemonic, "call") ||
+           startsWith(mnemonic, "ret") || startsWith(mnemonic, "leave") ||
+           startsWith(mnemonic, "push") || startsWith(mnemonic, "pop") ||
+           startsWith(mnemonic, "rep") || startsWith(mnemonic, "stos") ||
+           !strcmp(mnemonic, "movsb") || !strcmp(mnemonic, "movsw") ||
+           !strcmp(mnemonic, "movsl") || !strcmp(mnemonic, "movsq") || startsWith(mnemonic, "xchg") ||
+           startsWith(mnemonic, "cmpxchg") || startsWith(mnemonic, "xadd");
+}
+
+
+/**
+ * startsWith - Returns whether str starts with prefix.
+ */
+static _Bool startsWith(char *str, char *prefix) {
+    return !strncmp(str, prefix, strlen(prefix));
+}
+
+
+/**
+ * isSizedMnemonic - Returns whether mnemonic is the integer instruction
+ * base, with or without an operand size suffix (so "mull" is "mul", while
+ * "mulsd" isn't).
+ */
+static _Bool isSizedMnemonic(char *mnemonic, char *base) {
+    int len = strlen(base);
+    return !strncmp(mnemonic, base, len) &&
+           (!mnemonic[len] || (strchr("bwlq", mnemonic[len]) && !mnemonic[len+1]));
+}
+
+
+/**
+ * scheduleBlockAssemb - Reorders the assembly generated for a basic block,
+ * given as text, and writes it to body_output. The instructions between
+ * two barriers (labels, jumps, calls, pushes and pops, ...) are list
+ * scheduled using the latencies of the -mtune microarchitecture.
+ */
+void scheduleBlockAssemb(char *block_text, FILE *body_output) {
+    int capacity = 16, count = 0;
+    MachineInstr *instrs = malloc(capacity * sizeof(MachineInstr));
+
+    char *line = block_text;
+    while (*line) {
+        char *newline = strchr(line, '\n');
+        if (newline)
+            *newline = '\0';
+
+        MachineInstr instr;
+        parseMachineInstr(line, &instr);
+        if (instr.barrier) {
+            scheduleRegion(instrs, count, body_output);
+            count = 0;
+            fprintf(body_output, "%s\n", line);
+        }
+        else {
+            if (count == capacity) {
+                capacity *= 2;
+                instrs = realloc(instrs, capacity * sizeof(MachineInstr));
+            }
+            instrs[count++] = instr;
+        }
+
+        if (!newline)
+            break;
+        line = newline + 1;
+    }
+    scheduleRegion(instrs, count, body_output);
+
+    free(instrs);
+}
+
+
+/**
+ * scheduleRegion - List schedules a region of instructions without
+ * barriers, writing them to body_output in their new order.
+ *
+ * An instruction depends on an earlier one that writes what it reads
+ * (waiting out the earlier one's latency), or that reads or writes what
+ * it writes (only needing to come after it). Each cycle, up to the issue
+ * width of the ready instructions are issued, those with the longest
+ * path of latencies to the end of the region first.
+ */
+static void scheduleRegion(MachineInstr *instrs, int count, FILE *body_output) {
+    if (count <= 2) {
+        for (int i = 0; i < count; ++i)
+            fprintf(body_output, "%s\n", instrs[i].text);
+        return;
+    }
+
+    // latency[i*count + j] is the latency of the edge from i to j, or -1 for none
+    int *latency = malloc(count * count * sizeof(int));
+    for (int i = 0; i < count; ++i) {
+        for (int j = 0; j < count; ++j) {
+            latency[i*count + j] = -1;
+            if (j <= i)
+                continue;
+
+            MachineInstr *a = &instrs[i], *b = &instrs[j];
+            _Bool mem_alias = a->mem[0] && b->mem[0] && mayAlias(a->mem, b->mem);
+
+            if ((a->writes & b->reads) || (a->writes_flags && b->reads_flags) ||
+                (a->writes_mem && b->reads_mem && mem_alias))
+                latency[i*count + j] = a->latency;
+            else if ((a->reads & b->writes) || (a->writes & b->writes) ||
+                     (a->reads_flags && b->writes_flags) || (a->writes_flags && b->writes_flags) ||
+                     ((a->reads_mem || a->writes_mem) && b->writes_mem && mem_alias))
+                latency[i*count + j] = 0;
+        }
+    }
+
+    // the priority of an instruction is the longest path from it to the end
+    int *height = malloc(count * sizeof(int));
+    for (int i = count - 1; i >= 0; --i) {
+        height[i] = instrs[i].latency;
+        for (int j = i + 1; j < count; ++j)
+            if (latency[i*count + j] >= 0 && latency[i*count + j] + height[j] > height[i])
+                height[i] = latency[i*count + j] + height[j];
+    }
+
+    int *issue_cycle = malloc(count * sizeof(int));
+    for (int i = 0; i < count; ++i)
+        issue_cycle[i] = -1;
+
+    int issue_width = tunings[be_flags.tuning].issue_width;
+    int cycle = 0, issued_this_cycle = 0;
+    for (int scheduled = 0; scheduled < count; ) {
+        // the best of the instructions whose dependences are met by this cycle
+        int best = -1;
+        for (int j = 0; j < count && issued_this_cycle < issue_width; ++j) {
+            if (issue_cycle[j] >= 0)
+                continue;
+
+            _Bool ready = true;
+            for (int i = 0; i < j && ready; ++i)
+                if (latency[i*count + j] >= 0 &&
+                    (issue_cycle[i] < 0 || issue_cycle[i] + latency[i*count + j] > cycle))
+                    ready = false;
+
+            if (ready && (best < 0 || height[j] > height[best]))
+                best = j;
+        }
+
+        if (best < 0) {
+            ++cycle;
+            issued_this_cycle = 0;
+            continue;
+        }
+
+        issue_cycle[best] = cycle;
+        ++issued_this_cycle;
+        ++scheduled;
+        fprintf(body_output, "%s\n", instrs[best].text);
+    }
+
+    free(issue_cycle);
+    free(height);
+    free(latency);
+}
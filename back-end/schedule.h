@@ -0,0 +1,85 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * schedule.h - Declares the functions and defines the structs
+ * associated with instruction scheduling: reading back the
+ * assembly generated for a basic block as a list of machine
+ * instructions, and reordering them so that the instructions
+ * waiting on a slow one (a load, a multiply, a divide) are
+ * issued as late as their dependences allow.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#ifndef INSTR_SCHEDULE
+#define INSTR_SCHEDULE
+
+
+/* The latencies (in cycles) of the classes of instructions on one
+   microarchitecture, picked with -mtune=name. An instruction reading
+   memory waits the load latency on top of its own. */
+typedef struct SchedTuning {
+    char *name;
+    int issue_width;    /* instructions issued per cycle */
+    int alu;            /* integer add, logic, shift, move, lea */
+    int imul;           /* integer multiply */
+    int idiv;           /* integer divide */
+    int load;           /* load from the L1 cache */
+    int fp_add;         /* SSE add, subtract, compare, min/max */
+    int fp_mul;         /* SSE multiply */
+    int fp_div;         /* SSE divide */
+    int cvt;            /* conversions between ints, floats and doubles */
+    int vec_alu;        /* packed integer add, logic, shuffle */
+    int vec_mul;        /* pmuludq */
+    int vec_mulld;      /* pmulld */
+} SchedTuning;
+
+/* the default -mtune, that does well on the current Intel and AMD cores */
+#define DEFAULT_TUNING "generic"
+
+
+/* Where a machine instruction's dependences come from: the registers are
+   bits 0-15 (the general purpose registers, in encoding order) and 16-31
+   (%xmm0-%xmm15) of a mask, along with the flags and memory. */
+#define SCHED_REG_COUNT 32
+
+/* the longest memory operand kept for telling accesses apart */
+#define MAX_MEM_OPERAND 64
+
+typedef struct MachineInstr {
+    char *text;             /* the line of assembly, without its newline */
+    uint32_t reads, writes; /* the registers read and written */
+    _Bool reads_flags, writes_flags;
+    _Bool reads_mem, writes_mem;
+    char mem[MAX_MEM_OPERAND];  /* the memory operand accessed, if any */
+    _Bool barrier;          /* nothing is moved across it */
+    int latency;            /* cycles until its result can be used */
+} MachineInstr;
+
+
+/**
+ * lookupTuning - Returns the index in the tuning table of the
+ * microarchitecture called name, or -1 if there is none.
+ */
+int lookupTuning(char *name);
+
+
+/**
+ * parseMachineInstr - Fills in a machine instruction from a line of the
+ * generated assembly. Lines that are not understood are made barriers.
+ */
+void parseMachineInstr(char *line, MachineInstr *instr);
+
+
+/**
+ * scheduleBlockAssemb - Reorders the assembly generated for a basic block,
+ * given as text, and writes it to body_output. The instructions between
+ * two barriers (labels, jumps, calls, pushes and pops, ...) are list
+ * scheduled using the latencies of the -mtune microarchitecture.
+ */
+void scheduleBlockAssemb(char *block_text, FILE *body_output);
+
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * strength_reduce.c - Implements the functions declared in
+ * the header file 'strength_reduce.h'.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "../front-end/front_end_header.h"
+#include "../front-end/lexer/lheader2.h"
+#include "../front-end/parser/pheader_ast.h"
+#include "./strength_reduce.h"
+
+
+/* the largest divisor handled, so that the modulo's multiply by it
+   is an immediate on both targets */
+#define MAX_REDUCED_DIVISOR 2147483647LL
+
+
+/**
+ * isIntConstant - Returns whether node is an integer constant, storing
+ * its value in val if it is.
+ */
+_Bool isIntConstant(astnode *node, long long *val) {
+    if (!node || node->nodetype != NUM_TYPE || !(node->num.types & NUMMASK_INTGR))
+        return false;
+
+    *val = (long long) node->num.val;
+    return true;
+}
+
+
+/**
+ * isReducibleDivisor - Returns whether a division or modulo by the
+ * constant d is generated without an idiv. Division by 0 is left for
+ * idiv to trap on, as are the divisors that don't fit in an immediate.
+ */
+_Bool isReducibleDivisor(long long d) {
+    return d && d >= -MAX_REDUCED_DIVISOR && d <= MAX_REDUCED_DIVISOR;
+}
+
+
+/**
+ * isPowerOfTwoDivisor - Returns whether the absolute value of the
+ * divisor d is a power of two (including 1).
+ */
+_Bool isPowerOfTwoDivisor(long long d) {
+    unsigned long long abs_d = d < 0 ? -(unsigned long long) d : (unsigned long long) d;
+    return abs_d && !(abs_d & (abs_d - 1));
+}
+
+
+/**
+ * log2Exact - Returns k, for a val that is 2^k.
+ */
+static int log2Exact(unsigned long long val) {
+    int k = 0;
+    while (val > 1) {
+        val >>= 1;
+        ++k;
+    }
+    return k;
+}
+
+
+/**
+ * computeMagic - Computes the magic number multiplier and the shift that
+ * divide a signed bits (32 or 64) bit integer by d >= 2, as in Hacker's
+ * Delight: x / d is the high half of multiplier * x, plus x when the
+ * multiplier is negative, shifted right by shift, plus one if x < 0.
+ */
+void computeMagic(long long d, int bits, long long *multiplier, int *shift) {
+    unsigned long long mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    unsigned long long two_p = 1ULL << (bits - 1);
+    unsigned long long ad = d;
+    unsigned long long anc = two_p - 1 - two_p % ad;    // |nc|, the largest multiple of d minus 1
+    unsigned long long q1 = two_p / anc, r1 = two_p - q1 * anc;
+    unsigned long long q2 = two_p / ad, r2 = two_p - q2 * ad;
+    unsigned long long delta;
+    int p = bits - 1;
+
+    do {
+        ++p;
+        q1 = (q1 * 2) & mask;
+        r1 = (r1 * 2) & mask;
+        if (r1 >= anc) {
+            ++q1;
+            r1 -= anc;
+        }
+        q2 = (q2 * 2) & mask;
+        r2 = (r2 * 2) & mask;
+        if (r2 >= ad) {
+            ++q2;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    // the multiplier as a signed bits bit integer
+    unsigned long long m = (q2 + 1) & mask;
+    if (bits == 32)
+        *multiplier = (long long) (int) (unsigned int) m;
+    else
+        *multiplier = (long long) m;
+    *shift = p - bits;
+}
+
+
+/**
+ * generateConstMultiply - Generates the assembly that multiplies the
+ * register reg of a bits (32 or 64) bit target by the constant c, with a
+ * shift or an lea where one does, and an imul by the immediate otherwise.
+ */
+void generateConstMultiply(char *reg, long long c, int bits, FILE *body_output) {
+    char suffix = bits == 64 ? 'q' : 'l';
+    unsigned long long abs_c = c < 0 ? -(unsigned long long) c : (unsigned long long) c;
+
+    if (c == 0) {
+        fprintf(body_output, "        mov%c    $0, %s\n", suffix, reg);
+        return;
+    }
+
+    // |c| is 2^k, 3*2^k, 5*2^k or 9*2^k: an lea and a shift
+    int k = 0;
+    while (!(abs_c & 1)) {
+        abs_c >>= 1;
+        ++k;
+    }
+    if (abs_c == 1 || abs_c == 3 || abs_c == 5 || abs_c == 9) {
+        if (abs_c != 1)
+            fprintf(body_output, "        lea%c    (%s,%s,%llu), %s\n", suffix, reg, reg, abs_c - 1, reg);
+        if (k)
+            fprintf(body_output, "        sal%c    $%d, %s\n", suffix, k, reg);
+        if (c < 0)
+            fprintf(body_output, "        neg%c    %s\n", suffix, reg);
+        return;
+    }
+
+    fprintf(body_output, "        imul%c   $%lld, %s\n", suffix, c, reg);
+}
+
+
+/**
+ * generatePow2Divide - Generates the assembly that divides the register
+ * reg by the constant d (whose absolute value is a power of two), or takes
+ * its modulo, rounding towards 0 as C does. tmp is a free register.
+ */
+void generatePow2Divide(char *reg, char *tmp, long long d, _Bool is_modulo, int bits, FILE *body_output) {
+    char suffix = bits == 64 ? 'q' : 'l';
+    int k = log2Exact(d < 0 ? -(unsigned long long) d : (unsigned long long) d);
+
+    if (k == 0) {
+        if (is_modulo)
+            fprintf(body_output, "        mov%c    $0, %s\n", suffix, reg);
+        else if (d < 0)
+            fprintf(body_output, "        neg%c    %s\n", suffix, reg);
+        return;
+    }
+
+    /* an arithmetic shift rounds towards negative infinity, so negative
+    dividends are first biased by 2^k - 1 */
+    fprintf(body_output, "        mov%c    %s, %s\n", suffix, reg, tmp);
+    if (k > 1)
+        fprintf(body_output, "        sar%c    $%d, %s\n", suffix, bits - 1, tmp);
+    fprintf(body_output, "        shr%c    $%d, %s\n", suffix, bits - k, tmp);
+
+    if (is_modulo) {
+        // x % 2^k is x minus its biased value rounded down to a multiple of 2^k
+        fprintf(body_output, "        add%c    %s, %s\n", suffix, reg, tmp);
+        fprintf(body_output, "        and%c    $%lld, %s\n", suffix, -(1LL << k), tmp);
+        fprintf(body_output, "        sub%c    %s, %s\n", suffix, tmp, reg);
+    }
+    else {
+        fprintf(body_output, "        add%c    %s, %s\n", suffix, tmp, reg);
+        fprintf(body_output, "        sar%c    $%d, %s\n", suffix, k, reg);
+        if (d < 0)
+            fprintf(body_output, "        neg%c    %s\n", suffix, reg);
+    }
+}
+
+
+/**
+ * generateMagicDivide - Generates the assembly that divides the dividend
+ * pushed on top of the stack by the constant d, or takes its modulo, with
+ * a multiply by d's magic number. The dividend is popped, and the quotient
+ * is left in %edx/%rdx or the remainder in %eax/%rax, both of which are
+ * overwritten.
+ */
+void generateMagicDivide(long long d, _Bool is_modulo, int bits, FILE *body_output) {
+    char suffix = bits == 64 ? 'q' : 'l';
+    char *ax = bits == 64 ? "%rax" : "%eax";
+    char *dx = bits == 64 ? "%rdx" : "%edx";
+    char *dividend = bits == 64 ? "(%rsp)" : "(%esp)";
+
+    long long multiplier;
+    int shift;
+    computeMagic(d < 0 ? -d : d, bits, &multiplier, &shift);
+
+    // the high half of the product lands in %edx
+    if (multiplier >= -2147483648LL && multiplier <= 2147483647LL)
+        fprintf(body_output, "        mov%c    $%lld, %s\n", suffix, multiplier, ax);
+    else
+        fprintf(body_output, "        movabsq $%lld, %s\n", multiplier, ax);
+    fprintf(body_output, "        imul%c   %s\n", suffix, dividend);
+    if (multiplier < 0)
+        fprintf(body_output, "        add%c    %s, %s\n", suffix, dividend, dx);
+    if (shift)
+        fprintf(body_output, "        sar%c    $%d, %s\n", suffix, shift, dx);
+
+    // round towards 0, by adding one for negative dividends
+    fprintf(body_output, "        mov%c    %s, %s\n", suffix, dividend, ax);
+    fprintf(body_output, "        shr%c    $%d, %s\n", suffix, bits - 1, ax);
+    fprintf(body_output, "        add%c    %s, %s\n", suffix, ax, dx);
+    if (d < 0)
+        fprintf(body_output, "        neg%c    %s\n", suffix, dx);
+
+    // x % d is x - (x / d) * d
+    if (is_modulo) {
+        fprintf(body_output, "        imul%c   $%lld, %s\n", suffix, d, dx);
+        fprintf(body_output, "        mov%c    %s, %s\n", suffix, dividend, ax);
+        fprintf(body_output, "        sub%c    %s, %s\n", suffix, dx, ax);
+    }
+
+    fprintf(body_output, "        add%c    $%d, %s\n", suffix, bits / 8, bits == 64 ? "%rsp" : "%esp");
+}
@@ -0,0 +1,77 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * strength_reduce.h - Declares the functions associated with
+ * strength reduction: generating the multiplications, divisions
+ * and modulos by constants out of shifts, lea's and a multiply
+ * by a "magic number" instead of imul and idiv. They are shared
+ * by the 32 bit and x86-64 instruction selectors.
+ */
+
+#include <stdio.h>
+
+#ifndef STRENGTH_REDUCE
+#define STRENGTH_REDUCE
+
+struct astnode;
+
+
+/**
+ * isIntConstant - Returns whether node is an integer constant, storing
+ * its value in val if it is.
+ */
+_Bool isIntConstant(struct astnode *node, long long *val);
+
+
+/**
+ * isReducibleDivisor - Returns whether a division or modulo by the
+ * constant d is generated without an idiv. Division by 0 is left for
+ * idiv to trap on, as are the divisors that don't fit in an immediate.
+ */
+_Bool isReducibleDivisor(long long d);
+
+
+/**
+ * isPowerOfTwoDivisor - Returns whether the absolute value of the
+ * divisor d is a power of two (including 1).
+ */
+_Bool isPowerOfTwoDivisor(long long d);
+
+
+/**
+ * computeMagic - Computes the magic number multiplier and the shift that
+ * divide a signed bits (32 or 64) bit integer by d >= 2, as in Hacker's
+ * Delight: x / d is the high half of multiplier * x, plus x when the
+ * multiplier is negative, shifted right by shift, plus one if x < 0.
+ */
+void computeMagic(long long d, int bits, long long *multiplier, int *shift);
+
+
+/**
+ * generateConstMultiply - Generates the assembly that multiplies the
+ * register reg of a bits (32 or 64) bit target by the constant c, with a
+ * shift or an lea where one does, and an imul by the immediate otherwise.
+ */
+void generateConstMultiply(char *reg, long long c, int bits, FILE *body_output);
+
+
+/**
+ * generatePow2Divide - Generates the assembly that divides the register
+ * reg by the constant d (whose absolute value is a power of two), or takes
+ * its modulo, rounding towards 0 as C does. tmp is a free register.
+ */
+void generatePow2Divide(char *reg, char *tmp, long long d, _Bool is_modulo, int bits, FILE *body_output);
+
+
+/**
+ * generateMagicDivide - Generates the assembly that divides the dividend
+ * pushed on top of the stack by the constant d, or takes its modulo, with
+ * a multiply by d's magic number. The dividend is popped, and the quotient
+ * is left in %edx/%rdx or the remainder in %eax/%rax, both of which are
+ * overwritten.
+ */
+void generateMagicDivide(long long d, _Bool is_modulo, int bits, FILE *body_output);
+
+
+#endif
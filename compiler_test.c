@@ -3,7 +3,8 @@
  * By: Guy Bar Yosef
  *
  * compiler_test - A program to run the compiler
- * through whatever input is piped in.
+ * on a source file, through the integrated preprocessor,
+ * or through whatever preprocessed input is piped in.
  */
 
 
@@ -15,6 +16,8 @@
 #include "./front-end/front_end_header.h"
 #include "./front-end/lexer/lexer.c"
 #include "./front-end/parser/parser.c"
+#include "./front-end/preprocessor/preprocessor.h"
+#include "./front-end/parser/pch.h"
 #include "./back-end/assemb_gen.h"
 
 #include "./back-end/back_end_header.h"
@@ -23,80 +26,123 @@
 int main(int argc, char **argv) {
 
     // figure out file flags
-    char *output_name;
-    if (argc == 2) {
-        ast_pl = Minimal_Level; 
-        quads_pl = Minimal_Level;
-    }
-    else if (argc == 4 && !strcmp("p", argv[2])) {
-        if (!strcmp(argv[2], "1"))
-            ast_pl = Minimal_Level;
-        else if (!strcmp(argv[2], "2"))
-            ast_pl = Mid_Level;
-        else if (!strcmp(argv[2], "3"))
-            ast_pl = Verbose_Level;
-        else {
-            fprintf(stderr, "Correct Usage: %s [-p 1/2/3] [-n output_name]\n", argv[0]);
-            return -1;
+    char *output_name = NULL;
+    char *input_name = NULL;
+    _Bool preprocess_only = false;
+    _Bool generate_pch = false;
+    char **definitions = malloc(sizeof(char *) * argc);
+    int definition_count = 0;
+    ast_pl = Minimal_Level; 
+    quads_pl = Minimal_Level;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp("-p", argv[i]) && i + 2 < argc) {
+            if (!strcmp(argv[i+1], "1"))
+                ast_pl = Minimal_Level;
+            else if (!strcmp(argv[i+1], "2"))
+                ast_pl = Mid_Level;
+            else if (!strcmp(argv[i+1], "3"))
+                ast_pl = Verbose_Level;
+            else {
+                fprintf(stderr, "Correct Usage: %s [-p 1/2/3] [-n output_name]\n", argv[0]);
+                return -1;
+            }
+
+            if (!strcmp(argv[i+2], "1"))
+                quads_pl = Minimal_Level;
+            else if (!strcmp(argv[i+2], "2") || !strcmp(argv[i+2], "3"))
+                quads_pl = Mid_Level;
+            else {
+                fprintf(stderr, "Correct Usage: %s [-p 1/2/3 1/2/3] [-n output_name]\n", argv[0]);
+                return -1;
+            }   
+            i += 2;
         }
-
-        if (!strcmp(argv[3], "1"))
-            quads_pl = Minimal_Level;
-        else if (!strcmp(argv[3], "2") || !strcmp(argv[3], "3"))
-            quads_pl = Mid_Level;
-        else {
-            fprintf(stderr, "Correct Usage: %s [-p 1/2/3 1/2/3] [-n output_name]\n", argv[0]);
+        else if (!strcmp("-n", argv[i]) && i + 1 < argc) {
+            if (!strcmp(argv[i+1], "stdout"))
+                output_name = NULL;
+            else 
+                output_name = argv[i+1];
+            i += 1;
+        }
+        else if (!strcmp("-I", argv[i]) && i + 1 < argc)
+            addIncludePath(argv[++i]);
+        else if (!strncmp("-I", argv[i], 2))
+            addIncludePath(argv[i] + 2);
+        else if (!strcmp("-D", argv[i]) && i + 1 < argc)
+            definitions[definition_count++] = argv[++i];
+        else if (!strncmp("-D", argv[i], 2))
+            definitions[definition_count++] = argv[i] + 2;
+        else if (!strcmp("-E", argv[i]))
+            preprocess_only = true;
+        else if (!strcmp("-fpch-generate", argv[i]))
+            generate_pch = true;
+        else if (argv[i][0] != '-' && !input_name)
+            input_name = argv[i];
+        else if (!parseBackEndFlag(argv[i])) {
+            fprintf(stderr, "Correct Usage: %s [file.c] [-p 1/2/3 1/2] [-n output_name] [-E] [-I dir] [-D name[=value]] [-fpch-generate] "
+                            "[-m32/-m64] [-fprofile-generate[=file]] [-fprofile-use[=file]] "
+                            "[-ftree-vectorize] [-msse4.1] [-fschedule-insns] "
+                            "[-mtune=generic/skylake/znver2/atom] [-fif-conversion] [-fomit-frame-pointer] "
+                            "[-maccumulate-outgoing-args] [-fno-builtin]\n", argv[0]);
             return -1;
-        }   
+        }
     }
-    else if (argc == 3 && !strcmp("-n", argv[2])) {
 
-        if (!strcmp(argv[2], "stdout"))
-            output_name = NULL;
-        else 
-            output_name = argv[2];    
+    /* the -D macros are defined once the target is known, as the
+    predefined macros ahead of them depend on it */
+    for (int i = 0; i < definition_count; ++i)
+        defineMacro(definitions[i]);
+
+    /* initializes the front-end global vars, before preprocessing, as a
+    precompiled header that the source begins with is loaded into the
+    global scope */
+    initializeFrontEnd();   
+
+    /* a source file is preprocessed in-process, and the lexer scans its
+    expansion in place; without one, the input is already preprocessed
+    and streamed in from stdin */
+    char *source = NULL;
+    size_t source_size;
+    if (input_name && !(source = preprocessFile(input_name, &source_size)))
+        return -1;
+
+    if (preprocess_only) {
+        char line[LINESIZE];
+        if (source)
+            fwrite(source, 1, source_size - 2, stdout);
+        else
+            while (fgets(line, LINESIZE, stdin))
+                fputs(line, stdout);
+        return 0;
     }
-    else if (argc == 6) {
-        if (!strcmp(argv[2], "1"))
-            ast_pl = Minimal_Level;
-        else if (!strcmp(argv[2], "2"))
-            ast_pl = Mid_Level;
-        else if (!strcmp(argv[2], "3"))
-            ast_pl = Verbose_Level;
-        else {
-            fprintf(stderr, "Correct Usage: %s [-p 1/2/3] [-n output_name]\n", argv[0]);
+    if (source) {
+        yy_scan_buffer(source, source_size);
+        lex_in_place = true;
+    }
+
+    /* a header is saved as a precompiled header, rather than compiled */
+    if (generate_pch) {
+        if (!input_name) {
+            fprintf(stderr, "Error: -fpch-generate needs a header file\n");
             return -1;
         }
-
-        if (!strcmp(argv[3], "1"))
-            quads_pl = Minimal_Level;
-        else if (!strcmp(argv[3], "2") || !strcmp(argv[3], "3"))
-            quads_pl = Mid_Level;
-        else {
-            fprintf(stderr, "Correct Usage: %s [-p 1/2/3 1/2/3] [-n output_name]\n", argv[0]);
+        if (yyparse() || error_count)
             return -1;
-        }   
-
-        if (!strcmp(argv[5], "stdout"))
-            output_name = NULL;
-        else 
-            output_name = argv[5];
-    }
-    else {
-        fprintf(stderr, "Correct Usage: %s [-p 1/2/3 1/2] [-n output_name]\n", argv[0]);
-        return -1;
+        return generatePrecompiledHeader(input_name) ? 0 : -1;
     }
 
-    /* initializes the front-end global vars */
-    initializeFrontEnd();   
+    /* the back-end is set up first, as each function is compiled as soon as
+    the front-end has parsed it */
+    initializeRegisterCollection();
+    beginAssemb(output_name);
+    compile_functions = true;
 
     /* run front-end */
     yyparse();  
 
-    /* run back-end */
-    initializeRegisterCollection();
-
-    generateAssemb32(output_name);   
+    /* run what is left of the back-end */
+    finishAssemb();   
 
     return 0;
 }
\ No newline at end of file
@@ -30,7 +30,6 @@ void initializeFrontEnd() {
 
     /* IR generic code initialization */
     cur_basic_block = NULL;
-    cur_quad_ll = NULL;
     continue_bb = NULL;
     break_bb = NULL;
   
@@ -34,7 +34,6 @@ struct YYstr {
 enum PrintLevel { Minimal_Level = 1, Mid_Level, Verbose_Level};
 
 #define LINESIZE 1024
-#define MAX_STRLIT_SIZE 2048
 
 
 #ifndef EXTERN_VAR
@@ -45,18 +44,18 @@ EXTERN_VAR int cur_line_num;		            /* current line number	            */
 EXTERN_VAR int error_count;                     /* Counts errors - stops after 10   */
 EXTERN_VAR char cur_file_name[LINESIZE+1];		/* current file name                */
 EXTERN_VAR char tmp[20];						/* temp helper variable             */
-EXTERN_VAR char strlit_buffer[MAX_STRLIT_SIZE]; /* buffer for string literals       */
+EXTERN_VAR _Bool lex_in_place;                  /* the lexer scans its whole input from one buffer */
 EXTERN_VAR char *helper_end, *helper_begin; 
 EXTERN_VAR int yycolumn;                        /* implements locations for the lexer */
 EXTERN_VAR enum PrintLevel ast_pl;              /* the level of which to print asts */
 EXTERN_VAR enum PrintLevel quads_pl;            /* the level of which to print quads*/
 
 EXTERN_VAR struct BB_ll bb_ll;                 /* a linked list of basic blocks- 1 for each function in input */
-EXTERN_VAR struct QuadLLNode *cur_quad_ll;      /* the current quad linked list to append to      */
 EXTERN_VAR struct BasicBlock *cur_basic_block;  /* the current basic block to append to           */
 EXTERN_VAR struct BasicBlock *continue_bb;      /* the basic block that a continue stmt points to */
 EXTERN_VAR struct BasicBlock *break_bb;         /* the basic block that a break stmt points to    */
 EXTERN_VAR FILE *output_file;                   /* the output file that will be written to        */
+EXTERN_VAR _Bool compile_functions;             /* compile each function as soon as it is parsed  */
 
 
 
@@ -10,7 +10,9 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <limits.h>
+#include <ctype.h>
 
 #include "../front_end_header.h"
 #include "lheader.h"
@@ -132,6 +134,106 @@ void checkNumberTypes(YYSTYPE *yylval, char *yytext) {
 }
 
 
+/* The string literal arena: literals are appended one after the other
+   into large chunks, which are never freed, as the AST keeps pointing
+   into them. A literal that outgrows what is left of its chunk is moved
+   to a new chunk, large enough for it, and the old one is left with the
+   literals before it. */
+#define STRLIT_CHUNK_SIZE 65536
+
+static char *strlit_chunk = NULL;
+static size_t strlit_chunk_size = 0;
+static size_t strlit_used = 0;      /* where the literal being scanned begins */
+static size_t strlit_length = 0;    /* and how long it is so far */
+
+
+/*
+ * strlitBegin - Begins a new literal in the string literal arena.
+ */
+void strlitBegin() {
+    strlit_length = 0;
+}
+
+
+/*
+ * strlitAppend - Appends count characters to the literal being scanned.
+ */
+void strlitAppend(char *chars, int count) {
+    if (strlit_used + strlit_length + count + 1 > strlit_chunk_size) {
+        size_t size = STRLIT_CHUNK_SIZE;
+        while (size < 2*(strlit_length + count + 1))
+            size *= 2;
+
+        char *chunk = malloc(size);
+        if (!chunk) {
+            fprintf(stderr, "Error allocating space for string literals\n");
+            exit(-1);
+        }
+        if (strlit_length)
+            memcpy(chunk, strlit_chunk + strlit_used, strlit_length);
+        strlit_chunk = chunk;
+        strlit_chunk_size = size;
+        strlit_used = 0;
+    }
+
+    memcpy(strlit_chunk + strlit_used + strlit_length, chars, count);
+    strlit_length += count;
+}
+
+
+/*
+ * strlitEnd - Ends the literal being scanned, returning it, NUL terminated,
+ * and setting size to its length.
+ */
+char *strlitEnd(int *size) {
+    char *str;
+
+    strlitAppend("", 0);
+    str = strlit_chunk + strlit_used;
+    str[strlit_length] = 0;
+    *size = strlit_length;
+    strlit_used += strlit_length + 1;
+    return str;
+}
+
+
+/*
+ * strlitAppendCode - Appends the character that an octal or hex escape
+ * stands for, as an octal escape if it is in a string literal and can't be
+ * written out as it is.
+ */
+void strlitAppendCode(int code, _Bool in_string) {
+    char c = code, escape[5];
+
+    if (in_string && (!isprint(code) || c == '"' || c == '\\')) {
+        snprintf(escape, sizeof(escape), "\\%03o", code);
+        strlitAppend(escape, 4);
+    }
+    else
+        strlitAppend(&c, 1);
+}
+
+
+/*
+ * strlitConcat - Joins two adjacent string literals into one. A \0 that
+ * ends the first one is widened to \000, so that an octal digit that
+ * begins the second one doesn't become part of its escape.
+ */
+struct YYstr strlitConcat(struct YYstr left, struct YYstr right) {
+    int backslashes = 0;
+    for (int i = left.str_size - 2; i >= 0 && left.str[i] == '\\'; --i)
+        ++backslashes;
+
+    strlitBegin();
+    strlitAppend(left.str, left.str_size);
+    if (backslashes % 2 && left.str[left.str_size-1] == '0')
+        strlitAppend("00", 2);
+    strlitAppend(right.str, right.str_size);
+    left.str = strlitEnd(&left.str_size);
+    return left;
+}
+
+
 /* 
  * yyerror - The function that gets called when an error occurs in both
  * the lexer and and parser.
@@ -139,6 +241,7 @@ void checkNumberTypes(YYSTYPE *yylval, char *yytext) {
 int yyerror (char const *err_str) {
     fprintf(stderr, "%s:%d:%d Error: %s\n", 
                 cur_file_name, cur_line_num, yylloc.last_column, err_str);
+    ++error_count;
 
     return 0;
 }
@@ -48,6 +48,34 @@ char *stringFromTokens(enum yytokentype f);
 void checkNumberTypes(YYSTYPE *yylval, char *yytext);
 
 
+/*
+ * strlitBegin, strlitAppend, strlitEnd - Build a literal that has escapes
+ * to convert up in the string literal arena, a growable set of large
+ * chunks, rather than in a fixed size buffer: strlitBegin starts a new
+ * literal, strlitAppend appends count characters to it, and strlitEnd
+ * returns it, NUL terminated, with size set to its length.
+ */
+void strlitBegin();
+void strlitAppend(char *chars, int count);
+char *strlitEnd(int *size);
+
+
+/*
+ * strlitAppendCode - Appends the character that an octal or hex escape
+ * stands for. String literals are written out with their escapes kept, so
+ * into one (in_string), a character that isn't printable, or is a quote
+ * or backslash, goes as a three digit octal escape instead.
+ */
+void strlitAppendCode(int code, _Bool in_string);
+
+
+/*
+ * strlitConcat - Joins two adjacent string literals into one, in the
+ * string literal arena.
+ */
+struct YYstr strlitConcat(struct YYstr left, struct YYstr right);
+
+
 /* 
  * yyerror - The function that gets called when an error occurs in both
  * the lexer and and parser.
@@ -0,0 +1,286 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * if_convert.c - Implements the functions declared in
+ * the header file 'if_convert.h'.
+ *
+ * A converted if statement or ?: computes both of its values into
+ * temps first, then compares the condition's operands, and finishes
+ * with a CMOV quad picking one of the values by the compare's flags:
+ *      t1 = a
+ *      t2 = b
+ *      CMP cond_left, cond_right
+ *      CMOV_LT x, t1, t2       (x = flags say less ? t1 : t2)
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "quads.h"
+#include "if_convert.h"
+#include "../front_end_header.h"
+#include "../lexer/lheader.h"
+#include "../lexer/lheader2.h"
+#include "symbol_table.h"
+#include "pheader_ast.h"
+#include "../../back-end/assemb_gen.h"
+
+
+/**
+ * isVolatile - Returns whether a variable was declared volatile.
+ */
+static _Bool isVolatile(astnode *var) {
+    enum SymbolTableTypeQualifiers qual = var->stable_entry.var.type_qualifier;
+    return qual == V || qual == CV || qual == VR || qual == CVR;
+}
+
+
+/**
+ * isIntVar - Returns whether a node is a non-volatile int variable.
+ */
+static _Bool isIntVar(astnode *node) {
+    return node && node->nodetype == STABLE_VAR && !isVolatile(node) &&
+           node->stable_entry.node->nodetype == SCALAR_TYPE &&
+           node->stable_entry.node->scalar_type.type == Int;
+}
+
+
+/**
+ * valueCost - Returns about how many cycles an int expression takes to
+ * compute, or -1 if it can't be computed unless it is picked: it could
+ * have a side effect, trap (a division or a dereference) or be a float.
+ */
+static int valueCost(astnode *node) {
+    int left, right;
+
+    switch (node->nodetype) {
+        case NUM_TYPE:
+            return node->num.types & NUMMASK_INTGR ? 0 : -1;
+        case CHRLIT_TYPE:
+            return 0;
+        case STABLE_VAR:
+            return isIntVar(node) ? 0 : -1;
+        case UNOP_TYPE:
+            if (node->unop.op != '-' && node->unop.op != '+' &&
+                node->unop.op != '~' && node->unop.op != '!')
+                return -1;
+            left = valueCost(node->unop.expr);
+            return left < 0 ? -1 : left + 1;
+        case BINOP_TYPE:
+            if (node->binop.op != '+' && node->binop.op != '-' && node->binop.op != '*' &&
+                node->binop.op != '&' && node->binop.op != '|' && node->binop.op != '^')
+                return -1;
+            left = valueCost(node->binop.left);
+            right = valueCost(node->binop.right);
+            if (left < 0 || right < 0)
+                return -1;
+            return left + right + (node->binop.op == '*' ? 3 : 1);
+        default:
+            return -1;
+    }
+}
+
+
+/**
+ * hasSideEffect - Returns whether evaluating an expression could change a
+ * variable: it calls a function, assigns or increments. As both values are
+ * computed before the condition, they would miss what it changed.
+ */
+static _Bool hasSideEffect(astnode *node) {
+    if (!node)
+        return false;
+
+    switch (node->nodetype) {
+        case FNC_CALL:
+        case ASS_TYPE:
+            return true;
+        case BINOP_TYPE:
+        case COMPARE_TYPE:
+        case LOG_TYPE:
+            return hasSideEffect(node->binop.left) || hasSideEffect(node->binop.right);
+        case UNOP_TYPE:
+            if (node->unop.op == PLUSPLUS || node->unop.op == MINUSMINUS)
+                return true;
+            // fall through
+        case DEREF_TYPE:
+        case ADDR_TYPE:
+            return hasSideEffect(node->unop.expr);
+        case SLCT_TYPE:
+            return hasSideEffect(node->slct.left);
+        case TERNARY_TYPE:
+            return hasSideEffect(node->ternary.if_expr) || hasSideEffect(node->ternary.then_expr) ||
+                   hasSideEffect(node->ternary.else_expr);
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * hasDivision - Returns whether an expression divides or takes a modulo.
+ * Its lowering needs registers of its own, and on x86-32 there aren't
+ * enough of them left while both values are held for the compare.
+ */
+static _Bool hasDivision(astnode *node) {
+    if (!node)
+        return false;
+
+    switch (node->nodetype) {
+        case BINOP_TYPE:
+            if (node->binop.op == '/' || node->binop.op == '%')
+                return true;
+            // fall through
+        case COMPARE_TYPE:
+        case LOG_TYPE:
+            return hasDivision(node->binop.left) || hasDivision(node->binop.right);
+        case UNOP_TYPE:
+        case DEREF_TYPE:
+        case ADDR_TYPE:
+            return hasDivision(node->unop.expr);
+        case SLCT_TYPE:
+            return hasDivision(node->slct.left);
+        case TERNARY_TYPE:
+            return hasDivision(node->ternary.if_expr) || hasDivision(node->ternary.then_expr) ||
+                   hasDivision(node->ternary.else_expr);
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * isIntCondition - Returns whether a condition is one that a single
+ * compare decides: an integer comparison, a ! of an integer expression or
+ * an integer expression (compared to 0), without && or || or ?:, side
+ * effects or divisions in it.
+ */
+static _Bool isIntCondition(astnode *cond) {
+    if (hasBranchingValue(cond) || hasSideEffect(cond) || hasDivision(cond) || exprFloatClass(cond))
+        return false;
+    if (cond->nodetype == COMPARE_TYPE)
+        return !exprFloatClass(cond->binop.left) && !exprFloatClass(cond->binop.right);
+    if (cond->nodetype == UNOP_TYPE && cond->unop.op == '!')
+        return isIntCondition(cond->unop.expr) && cond->unop.expr->nodetype != COMPARE_TYPE;
+    return true;
+}
+
+
+/**
+ * genCondMove - Generates the quads of des = cond ? then_val : else_val,
+ * computing both values before the compare whose flags pick one.
+ */
+static void genCondMove(astnode *des, astnode *cond, astnode *then_val, astnode *else_val) {
+    astnode *then_tmp = genRvalue(then_val, NULL);
+    astnode *else_tmp = genRvalue(else_val, NULL);
+
+    struct YYnum num_val;
+    num_val.types = NUMMASK_INTGR | NUMMASK_INT;
+    num_val.val = 0;
+
+    enum QuadOpcode op;
+    if (cond->nodetype == COMPARE_TYPE) {
+        astnode *left = genRvalue(cond->binop.left, NULL);
+        astnode *right = genRvalue(cond->binop.right, NULL);
+        emitQuad(CMP, NULL, left, right);
+
+        switch (cond->binop.op) {
+            case '<':   op = CMOV_LT;   break;
+            case '>':   op = CMOV_GT;   break;
+            case LTEQ:  op = CMOV_LE;   break;
+            case GTEQ:  op = CMOV_GE;   break;
+            case EQEQ:  op = CMOV_EQ;   break;
+            default:    op = CMOV_NEQ;  break;
+        }
+    }
+    else if (cond->nodetype == UNOP_TYPE && cond->unop.op == '!') {
+        emitQuad(CMP, NULL, genRvalue(cond->unop.expr, NULL), newNode_num(num_val));
+        op = CMOV_EQ;
+    }
+    else {
+        emitQuad(CMP, NULL, genRvalue(cond, NULL), newNode_num(num_val));
+        op = CMOV_NEQ;
+    }
+
+    emitQuad(op, des, then_tmp, else_tmp);
+}
+
+
+/**
+ * assignedValue - Returns the assignment x = value that a statement
+ * (possibly in braces) consists of, or NULL if it is anything else.
+ */
+static astnode *assignedValue(astnode *stmt) {
+    if (stmt && stmt->nodetype == COMPOUND_STMT) {
+        AstnodeLinkedListNode *first = stmt->compound_stmt.astnode_ll->first;
+        if (!first || first->next)
+            return NULL;
+        stmt = first->node;
+    }
+
+    if (!stmt || stmt->nodetype != ASS_TYPE || stmt->assignment.op != '=' ||
+        !isIntVar(stmt->assignment.left))
+        return NULL;
+    return stmt;
+}
+
+
+/**
+ * ifConvertConditionalIR - Generates an if statement as a conditional
+ * move, if it is one of
+ *      if (cond) x = a; else x = b;
+ *      if (cond) x = a;
+ * for an int variable x, an integer condition without && or || or side
+ * effects, and values a and b that can be computed whether or not they are
+ * picked (no calls, assignments, dereferences or divisions) cheaply.
+ * Returns whether it was.
+ */
+_Bool ifConvertConditionalIR(astnode *node) {
+    if (!be_flags.if_conversion || !isIntCondition(node->conditional_stmt.expr))
+        return false;
+
+    astnode *then_ass = assignedValue(node->conditional_stmt.if_node);
+    if (!then_ass)
+        return false;
+
+    // without an else, x keeps its value
+    astnode *var = then_ass->assignment.left;
+    astnode *else_val = var;
+    if (node->conditional_stmt.else_node) {
+        astnode *else_ass = assignedValue(node->conditional_stmt.else_node);
+        if (!else_ass || else_ass->assignment.left != var)
+            return false;
+        else_val = else_ass->assignment.right;
+    }
+
+    int then_cost = valueCost(then_ass->assignment.right);
+    int else_cost = valueCost(else_val);
+    if (then_cost < 0 || else_cost < 0 || then_cost + else_cost > MAX_IF_CONVERT_COST)
+        return false;
+
+    genCondMove(var, node->conditional_stmt.expr, then_ass->assignment.right, else_val);
+    return true;
+}
+
+
+/**
+ * ifConvertTernaryIR - Generates a ?: expression as a conditional move,
+ * under the same conditions as ifConvertConditionalIR, into target (or a
+ * new temp when it is NULL). Returns the target, or NULL if the expression
+ * has to branch.
+ */
+astnode *ifConvertTernaryIR(astnode *node, astnode *target) {
+    if (!be_flags.if_conversion || !isIntCondition(node->ternary.if_expr))
+        return NULL;
+
+    int then_cost = valueCost(node->ternary.then_expr);
+    int else_cost = valueCost(node->ternary.else_expr);
+    if (then_cost < 0 || else_cost < 0 || then_cost + else_cost > MAX_IF_CONVERT_COST)
+        return NULL;
+
+    if (!target) target = newGenericTemp();
+    genCondMove(target, node->ternary.if_expr, node->ternary.then_expr, node->ternary.else_expr);
+    return target;
+}
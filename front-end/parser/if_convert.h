@@ -0,0 +1,45 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * if_convert.h - Declares the functions associated with
+ * if-conversion: turning ?: expressions and if statements
+ * that only pick which value a variable is assigned into
+ * a conditional move, rather than branches that mispredict
+ * whenever the condition depends on the data.
+ */
+
+#ifndef IF_CONVERT
+#define IF_CONVERT
+
+struct astnode;
+
+
+/* The most that the two values picked between may cost, in about the
+   cycles it takes to compute them. A mispredicted branch costs 15-20
+   cycles, while a cmov has to compute both of them every time. */
+#define MAX_IF_CONVERT_COST 4
+
+
+/**
+ * ifConvertConditionalIR - Generates an if statement as a conditional
+ * move, if it is one of
+ *      if (cond) x = a; else x = b;
+ *      if (cond) x = a;
+ * for an int variable x, an integer condition without && or ||, and values
+ * a and b that can be computed whether or not they are picked (no calls,
+ * assignments, dereferences or divisions) cheaply. Returns whether it was.
+ */
+_Bool ifConvertConditionalIR(struct astnode *node);
+
+
+/**
+ * ifConvertTernaryIR - Generates a ?: expression as a conditional move,
+ * under the same conditions as ifConvertConditionalIR, into target (or a
+ * new temp when it is NULL). Returns the target, or NULL if the expression
+ * has to branch.
+ */
+struct astnode *ifConvertTernaryIR(struct astnode *node, struct astnode *target);
+
+
+#endif
@@ -13,6 +13,7 @@
     #include "./symbol_table.h"
     #include "./pheader_ast.h"
     #include "./quads.h"
+    #include "../../back-end/assemb_gen.h"
 %}
 
 /* Specify bison header file of token and YYSTYPE definitions.
@@ -73,6 +74,7 @@
 %type <astnode_p> direct-comp-sel indirect-comp-sel
 %type <astnode_p> postfix-expr subscript-expr component-sel-expr function-call postinc-expr postdec-expr
 %type <astnode_p> primary-expr
+%type <str> string-literal
 
 
 /**************************** STATEMENT GRAMMAR-TYPES ****************************/
@@ -138,10 +140,15 @@ primary-expr: IDENT     {
                 }
             | CHARLIT       { $$ = newNode_str(CHARLIT, $1); }
             | NUMBER        { $$ = newNode_num($1);          }
-            | STRING        { $$ = newNode_str(STRING, $1);  }
+            | string-literal { $$ = newNode_str(STRING, $1);  }
             | '(' expr ')'  { $$ = $2; }
             ; 
 
+/* adjacent string literals are joined into one */
+string-literal: STRING                  { $$ = $1; }
+              | string-literal STRING   { $$ = strlitConcat($1, $2); }
+              ;
+
 
 /* postfix expressions */
 postfix-expr: primary-expr          { $$ = $1; }               
@@ -728,7 +735,7 @@ type-name: decl-specifiers {
                     yyerror("Specifying storage class for abstract type");
                 else {
                     astnode *tmp = newNode_sTableEntry($1);
-                    $$ = tmp->stable_entry.node;
+                    $$ = internType(tmp->stable_entry.node);
                     free(tmp);
                 }
             }
@@ -760,7 +767,7 @@ type-name: decl-specifiers {
                         case FNC_TYPE: tmp2->fnc_type.return_type = tmp3->stable_entry.node;  break;
                     }
 
-                    $$ = $2;
+                    $$ = internType($2);
                     free(tmp3);
                 }
             }
@@ -875,10 +882,13 @@ declaration: decl-specifiers ';'    {
 
 
                         /* check if we are in global scope, as this will make
-                        variables extern by default instead of auto. */
+                        variables extern by default instead of auto. A static
+                        function stays static, for the back-end to know that
+                        nothing outside the file calls it. */
                         if  (   scope_stack.innermost_scope->scope_type == File &&
                                 ($$->list[i]->stable_entry.type == Variable_Type ||
-                                $$->list[i]->stable_entry.type == Function_Type)
+                                ($$->list[i]->stable_entry.type == Function_Type &&
+                                $$->list[i]->stable_entry.fnc.storage_class != Static))
                             )
                             $$->list[i]->stable_entry.var.storage_class = Extern;
 
@@ -1079,6 +1089,7 @@ struct-type-def: STRUCT '{' field-list '}' {
                     /* insert fields into the struct */
                     for (int i = 0; i < $3->len; ++i)
                         sTableInsert($$->stable_entry.sutag.su_table, $3->list[i], 0);
+                    layoutStructMembers($$, $3, false);
                 }
                | STRUCT struct-tag  {
                         /* NOTE: this struct will be inserted into the symbol table (if not there already) */
@@ -1118,6 +1129,7 @@ struct-type-def: STRUCT '{' field-list '}' {
                             sTableInsert($$->stable_entry.sutag.su_table, $5->list[i], 0);
                         }
 
+                        layoutStructMembers($$, $5, false);
                         $$->stable_entry.sutag.is_defined = 1;
 
                         if (!searchStackScope(SU_TAG_NAMESPACE, $$->stable_entry.ident))
@@ -1126,7 +1138,7 @@ struct-type-def: STRUCT '{' field-list '}' {
                ;
 
 struct-type-ref: STRUCT struct-tag {                    
-                    if (!($$ = sTableLookUp(scope_stack.innermost_scope->tables[SU_TAG_NAMESPACE], $2.str))) {  
+                    if (!($$ = searchStackScope(SU_TAG_NAMESPACE, $2.str))) {  
                         //* create a forward, incomplete declaration */
                         TmpSymbolTableEntry *new_struct = createTmpSTableEntry();
                         new_struct->type = S_Tag_Type;
@@ -1188,6 +1200,7 @@ union-type-def: UNION '{' field-list '}' {
                     /* insert fields into the union */
                     for (int i = 0; i < $3->len; ++i)
                         sTableInsert($$->stable_entry.sutag.su_table, $3->list[i], 0);
+                    layoutStructMembers($$, $3, true);
                 }
               | UNION union-tag {
                         /* NOTE: this union will be inserted into the symbol table (if not there already) */
@@ -1227,6 +1240,7 @@ union-type-def: UNION '{' field-list '}' {
                             sTableInsert($$->stable_entry.sutag.su_table, $5->list[i], 0);
                         }
 
+                        layoutStructMembers($$, $5, true);
                         $$->stable_entry.sutag.is_defined = 1;
 
                         if (!searchStackScope(SU_TAG_NAMESPACE, $$->stable_entry.ident))
@@ -1236,7 +1250,7 @@ union-type-def: UNION '{' field-list '}' {
 
 union-type-ref: UNION union-tag { 
 
-                    if (!($$ = sTableLookUp(scope_stack.innermost_scope->tables[SU_TAG_NAMESPACE], $2.str))) {  /* create a forward, incomplete declaration */
+                    if (!($$ = searchStackScope(SU_TAG_NAMESPACE, $2.str))) {  /* create a forward, incomplete declaration */
                         TmpSymbolTableEntry *new_union = createTmpSTableEntry();
                         new_union->type = U_Tag_Type;
                         new_union->su_tag_is_defined = 0;
@@ -1458,7 +1472,9 @@ function-def: decl-specifiers declarator  {
             if ($<astnode_p>$ = searchStackScope(GENERAL_NAMESPACE, $2->stable_entry.ident)) {
                 $<astnode_p>$->stable_entry.type = Function_Type;
                 $<astnode_p>$->nodetype = STABLE_FNC_DEFINITION;
-                $<astnode_p>$->stable_entry.node->fnc_type.fnc_body = NULL;
+                /* a prototype keeps its return type apart, without a function type node */
+                if ($<astnode_p>$->stable_entry.node)
+                    $<astnode_p>$->stable_entry.node->fnc_type.fnc_body = NULL;
                 $<astnode_p>$->stable_entry.line_num = cur_line_num;
                 $<astnode_p>$->stable_entry.file_name = cur_file_name;
             }
@@ -1471,7 +1487,8 @@ function-def: decl-specifiers declarator  {
                 $<astnode_p>$->stable_entry.type = Function_Type;
                 $<astnode_p>$->nodetype = STABLE_FNC_DEFINITION;
                 $<astnode_p>$->stable_entry.fnc.function_body = NULL;
-                $<astnode_p>$->stable_entry.fnc.storage_class = Extern;
+                if ($<astnode_p>$->stable_entry.fnc.storage_class != Static)
+                    $<astnode_p>$->stable_entry.fnc.storage_class = Extern;
                 
                 /* adding function to the scope above it */
                 sTableInsert(scope_stack.innermost_scope->tables[GENERAL_NAMESPACE], $<astnode_p>$, 0);
@@ -1487,7 +1504,7 @@ function-def: decl-specifiers declarator  {
    so that we could specify that this is a function scope and not a 
    block scope... probably could be avoided but not too bad a case
    of code duplication anyways... */
-function-body: '{' { createNewScope(Function, $<astnode_p>-1->stable_entry.ident); } decl-or-stmt-list '}' {
+function-body: '{' { createNewScope(Function, $<astnode_p>-1->stable_entry.ident); beginFunctionNodes(); } decl-or-stmt-list '}' {
                 $$ = newNode_compoundStmt();
 
                 /* connect compound stmt to its astnodes */
@@ -1519,6 +1536,13 @@ declaration_or_fndef: /* empty */                           { /* NOTHING */ }
                             if (quads_pl == Mid_Level) 
                                 printBB_ll(&bb_ll);
                             printf("\n");
+
+                            /* the function is compiled right away, and then released,
+                            so that only one function's tree and quads are kept at a time */
+                            if (compile_functions)
+                                compileFunction($2, bb_ll.last->bb);
+                            else
+                                endFunctionNodes();
                         }
                     ;
 
@@ -0,0 +1,434 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * pch.c - Implements the functions declared in the header
+ * file 'pch.h'.
+ *
+ * A precompiled header is a PchHeader followed by four sections: the
+ * AST nodes reachable from the global scope's symbol tables, the tables
+ * themselves, the arrays of node pointers (the tables' data and the
+ * argument types of function types, each after its length) and the
+ * strings. Every pointer in them is saved as the offset into the file
+ * of what it points at, 0 being NULL, so the file doesn't depend on
+ * where it is mapped. Loading maps it in privately, writable, and adds
+ * the address it was mapped at to each pointer, after which the nodes
+ * are used in place, as if they were just parsed.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../front_end_header.h"
+#include "./pheader_ast.h"
+#include "./symbol_table.h"
+#include "./quads.h"
+#include "../preprocessor/preprocessor.h"
+#include "./pch.h"
+#include "../../back-end/assemb_gen.h"
+
+
+#define PCH_MAGIC "GUYCCPCH"
+#define PCH_VERSION 3
+
+/* the initial size of the hash table of objects, which doubles when half full */
+#define PCH_MAP_INIT_SIZE 1024
+
+enum PchSection { PCH_NODES = 0, PCH_TABLES, PCH_ARRAYS, PCH_STRINGS, PCH_SECTION_COUNT };
+
+typedef struct PchHeader {
+    char magic[8];
+    int version;
+    int node_size;          /* sizeof(astnode) of the compiler that saved it   */
+    int table_size;         /* and sizeof(SymbolTable)                          */
+    int target;             /* the target that its types were laid out for     */
+    int parsed_cleanly;     /* whether the header was parsed without errors    */
+    long section_offset[PCH_SECTION_COUNT];
+    long section_size[PCH_SECTION_COUNT];
+    long global_tables[3];  /* the global scope's table of each namespace      */
+    long state_offset;      /* the state of the preprocessor, as text          */
+} PchHeader;
+
+/* an object saved to a precompiled header */
+typedef struct PchObject {
+    void *ptr;              /* where it is in memory                           */
+    enum PchSection section;
+    long offset;            /* where it is within its section                  */
+    long size;
+    long length;            /* the number of slots, if it is an array          */
+} PchObject;
+
+typedef void (*PointerVisitor)(void **field, enum PchSection section, long length);
+
+static PchObject *objects = NULL;
+static int object_count = 0, object_capacity = 0;
+static int *object_map = NULL;          /* object index + 1, by address */
+static int object_map_size = 0;
+static long section_sizes[PCH_SECTION_COUNT];
+static astnode *unsupported = NULL;     /* the first node that can't be saved */
+static char *pch_base = NULL;           /* the file, when saving or loading it */
+static PchHeader *pch_header = NULL;
+
+
+/**
+ * visitNodePointers - Calls visit on each pointer field of an AST node,
+ * with the section that it points into. Returns false if the node is of
+ * a kind that a precompiled header can't hold.
+ */
+static _Bool visitNodePointers(astnode *node, PointerVisitor visit) {
+    switch (node->nodetype) {
+        case NUM_TYPE:
+        case CHRLIT_TYPE:
+        case SCALAR_TYPE:
+            return true;
+        case IDENT_TYPE:
+            visit((void **) &node->ident.str, PCH_STRINGS, 0);
+            return true;
+        case PTR_TYPE:
+            visit((void **) &node->ptr.pointee, PCH_NODES, 0);
+            return true;
+        case ARRAY_TYPE:
+            visit((void **) &node->arr.ptr, PCH_NODES, 0);
+            return true;
+        case FNC_TYPE:
+            visit((void **) &node->fnc_type.args_types, PCH_ARRAYS,
+                    node->fnc_type.arg_count > 0 ? node->fnc_type.arg_count : 0);
+            visit((void **) &node->fnc_type.return_type, PCH_NODES, 0);
+            return !node->fnc_type.fnc_body;
+        case STRUCT_TYPE:
+            visit((void **) &node->strct.stable, PCH_TABLES, 0);
+            return true;
+        case STABLE_VAR:
+        case STABLE_FNC_DECLARATOR:
+        case STABLE_SU_TAG:
+        case STABLE_ENUM_TAG:
+        case STABLE_ENUM_CONST:
+        case STABLE_TYPEDEF:
+        case STABLE_SU_MEMB:
+            visit((void **) &node->stable_entry.file_name, PCH_STRINGS, 0);
+            visit((void **) &node->stable_entry.ident, PCH_STRINGS, 0);
+            visit((void **) &node->stable_entry.node, PCH_NODES, 0);
+            break;
+        default:    /* function definitions, labels and expressions */
+            return false;
+    }
+
+    switch (node->nodetype) {
+        case STABLE_FNC_DECLARATOR:
+            visit((void **) &node->stable_entry.fnc.return_type, PCH_NODES, 0);
+            return !node->stable_entry.fnc.args_types && !node->stable_entry.fnc.function_body;
+        case STABLE_SU_TAG:
+            visit((void **) &node->stable_entry.sutag.su_table, PCH_TABLES, 0);
+            return true;
+        case STABLE_ENUM_CONST:
+            visit((void **) &node->stable_entry.enumconst.tag, PCH_NODES, 0);
+            return true;
+        case STABLE_TYPEDEF:
+            visit((void **) &node->stable_entry.typedef_name.equivalent_type, PCH_NODES, 0);
+            return true;
+        case STABLE_SU_MEMB:
+            visit((void **) &node->stable_entry.sumemb.type, PCH_NODES, 0);
+            return true;
+        default:
+            return true;
+    }
+}
+
+
+/**
+ * objectHash - Returns the bucket of the hash table of objects that the
+ * search for the object at ptr begins at.
+ */
+static int objectHash(void *ptr) {
+    unsigned long key = (unsigned long) ptr;
+    key ^= key >> 17;
+    key *= 0x9e3779b97f4a7c15UL;
+    return (int) ((key >> 32) & (object_map_size - 1));
+}
+
+
+/**
+ * findObject - Returns the index of the object at ptr, or -1 if it hasn't
+ * been collected.
+ */
+static int findObject(void *ptr) {
+    if (!object_map_size)
+        return -1;
+    for (int i = objectHash(ptr); object_map[i]; i = (i + 1) & (object_map_size - 1))
+        if (objects[object_map[i] - 1].ptr == ptr)
+            return object_map[i] - 1;
+    return -1;
+}
+
+
+/**
+ * addObject - Adds the object at ptr, of size bytes, to the end of its
+ * section.
+ */
+static void addObject(void *ptr, enum PchSection section, long size, long length) {
+    if (2*(object_count + 1) > object_map_size) {
+        free(object_map);
+        object_map_size = object_map_size ? 2*object_map_size : PCH_MAP_INIT_SIZE;
+        object_map = calloc(object_map_size, sizeof(int));
+
+        for (int j = 0; j < object_count; ++j) {
+            int i = objectHash(objects[j].ptr);
+            while (object_map[i])
+                i = (i + 1) & (object_map_size - 1);
+            object_map[i] = j + 1;
+        }
+    }
+    if (object_count == object_capacity) {
+        object_capacity = object_capacity ? 2*object_capacity : PCH_MAP_INIT_SIZE;
+        objects = realloc(objects, sizeof(PchObject)*object_capacity);
+    }
+
+    /* everything in a section stays 8 byte aligned */
+    objects[object_count] = (PchObject) {ptr, section, section_sizes[section], size, length};
+    section_sizes[section] += (size + 7) & ~7L;
+
+    int i = objectHash(ptr);
+    while (object_map[i])
+        i = (i + 1) & (object_map_size - 1);
+    object_map[i] = ++object_count;
+}
+
+
+/**
+ * collectPointer - Collects what a pointer field points at, and everything
+ * reachable from it, that hasn't been collected yet.
+ */
+static void collectPointer(void **field, enum PchSection section, long length) {
+    void *ptr = *field;
+    if (!ptr || findObject(ptr) >= 0)
+        return;
+
+    switch (section) {
+        case PCH_NODES:
+            addObject(ptr, section, sizeof(astnode), 0);
+            if (!visitNodePointers(ptr, collectPointer) && !unsupported)
+                unsupported = ptr;
+            break;
+        case PCH_TABLES:
+            addObject(ptr, section, sizeof(SymbolTable), 0);
+            collectPointer((void **) &((SymbolTable *) ptr)->data, PCH_ARRAYS, ((SymbolTable *) ptr)->size);
+            break;
+        case PCH_ARRAYS:
+            addObject(ptr, section, sizeof(long) + sizeof(astnode *)*length, length);
+            for (int i = 0; i < length; ++i)
+                collectPointer(&((void **) ptr)[i], PCH_NODES, 0);
+            break;
+        default:
+            addObject(ptr, section, strlen(ptr) + 1, 0);
+            break;
+    }
+}
+
+
+/**
+ * objectOffset - Returns the offset into the file of the object at ptr:
+ * for an array, that of its first slot, after its length.
+ */
+static long objectOffset(void *ptr) {
+    PchObject *object = &objects[findObject(ptr)];
+    long offset = sizeof(PchHeader) + object->offset;
+
+    for (int i = 0; i < (int) object->section; ++i)
+        offset += section_sizes[i];
+    return object->section == PCH_ARRAYS ? offset + (long) sizeof(long) : offset;
+}
+
+
+/**
+ * encodePointer - Replaces a pointer field, in the file being saved, by the
+ * offset into the file of what it points at.
+ */
+static void encodePointer(void **field, enum PchSection section, long length) {
+    (void) section;
+    (void) length;
+    if (*field)
+        *field = (void *) objectOffset(*field);
+}
+
+
+/**
+ * relocatePointer - Replaces a pointer field, in the file being loaded, by
+ * the address of what it points at.
+ */
+static void relocatePointer(void **field, enum PchSection section, long length) {
+    (void) section;
+    (void) length;
+    if (*field)
+        *field = pch_base + (long) *field;
+}
+
+
+/**
+ * canonicalizePointer - Replaces a pointer field of a loaded node by the
+ * canonical node of the type it points at (or of each type, for an array
+ * of them).
+ */
+static void canonicalizePointer(void **field, enum PchSection section, long length) {
+    if (section == PCH_NODES)
+        *field = internType(*field);
+    else if (section == PCH_ARRAYS && *field)
+        for (long i = 0; i < length; ++i)
+            ((astnode **) *field)[i] = internType(((astnode **) *field)[i]);
+}
+
+
+/**
+ * unsupportedName - Returns the name of an unsupported node, for its error.
+ */
+static char *unsupportedName(astnode *node) {
+    if (node->nodetype >= STABLE_VAR && node->nodetype <= STABLE_SU_MEMB && node->stable_entry.ident)
+        return node->stable_entry.ident;
+    return "a declaration";
+}
+
+
+_Bool generatePrecompiledHeader(char *header_name) {
+    if (error_count) {
+        fprintf(stderr, "%s: Error: a header with errors can't be precompiled\n", header_name);
+        return false;
+    }
+    if (bb_ll.first) {
+        fprintf(stderr, "%s: Error: a precompiled header can't define functions\n", header_name);
+        return false;
+    }
+
+    for (int i = 0; i < 3; ++i)
+        collectPointer((void **) &scope_stack.global_scope->tables[i], PCH_TABLES, 0);
+    if (unsupported) {
+        fprintf(stderr, "%s: Error: can't precompile %s\n", header_name, unsupportedName(unsupported));
+        return false;
+    }
+
+    char *state;
+    size_t state_size;
+    FILE *state_stream = open_memstream(&state, &state_size);
+    writePreprocessorState(state_stream);
+    fclose(state_stream);
+
+    PchHeader header = {PCH_MAGIC, PCH_VERSION, sizeof(astnode), sizeof(SymbolTable), be_flags.target, !error_count, {0}, {0}, {0}, 0};
+    long size = sizeof(PchHeader);
+    for (int i = 0; i < PCH_SECTION_COUNT; ++i) {
+        header.section_offset[i] = size;
+        header.section_size[i] = section_sizes[i];
+        size += section_sizes[i];
+    }
+    for (int i = 0; i < 3; ++i)
+        header.global_tables[i] = objectOffset(scope_stack.global_scope->tables[i]);
+    header.state_offset = size;
+    size += state_size + 1;
+
+    /* each object is copied into the file, and then its pointers encoded */
+    pch_base = calloc(1, size);
+    memcpy(pch_base, &header, sizeof(PchHeader));
+    for (int i = 0; i < object_count; ++i) {
+        PchObject *object = &objects[i];
+        char *copy = pch_base + header.section_offset[object->section] + object->offset;
+
+        switch (object->section) {
+            case PCH_NODES:
+                /* a node may be shorter than the astnode slot it is saved in */
+                memcpy(copy, object->ptr, nodeSize(((astnode *) object->ptr)->nodetype));
+                visitNodePointers((astnode *) copy, encodePointer);
+                break;
+            case PCH_TABLES:
+                memcpy(copy, object->ptr, sizeof(SymbolTable));
+                encodePointer((void **) &((SymbolTable *) copy)->data, PCH_ARRAYS, 0);
+                break;
+            case PCH_ARRAYS:
+                memcpy(copy, &object->length, sizeof(long));
+                memcpy(copy + sizeof(long), object->ptr, sizeof(astnode *)*object->length);
+                for (int j = 0; j < object->length; ++j)
+                    encodePointer(&((void **) (copy + sizeof(long)))[j], PCH_NODES, 0);
+                break;
+            default:
+                strcpy(copy, object->ptr);
+                break;
+        }
+    }
+    memcpy(pch_base + header.state_offset, state, state_size);
+
+    char *pch_name = malloc(strlen(header_name) + 5);
+    sprintf(pch_name, "%s.pch", header_name);
+    FILE *pch_file = fopen(pch_name, "wb");
+    if (!pch_file || fwrite(pch_base, 1, size, pch_file) != (size_t) size) {
+        fprintf(stderr, "%s: Error: can't write the precompiled header\n", pch_name);
+        return false;
+    }
+    fclose(pch_file);
+
+    free(pch_base);
+    free(state);
+    return true;
+}
+
+
+_Bool loadPrecompiledHeader(char *pch_name) {
+    struct stat st;
+    int fd = open(pch_name, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) || st.st_size < (off_t) sizeof(PchHeader)) {
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+
+    pch_base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pch_base == MAP_FAILED)
+        return false;
+
+    pch_header = (PchHeader *) pch_base;
+    if (memcmp(pch_header->magic, PCH_MAGIC, 8) || pch_header->version != PCH_VERSION ||
+            pch_header->node_size != sizeof(astnode) || pch_header->table_size != sizeof(SymbolTable) ||
+            pch_header->target != (int) be_flags.target || !pch_header->parsed_cleanly ||
+            pch_header->state_offset >= st.st_size || pch_base[st.st_size - 1] ||
+            !restorePreprocessorState(pch_base + pch_header->state_offset)) {
+        munmap(pch_base, st.st_size);
+        return false;
+    }
+
+    /* the arrays' slots, then the nodes and the tables, are relocated */
+    char *arrays = pch_base + pch_header->section_offset[PCH_ARRAYS];
+    for (long offset = 0; offset < pch_header->section_size[PCH_ARRAYS]; ) {
+        long length = *(long *) (arrays + offset);
+        void **slots = (void **) (arrays + offset + sizeof(long));
+
+        for (long j = 0; j < length; ++j)
+            relocatePointer(&slots[j], PCH_NODES, 0);
+        offset += sizeof(long) + sizeof(astnode *)*length;
+    }
+
+    astnode *nodes = (astnode *) (pch_base + pch_header->section_offset[PCH_NODES]);
+    for (long i = 0; i < pch_header->section_size[PCH_NODES]/(long) sizeof(astnode); ++i)
+        visitNodePointers(&nodes[i], relocatePointer);
+
+    /* the types were canonical when saved, and every node is pointed at the
+    canonical ones again, which are already interned for the types the
+    compiler made before loading it */
+    for (long i = 0; i < pch_header->section_size[PCH_NODES]/(long) sizeof(astnode); ++i)
+        visitNodePointers(&nodes[i], canonicalizePointer);
+
+    /* a table's data is moved to the heap, as it is freed when the table grows */
+    SymbolTable *tables = (SymbolTable *) (pch_base + pch_header->section_offset[PCH_TABLES]);
+    for (long i = 0; i < pch_header->section_size[PCH_TABLES]/(long) sizeof(SymbolTable); ++i) {
+        astnode **data = malloc(sizeof(astnode *)*tables[i].size);
+        relocatePointer((void **) &tables[i].data, PCH_ARRAYS, 0);
+        memcpy(data, tables[i].data, sizeof(astnode *)*tables[i].size);
+        tables[i].data = data;
+    }
+
+    for (int i = 0; i < 3; ++i)
+        scope_stack.global_scope->tables[i] = (SymbolTable *) (pch_base + pch_header->global_tables[i]);
+    return true;
+}
@@ -0,0 +1,36 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * pch.h - Declares the functions of precompiled headers: the
+ * global scope that parsing a header leaves behind (its typedefs,
+ * struct tags, prototypes and variables) and the macros that it
+ * defines, saved to a file that later compiles map back in when
+ * they include the header first, instead of parsing it again.
+ */
+
+#ifndef PRECOMPILED_HEADER
+#define PRECOMPILED_HEADER
+
+
+/**
+ * generatePrecompiledHeader - Saves the global scope and the state of the
+ * preprocessor, after parsing the header header_name, to header_name.pch
+ * (the -fpch-generate flag). Returns false if the header had errors or
+ * defines anything that can't be precompiled, such as a function.
+ */
+_Bool generatePrecompiledHeader(char *header_name);
+
+
+/**
+ * loadPrecompiledHeader - Maps in the precompiled header pch_name, making
+ * its declarations the global scope and defining its macros, if it was
+ * saved by a build of the compiler with the same node layout, for the
+ * same target and -D macros, from files that parsed cleanly and have not
+ * changed since.
+ * Returns whether it did.
+ */
+_Bool loadPrecompiledHeader(char *pch_name);
+
+
+#endif
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <errno.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 #include "../front_end_header.h"
 #include "../lexer/lheader.h"
@@ -24,17 +25,181 @@
 ////////////////////////////////////////////////////////
 
 
+/* The nodes are carved out of large zeroed chunks, one after the other,
+each taking only as much room as its own member of the union. While a
+function body is parsed, its nodes (other than types, which the canonical
+types and struct tags outlive it through) are carved out of chunks of their
+own, linked together so that they can be freed once it has been compiled. */
+#define NODE_POOL_CHUNK_SIZE (64*1024)
+typedef struct NodeChunk {
+    struct NodeChunk *next;
+} NodeChunk;
+#define NODE_CHUNK_HEADER ((sizeof(NodeChunk) + _Alignof(astnode) - 1) / _Alignof(astnode) * _Alignof(astnode))
+
+static char *node_pool = NULL;
+static size_t node_pool_left = 0;
+static char *body_pool = NULL;
+static size_t body_pool_left = 0;
+static NodeChunk *body_chunks = NULL;
+static _Bool in_function_body = 0;
+
+
 /**
- *  newNode_num - Creates a new AST node of type num.
+ * nodeSize - Returns how many bytes an AST node of the given type takes
+ * up: its nodetype, followed by its own member of the union, but never
+ * less than a register node, as the back-end turns temps into registers
+ * in place. Symbol table entries and argument lists, which are freed,
+ * are still whole astnodes.
  */
-astnode *newNode_num(struct YYnum num) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
+size_t nodeSize(int nodetype) {
+    size_t payload;
+
+    switch (nodetype) {
+        case IDENT_TYPE:        payload = sizeof(struct astnode_ident);         break;
+        case NUM_TYPE:          payload = sizeof(struct astnode_num);           break;
+        case BINOP_TYPE:
+        case COMPARE_TYPE:
+        case LOG_TYPE:          payload = sizeof(struct astnode_binop);         break;
+        case UNOP_TYPE:
+        case ADDR_TYPE:
+        case DEREF_TYPE:
+        case SIZEOF_TYPE:       payload = sizeof(struct astnode_unop);          break;
+        case STRLIT_TYPE:       payload = sizeof(struct astnode_strlit);        break;
+        case CHRLIT_TYPE:       payload = sizeof(struct astnode_chrlit);        break;
+        case ARG_TYPE:          payload = sizeof(struct astnode_arg);           break;
+        case FNC_CALL:          payload = sizeof(struct astnode_fnc);           break;
+        case SLCT_TYPE:         payload = sizeof(struct astnode_slct);          break;
+        case TERNARY_TYPE:      payload = sizeof(struct astnode_ternary);       break;
+        case ASS_TYPE:          payload = sizeof(struct astnode_assignment);    break;
+        case PTR_TYPE:          payload = sizeof(struct astnode_ptr);           break;
+        case ARRAY_TYPE:        payload = sizeof(struct astnode_arr);           break;
+        case SCALAR_TYPE:       payload = sizeof(struct astnode_scalar_type);   break;
+        case FNC_TYPE:          payload = sizeof(struct astnode_fnc_type);      break;
+        case STRUCT_TYPE:       payload = sizeof(struct astnode_struct);        break;
+        case CONDITIONAL_STMT:  payload = sizeof(struct astnode_conditional);   break;
+        case WHILE_STMT:        payload = sizeof(struct astnode_while);         break;
+        case DO_WHILE_STMT:     payload = sizeof(struct astnode_do_while);      break;
+        case FOR_STMT:          payload = sizeof(struct astnode_for_loop);      break;
+        case SWITCH_STMT:       payload = sizeof(struct astnode_switch);        break;
+        case BREAK_STMT:
+        case CONTINUE_STMT:     payload = sizeof(struct astnode_flow_control);  break;
+        case NULL_STMT:
+        case GOTO_STMT:         payload = sizeof(struct astnode_goto);          break;
+        case RETURN_STMT:       payload = sizeof(struct astnode_return);        break;
+        case COMPOUND_STMT:     payload = sizeof(struct astnode_scope_contents); break;
+        case BASIC_BLOCK_TYPE:  /* and LABEL_DEREF_HACK */
+            payload = sizeof(struct astnode_bb) > sizeof(struct labelDerefHack) ?
+                      sizeof(struct astnode_bb) : sizeof(struct labelDerefHack);
+            break;
+        case TEMP_REG_TYPE:
+        case REG_TYPE:          payload = sizeof(struct astnode_reg);           break;
+        default:
+            return sizeof(astnode);
+    }
+
+    if (payload < sizeof(struct astnode_reg))
+        payload = sizeof(struct astnode_reg);
+    size_t size = offsetof(astnode, num) + payload;
+    return (size + _Alignof(astnode) - 1) / _Alignof(astnode) * _Alignof(astnode);
+}
+
+
+/**
+ * newNodeChunk - Allocates a zeroed chunk of the node pool, exiting if it
+ * can't.
+ */
+static char *newNodeChunk() {
+    char *chunk = calloc(1, NODE_POOL_CHUNK_SIZE);
+    if (!chunk) {
         fprintf(stderr, "Error allocating memory for AST node: %s\n", 
                                                     strerror(errno));
         exit(-1);
     }
-    node->nodetype = NUM_TYPE;
+    return chunk;
+}
+
+
+/**
+ * allocNode - Allocates a zeroed AST node of the given type from the
+ * node pool, so that the nodes of a tree lie close together in memory.
+ */
+astnode *allocNode(int nodetype) {
+    size_t size = nodeSize(nodetype);
+    char **pool = &node_pool;
+    size_t *pool_left = &node_pool_left;
+
+    _Bool is_type = nodetype == SCALAR_TYPE || nodetype == PTR_TYPE || nodetype == ARRAY_TYPE ||
+                    nodetype == FNC_TYPE || nodetype == STRUCT_TYPE;
+    if (in_function_body && !is_type) {
+        pool = &body_pool;
+        pool_left = &body_pool_left;
+    }
+
+    if (size > *pool_left) {
+        *pool = newNodeChunk();
+        *pool_left = NODE_POOL_CHUNK_SIZE;
+
+        if (pool == &body_pool) {
+            NodeChunk *chunk = (NodeChunk *) body_pool;
+            chunk->next = body_chunks;
+            body_chunks = chunk;
+            body_pool += NODE_CHUNK_HEADER;
+            body_pool_left -= NODE_CHUNK_HEADER;
+        }
+    }
+
+    astnode *node = (astnode *) *pool;
+    *pool += size;
+    *pool_left -= size;
+
+    node->nodetype = nodetype;
+    return node;
+}
+
+
+/**
+ * beginFunctionNodes - Has the nodes allocated from here on, other than
+ * types, come from the chunks of a function body.
+ */
+void beginFunctionNodes() {
+    in_function_body = 1;
+    body_chunks = NULL;
+    body_pool_left = 0;
+}
+
+
+/**
+ * endFunctionNodes - Stops allocating from the chunks of the function body,
+ * returning them for freeFunctionNodes.
+ */
+NodeChunk *endFunctionNodes() {
+    NodeChunk *chunks = body_chunks;
+
+    in_function_body = 0;
+    body_chunks = NULL;
+    body_pool_left = 0;
+    return chunks;
+}
+
+
+/**
+ * freeFunctionNodes - Frees the chunks of a function body, and with them
+ * every node allocated from them.
+ */
+void freeFunctionNodes(NodeChunk *chunks) {
+    while (chunks) {
+        NodeChunk *next = chunks->next;
+        free(chunks);
+        chunks = next;
+    }
+}
+
+
+/**
+ *  newNode_num - Creates a new AST node of type num.
+ */
+astnode *newNode_num(struct YYnum num) {
+    astnode *node = allocNode(NUM_TYPE);
 
     node->num.types = num.types;
     node->num.val = num.val;
@@ -52,12 +217,7 @@ astnode *newNode_num(struct YYnum num) {
  * handle all of these differnet tokens together.
  */
 astnode *newNode_str(int token_name, struct YYstr str) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(token_name == STRING ? STRLIT_TYPE : IDENT_TYPE);
 
     switch(token_name) {
         case IDENT:
@@ -84,12 +244,7 @@ astnode *newNode_str(int token_name, struct YYstr str) {
  * (unary operation).
  */
 astnode *newNode_unop(int token_name) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(UNOP_TYPE);
 
     switch(token_name) {
         case SIZEOF:
@@ -115,12 +270,7 @@ astnode *newNode_unop(int token_name) {
  * (binary operation).
  */
 astnode *newNode_binop(int token_name) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(BINOP_TYPE);
 
     switch(token_name) {
         case '>':
@@ -154,13 +304,7 @@ astnode *newNode_binop(int token_name) {
  * of arguments is unknown.
  */
 astnode *newNode_fnc() {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = FNC_CALL;
+    astnode *node = allocNode(FNC_CALL);
     node->fnc.arg_count = 0;
     node->fnc.arguments = NULL;
     node->fnc.ident = NULL;
@@ -204,13 +348,7 @@ void expand_arglist(astnode *node) {
  * of type function argument.
  */
 astnode *newNode_arg(int num) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = ARG_TYPE;
+    astnode *node = allocNode(ARG_TYPE);
     node->arg.num = num;
     node->arg.expr = NULL;
     return node;
@@ -224,13 +362,7 @@ astnode *newNode_arg(int num) {
  *  - 0: Direct component selection.
  */
 astnode *newNode_slct() {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = SLCT_TYPE;
+    astnode *node = allocNode(SLCT_TYPE);
     node->slct.left = NULL;
     node->slct.right = NULL;
     return node;
@@ -242,13 +374,7 @@ astnode *newNode_slct() {
  * the ternary operator (expr ? res1 : res 2).
  */
 astnode *newNode_ternary() {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = TERNARY_TYPE;
+    astnode *node = allocNode(TERNARY_TYPE);
     node->ternary.if_expr = NULL;
     node->ternary.then_expr = NULL;
     node->ternary.else_expr = NULL;
@@ -261,13 +387,7 @@ astnode *newNode_ternary() {
  * assignment expression operator (=).
  */
 astnode *newNode_assment(int op) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = ASS_TYPE;
+    astnode *node = allocNode(ASS_TYPE);
     node->assignment.op = op;
     node->assignment.left = NULL;
     node->assignment.right = NULL;
@@ -279,13 +399,7 @@ astnode *newNode_assment(int op) {
  * newNode_ptr - Creates an AST node for a pointer.
  */
 astnode *newNode_ptr(enum SymbolTableTypeQualifiers qual) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = PTR_TYPE;
+    astnode *node = allocNode(PTR_TYPE);
     node->ptr.pointee = NULL;
     node->ptr.type_qualifier = qual;
     return node;
@@ -298,15 +412,11 @@ astnode *newNode_ptr(enum SymbolTableTypeQualifiers qual) {
  * An input of -1 indicates that it is an incomplete array type.
  */
 astnode *newNode_arr(int size) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = ARRAY_TYPE;
+    astnode *node = allocNode(ARRAY_TYPE);
     node->arr.size = size;
     node->arr.ptr = newNode_ptr(None);
+    node->arr.byte_size = -1;
+    node->arr.align = 0;
     return node;
 }
 
@@ -314,13 +424,7 @@ astnode *newNode_arr(int size) {
  * newNodeType - Creates a new AST node for a scalar type.
  */
 astnode *newNode_scalarType(enum ScalarTypes type, _Bool is_signed) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = SCALAR_TYPE;
+    astnode *node = allocNode(SCALAR_TYPE);
     node->scalar_type.sign = is_signed;
     node->scalar_type.type = type;
     return node;
@@ -332,13 +436,7 @@ astnode *newNode_scalarType(enum ScalarTypes type, _Bool is_signed) {
  * function type.
  */
 astnode *newNode_fncType(int arg_len) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = FNC_TYPE;
+    astnode *node = allocNode(FNC_TYPE);
     node->fnc_type.arg_count = arg_len;
     if (arg_len > 0)
         node->fnc_type.args_types = calloc(arg_len, sizeof(astnode *));
@@ -354,13 +452,7 @@ astnode *newNode_fncType(int arg_len) {
  * the symbol table of a struct type.
  */
 astnode *newNode_strctType() {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = STRUCT_TYPE;
+    astnode *node = allocNode(STRUCT_TYPE);
     node->strct.stable = sTableCreate();
     return node;
 }
@@ -372,14 +464,8 @@ astnode *newNode_strctType() {
 astnode *newNode_conditionalStmt
         (astnode *expr, astnode *if_stmt, astnode *else_stmt) {
     
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(CONDITIONAL_STMT);
     
-    node->nodetype = CONDITIONAL_STMT;
     node->conditional_stmt.expr = expr;
     node->conditional_stmt.if_node = if_stmt;
     node->conditional_stmt.else_node = else_stmt;
@@ -392,14 +478,8 @@ astnode *newNode_conditionalStmt
  * a while loop statement.
  */
 astnode *newNode_whileStmt(astnode *expr, astnode *stmt) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(WHILE_STMT);
 
-    node->nodetype = WHILE_STMT;
     node->while_stmt.expr = expr;
     node->while_stmt.stmt = stmt;
 
@@ -412,14 +492,8 @@ astnode *newNode_whileStmt(astnode *expr, astnode *stmt) {
  * a do-while loop statment.
  */
 astnode *newNode_doWhileStmt(astnode *expr, astnode *stmt) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(DO_WHILE_STMT);
 
-    node->nodetype = DO_WHILE_STMT;
     node->while_stmt.expr = expr;
     node->while_stmt.stmt = stmt;
 
@@ -431,16 +505,7 @@ astnode *newNode_doWhileStmt(astnode *expr, astnode *stmt) {
  * a for loop statment.
  */
 astnode *newNode_forLoop() {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-
-    node->nodetype = FOR_STMT;
-
-    return node;
+    return allocNode(FOR_STMT);
 }   
 
 /**
@@ -448,14 +513,8 @@ astnode *newNode_forLoop() {
  * a switch statment.
  */
 astnode *newNode_switch(astnode *expr, astnode *stmt) {
-    astnode *node;
-    if ((node = malloc(sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
+    astnode *node = allocNode(SWITCH_STMT);
 
-    node->nodetype = SWITCH_STMT;
     node->switch_stmt.expr = expr;
     node->switch_stmt.stmt = stmt;
     node->switch_stmt.labels = NULL;
@@ -468,13 +527,7 @@ astnode *newNode_switch(astnode *expr, astnode *stmt) {
  * a flow control statment (break or continue statement).
  */
 astnode *newNode_flowControl() {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    return node;
+    return allocNode(BREAK_STMT);
 }
 
 /**
@@ -482,14 +535,7 @@ astnode *newNode_flowControl() {
  * a return statement.
  */
 astnode *newNode_returnStmt() {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = RETURN_STMT;
-    return node;
+    return allocNode(RETURN_STMT);
 }
 
 /**
@@ -497,14 +543,7 @@ astnode *newNode_returnStmt() {
  * a goto statement.
  */
 astnode *newNode_gotoStmt() {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    node->nodetype = GOTO_STMT;
-    return node;
+    return allocNode(GOTO_STMT);
 }
 
 
@@ -513,14 +552,7 @@ astnode *newNode_gotoStmt() {
  * a compound statnement.
  */
 astnode *newNode_compoundStmt() {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    
-    node->nodetype = COMPOUND_STMT;
+    astnode *node = allocNode(COMPOUND_STMT);
 
     node->compound_stmt.scope_layer = NULL;
     node->compound_stmt.astnode_ll = NULL;
@@ -537,14 +569,7 @@ astnode *newNode_compoundStmt() {
  * instead of only having access to a single statement.
  */
 astnode *newNode_labelHack(struct AstnodeLinkedListNode *ll_node) {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    
-    node->nodetype = LABEL_DEREF_HACK;
+    astnode *node = allocNode(LABEL_DEREF_HACK);
     node->label_deref_hack.ptr = ll_node;
     return node;   
 }
@@ -555,28 +580,14 @@ astnode *newNode_labelHack(struct AstnodeLinkedListNode *ll_node) {
  * newNode_bb - creates a new basic block node.
  */
 astnode *newNode_bb(struct BasicBlock *block) {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    
-    node->nodetype = BASIC_BLOCK_TYPE;
+    astnode *node = allocNode(BASIC_BLOCK_TYPE);
     node->bb_type.bb = block;
     return node;  
 }
 
 
 astnode *newNode_reg(char *name) {
-    astnode *node;
-    if ((node = calloc(1, sizeof(astnode))) == NULL) {
-        fprintf(stderr, "Error allocating memory for AST node: %s\n", 
-                                                    strerror(errno));
-        exit(-1);
-    }
-    
-    node->nodetype = REG_TYPE;
+    astnode *node = allocNode(REG_TYPE);
     node->reg_type.name = name;
     return node;  
 }
@@ -631,6 +642,8 @@ astnode *newNode_sTableEntry(TmpSymbolTableEntry *tmp_entry) {
             new_entry->nodetype = STABLE_SU_TAG;
             new_entry->stable_entry.sutag.is_defined = tmp_entry->su_tag_is_defined;
             new_entry->stable_entry.sutag.su_table = sTableCreate();
+            new_entry->stable_entry.sutag.size = 0;
+            new_entry->stable_entry.sutag.align = 1;
             break;
         case Enum_Tag:
             new_entry->nodetype = STABLE_ENUM_TAG;
@@ -665,6 +678,106 @@ astnode *newNode_sTableEntry(TmpSymbolTableEntry *tmp_entry) {
 }
 
 
+/* the canonical type nodes, hash-consed by their contents: an open
+addressing hash table of them, that doubles when half full */
+#define TYPE_TABLE_INIT_SIZE 256
+static astnode **type_table = NULL;
+static int type_table_size = 0, type_table_filled = 0;
+
+
+/**
+ * typeHash - Hashes a scalar, pointer or array type by its contents, which
+ * for the latter two are their canonical pointee.
+ */
+static unsigned long typeHash(astnode *type) {
+    unsigned long hash = type->nodetype;
+    switch (type->nodetype) {
+        case SCALAR_TYPE:
+            hash = hash*31 + type->scalar_type.type;
+            return hash*31 + type->scalar_type.sign;
+        case PTR_TYPE:
+            hash = hash*31 + ((unsigned long) type->ptr.pointee >> 4);
+            return hash*31 + type->ptr.type_qualifier;
+        default:
+            hash = hash*31 + ((unsigned long) type->arr.ptr >> 4);
+            return hash*31 + (unsigned) type->arr.size;
+    }
+}
+
+
+/**
+ * sameType - Returns whether two scalar, pointer or array types, whose
+ * pointees are canonical, are the same.
+ */
+static _Bool sameType(astnode *type1, astnode *type2) {
+    if (type1->nodetype != type2->nodetype)
+        return 0;
+    switch (type1->nodetype) {
+        case SCALAR_TYPE:
+            return type1->scalar_type.type == type2->scalar_type.type &&
+                   type1->scalar_type.sign == type2->scalar_type.sign;
+        case PTR_TYPE:
+            return type1->ptr.pointee == type2->ptr.pointee &&
+                   type1->ptr.type_qualifier == type2->ptr.type_qualifier;
+        default:
+            return type1->arr.ptr == type2->arr.ptr && type1->arr.size == type2->arr.size;
+    }
+}
+
+
+/**
+ * internType - Returns the canonical node of a type, which every type of
+ * the same structure shares, after making the types inside of it canonical.
+ */
+astnode *internType(astnode *type) {
+    if (!type)
+        return NULL;
+
+    switch (type->nodetype) {
+        case SCALAR_TYPE:
+            break;
+        case PTR_TYPE:
+            type->ptr.pointee = internType(type->ptr.pointee);
+            break;
+        case ARRAY_TYPE:
+            type->arr.ptr = internType(type->arr.ptr);
+            break;
+        case FNC_TYPE:
+            /* a function type is kept apart, as its definition fills in its body */
+            type->fnc_type.return_type = internType(type->fnc_type.return_type);
+            for (int i = 0; i < type->fnc_type.arg_count && type->fnc_type.args_types; ++i)
+                type->fnc_type.args_types[i] = internType(type->fnc_type.args_types[i]);
+            return type;
+        default:    /* struct and union tags are already unique */
+            return type;
+    }
+
+    if (2*(type_table_filled + 1) > type_table_size) {
+        astnode **old_table = type_table;
+        int old_size = type_table_size;
+
+        type_table_size = type_table_size ? 2*type_table_size : TYPE_TABLE_INIT_SIZE;
+        type_table = calloc(type_table_size, sizeof(astnode *));
+        for (int i = 0; i < old_size; ++i)
+            if (old_table[i]) {
+                int j = typeHash(old_table[i]) & (type_table_size - 1);
+                while (type_table[j])
+                    j = (j + 1) & (type_table_size - 1);
+                type_table[j] = old_table[i];
+            }
+        free(old_table);
+    }
+
+    int i = typeHash(type) & (type_table_size - 1);
+    for (; type_table[i]; i = (i + 1) & (type_table_size - 1))
+        if (sameType(type_table[i], type))
+            return type_table[i];
+
+    ++type_table_filled;
+    return type_table[i] = type;
+}
+
+
 /** 
  * The constructor for the astnode_list struct.
  * This struct will be used for a declarator list. 
@@ -1419,5 +1532,7 @@ void freeTree(astnode *root) {
             freeTree(root->fnc_type.args_types[i]);
     }
 
-    free(root);
+    /* only the nodes outside of the node pool can be freed one by one */
+    if (nodeSize(root->nodetype) == sizeof(astnode))
+        free(root);
 }
\ No newline at end of file
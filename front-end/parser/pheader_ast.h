@@ -123,6 +123,8 @@ struct astnode_ptr {
 struct astnode_arr {
     int size;
     struct astnode *ptr;
+    long long byte_size;    /* its size in bytes, once computed (-1 until then) */
+    int align;              /* its alignment, once computed (0 until then)      */
 };
 
 #define CONDITIONAL_STMT 50 /* conditional statement */
@@ -217,6 +219,7 @@ struct astnode_bb {
 #define REG_TYPE 300 /* a register type */
 struct astnode_reg {
     char *name;
+    int float_type;     /* Float or Double in an SSE register, Void otherwise */
 };
 
 ////////////////////////////////////////////////////////
@@ -273,6 +276,8 @@ struct stable_fnc {
 struct stable_sutag {
     _Bool is_defined;
     struct SymbolTable *su_table;
+    long long size;     /* its size and alignment, laid out once it is defined */
+    int align;
 };
 
 #define STABLE_ENUM_TAG 104  /* s_table entry for an enum tag */
@@ -437,6 +442,27 @@ typedef struct astnode {
 struct YYstr; struct YYnum;
 
 //////// Constructors for the different AST nodes /////////
+
+/**
+ * allocNode - Allocates a zeroed AST node of the given type from the node
+ * pool, taking up only the nodeSize(nodetype) bytes that its member of the
+ * union needs rather than a whole astnode. Only the chunks that a function
+ * body's nodes came from are ever freed.
+ */
+astnode *allocNode(int nodetype);
+size_t nodeSize(int nodetype);  /* the bytes a node of a type takes up */
+
+/**
+ * beginFunctionNodes - Has the nodes allocated from here on (other than
+ * types) come from chunks of their own, until endFunctionNodes returns
+ * them, so that a function body's nodes can be freed with freeFunctionNodes
+ * once it has been compiled.
+ */
+struct NodeChunk;
+void beginFunctionNodes();
+struct NodeChunk *endFunctionNodes();
+void freeFunctionNodes(struct NodeChunk *chunks);
+
 astnode *newNode_num(struct YYnum num);                  /* Integers and floats      */
 astnode *newNode_str(int token_name, struct YYstr str);  /* IDENTs, CHRLITs, & STRLITS */
 astnode *newNode_unop(int token_name);                   /* unary operation  */
@@ -475,6 +501,17 @@ struct TmpSymbolTableEntry;
 astnode *newNode_sTableEntry(struct TmpSymbolTableEntry *tmp_entry);
 
 
+/**
+ * internType - Returns the canonical node of a type, after making the
+ * types inside of it canonical: scalar, pointer and array types are
+ * hash-consed, so that structurally identical ones share a single node,
+ * and comparing two canonical types is comparing their pointers. A
+ * function type keeps its own node, as its definition writes its body
+ * into it, though its return and argument types are made canonical.
+ */
+astnode *internType(astnode *type);
+
+
 /**
  * token2op - Takes the token name of an operator and 
  * returns a string of how that operator looks in the C
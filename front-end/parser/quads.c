@@ -18,7 +18,10 @@
 #include "../lexer/lheader2.h"
 #include "symbol_table.h"
 #include "pheader_ast.h"
+#include "vectorize.h"
+#include "if_convert.h"
 #include "../../back-end/assemb_gen.h"
+#include "../../back-end/strength_reduce.h"
 
 
 
@@ -44,9 +47,17 @@ BasicBlock *newBasicBlock(char *name) {
         new_block->u_label = name;
 
     new_block->next = NULL;
-    new_block->quads_ll = NULL;
+    new_block->quads = NULL;
+    new_block->quad_count = 0;
+    new_block->quad_capacity = 0;
     new_block->printed = false;
-    new_block->translated = false;
+    new_block->visited = 0;
+    new_block->index = 0;
+    new_block->loop_depth = 0;
+    new_block->loop_header = false;
+    new_block->exec_count = -1;
+    new_block->edge_count[0] = -1;
+    new_block->edge_count[1] = -1;
     return new_block;
 }
 
@@ -62,30 +73,463 @@ BB_ll_node *newBBnode(BasicBlock *bb) {
 }
 
 
+/**
+ * getSuccessors - Fills the succs array with the basic blocks that control
+ * can flow into from the end of bb, and returns how many there are. The
+ * taken target of a conditional branch comes before its fall-through arm.
+ * 
+ * Every branch quad in the block is looked at, not just the last one, 
+ * because a break or continue in the middle of a block leaves quads
+ * after its BR.
+ */
+int getSuccessors(BasicBlock *bb, BasicBlock **succs, int max_succs) {
+    int count = 0;
+    _Bool falls_through = true;
+
+    for (int i = 0; i < bb->quad_count; ++i) {
+        Quad *quad = &bb->quads[i];
+
+        if (quad->opcode == BR && count < max_succs) {
+            succs[count++] = quad->src1->bb_type.bb;
+            falls_through = (i + 1 < bb->quad_count);
+        }
+        else if (isCondBranch(quad->opcode) && count + 1 < max_succs) {
+            succs[count++] = quad->src1->bb_type.bb;
+            succs[count++] = quad->src2->bb_type.bb;
+            falls_through = (i + 1 < bb->quad_count);
+        }
+        else if (quad->opcode == RETURN) {
+            falls_through = (i + 1 < bb->quad_count);
+        }
+        else 
+            falls_through = true;
+    }
+
+    if (falls_through && bb->next && count < max_succs)
+        succs[count++] = bb->next;
+
+    return count;
+}
+
+
+/**
+ * collectBasicBlocks - Walks the CFG starting at a function's entry block
+ * and returns a newly allocated array of every block reached, in depth-first
+ * order. The number of blocks is stored in count, and each block's index
+ * member is set to its position in the array.
+ */
+BasicBlock **collectBasicBlocks(BasicBlock *entry, int *count) {
+    static int walk_id = 0;
+    ++walk_id;
+
+    int capacity = 16, stack_size = 0;
+    BasicBlock **blocks = malloc(sizeof(BasicBlock *)*capacity);
+    BasicBlock **stack = malloc(sizeof(BasicBlock *)*capacity);
+    *count = 0;
+
+    entry->visited = walk_id;
+    stack[stack_size++] = entry;
+    while (stack_size) {
+        BasicBlock *bb = stack[--stack_size];
+        bb->index = *count;
+        blocks[(*count)++] = bb;
+
+        BasicBlock *succs[MAX_SUCCESSORS];
+        int succ_count = getSuccessors(bb, succs, MAX_SUCCESSORS);
+
+        /* push in reverse so the first successor is walked first */
+        for (int i = succ_count-1; i > -1; --i) {
+            if (succs[i]->visited == walk_id)
+                continue;
+            succs[i]->visited = walk_id;
+
+            if (*count + stack_size + 1 >= capacity) {
+                capacity *= 2;
+                blocks = realloc(blocks, sizeof(BasicBlock *)*capacity);
+                stack = realloc(stack, sizeof(BasicBlock *)*capacity);
+            }
+            stack[stack_size++] = succs[i];
+        }
+    }
+
+    free(stack);
+    return blocks;
+}
+
+
 /////////////////////////////////////////////////////////////////////////
 ///////////////////////////////// Quads /////////////////////////////////
 /////////////////////////////////////////////////////////////////////////
 
 /**
- * newQuadLLNode - Creates and returns a new linked list node of a quad.
+ * isCondBranch - Returns whether the opcode is one of the conditional branches.
  */
-void newQuadLLNode(Quad *new_quad) {
-    QuadLLNode *new_node = malloc(sizeof(QuadLLNode));
-    if (!new_node)
-        yyerror("Error allocating new quad node :(");
+_Bool isCondBranch(enum QuadOpcode op) {
+    return op == BRLE || op == BRGE || op == BRLT || 
+           op == BRGT || op == BRNEQ || op == BREQ;
+}
 
-    new_node->quad = *new_quad;
 
-    if (!cur_quad_ll) { /* new basic block */
-        cur_basic_block->quads_ll = new_node; 
+/**
+ * invertCondBranch - Returns the conditional branch opcode that branches
+ * on the opposite condition of op (so BRLT becomes BRGE).
+ */
+enum QuadOpcode invertCondBranch(enum QuadOpcode op) {
+    switch (op) {
+        case BRLT:  return BRGE;
+        case BRGE:  return BRLT;
+        case BRGT:  return BRLE;
+        case BRLE:  return BRGT;
+        case BREQ:  return BRNEQ;
+        case BRNEQ: return BREQ;
+        default:    return op;
     }
-    else {
-        cur_quad_ll->next = new_node;
+}
+
+
+/**
+ * isFloatOpcode - Returns whether the opcode is one of the SSE2 floating
+ * point opcodes.
+ */
+_Bool isFloatOpcode(enum QuadOpcode op) {
+    return op >= MOVSS && op <= UCOMISD;
+}
+
+
+/**
+ * isFloatCompare - Returns whether the opcode is a floating point compare.
+ */
+_Bool isFloatCompare(enum QuadOpcode op) {
+    return op == UCOMISS || op == UCOMISD;
+}
+
+
+/**
+ * isVectorOpcode - Returns whether the opcode is one of the vector opcodes
+ * of vectorized loops.
+ */
+_Bool isVectorOpcode(enum QuadOpcode op) {
+    return op >= VLOADU && op <= VHADDD;
+}
+
+
+/**
+ * isCondMove - Returns whether the opcode is one of the conditional moves.
+ */
+_Bool isCondMove(enum QuadOpcode op) {
+    return op >= CMOV_LT && op <= CMOV_LE;
+}
+
+
+/**
+ * isBlockMove - Returns whether the opcode is one of the block copy and
+ * clear opcodes, of structs and of memcpy and memset calls.
+ */
+_Bool isBlockMove(enum QuadOpcode op) {
+    return op == BLKCPY || op == BLKCLR;
+}
+
+
+/**
+ * getLastQuad - Returns the last quad of a basic block, or NULL if empty.
+ */
+Quad *getLastQuad(BasicBlock *bb) {
+    return bb->quad_count ? &bb->quads[bb->quad_count - 1] : NULL;
+}
+
+
+/**
+ * spliceQuads - Replaces the remove_count quads of the basic block bb
+ * starting at index with the insert_count quads of insert (or leaves them
+ * to be filled in, if it is NULL), moving the quads after them along, and
+ * returns the first of the inserted quads. The block's array doubles when
+ * it runs out of room.
+ */
+Quad *spliceQuads(BasicBlock *bb, int index, int remove_count, Quad *insert, int insert_count) {
+    int new_count = bb->quad_count - remove_count + insert_count;
+
+    if (new_count > bb->quad_capacity) {
+        int capacity = bb->quad_capacity ? 2*bb->quad_capacity : INIT_BB_QUADS;
+        while (capacity < new_count)
+            capacity *= 2;
+
+        Quad *quads = realloc(bb->quads, sizeof(Quad)*capacity);
+        if (!quads)
+            yyerror("Error allocating new quad node :(");
+        bb->quads = quads;
+        bb->quad_capacity = capacity;
+    }
+
+    memmove(&bb->quads[index + insert_count], &bb->quads[index + remove_count],
+            sizeof(Quad)*(bb->quad_count - index - remove_count));
+    if (insert)
+        memcpy(&bb->quads[index], insert, sizeof(Quad)*insert_count);
+    bb->quad_count = new_count;
+    return &bb->quads[index];
+}
+
+
+
+
+/* the function whose quads are being generated */
+static astnode *cur_fnc = NULL;
+
+
+/**
+ * typeFloatClass - Returns Float or Double if the type node is one of the
+ * floating types, and Void (0) for any other type. Long doubles are computed
+ * as doubles, as SSE2 has nothing wider.
+ */
+int typeFloatClass(astnode *type) {
+    if (!type || type->nodetype != SCALAR_TYPE)
+        return Void;
+
+    switch (type->scalar_type.type) {
+        case Float:         return Float;
+        case Double:
+        case LongDouble:    return Double;
+        default:            return Void;
+    }
+}
+
+
+/**
+ * exprFloatClass - Returns the floating type (Float or Double) that an
+ * expression evaluates to, by the usual arithmetic conversions, or Void (0)
+ * for integer and pointer expressions.
+ */
+int exprFloatClass(astnode *node) {
+    int left, right;
+
+    switch (node->nodetype) {
+        case STABLE_VAR:
+            return typeFloatClass(node->stable_entry.node);
+        case NUM_TYPE:
+            if (node->num.types & NUMMASK_FLOAT)
+                return Float;
+            if (node->num.types & (NUMMASK_DOUBLE | NUMMASK_LDBLE))
+                return Double;
+            return Void;
+        case BINOP_TYPE:
+            if (node->binop.op == ',')
+                return exprFloatClass(node->binop.right);
+            if (node->binop.op != '+' && node->binop.op != '-' &&
+                node->binop.op != '*' && node->binop.op != '/')
+                return Void;
+
+            /* Double > Float > Void, so the wider type is the larger one */
+            left = exprFloatClass(node->binop.left);
+            right = exprFloatClass(node->binop.right);
+            return left > right ? left : right;
+        case UNOP_TYPE:
+            if (node->unop.op == '-' || node->unop.op == '+')
+                return exprFloatClass(node->unop.expr);
+            return Void;
+        case ASS_TYPE:
+            return exprFloatClass(node->assignment.left);
+        case TERNARY_TYPE:
+            left = exprFloatClass(node->ternary.then_expr);
+            right = exprFloatClass(node->ternary.else_expr);
+            return left > right ? left : right;
+        case FNC_CALL:
+            if (node->fnc.ident->nodetype == STABLE_FNC_DECLARATOR ||
+                node->fnc.ident->nodetype == STABLE_FNC_DEFINITION)
+                return typeFloatClass(node->fnc.ident->stable_entry.fnc.return_type);
+            return Void;
+        default:
+            return Void;
+    }
+}
+
+
+/**
+ * newFloatConstant - Creates a floating point constant of the type float_type.
+ */
+static astnode *newFloatConstant(double val, int float_type) {
+    struct YYnum num_val;
+    num_val.types = float_type == Float ? NUMMASK_FLOAT : NUMMASK_DOUBLE;
+    num_val.val = 0;
+    num_val.d_val = val;
+    return newNode_num(num_val);
+}
+
+
+/**
+ * genConvertedRvalue - Generates the r-value of an expression converted to
+ * the floating type float_type (Void for an integer), into target if given.
+ * 
+ * Constants are converted at compile time, anything else is evaluated into
+ * a temporary that a conversion quad then reads.
+ */
+astnode *genConvertedRvalue(astnode *node, int float_type, astnode *target) {
+    int from = exprFloatClass(node);
+    if (from == float_type)
+        return genRvalue(node, target);
+
+    if (node->nodetype == NUM_TYPE) {
+        if (float_type == Void) {
+            struct YYnum num_val;
+            num_val.types = NUMMASK_INTGR | NUMMASK_INT;
+            num_val.val = (long long) node->num.d_val;
+            return genRvalue(newNode_num(num_val), target);
+        }
+        
+        double val = from == Void ? (double) (long long) node->num.val : node->num.d_val;
+        return genRvalue(newFloatConstant(val, float_type), target);
     }
-    cur_quad_ll = new_node;
+
+    enum QuadOpcode op;
+    if (from == Void)
+        op = float_type == Float ? CVTSI2SS : CVTSI2SD;
+    else if (float_type == Void)
+        op = from == Float ? CVTTSS2SI : CVTTSD2SI;
+    else
+        op = from == Float ? CVTSS2SD : CVTSD2SS;
+
+    astnode *converted = newGenericTemp();
+    emitQuad(op, converted, genRvalue(node, NULL), NULL);
+    if (!target)
+        return converted;
+
+    switch (float_type) {
+        case Float:  emitQuad(MOVSS, target, converted, NULL); break;
+        case Double: emitQuad(MOVSD, target, converted, NULL); break;
+        default:     emitQuad(MOVL, target, converted, NULL);  break;
+    }
+    return target;
 }
 
 
+/**
+ * foldNegatedConstant - Returns a negated signed integer constant (-3) as
+ * the constant -3 itself, so that it can be strength reduced as any other
+ * constant operand, and any other operand as it is.
+ */
+static astnode *foldNegatedConstant(astnode *operand) {
+    if (operand->nodetype != UNOP_TYPE || operand->unop.op != '-')
+        return operand;
+
+    astnode *expr = operand->unop.expr;
+    if (expr->nodetype != NUM_TYPE || !(expr->num.types & NUMMASK_INTGR) ||
+        (expr->num.types & NUMMASK_UNSIGN))
+        return operand;
+
+    struct YYnum num_val;
+    num_val.val = -expr->num.val;
+    num_val.d_val = 0;
+    num_val.types = expr->num.types;
+    return newNode_num(num_val);
+}
+
+
+/**
+ * isReducibleConstant - Returns whether an operand of an integer binary
+ * operation is a constant that the back-end strength reduces: a factor of
+ * a multiplication, or a divisor of a division or modulo that the back-end
+ * generates without an idiv (as idiv can't take an immediate). Those are
+ * left as constants in the quads rather than moved into a temp.
+ */
+static _Bool isReducibleConstant(astnode *node, astnode *operand) {
+    if (operand->nodetype != NUM_TYPE || !(operand->num.types & NUMMASK_INTGR))
+        return false;
+    if (node->binop.op == '*')
+        return true;
+    return (node->binop.op == '/' || node->binop.op == '%') &&
+            operand == node->binop.right && isReducibleDivisor((long long) operand->num.val);
+}
+
+
+/**
+ * hasBranchingValue - Returns whether computing an expression's value takes
+ * branches, as the value of a && or || or of a ?: does.
+ */
+_Bool hasBranchingValue(astnode *node) {
+    if (!node)
+        return false;
+
+    switch (node->nodetype) {
+        case LOG_TYPE:
+        case TERNARY_TYPE:
+            return true;
+        case BINOP_TYPE:
+        case COMPARE_TYPE:
+            return hasBranchingValue(node->binop.left) || hasBranchingValue(node->binop.right);
+        case UNOP_TYPE:
+        case DEREF_TYPE:
+        case ADDR_TYPE:
+            return hasBranchingValue(node->unop.expr);
+        case ASS_TYPE:
+            return hasBranchingValue(node->assignment.left) || hasBranchingValue(node->assignment.right);
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * genOperandRvalues - Generates the r-values of a binary operation's left
+ * and right operands, converted to float_type, except for the ones that
+ * keep_left/keep_right leave as they are. As no temp lives from one basic
+ * block into the next, a right operand that branches is generated first (C
+ * leaves the order up to the compiler), and when both do, the left one's
+ * value waits in a hidden local.
+ */
+static void genOperandRvalues(astnode *node, int float_type, _Bool keep_left, _Bool keep_right,
+                              astnode **left, astnode **right) {
+    _Bool left_branches = !keep_left && hasBranchingValue(node->binop.left);
+    _Bool right_branches = !keep_right && hasBranchingValue(node->binop.right);
+
+    if (left_branches && right_branches) {
+        astnode *held = newHiddenLocal(cur_fnc, newNode_scalarType(float_type ? float_type : Int, true), ".held");
+        genConvertedRvalue(node->binop.left, float_type, held);
+        *right = genConvertedRvalue(node->binop.right, float_type, NULL);
+        *left = genRvalue(held, NULL);
+        return;
+    }
+
+    if (right_branches)
+        *right = genConvertedRvalue(node->binop.right, float_type, NULL);
+    *left = keep_left ? node->binop.left : genConvertedRvalue(node->binop.left, float_type, NULL);
+    if (!right_branches)
+        *right = keep_right ? node->binop.right : genConvertedRvalue(node->binop.right, float_type, NULL);
+}
+
+
+/**
+ * isFloatComparison - Returns whether a comparison has a floating operand.
+ */
+static _Bool isFloatComparison(astnode *node) {
+    return exprFloatClass(node->binop.left) || exprFloatClass(node->binop.right);
+}
+
+
+/**
+ * genFloatCompareIR - Generates the compare quad of a floating point
+ * comparison, and returns the comparison operator that the branch or the 
+ * setcc after it has to test for.
+ * 
+ * A NaN operand makes the compare unordered, which sets the flags the same
+ * way as "less than". So a < b is generated as b > a, and a <= b as b >= a,
+ * which are both false when either side is a NaN.
+ */
+static int genFloatCompareIR(astnode *node) {
+    int left_type = exprFloatClass(node->binop.left);
+    int right_type = exprFloatClass(node->binop.right);
+    int float_type = left_type > right_type ? left_type : right_type;
+    enum QuadOpcode op = float_type == Float ? UCOMISS : UCOMISD;
+
+    astnode *left, *right;
+    genOperandRvalues(node, float_type, false, false, &left, &right);
+
+    switch (node->binop.op) {
+        case '<':   emitQuad(op, NULL, right, left);    return '>';
+        case LTEQ:  emitQuad(op, NULL, right, left);    return GTEQ;
+        case '>':
+        case GTEQ:
+        case EQEQ:  emitQuad(op, NULL, left, right);    return node->binop.op;
+        default:    emitQuad(op, NULL, left, right);    return NOTEQ;
+    }
+}
 
 
 /**
@@ -96,8 +540,8 @@ void generateQuads(astnode *root) {
     if (root->nodetype != STABLE_FNC_DEFINITION)
         yyerror("Attempting to print quads of a non-function definition type!");
     else {
+        cur_fnc = root;
         cur_basic_block = newBasicBlock(root->stable_entry.ident);
-        cur_quad_ll = cur_basic_block->quads_ll;
 
         if (bb_ll.first == NULL) {
             bb_ll.first = newBBnode(cur_basic_block);
@@ -113,6 +557,40 @@ void generateQuads(astnode *root) {
 }
 
 
+/**
+ * releaseFunction - Frees what is left of a function once its assembly has
+ * been generated: its basic blocks and their quads, which entry leads to,
+ * the scopes of its body and the chunks (nodes) that its tree came from.
+ */
+void releaseFunction(astnode *fnc, BasicBlock *entry, struct NodeChunk *nodes) {
+    for (BB_ll_node **cur = &bb_ll.first, *prev = NULL; *cur; prev = *cur, cur = &(*cur)->next) {
+        if ((*cur)->bb != entry)
+            continue;
+
+        BB_ll_node *node = *cur;
+        *cur = node->next;
+        if (bb_ll.last == node)
+            bb_ll.last = prev;
+        free(node);
+        break;
+    }
+
+    int block_count;
+    BasicBlock **blocks = collectBasicBlocks(entry, &block_count);
+    for (int i = 0; i < block_count; ++i) {
+        free(blocks[i]->quads);
+        if (blocks[i] != entry)     /* the entry block is labeled by the function's name */
+            free(blocks[i]->u_label);
+        free(blocks[i]);
+    }
+    free(blocks);
+
+    releaseScopes(fnc->stable_entry.fnc.function_body);
+    fnc->stable_entry.fnc.function_body = NULL;
+    freeFunctionNodes(nodes);
+}
+
+
 /**
  * genQuads - Generates the QUADS of an astnode (and all its children).
  */
@@ -172,7 +650,8 @@ astnode *genQuads(astnode *node) {
             return NULL;
 
         case RETURN_STMT:
-            target = genRvalue(node->return_stmt.expr, NULL);
+            target = genConvertedRvalue(node->return_stmt.expr, 
+                                        typeFloatClass(cur_fnc->stable_entry.fnc.return_type), NULL);
             emitQuad(RETURN, NULL, target, NULL);
             return NULL;
 
@@ -234,6 +713,10 @@ void generateForLoopIR(astnode *node) {
     // generate initial clause IR in existing bb 
     genQuads(node->for_stmt.initial_clause);
 
+    /* with -ftree-vectorize, simple loops first run 4 iterations at a time,
+    and the scalar loop below finishes off the iterations left over */
+    vectorizeForLoopIR(node, cur_fnc);
+
     // set up the basic blocks the for loop will consist of
     BasicBlock *condition_bb = newBasicBlock(NULL);
     BasicBlock *loop_bb = newBasicBlock(NULL);
@@ -244,7 +727,6 @@ void generateForLoopIR(astnode *node) {
     // move basic block state to condition basic block
     cur_basic_block->next = condition_bb;
     cur_basic_block = condition_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     // set up the corresponding cursors for continue and break stmts
     BasicBlock *past_cont_bb = NULL;
@@ -262,7 +744,6 @@ void generateForLoopIR(astnode *node) {
 
     // set up basic block setup for the loop body
     cur_basic_block = loop_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     // generate quads for the loop body
     genQuads(node->for_stmt.stmt);
@@ -270,7 +751,6 @@ void generateForLoopIR(astnode *node) {
 
     // set up bb setups for the increment expression
     cur_basic_block = increment_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     // generate quads for the increment expression
     genQuads(node->for_stmt.iteration_expr);
@@ -289,7 +769,6 @@ void generateForLoopIR(astnode *node) {
 
     // set up next basic block after while loop 
     cur_basic_block = next_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 }
 
 
@@ -308,7 +787,6 @@ void generateDoWhileLoopIR(astnode *node) {
     // move bb state to loop body bb
     cur_basic_block->next = loop_bb;
     cur_basic_block = loop_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     // set up the corresponding cursors for continue and break stmts
     BasicBlock *past_cont_bb = NULL;
@@ -327,7 +805,6 @@ void generateDoWhileLoopIR(astnode *node) {
 
     // set up basic block setup for the loop condition
     cur_basic_block = if_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     generateConditionIR(node->while_stmt.expr, loop_bb, next_bb);
 
@@ -344,7 +821,6 @@ void generateDoWhileLoopIR(astnode *node) {
 
     // set up next basic block after while loop 
     cur_basic_block = next_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 }
 
 
@@ -361,7 +837,6 @@ void generateWhileLoopIR(astnode *node) {
     // move basic block state to while condition basic block
     cur_basic_block->next = if_bb;
     cur_basic_block = if_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     // set up the corresponding cursors for continue and break stmts
     BasicBlock *past_cont_bb = NULL;
@@ -379,7 +854,6 @@ void generateWhileLoopIR(astnode *node) {
 
     // set up basic block setup for the loop body
     cur_basic_block = loop_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 
     // generate quads for the loop body
     genQuads(node->while_stmt.stmt);
@@ -398,76 +872,48 @@ void generateWhileLoopIR(astnode *node) {
 
     // set up next basic block after while loop 
     cur_basic_block = next_bb;
-    cur_quad_ll = cur_basic_block->quads_ll;
 }
 
 
 /**
  * generateConditionalStmt - Generates the IR required for 
- * conditional statements.
+ * conditional statements. Conditions with && and || become chains
+ * of branches in generateConditionIR, and the if statements that only
+ * pick a variable's value may become conditional moves instead.
  */
 void generateConditionalIR(astnode *node) {
+    if (ifConvertConditionalIR(node))
+        return;
 
-    // check for logical and and ors- we need to break them apart */
-    if (node->conditional_stmt.expr->nodetype == LOG_TYPE) {
-        astnode *cond_node = node->conditional_stmt.expr;
-        if (cond_node->binop.op == LOGAND) {
+    BasicBlock *bb_then= newBasicBlock(NULL);
+    BasicBlock *bb_else= newBasicBlock(NULL);
 
-            astnode *reorder1 = newNode_conditionalStmt(cond_node->binop.right, 
-                                                    node->conditional_stmt.if_node, 
-                                                    node->conditional_stmt.else_node);
+    /* check if there exists an else stmt, if not then consolidate the 
+    continuing basic block to be the already created else block. */
+    BasicBlock *bb_next;
+    if (node->conditional_stmt.else_node)
+        bb_next = newBasicBlock(NULL);
+    else
+        bb_next = bb_else;
 
-            astnode *reorder2 = newNode_conditionalStmt(cond_node->binop.left, 
-                                                    reorder1, 
-                                                    node->conditional_stmt.else_node);
-            generateConditionalIR(reorder2);
-        }
-        else if (cond_node->binop.op == LOGOR) {
-            astnode *reorder1 = newNode_conditionalStmt(cond_node->binop.right, 
-                                                    node->conditional_stmt.if_node, 
-                                                    node->conditional_stmt.else_node);
-
-            astnode *reorder2 = newNode_conditionalStmt(cond_node->binop.left, 
-                                                    node->conditional_stmt.if_node, 
-                                                    reorder1);
-            generateConditionalIR(reorder2);
-        }
-    }
-    else {
-        
-        BasicBlock *bb_then= newBasicBlock(NULL);
-        BasicBlock *bb_else= newBasicBlock(NULL);
-
-        /* check if there exists an else stmt, if not then consolidate the 
-        continuing basic block to be the already created else block. */
-        BasicBlock *bb_next;
-        if (node->conditional_stmt.else_node)
-            bb_next = newBasicBlock(NULL);
-        else
-            bb_next = bb_else;
+    // create quads for conditional
+    generateConditionIR(node->conditional_stmt.expr, bb_then, bb_else);
 
-        // create quads for conditional
-        generateConditionIR(node->conditional_stmt.expr, bb_then, bb_else);
+    // create quads for 'then' case
+    cur_basic_block = bb_then;
 
-        // create quads for 'then' case
-        cur_basic_block = bb_then;
-        cur_quad_ll = cur_basic_block->quads_ll;
+    genQuads(node->conditional_stmt.if_node);
+    emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
 
-        genQuads(node->conditional_stmt.if_node);
+    // create quads for 'else' case
+    if (node->conditional_stmt.else_node) {
+        cur_basic_block = bb_else;
+    
+        genQuads(node->conditional_stmt.else_node);
         emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
+    }
 
-        // create quads for 'else' case
-        if (node->conditional_stmt.else_node) {
-            cur_basic_block = bb_else;
-            cur_quad_ll = cur_basic_block->quads_ll;
-        
-            genQuads(node->conditional_stmt.else_node);
-            emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
-        }
-
-        cur_basic_block = bb_next;
-        cur_quad_ll = cur_basic_block->quads_ll;
-    }    
+    cur_basic_block = bb_next;
 }
 
 
@@ -481,19 +927,38 @@ void generateConditionIR(astnode *node, BasicBlock *bb_then, BasicBlock *bb_else
     num_val.types = NUMMASK_INTGR | NUMMASK_INT;
     num_val.val = 0;
 
-    // evaluate conditional 'if' stmt
-    if (node->nodetype == COMPARE_TYPE) {       /* compare */
-        astnode *left_side, *right_side;
-        
-        if (node->binop.left->nodetype != TEMP_REG_TYPE)
-            left_side = genRvalue(node->binop.left, NULL);
+    /* && and || only test their right side when the left one leaves the
+    result undecided, and ! swaps the targets, so each test branches
+    straight to where it decides the condition instead of making a 0/1 */
+    if (node->nodetype == LOG_TYPE) {
+        BasicBlock *bb_right = newBasicBlock(NULL);
+        if (node->binop.op == LOGAND)
+            generateConditionIR(node->binop.left, bb_right, bb_else);
         else
-            left_side = node->binop.left;
+            generateConditionIR(node->binop.left, bb_then, bb_right);
 
-        if (node->binop.right->nodetype != TEMP_REG_TYPE)
-            right_side = genRvalue(node->binop.right, NULL);
-        else
-            right_side = node->binop.right;
+        cur_basic_block = bb_right;
+        generateConditionIR(node->binop.right, bb_then, bb_else);
+        return;
+    }
+    if (node->nodetype == UNOP_TYPE && node->unop.op == '!') {
+        generateConditionIR(node->unop.expr, bb_else, bb_then);
+        return;
+    }
+
+    // evaluate conditional 'if' stmt
+    if (node->nodetype == COMPARE_TYPE && isFloatComparison(node)) {
+        switch(genFloatCompareIR(node)) {
+            case '>': emitQuad(BRGT, NULL, newNode_bb(bb_then), newNode_bb(bb_else));   break;
+            case GTEQ: emitQuad(BRGE, NULL, newNode_bb(bb_then), newNode_bb(bb_else));  break;
+            case EQEQ: emitQuad(BREQ, NULL, newNode_bb(bb_then), newNode_bb(bb_else));  break;
+            default:  emitQuad(BRNEQ, NULL, newNode_bb(bb_then), newNode_bb(bb_else)); break;
+        }
+    }
+    else if (node->nodetype == COMPARE_TYPE) {  /* compare */
+        astnode *left_side, *right_side;
+        genOperandRvalues(node, Void, node->binop.left->nodetype == TEMP_REG_TYPE,
+                          node->binop.right->nodetype == TEMP_REG_TYPE, &left_side, &right_side);
 
         emitQuad(CMP, NULL, left_side, right_side);
 
@@ -507,6 +972,13 @@ void generateConditionIR(astnode *node, BasicBlock *bb_then, BasicBlock *bb_else
             default:  yyerror("Invalid comparator operator");
         }
     }
+    else if (exprFloatClass(node)) {            /* compare to 0.0 */
+        int float_type = exprFloatClass(node);
+        astnode *tmp_target = genRvalue(node, NULL);
+
+        emitQuad(float_type == Float ? UCOMISS : UCOMISD, NULL, tmp_target, newFloatConstant(0, float_type));
+        emitQuad(BRNEQ, NULL, newNode_bb(bb_then), newNode_bb(bb_else));
+    }
     else if (node->nodetype == STABLE_VAR) {    /* compare to 0 */
         emitQuad(CMP, NULL, node, newNode_num(num_val));
         emitQuad(BRNEQ, NULL, newNode_bb(bb_then), newNode_bb(bb_else));
@@ -520,6 +992,104 @@ void generateConditionIR(astnode *node, BasicBlock *bb_then, BasicBlock *bb_else
 }
 
 
+/**
+ * blockAddress - Returns the operand of a block copy or clear that is at the
+ * address an expression evaluates to: the variable itself when it is the
+ * address of a variable or an array, which the backend then addresses
+ * directly, or else a temp holding the address.
+ */
+static astnode *blockAddress(astnode *node) {
+    if (node->nodetype == ADDR_TYPE && node->unop.expr->nodetype == STABLE_VAR)
+        return node->unop.expr;
+    if (node->nodetype == STABLE_VAR && node->stable_entry.node->nodetype == ARRAY_TYPE)
+        return node;
+    return genRvalue(node, NULL);
+}
+
+
+/**
+ * structType - Returns the struct (or union) type of an expression that is
+ * a struct variable or a dereferenced pointer to a struct, or NULL if it
+ * isn't one.
+ */
+static astnode *structType(astnode *node) {
+    astnode *type = NULL;
+
+    if (node->nodetype == STABLE_VAR)
+        type = node->stable_entry.node;
+    else if (node->nodetype == DEREF_TYPE && node->unop.expr->nodetype == STABLE_VAR &&
+             node->unop.expr->stable_entry.node->nodetype == PTR_TYPE)
+        type = node->unop.expr->stable_entry.node->ptr.pointee;
+
+    return type && type->nodetype == STABLE_SU_TAG ? type : NULL;
+}
+
+
+/**
+ * structOperand - Returns the operand of a block copy that accesses the
+ * bytes of a struct expression accepted by structType.
+ */
+static astnode *structOperand(astnode *node) {
+    if (node->nodetype == STABLE_VAR)
+        return node;
+    return genRvalue(node->unop.expr, NULL);
+}
+
+
+/**
+ * constantSize - Returns the value of an integer constant or a sizeof in
+ * size, or -1 if the expression is neither.
+ */
+static long long constantSize(astnode *node) {
+    if (node->nodetype == SIZEOF_TYPE)
+        node = evaluateSizeOf(node->unop.expr);
+    if (node->nodetype != NUM_TYPE || !(node->num.types & NUMMASK_INTGR))
+        return -1;
+    return node->num.val;
+}
+
+
+/**
+ * genBuiltinCallIR - Generates a call to memcpy or memset with a constant
+ * size, whose value isn't used, as a block copy or clear that the backend
+ * expands inline, unless -fno-builtin was given or the translation unit
+ * defines the function itself. Returns whether it did so.
+ */
+static _Bool genBuiltinCallIR(astnode *node) {
+    astnode *fnc = node->fnc.ident;
+    if (be_flags.no_builtin || node->fnc.arg_count != 3 || (fnc->nodetype != IDENT_TYPE &&
+        fnc->nodetype != STABLE_IDENT_TYPE && fnc->nodetype != STABLE_FNC_DECLARATOR))
+        return false;
+
+    char *name = fnc->nodetype == IDENT_TYPE ? fnc->ident.str : fnc->stable_entry.ident;
+    astnode *args[3];
+    for (int i = 0; i < 3; ++i)
+        args[i] = node->fnc.arguments[i]->arg.expr;
+
+    long long size = constantSize(args[2]);
+    if (size < 0)
+        return false;
+
+    struct YYnum num_val;
+    num_val.val = size;
+    num_val.d_val = 0;
+    num_val.types = NUMMASK_INTGR | NUMMASK_INT;
+
+    if (!strcmp(name, "memcpy")) {
+        astnode *src = blockAddress(args[1]);
+        emitQuad(BLKCPY, blockAddress(args[0]), src, newNode_num(num_val));
+        return true;
+    }
+    if (!strcmp(name, "memset") && constantSize(args[1]) >= 0) {
+        astnode *fill = newNode_num(num_val);
+        fill->num.val = constantSize(args[1]) & 0xff;
+        emitQuad(BLKCLR, blockAddress(args[0]), fill, newNode_num(num_val));
+        return true;
+    }
+    return false;
+}
+
+
 /**
  * generateFunctionCall - Generates the QUADS necessary for a 
  * function call. We will attempt to keep this architecture 
@@ -530,16 +1100,23 @@ void generateConditionIR(astnode *node, BasicBlock *bb_then, BasicBlock *bb_else
 void generateFunctionCallIR(astnode *node, astnode *target) {
     if (node->nodetype != FNC_CALL)
         yyerror("Cannot create a funciton call for a non-function call type");
+    if (!target && genBuiltinCallIR(node))
+        return;
 
     struct YYnum num_val;
     num_val.val = node->fnc.arg_count;
     num_val.types = NUMMASK_INTGR | NUMMASK_INT;
 
-    emitQuad(ARGBEGIN, NULL, newNode_num(num_val), NULL);
+    /* the call rides along, for the backend to know its callee and the
+    size of its arguments up front */
+    emitQuad(ARGBEGIN, NULL, newNode_num(num_val), node);
 
     for (int i = node->fnc.arg_count-1 ; i > -1 ; --i) {
         num_val.val = i+1;
-        astnode *new_tmp = genRvalue(node->fnc.arguments[i]->arg.expr, NULL);
+
+        /* there are no prototypes, so floats are promoted to doubles */
+        astnode *arg = node->fnc.arguments[i]->arg.expr;
+        astnode *new_tmp = genConvertedRvalue(arg, exprFloatClass(arg) ? Double : Void, NULL);
         emitQuad(ARG, NULL, newNode_num(num_val), new_tmp);
     }
 
@@ -554,17 +1131,36 @@ void generateFunctionCallIR(astnode *node, astnode *target) {
  * generateAssignmentIR - Generates the IR of an assignment operation.
  */
 void generateAssignmentIR(astnode *node) {
+
+    /* a struct is assigned by copying its bytes over */
+    astnode *type = structType(node->assignment.left);
+    if (type) {
+        if (structType(node->assignment.right) != type)
+            yyerror("Invalid assignment of a struct from a different type.");
+        else {
+            astnode *src = structOperand(node->assignment.right);
+            emitQuad(BLKCPY, structOperand(node->assignment.left), src, evaluateSizeOf(type));
+        }
+        return;
+    }
     
+    /* an address can't wait in a temp while the value's branches run,
+    so a value that branches is generated before the address it is stored to */
+    astnode *r_val = NULL;
+    if (node->assignment.left->nodetype == DEREF_TYPE && hasBranchingValue(node->assignment.right))
+        r_val = genRvalue(node->assignment.right, NULL);
+
     enum LvalueMode l_mode;
     astnode *des = genLvalue(node->assignment.left, &l_mode);
 
     if (des == NULL)
         yyerror("Invalid assignment of an l-value.");
     else if (l_mode == DIRECT) {
-        astnode *r_val = genRvalue(node->assignment.right, des);
+        r_val = genConvertedRvalue(node->assignment.right, exprFloatClass(des), des);
     }
     else {      /* indirect l-value mode */
-        astnode *r_val = genRvalue(node->assignment.right, NULL);
+        if (!r_val)
+            r_val = genRvalue(node->assignment.right, NULL);
         emitQuad(STORE, NULL, r_val, des);
     }
     
@@ -589,6 +1185,90 @@ astnode *genLvalue(astnode *node, enum LvalueMode *mode) {
 }
 
 
+/**
+ * genLogicalRvalue - Generates the value of a && or || expression, that is
+ * used rather than branched on. It is computed by the same branches as a
+ * condition, which store 1 or 0 into the int variable being assigned to,
+ * or else into a hidden local, as the value has to outlive the branches.
+ */
+static astnode *genLogicalRvalue(astnode *node, astnode *target) {
+    BasicBlock *bb_true = newBasicBlock(NULL);
+    BasicBlock *bb_false = newBasicBlock(NULL);
+    BasicBlock *bb_next = newBasicBlock(NULL);
+
+    astnode *value;
+    if (target && target->nodetype == STABLE_VAR && 
+            target->stable_entry.node->nodetype == SCALAR_TYPE &&
+            target->stable_entry.node->scalar_type.type == Int)
+        value = target;
+    else
+        value = newHiddenLocal(cur_fnc, newNode_scalarType(Int, true), ".bool");
+
+    struct YYnum num_val;
+    num_val.types = NUMMASK_INTGR | NUMMASK_INT;
+
+    generateConditionIR(node, bb_true, bb_false);
+
+    num_val.val = 1;
+    cur_basic_block = bb_true;
+    emitQuad(MOVL, value, newNode_num(num_val), NULL);
+    emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
+
+    num_val.val = 0;
+    cur_basic_block = bb_false;
+    emitQuad(MOVL, value, newNode_num(num_val), NULL);
+    emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
+
+    cur_basic_block = bb_next;
+
+    if (value == target)
+        return target;
+    return genRvalue(value, target);
+}
+
+
+/**
+ * genTernaryRvalue - Generates the value of a ?: expression. With
+ * -fif-conversion, cheap values are picked by a conditional move, and
+ * otherwise the condition branches to the value's two blocks, which store
+ * it into the int variable being assigned to or else into a hidden local.
+ */
+static astnode *genTernaryRvalue(astnode *node, astnode *target) {
+    astnode *moved = ifConvertTernaryIR(node, target);
+    if (moved)
+        return moved;
+
+    BasicBlock *bb_then = newBasicBlock(NULL);
+    BasicBlock *bb_else = newBasicBlock(NULL);
+    BasicBlock *bb_next = newBasicBlock(NULL);
+
+    int float_type = exprFloatClass(node);
+    astnode *value;
+    if (!float_type && target && target->nodetype == STABLE_VAR && 
+            target->stable_entry.node->nodetype == SCALAR_TYPE &&
+            target->stable_entry.node->scalar_type.type == Int)
+        value = target;
+    else
+        value = newHiddenLocal(cur_fnc, newNode_scalarType(float_type ? float_type : Int, true), ".cond");
+
+    generateConditionIR(node->ternary.if_expr, bb_then, bb_else);
+
+    cur_basic_block = bb_then;
+    genConvertedRvalue(node->ternary.then_expr, float_type, value);
+    emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
+
+    cur_basic_block = bb_else;
+    genConvertedRvalue(node->ternary.else_expr, float_type, value);
+    emitQuad(BR, NULL, newNode_bb(bb_next), NULL);
+
+    cur_basic_block = bb_next;
+
+    if (value == target)
+        return target;
+    return genRvalue(value, target);
+}
+
+
 /**
  * genRvalue - Generates the r-values of an expression.
  * 
@@ -610,6 +1290,20 @@ astnode *genRvalue(astnode *node, astnode *target) {
         emitQuad(LEA, target, node, NULL);
         return target;
     }
+    else if (node->nodetype == STABLE_VAR && exprFloatClass(node)) {
+        enum QuadOpcode op = exprFloatClass(node) == Float ? MOVSS : MOVSD;
+        if (!target) target = newGenericTemp();
+
+        if (target->nodetype == STABLE_VAR) {
+            astnode *tmp_tag = newGenericTemp();
+            emitQuad(op, tmp_tag, node, NULL);
+            emitQuad(op, target, tmp_tag, NULL);
+        }
+        else
+            emitQuad(op, target, node, NULL);
+
+        return target;
+    }
     else if (node->nodetype == STABLE_VAR) {
         if (!target) target = newGenericTemp();
 
@@ -629,7 +1323,10 @@ astnode *genRvalue(astnode *node, astnode *target) {
     }
     else if (node->nodetype == NUM_TYPE) {
         if (!target) target = newGenericTemp();
-        emitQuad(MOVL, target, node, NULL);
+        if (exprFloatClass(node))
+            emitQuad(exprFloatClass(node) == Float ? MOVSS : MOVSD, target, node, NULL);
+        else
+            emitQuad(MOVL, target, node, NULL);
         return target;
     }
     else if (node->nodetype == CHRLIT_TYPE) {
@@ -647,10 +1344,30 @@ astnode *genRvalue(astnode *node, astnode *target) {
         emitQuad(MOVL, target, node, NULL);
         return target;
     }
+    else if (node->nodetype == BINOP_TYPE && exprFloatClass(node) && node->binop.op != ',') {
+        int float_type = exprFloatClass(node);
+        astnode *left, *right;
+        genOperandRvalues(node, float_type, false, false, &left, &right);
+
+        enum QuadOpcode op;
+        switch (node->binop.op) {
+            case '*':   op = float_type == Float ? MULSS : MULSD;   break;
+            case '-':   op = float_type == Float ? SUBSS : SUBSD;   break;
+            case '/':   op = float_type == Float ? DIVSS : DIVSD;   break;
+            default:    op = float_type == Float ? ADDSS : ADDSD;   break;
+        }
+
+        if (!target) target = newGenericTemp();
+        emitQuad(op, target, left, right);
+        return target;
+    }
     else if (node->nodetype == BINOP_TYPE) {
         // for now ignore type values
-        astnode *left = genRvalue(node->binop.left, NULL);
-        astnode *right = genRvalue(node->binop.right, NULL);
+        astnode *left, *right;
+        node->binop.left = foldNegatedConstant(node->binop.left);
+        node->binop.right = foldNegatedConstant(node->binop.right);
+        genOperandRvalues(node, Void, isReducibleConstant(node, node->binop.left),
+                          isReducibleConstant(node, node->binop.right), &left, &right);
         
         enum QuadOpcode op;
         switch (node->binop.op)  {
@@ -735,20 +1452,10 @@ astnode *genRvalue(astnode *node, astnode *target) {
         return target;
     }
     else if (node->nodetype == LOG_TYPE) {
-        // for now ignore type values
-        astnode *left = genRvalue(node->binop.left, NULL);
-        astnode *right = genRvalue(node->binop.right, NULL);
-        
-        enum QuadOpcode op;
-        switch (node->binop.op) {
-            case LOGAND: op = LOGN; break;
-            case LOGOR:  op = LOGO; break;
-        }
-
-        if (!target) target = newGenericTemp();
-        emitQuad(op, target, left, right);
-        
-        return target;
+        return genLogicalRvalue(node, target);
+    }
+    else if (node->nodetype == TERNARY_TYPE) {
+        return genTernaryRvalue(node, target);
     }
     else if (node->nodetype == UNOP_TYPE) {
         // for now ignore type values
@@ -757,6 +1464,17 @@ astnode *genRvalue(astnode *node, astnode *target) {
         if (node->unop.op == PLUSPLUS || node->unop.op == MINUSMINUS) {
             return genPostixIncrIR(node, node->unop.op);
         }
+        else if (exprFloatClass(node)) {
+            int float_type = exprFloatClass(node);
+            astnode *expr = genRvalue(node->unop.expr, NULL);
+
+            if (!target) target = newGenericTemp();
+            if (node->unop.op == '-')
+                emitQuad(float_type == Float ? NEGSS : NEGSD, target, expr, NULL);
+            else
+                emitQuad(float_type == Float ? MOVSS : MOVSD, target, expr, NULL);
+            return target;
+        }
         else {
             // convert sizeof operator to an constant value
             astnode *expr = genRvalue(node->unop.expr, NULL);
@@ -806,18 +1524,41 @@ astnode *genRvalue(astnode *node, astnode *target) {
         }
         return target;
     }
+    else if (node->nodetype == COMPARE_TYPE && isFloatComparison(node)) {
+        astnode *flag = newGenericTemp();
+        switch(genFloatCompareIR(node)) {
+            case '>':  emitQuad(CC_GT, flag, NULL, NULL);  break;
+            case GTEQ: emitQuad(CC_GE, flag, NULL, NULL);  break;
+            case EQEQ: emitQuad(CC_EQ, flag, NULL, NULL);  break;
+            default:   emitQuad(CC_NEQ, flag, NULL, NULL); break;
+        }
+
+        if (!target)
+            return flag;
+        emitQuad(MOVL, target, flag, NULL);
+        return target;
+    }
     else if (node->nodetype == COMPARE_TYPE) {
-        emitQuad(CMP, NULL, node->binop.left, node->binop.right);
+        /* a compare's value is only made with a setcc when it is stored,
+        as conditions branch on the compare's flags directly */
+        astnode *left, *right;
+        genOperandRvalues(node, Void, false, false, &left, &right);
+        astnode *flag = newGenericTemp();
+
+        emitQuad(CMP, NULL, left, right);
         switch(node->binop.op) {
-            case '<': emitQuad(CC_LT, target, NULL, NULL);   break;
-            case '>': emitQuad(CC_GT, target, NULL, NULL);   break;
-            case LTEQ: emitQuad(CC_LE, target, NULL, NULL);  break;
-            case GTEQ: emitQuad(CC_GE, target, NULL, NULL);  break;
-            case EQEQ: emitQuad(CC_EQ, target, NULL, NULL);  break;
-            case NOTEQ:emitQuad(CC_NEQ, target, NULL, NULL); break;
+            case '<': emitQuad(CC_LT, flag, NULL, NULL);   break;
+            case '>': emitQuad(CC_GT, flag, NULL, NULL);   break;
+            case LTEQ: emitQuad(CC_LE, flag, NULL, NULL);  break;
+            case GTEQ: emitQuad(CC_GE, flag, NULL, NULL);  break;
+            case EQEQ: emitQuad(CC_EQ, flag, NULL, NULL);  break;
+            case NOTEQ:emitQuad(CC_NEQ, flag, NULL, NULL); break;
             default:  yyerror("Invalid comparator operator");
         }
-        if (!target) target = newGenericTemp();
+
+        if (!target)
+            return flag;
+        emitQuad(MOVL, target, flag, NULL);
         return target;
     }
     else if (node->nodetype == FNC_CALL) {
@@ -835,18 +1576,14 @@ astnode *genRvalue(astnode *node, astnode *target) {
  * emitQuad - generates a new quad with the specified opcode and the generic
  * nodes des (destination), source 1 (src 1), and source 2 (src2).
  * 
- * Note that although the function returns a pointer to the QUAD, we will 
- * almost never actually store the returned pointer.
+ * The quad is appended to the current basic block's array of quads. Note
+ * that although the function returns a pointer to the QUAD, we will almost
+ * never actually store the returned pointer, which only stays valid until
+ * the block is appended to again.
  */
 Quad *emitQuad(enum QuadOpcode op, astnode *des, astnode *src1, astnode *src2) {
-    Quad *new_quad = malloc(sizeof(Quad));
-    new_quad->opcode = op;
-    new_quad->result = des;
-    new_quad->src1 = src1;
-    new_quad->src2 = src2;
-
-    newQuadLLNode(new_quad);
-    return new_quad;
+    Quad new_quad = {op, des, src1, src2};
+    return spliceQuads(cur_basic_block, cur_basic_block->quad_count, 0, &new_quad, 1);
 }
 
 
@@ -872,14 +1609,10 @@ Quad *printBB(BasicBlock *bb, _Bool in_conditional_arm) {
         return NULL;
     
     fprintf(output_file, "%s:\n", bb->u_label);
-    QuadLLNode *cur_node = bb->quads_ll;
-
     Quad *last_quad = NULL;
-    while(cur_node) {
-        last_quad = &cur_node->quad;
-
+    for (int i = 0; i < bb->quad_count; ++i) {
+        last_quad = &bb->quads[i];
         printQuad(*last_quad);
-        cur_node = cur_node->next;
     }
 
     bb->printed = true;
@@ -1036,6 +1769,47 @@ char *op2str(enum QuadOpcode op) {
         case SHR_OP:        return "SHR_OP";
         case ARGBEGIN:      return "ARGBEGIN";
         case LOG_NEG_EXPR:  return "LOG_NEG_EXPR";
+        case MOVSS:         return "MOVSS";
+        case MOVSD:         return "MOVSD";
+        case ADDSS:         return "ADDSS";
+        case ADDSD:         return "ADDSD";
+        case SUBSS:         return "SUBSS";
+        case SUBSD:         return "SUBSD";
+        case MULSS:         return "MULSS";
+        case MULSD:         return "MULSD";
+        case DIVSS:         return "DIVSS";
+        case DIVSD:         return "DIVSD";
+        case NEGSS:         return "NEGSS";
+        case NEGSD:         return "NEGSD";
+        case CVTSI2SS:      return "CVTSI2SS";
+        case CVTSI2SD:      return "CVTSI2SD";
+        case CVTTSS2SI:     return "CVTTSS2SI";
+        case CVTTSD2SI:     return "CVTTSD2SI";
+        case CVTSS2SD:      return "CVTSS2SD";
+        case CVTSD2SS:      return "CVTSD2SS";
+        case UCOMISS:       return "UCOMISS";
+        case UCOMISD:       return "UCOMISD";
+        case VLOADU:        return "VLOADU";
+        case VLOADA:        return "VLOADA";
+        case VSTOREU:       return "VSTOREU";
+        case VSTOREA:       return "VSTOREA";
+        case VSPLAT:        return "VSPLAT";
+        case VZERO:         return "VZERO";
+        case VADDD:         return "VADDD";
+        case VSUBD:         return "VSUBD";
+        case VMULD:         return "VMULD";
+        case VANDD:         return "VANDD";
+        case VORD:          return "VORD";
+        case VXORD:         return "VXORD";
+        case VHADDD:        return "VHADDD";
+        case CMOV_LT:       return "CMOV_LT";
+        case CMOV_GT:       return "CMOV_GT";
+        case CMOV_EQ:       return "CMOV_EQ";
+        case CMOV_NEQ:      return "CMOV_NEQ";
+        case CMOV_GE:       return "CMOV_GE";
+        case CMOV_LE:       return "CMOV_LE";
+        case BLKCPY:        return "BLKCPY";
+        case BLKCLR:        return "BLKCLR";
     }
 }
 
@@ -1054,6 +1828,10 @@ char *node2str(astnode *node) {
         node->nodetype == STABLE_FNC_DEFINITION ) {
         sprintf(str_val, "%s", node->stable_entry.ident);
     }
+    else if (node->nodetype == FNC_CALL) {
+        free(str_val);
+        return node2str(node->fnc.ident);
+    }
     else if (node->nodetype == NUM_TYPE) {
         if (node->num.types & NUMMASK_INTGR) {
             if (node->num.types & NUMMASK_INT) {
@@ -1102,6 +1880,82 @@ char *node2str(astnode *node) {
 }
 
 
+/**
+ * typeSize - Returns the size of a type (or of a variable's type) in bytes,
+ * or -1 if it has none. An array's size is computed the first time that it
+ * is asked for and kept in its node, which its canonical type shares with
+ * every array of the same type, and a struct's is laid out with its members.
+ */
+long long typeSize(astnode *type) {
+    if (type->nodetype == STABLE_VAR)
+        type = type->stable_entry.node;
+
+    switch(type->nodetype) {
+        case PTR_TYPE:
+            return DATATYPE_POINTER;
+        case NUM_TYPE:
+            if (type->num.types & NUMMASK_DOUBLE)
+                return DATATYPE_DOUBLE;
+            else if (type->num.types & NUMMASK_FLOAT)
+                return DATATYPE_FLOAT;
+            else if (type->num.types & NUMMASK_INT)
+                return DATATYPE_INTEGER_SIZE;
+            else if (type->num.types & NUMMASK_LDBLE)
+                return DATATYPE_LONGDOUBLE;
+            else if (type->num.types & NUMMASK_LL)
+                return DATATYPE_LONGLONG;
+            else if (type->num.types & NUMMASK_LONG)
+                return DATATYPE_LONG;
+            else
+                return -1;
+        case SCALAR_TYPE:
+            switch (type->scalar_type.type) {
+                case Void: return DATATYPE_POINTER;
+                case Char: return DATATYPE_CHAR_SIZE;
+                case Short: return DATATYPE_SHORT_SIZE;
+                case Int: return DATATYPE_INTEGER_SIZE;
+                case Long: return DATATYPE_LONG;
+                case LongLong: return DATATYPE_LONGLONG;
+                case Bool: return DATATYPE_CHAR_SIZE;
+                case Float: return DATATYPE_FLOAT;
+                case Double: return DATATYPE_DOUBLE;
+                case LongDouble: return DATATYPE_LONGDOUBLE;
+                case FloatComplex: return DATATYPE_FLOAT;
+                case DoubleComplex: return DATATYPE_DOUBLE;
+                case LongDoubleComplex: return DATATYPE_LONGDOUBLE;
+                case FloatImag: return DATATYPE_FLOAT;
+                case DoubleImag: return DATATYPE_DOUBLE;
+                case LongDoubleImag: return DATATYPE_LONGDOUBLE;
+                default: return -1;
+            }
+        case ARRAY_TYPE:
+            if (type->arr.byte_size < 0)
+                type->arr.byte_size = typeSize(type->arr.ptr->ptr.pointee) * type->arr.size;
+            return type->arr.byte_size;
+        case STABLE_SU_TAG:
+            return type->stable_entry.sutag.size;
+        default:
+            return -1;
+    }
+}
+
+
+/**
+ * typeAlign - Returns the alignment of a type, keeping an array's in its
+ * node once computed, as typeSize does its size.
+ */
+int typeAlign(astnode *type) {
+    if (type->nodetype == ARRAY_TYPE) {
+        if (!type->arr.align)
+            type->arr.align = getAlignment(type->arr.ptr->ptr.pointee);
+        return type->arr.align;
+    }
+    if (type->nodetype == STABLE_SU_TAG)
+        return type->stable_entry.sutag.align;
+    return getAlignment(type);
+}
+
+
 /**
  * evaluateSizeOf - Evalutates the SizeOf operators into a constant.
  * Because we are not implementing a variable length array any time
@@ -1113,116 +1967,78 @@ astnode *evaluateSizeOf(astnode *node) {
         num_val.types = NUMMASK_INTGR;
         num_val.types |= NUMMASK_INT;
 
-    astnode *resulting_size;
+    /* an incomplete array is given a negative size, rather than none */
+    astnode *type = node->nodetype == STABLE_VAR ? node->stable_entry.node : node;
+    if ((num_val.val = typeSize(type)) < 0 && type->nodetype != ARRAY_TYPE)
+        return NULL;
+    return newNode_num(num_val);
+}
 
-    if (node->nodetype == STABLE_VAR)
-        node = node->stable_entry.node;
 
-    switch(node->nodetype) {
-        case PTR_TYPE:
-            num_val.val = DATATYPE_POINTER;
-            return newNode_num(num_val);
-        case NUM_TYPE:
+/**
+ * layoutStructMembers - Gives the members of a struct (or a union) their
+ * offsets, in the order they were declared in, and the struct's tag its
+ * size and alignment. Each member of a struct is placed at the first offset
+ * past the one before it that is a multiple of its alignment, while all the
+ * members of a union start at 0. The struct ends where its last member does,
+ * padded out to its alignment so that the elements of an array of it stay
+ * aligned.
+ */
+void layoutStructMembers(astnode *tag, astnode_list *fields, _Bool is_union) {
+    long long offset = 0, end = 0;
+    int struct_align = 1;
+
+    for (int i = 0; i < fields->len; ++i) {
+        astnode *memb = fields->list[i];
+        if (!memb || memb->nodetype != STABLE_SU_MEMB)
+            continue;
+
+        int align = typeAlign(memb->stable_entry.node);
+        if (align < 1)
+            align = 1;
+        if (align > struct_align)
+            struct_align = align;
+
+        if (!is_union)
+            offset = (offset + align - 1) / align * align;
+        memb->stable_entry.sumemb.offset_within_s_u = offset;
+        if (is_union)
+            offset = 0;
+        else
+            offset += typeSize(memb->stable_entry.node);
 
-            if (node->num.types & NUMMASK_DOUBLE) {
-                num_val.val = DATATYPE_DOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->num.types & NUMMASK_FLOAT) {
-                num_val.val = DATATYPE_FLOAT;
-                return newNode_num(num_val);
-            }
-            else if (node->num.types & NUMMASK_INT) {
-                num_val.val = DATATYPE_INTEGER_SIZE;
-                return newNode_num(num_val);
-            }
-            else if (node->num.types & NUMMASK_LDBLE) {
-                num_val.val = DATATYPE_LONGDOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->num.types & NUMMASK_LL) {
-                num_val.val = DATATYPE_LONGLONG;
-                return newNode_num(num_val);
-            }
-            else if (node->num.types & NUMMASK_LONG) {
-                num_val.val = DATATYPE_LONG;
-                return newNode_num(num_val);
-            }
-            else
-                return NULL;
-        case SCALAR_TYPE:
+        if (memb->stable_entry.sumemb.offset_within_s_u + typeSize(memb->stable_entry.node) > end)
+            end = memb->stable_entry.sumemb.offset_within_s_u + typeSize(memb->stable_entry.node);
+    }
 
-            if (node->scalar_type.type == Void) {
-                num_val.val = DATATYPE_POINTER;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Char) {
-                num_val.val = DATATYPE_CHAR_SIZE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Short) {
-                num_val.val = DATATYPE_SHORT_SIZE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Int) {
-                num_val.val = DATATYPE_INTEGER_SIZE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Long) {
-                num_val.val = DATATYPE_LONG;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == LongLong) {
-                num_val.val = DATATYPE_LONGLONG;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Bool) {
-                num_val.val = DATATYPE_CHAR_SIZE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Float) {
-                num_val.val = DATATYPE_FLOAT;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == Double) {
-                num_val.val = DATATYPE_DOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == LongDouble) {
-                num_val.val = DATATYPE_LONGDOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == FloatComplex) {
-                num_val.val = DATATYPE_FLOAT;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == DoubleComplex) {
-                num_val.val = DATATYPE_DOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == LongDoubleComplex) {
-                num_val.val = DATATYPE_LONGDOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == FloatImag) {
-                num_val.val = DATATYPE_FLOAT;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == DoubleImag) {
-                num_val.val = DATATYPE_DOUBLE;
-                return newNode_num(num_val);
-            }
-            else if (node->scalar_type.type == LongDoubleImag) {
-                num_val.val = DATATYPE_LONGDOUBLE;
-                return newNode_num(num_val);
-            }
-            else
-                return NULL;
+    tag->stable_entry.sutag.size = (end + struct_align - 1) / struct_align * struct_align;
+    tag->stable_entry.sutag.align = struct_align;
+}
+
+
+/**
+ * sameTargetType - Returns whether two types that pointers point at are the
+ * same, for pointer arithmetic: scalars of the same size, or pointers to
+ * (and arrays of) the same type.
+ */
+static _Bool sameTargetType(astnode *type1, astnode *type2) {
+    /* canonical types are the same exactly when they are the same node */
+    if (type1 == type2)
+        return true;
+    if (type1->nodetype != type2->nodetype)
+        return false;
+
+    switch (type1->nodetype) {
+        case SCALAR_TYPE:
+        case NUM_TYPE:
+            return typeSize(type1) == typeSize(type2);
         case ARRAY_TYPE:
-            resulting_size = evaluateSizeOf(node->arr.ptr->ptr.pointee);
-            num_val.val = resulting_size->num.val * node->arr.size;
-            return newNode_num(num_val);
-    }            
+            return sameTargetType(type1->arr.ptr->ptr.pointee, type2->arr.ptr->ptr.pointee);
+        case PTR_TYPE:
+            return sameTargetType(type1->ptr.pointee, type2->ptr.pointee);
+        default:
+            return false;
+    }
 }
 
 
@@ -1232,25 +2048,10 @@ astnode *evaluateSizeOf(astnode *node) {
  * Else returns a NULL AST pointer.
  */
 astnode *confirmSamePointer(astnode *node1, astnode *node2) {
-    if (node1->nodetype != node2->nodetype)
-        return NULL;
-    else {
-        astnode *val1, *val2;
-        switch (node1->nodetype) {
-            case SCALAR_TYPE:
-            case NUM_TYPE:
-                val1 = evaluateSizeOf(node1);
-                val2 = evaluateSizeOf(node2);
-                if (val1->num.val == val2->num.val)
-                    return val1;
-                else 
-                    return NULL;
-            case ARRAY_TYPE:
-                return confirmSamePointer(node1->arr.ptr->ptr.pointee, node2->arr.ptr->ptr.pointee);
-            case PTR_TYPE:
-                return confirmSamePointer(node1->ptr.pointee, node2->ptr.pointee);
-        }
-    }
+    astnode *pointee1 = node1->nodetype == ARRAY_TYPE ? node1->arr.ptr->ptr.pointee : node1->ptr.pointee;
+    astnode *pointee2 = node2->nodetype == ARRAY_TYPE ? node2->arr.ptr->ptr.pointee : node2->ptr.pointee;
+
+    return sameTargetType(pointee1, pointee2) ? evaluateSizeOf(pointee1) : NULL;
 }
 
 
@@ -1268,9 +2069,34 @@ astnode *newGenericTemp() {
     sprintf(str, "%%T%d", generic_node_count);
     generic_node_count++;
 
-    astnode *node = malloc(sizeof(astnode));
-
-    node->nodetype = TEMP_REG_TYPE;
+    astnode *node = allocNode(TEMP_REG_TYPE);
     node->ident.str = str;
     return node;
-}
\ No newline at end of file
+}
+
+
+/**
+ * newHiddenLocal - Adds a local variable of the given type to the function
+ * fnc, that the quads keep a value in across basic blocks (a temp is only
+ * given a register for as long as one quad). Its name, starting with
+ * prefix, is not a valid C name so that it can't clash with the program's.
+ */
+astnode *newHiddenLocal(astnode *fnc, astnode *type, char *prefix) {
+    static int local_count = 0;
+
+    astnode *local = newNode_sTableEntry(NULL);
+    local->nodetype = STABLE_VAR;
+    local->stable_entry.ident = malloc(sizeof(char)*32);
+    sprintf(local->stable_entry.ident, "%s%d", prefix, local_count++);
+    local->stable_entry.file_name = cur_file_name;
+    local->stable_entry.line_num = cur_line_num;
+    local->stable_entry.type = Variable_Type;
+    local->stable_entry.node = type;
+    local->stable_entry.var.storage_class = Auto;
+    local->stable_entry.var.type_qualifier = None;
+    local->stable_entry.var.offset_within_stack_frame = 1;
+
+    ScopeStackLayer *scope = fnc->stable_entry.fnc.function_body->compound_stmt.scope_layer;
+    sTableInsert(scope->tables[GENERAL_NAMESPACE], local, 0);
+    return local;
+}
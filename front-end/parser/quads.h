@@ -13,19 +13,29 @@
 #define QUADS
 
 struct astnode;
+struct astnode_list;
 
 
 /////////////////////////////////////////////////////////////////////////
 ///////////////////////////// Basic Blocks //////////////////////////////
 /////////////////////////////////////////////////////////////////////////
 
-/* each basic block is made out of a linked list of quads and a unique label */
+#define INIT_BB_QUADS 8 /* the quads a basic block has room for at first */
+
+/* each basic block is made out of an array of quads and a unique label */
 typedef struct BasicBlock {
     char *u_label;        /* a unique label */
-    struct QuadLLNode *quads_ll;    /* linked list of quads */
+    struct Quad *quads;     /* the block's quads, one after the other */
+    int quad_count;         /* number of quads in the block */
+    int quad_capacity;      /* number of quads there is room for */
     struct BasicBlock *next;  /* the next basic block */
     _Bool printed;          /* a flag to know if already printed or not */
-    _Bool translated;       /* whether the bb has already been converted into assembly */
+    int visited;            /* marker of the last CFG walk that reached this block */
+    int index;              /* position of the block in the last CFG walk */
+    int loop_depth;         /* number of loops the block is nested in */
+    _Bool loop_header;      /* whether the block is the target of a loop's back edge */
+    long long exec_count;   /* times the block ran in a profiling run, -1 if unknown */
+    long long edge_count[2];/* times each outgoing edge was taken, in getSuccessors order */
 } BasicBlock;
 
 /**
@@ -43,6 +53,27 @@ typedef struct BB_ll_node {
 
 BB_ll_node *newBBnode(BasicBlock *bb);  /* constructor for a BB_ll_node */
 
+
+/* the most blocks a single basic block can branch to (a block can hold a
+   break or continue BR, a conditional branch, and a fall-through block) */
+#define MAX_SUCCESSORS 8
+
+/**
+ * getSuccessors - Fills the succs array with the basic blocks that control
+ * can flow into from the end of bb, and returns how many there are. The
+ * taken target of a conditional branch comes before its fall-through arm.
+ */
+int getSuccessors(BasicBlock *bb, BasicBlock **succs, int max_succs);
+
+
+/**
+ * collectBasicBlocks - Walks the CFG starting at a function's entry block
+ * and returns a newly allocated array of every block reached, in depth-first
+ * order. The number of blocks is stored in count, and each block's index
+ * member is set to its position in the array.
+ */
+BasicBlock **collectBasicBlocks(BasicBlock *entry, int *count);
+
 typedef struct BB_ll {
     BB_ll_node *first;
     BB_ll_node *last;
@@ -60,6 +91,17 @@ typedef struct BB_ll {
  *  - w - words - 16 bites
  *  - l - long  - 32 bites
  *  - q - quads - 64 bites 
+ * The floating point opcodes are instead named after the SSE2 instructions
+ * they become, with ss for floats and sd for doubles. Their values live in
+ * SSE registers, and UCOMISS/UCOMISD set the flags that the branch or the
+ * setcc right after them tests.
+ * The vector opcodes work on 4 ints at a time, in SSE registers, and are
+ * only generated for vectorized loops: the loads and stores (U for any
+ * address, A for 16 byte aligned ones) read and write 4 ints in memory,
+ * VSPLAT copies a value into all 4 ints, and VHADDD adds up the 4 ints.
+ * The conditional moves, which if-conversion generates after a CMP, set
+ * their result to src1 when the compare's flags say the condition holds,
+ * and to src2 otherwise.
  */
 enum QuadOpcode {MOVB = 1,MOVW, MOVL, MOVQ, ADDB, ADDW, ADDL, ADDQ,
                     MODB, MODW, MODL, MODQ, XORB, XORW, XORL, XORQ,
@@ -70,7 +112,13 @@ enum QuadOpcode {MOVB = 1,MOVW, MOVL, MOVQ, ADDB, ADDW, ADDL, ADDQ,
                     LOGO, LOGN, COMMA, DEREF, PLPL, MINMIN,
                     NEG, LOG_NEG_EXPR, STORE, LOAD, LEA,
                     ARGBEGIN, ARG, CALL, CMP, BR, BRNEQ, BREQ, BRLT, BRLE,
-                    BRGT, BRGE, CC_LT, CC_GT, CC_EQ, CC_NEQ, CC_GE, CC_LE
+                    BRGT, BRGE, CC_LT, CC_GT, CC_EQ, CC_NEQ, CC_GE, CC_LE,
+                    MOVSS, MOVSD, ADDSS, ADDSD, SUBSS, SUBSD, MULSS, MULSD,
+                    DIVSS, DIVSD, NEGSS, NEGSD, CVTSI2SS, CVTSI2SD, CVTTSS2SI,
+                    CVTTSD2SI, CVTSS2SD, CVTSD2SS, UCOMISS, UCOMISD,
+                    VLOADU, VLOADA, VSTOREU, VSTOREA, VSPLAT, VZERO, VADDD, VSUBD,
+                    VMULD, VANDD, VORD, VXORD, VHADDD, CMOV_LT, CMOV_GT,
+                    CMOV_EQ, CMOV_NEQ, CMOV_GE, CMOV_LE, BLKCPY, BLKCLR
                 };  
 
 
@@ -82,17 +130,67 @@ typedef struct Quad {
 } Quad;
 
 
-/* A linked list wrapper of a quad */
-typedef struct QuadLLNode {
-    Quad quad;                  /* quad that the node contains  */
-    struct QuadLLNode *next;    /* next node in the linked list */
-} QuadLLNode;
+/**
+ * isCondBranch - Returns whether the opcode is one of the conditional branches.
+ */
+_Bool isCondBranch(enum QuadOpcode op);
+
+
+/**
+ * invertCondBranch - Returns the conditional branch opcode that branches
+ * on the opposite condition of op (so BRLT becomes BRGE).
+ */
+enum QuadOpcode invertCondBranch(enum QuadOpcode op);
+
+
+/**
+ * isFloatOpcode - Returns whether the opcode is one of the SSE2 floating
+ * point opcodes.
+ */
+_Bool isFloatOpcode(enum QuadOpcode op);
+
+
+/**
+ * isFloatCompare - Returns whether the opcode is a floating point compare.
+ */
+_Bool isFloatCompare(enum QuadOpcode op);
+
+
+/**
+ * isVectorOpcode - Returns whether the opcode is one of the vector opcodes
+ * of vectorized loops.
+ */
+_Bool isVectorOpcode(enum QuadOpcode op);
+
+
+/**
+ * isCondMove - Returns whether the opcode is one of the conditional moves.
+ */
+_Bool isCondMove(enum QuadOpcode op);
+
+
+/**
+ * isBlockMove - Returns whether the opcode is one of the block copy and
+ * clear opcodes, of structs and of memcpy and memset calls.
+ */
+_Bool isBlockMove(enum QuadOpcode op);
+
+
+/**
+ * spliceQuads - Replaces the remove_count quads of the basic block bb
+ * starting at index with the insert_count quads of insert (which may be
+ * NULL, to leave them to be filled in), moving the quads after them along.
+ * Returns the first of the inserted quads. A quad's index in its block, and
+ * pointers into the block's quads, stay valid until the block is spliced or
+ * appended to again.
+ */
+Quad *spliceQuads(BasicBlock *bb, int index, int remove_count, Quad *insert, int insert_count);
 
 
 /**
- * newQuadLLNode - Creates and returns a new linked list node of a quad.
+ * getLastQuad - Returns the last quad of a basic block, or NULL if empty.
  */
-void newQuadLLNode(Quad *new_quad);
+Quad *getLastQuad(BasicBlock *bb);
 
 
 /**
@@ -102,6 +200,15 @@ void newQuadLLNode(Quad *new_quad);
 void generateQuads(struct astnode *root);
 
 
+/**
+ * releaseFunction - Frees what is left of a function once its assembly has
+ * been generated: its basic blocks and their quads, which entry leads to,
+ * the scopes of its body and the chunks (nodes) that its tree came from.
+ */
+struct NodeChunk;
+void releaseFunction(struct astnode *fnc, BasicBlock *entry, struct NodeChunk *nodes);
+
+
 /**
  * genQuads - Generates the QUADS of an astnode (and all its children).
  */
@@ -173,6 +280,36 @@ struct astnode *genLvalue(struct astnode *node, enum LvalueMode *mode);
 struct astnode *genRvalue(struct astnode *node, struct astnode *target);
 
 
+/**
+ * typeFloatClass - Returns Float or Double if the type node is one of the
+ * floating types, and Void (0) for any other type. Long doubles are computed
+ * as doubles, as SSE2 has nothing wider.
+ */
+int typeFloatClass(struct astnode *type);
+
+
+/**
+ * hasBranchingValue - Returns whether computing an expression's value takes
+ * branches, as the value of a && or || or of a ?: does.
+ */
+_Bool hasBranchingValue(struct astnode *node);
+
+
+/**
+ * exprFloatClass - Returns the floating type (Float or Double) that an
+ * expression evaluates to, by the usual arithmetic conversions, or Void (0)
+ * for integer and pointer expressions.
+ */
+int exprFloatClass(struct astnode *node);
+
+
+/**
+ * genConvertedRvalue - Generates the r-value of an expression converted to
+ * the floating type float_type (Void for an integer), into target if given.
+ */
+struct astnode *genConvertedRvalue(struct astnode *node, int float_type, struct astnode *target);
+
+
 /*
  * emitQuad - generates a new quad with the specified opcode and the generic
  * nodes des (destination), source 1 (src 1), and source 2 (src2).
@@ -219,6 +356,21 @@ char *node2str(struct astnode *node);
 struct astnode *confirmSamePointer(struct astnode *node1,struct astnode *node2);
 
 
+/**
+ * typeSize - Returns the size of a type (or of a variable's type) in bytes,
+ * or -1 if it has none. Arrays keep their size in their node once it is
+ * computed, and structs and unions theirs once they are laid out.
+ */
+long long typeSize(struct astnode *type);
+
+
+/**
+ * typeAlign - Returns the alignment of a type, kept in the node of an array,
+ * struct or union once computed.
+ */
+int typeAlign(struct astnode *type);
+
+
 /**
  * evaluateSizeOf - Evalutates the SizeOf operators into a constant.
  * Because we are not implementing a variable length array any time
@@ -227,6 +379,14 @@ struct astnode *confirmSamePointer(struct astnode *node1,struct astnode *node2);
 struct astnode *evaluateSizeOf(struct astnode *node);
 
 
+/**
+ * layoutStructMembers - Gives the members of a struct (or a union) their
+ * offsets, in the order they were declared in, and its tag its size and
+ * alignment.
+ */
+void layoutStructMembers(struct astnode *tag, struct astnode_list *fields, _Bool is_union);
+
+
 /**
  * newGenericTemp - Generates a new generic node that is of temporary
  * type. There temporary types will be used when evaluating
@@ -237,5 +397,14 @@ struct astnode *evaluateSizeOf(struct astnode *node);
 struct astnode *newGenericTemp();
 
 
+/**
+ * newHiddenLocal - Adds a local variable of the given type to the function
+ * fnc, that the quads keep a value in across basic blocks (a temp is only
+ * given a register for as long as one quad). Its name, starting with
+ * prefix, is not a valid C name so that it can't clash with the program's.
+ */
+struct astnode *newHiddenLocal(struct astnode *fnc, struct astnode *type, char *prefix);
+
+
 
 #endif
\ No newline at end of file
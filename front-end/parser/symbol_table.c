@@ -456,6 +456,7 @@ astnode_list *combineSpecifierDeclarator(TmpSymbolTableEntry *specifier,
                 second_handle->ptr.pointee = specifier->node;
                 
             }
+            decl_list->list[i]->stable_entry.fnc.storage_class = specifier->var_fnc_storage_class;
             new_entries->list[i] = decl_list->list[i];
         }
         else if (cur_handle && cur_handle->nodetype == FNC_TYPE) {
@@ -469,6 +470,11 @@ astnode_list *combineSpecifierDeclarator(TmpSymbolTableEntry *specifier,
             second_handle->ptr.pointee = specifier->node;
         }     
 
+        /* the finished type is swapped for its canonical node */
+        new_entries->list[i]->stable_entry.node = internType(new_entries->list[i]->stable_entry.node);
+        if (new_entries->list[i]->nodetype == STABLE_FNC_DECLARATOR)
+            new_entries->list[i]->stable_entry.fnc.return_type =
+                                internType(new_entries->list[i]->stable_entry.fnc.return_type);
     }
     free(specifier);
 
@@ -548,4 +554,59 @@ void deleteInnermostScope() {
         free(scope_stack.innermost_scope->tables[i]);
     free(scope_stack.innermost_scope);
     scope_stack.innermost_scope = new_innermost;
+}
+
+
+/**
+ * releaseScopes - Frees the scopes within a statement of a function body
+ * that has been compiled, with their labels and identifiers, and the lists
+ * of its compound statements. The struct and union tags declared in them
+ * are kept, as the types that they are part of outlive the function.
+ */
+void releaseScopes(astnode *stmt) {
+    if (!stmt)
+        return;
+
+    switch (stmt->nodetype) {
+        case COMPOUND_STMT: {
+            AstnodeLinkedList *ll = stmt->compound_stmt.astnode_ll;
+            for (AstnodeLinkedListNode *cur = ll ? ll->first : NULL, *next; cur; cur = next) {
+                next = cur->next;
+                releaseScopes(cur->node);
+                free(cur);
+            }
+            free(ll);
+
+            /* the labels inside of it are freed along with the scope they are in,
+            once every statement that could refer to them has been gone through */
+            ScopeStackLayer *scope = stmt->compound_stmt.scope_layer;
+            if (scope) {
+                sTableDestroy(scope->tables[LABEL_NAMESPACE]);
+                sTableDestroy(scope->tables[GENERAL_NAMESPACE]);
+                free(scope->tables[SU_TAG_NAMESPACE]->data);
+                free(scope->tables[SU_TAG_NAMESPACE]);
+                free(scope);
+            }
+            break;
+        }
+        case CONDITIONAL_STMT:
+            releaseScopes(stmt->conditional_stmt.if_node);
+            releaseScopes(stmt->conditional_stmt.else_node);
+            break;
+        case WHILE_STMT:
+            releaseScopes(stmt->while_stmt.stmt);
+            break;
+        case DO_WHILE_STMT:
+            releaseScopes(stmt->do_while_stmt.stmt);
+            break;
+        case FOR_STMT:
+            releaseScopes(stmt->for_stmt.stmt);
+            break;
+        case SWITCH_STMT:
+            releaseScopes(stmt->switch_stmt.stmt);
+            break;
+        case STABLE_STMT_LABEL:
+            releaseScopes(stmt->stable_entry.node);
+            break;
+    }
 }
\ No newline at end of file
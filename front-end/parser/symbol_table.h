@@ -254,6 +254,15 @@ void createNewScope(enum ScopeType type, char *name);
 void deleteInnermostScope();
 
 
+/**
+ * releaseScopes - Frees the scopes within a statement of a function body
+ * that has been compiled, with their labels and identifiers, and the lists
+ * of its compound statements. The struct and union tags declared in them
+ * are kept, as the types that they are part of outlive the function.
+ */
+void releaseScopes(astnode *stmt);
+
+
 
 
 
@@ -0,0 +1,590 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * vectorize.c - Implements the loop vectorizer, ie the
+ * functions declared at vectorize.h.
+ *
+ * A vectorized loop is generated in front of the scalar loop:
+ *
+ *      zero the reduction accumulators, check the pointers for overlap
+ *      and that n >= 3
+ *  vector condition:   if (i < n - 3) goto vector body, else goto epilogue
+ *  vector body:        a[i..i+3] = ...; i += 4; goto vector condition
+ *  epilogue:           add the reduction accumulators into their variables
+ *
+ * after which the scalar loop runs the (at most three) iterations left,
+ * or all of them when a pointer check fails. The body only accesses the
+ * arrays at index i, so its iterations are independent of one another
+ * unless two different pointers point less than a vector apart.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quads.h"
+#include "vectorize.h"
+#include "../front_end_header.h"
+#include "../lexer/lheader.h"
+#include "../lexer/lheader2.h"
+#include "symbol_table.h"
+#include "pheader_ast.h"
+#include "../../back-end/assemb_gen.h"
+
+
+/* what the analysis of a for loop found out about it */
+typedef struct VectorLoop {
+    astnode *iv;                /* the induction variable, i */
+    astnode *bound;             /* the loop runs while i < bound */
+    _Bool aligned_start;        /* i starts at a multiple of VECTOR_WIDTH */
+
+    astnode *stmts[MAX_VECTOR_STMTS];   /* the assignments of the body */
+    int stmt_count;
+
+    astnode *bases[MAX_VECTOR_BASES];   /* the arrays and pointers accessed */
+    _Bool stored[MAX_VECTOR_BASES];     /* whether a base is stored into */
+    int base_count;
+
+    astnode *scalars[MAX_VECTOR_BASES]; /* the loop invariant variables read */
+    int scalar_count;
+
+    astnode *sums[MAX_VECTOR_STMTS];    /* the reduction variables */
+    astnode *slots[MAX_VECTOR_STMTS];   /* their accumulators, on the stack */
+    int sum_count;
+} VectorLoop;
+
+
+/**
+ * isVolatile - Returns whether a variable was declared volatile.
+ */
+static _Bool isVolatile(astnode *var) {
+    enum SymbolTableTypeQualifiers qual = var->stable_entry.var.type_qualifier;
+    return qual == V || qual == CV || qual == VR || qual == CVR;
+}
+
+
+/**
+ * isIntVar - Returns whether a node is an int variable (of either sign),
+ * which is what the quads of the vector loop compute with.
+ */
+static _Bool isIntVar(astnode *node) {
+    return node && node->nodetype == STABLE_VAR && !isVolatile(node) &&
+           node->stable_entry.node->nodetype == SCALAR_TYPE &&
+           node->stable_entry.node->scalar_type.type == Int;
+}
+
+
+/**
+ * isIntBase - Returns whether a node is an array of ints or a pointer to
+ * an int, the bases whose elements the vector loop accesses.
+ */
+static _Bool isIntBase(astnode *node) {
+    if (!node || node->nodetype != STABLE_VAR)
+        return false;
+
+    astnode *pointee;
+    if (node->stable_entry.node->nodetype == ARRAY_TYPE)
+        pointee = node->stable_entry.node->arr.ptr->ptr.pointee;
+    else if (node->stable_entry.node->nodetype == PTR_TYPE)
+        pointee = node->stable_entry.node->ptr.pointee;
+    else
+        return false;
+
+    return pointee && pointee->nodetype == SCALAR_TYPE && pointee->scalar_type.type == Int;
+}
+
+
+/**
+ * accessBase - Returns the base of an a[i] (or i[a]) access of the
+ * induction variable iv, or NULL if the node is no such access.
+ */
+static astnode *accessBase(astnode *node, astnode *iv) {
+    if (node->nodetype != DEREF_TYPE || node->unop.expr->nodetype != BINOP_TYPE ||
+        node->unop.expr->binop.op != '+')
+        return NULL;
+
+    astnode *left = node->unop.expr->binop.left;
+    astnode *right = node->unop.expr->binop.right;
+    if (right == iv && isIntBase(left))
+        return left;
+    if (left == iv && isIntBase(right))
+        return right;
+    return NULL;
+}
+
+
+/**
+ * addBase - Adds an accessed base to the loop, unless it is already there.
+ * Returns false if the loop accesses too many bases to be vectorized.
+ */
+static _Bool addBase(VectorLoop *loop, astnode *base, _Bool stored) {
+    for (int i = 0; i < loop->base_count; ++i) {
+        if (loop->bases[i] == base) {
+            loop->stored[i] |= stored;
+            return true;
+        }
+    }
+
+    if (loop->base_count == MAX_VECTOR_BASES)
+        return false;
+    loop->bases[loop->base_count] = base;
+    loop->stored[loop->base_count++] = stored;
+    return true;
+}
+
+
+/**
+ * sumIndex - Returns the index of a reduction variable of the loop, or -1
+ * if the variable is not one.
+ */
+static int sumIndex(VectorLoop *loop, astnode *var) {
+    for (int i = 0; i < loop->sum_count; ++i)
+        if (loop->sums[i] == var)
+            return i;
+    return -1;
+}
+
+
+/**
+ * sumAddend - Returns what a reduction statement, s = s + x (or the
+ * s += x that the parser turns into it), adds to s. Returns NULL if the
+ * statement is no reduction.
+ */
+static astnode *sumAddend(astnode *stmt, astnode *iv) {
+    astnode *sum = stmt->assignment.left, *right = stmt->assignment.right;
+    if (!isIntVar(sum) || sum == iv || right->nodetype != BINOP_TYPE || right->binop.op != '+')
+        return NULL;
+
+    if (right->binop.left == sum)
+        return right->binop.right;
+    if (right->binop.right == sum)
+        return right->binop.left;
+    return NULL;
+}
+
+
+/**
+ * isVectorExpr - Returns whether an expression can be computed four
+ * iterations at a time: an int expression of + - * & | ^ and unary minus
+ * over accesses at index i, constants and loop invariant variables. The
+ * bases and invariants read are added to the loop.
+ */
+static _Bool isVectorExpr(VectorLoop *loop, astnode *node) {
+    astnode *base;
+
+    switch (node->nodetype) {
+        case NUM_TYPE:
+            return node->num.types & NUMMASK_INTGR;
+
+        case STABLE_VAR:
+            if (!isIntVar(node) || node == loop->iv || sumIndex(loop, node) != -1)
+                return false;
+            for (int i = 0; i < loop->scalar_count; ++i)
+                if (loop->scalars[i] == node)
+                    return true;
+            if (loop->scalar_count == MAX_VECTOR_BASES)
+                return false;
+            loop->scalars[loop->scalar_count++] = node;
+            return true;
+
+        case DEREF_TYPE:
+            return (base = accessBase(node, loop->iv)) && addBase(loop, base, false);
+
+        case BINOP_TYPE:
+            switch (node->binop.op) {
+                case '+': case '-': case '*': case '&': case '|': case '^':
+                    return isVectorExpr(loop, node->binop.left) &&
+                           isVectorExpr(loop, node->binop.right);
+                default:
+                    return false;
+            }
+
+        case UNOP_TYPE:
+            return (node->unop.op == '-' || node->unop.op == '+') &&
+                   isVectorExpr(loop, node->unop.expr);
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * isAddressTaken - Returns whether the address of a variable is taken
+ * anywhere in a statement, which would let a pointer store change it.
+ * Statements that are not looked into are assumed to take it.
+ */
+static _Bool isAddressTaken(astnode *node, astnode *var) {
+    if (!node)
+        return false;
+
+    switch (node->nodetype) {
+        case ADDR_TYPE:
+            return node->unop.expr == var || isAddressTaken(node->unop.expr, var);
+        case UNOP_TYPE: case DEREF_TYPE:
+            return isAddressTaken(node->unop.expr, var);
+        case BINOP_TYPE: case COMPARE_TYPE: case LOG_TYPE:
+            return isAddressTaken(node->binop.left, var) || isAddressTaken(node->binop.right, var);
+        case ASS_TYPE:
+            return isAddressTaken(node->assignment.left, var) ||
+                   isAddressTaken(node->assignment.right, var);
+        case TERNARY_TYPE:
+            return isAddressTaken(node->ternary.if_expr, var) ||
+                   isAddressTaken(node->ternary.then_expr, var) ||
+                   isAddressTaken(node->ternary.else_expr, var);
+        case FNC_CALL:
+            for (int i = 0; i < node->fnc.arg_count; ++i)
+                if (isAddressTaken(node->fnc.arguments[i]->arg.expr, var))
+                    return true;
+            return false;
+        case COMPOUND_STMT:
+            for (AstnodeLinkedListNode *cur = node->compound_stmt.astnode_ll->first; cur; cur = cur->next)
+                if (isAddressTaken(cur->node, var))
+                    return true;
+            return false;
+        case CONDITIONAL_STMT:
+            return isAddressTaken(node->conditional_stmt.expr, var) ||
+                   isAddressTaken(node->conditional_stmt.if_node, var) ||
+                   isAddressTaken(node->conditional_stmt.else_node, var);
+        case WHILE_STMT: case DO_WHILE_STMT:
+            /* both hold an expression and a statement, in either order */
+            return isAddressTaken(node->while_stmt.expr, var) ||
+                   isAddressTaken(node->while_stmt.stmt, var);
+        case FOR_STMT:
+            return isAddressTaken(node->for_stmt.initial_clause, var) ||
+                   isAddressTaken(node->for_stmt.check_expr, var) ||
+                   isAddressTaken(node->for_stmt.iteration_expr, var) ||
+                   isAddressTaken(node->for_stmt.stmt, var);
+        case SWITCH_STMT:
+            return isAddressTaken(node->switch_stmt.expr, var) ||
+                   isAddressTaken(node->switch_stmt.stmt, var);
+        case RETURN_STMT:
+            return isAddressTaken(node->return_stmt.expr, var);
+        case STABLE_VAR: case NUM_TYPE: case STRLIT_TYPE: case CHRLIT_TYPE: case IDENT_TYPE:
+        case SIZEOF_TYPE: case BREAK_STMT: case CONTINUE_STMT: case NULL_STMT: case GOTO_STMT:
+            return false;
+        default:
+            return true;
+    }
+}
+
+
+/**
+ * isPrivateVar - Returns whether a variable can only be changed by name,
+ * ie it is a local variable whose address is never taken in fnc.
+ */
+static _Bool isPrivateVar(astnode *var, astnode *fnc) {
+    return var->stable_entry.var.storage_class != Extern &&
+           !isAddressTaken(fnc->stable_entry.fnc.function_body, var);
+}
+
+
+/**
+ * needsAliasCheck - Returns whether the bases at indices i and j of the
+ * loop have to be checked for overlap at run time. That is when one of
+ * them is stored into and they are not two different arrays.
+ */
+static _Bool needsAliasCheck(VectorLoop *loop, int i, int j) {
+    return (loop->stored[i] || loop->stored[j]) && (
+            loop->bases[i]->stable_entry.node->nodetype == PTR_TYPE ||
+            loop->bases[j]->stable_entry.node->nodetype == PTR_TYPE);
+}
+
+
+/**
+ * analyzeLoop - Fills in the VectorLoop of a for loop, returning whether
+ * the loop can be vectorized.
+ */
+static _Bool analyzeLoop(astnode *node, astnode *fnc, VectorLoop *loop) {
+    astnode *init = node->for_stmt.initial_clause;
+    astnode *check = node->for_stmt.check_expr;
+    astnode *iter = node->for_stmt.iteration_expr;
+    astnode *body = node->for_stmt.stmt;
+    memset(loop, 0, sizeof(VectorLoop));
+
+    // the header has to be for (i = init; i < bound; i++)
+    if (!init || !check || !iter || !body || init->nodetype != ASS_TYPE ||
+        !isIntVar(init->assignment.left))
+        return false;
+    loop->iv = init->assignment.left;
+    loop->aligned_start = init->assignment.right->nodetype == NUM_TYPE &&
+                          (init->assignment.right->num.types & NUMMASK_INTGR) &&
+                          init->assignment.right->num.val % VECTOR_WIDTH == 0;
+
+    if (check->nodetype != COMPARE_TYPE || check->binop.op != '<' || check->binop.left != loop->iv)
+        return false;
+    loop->bound = check->binop.right;
+    if (!(loop->bound->nodetype == NUM_TYPE && (loop->bound->num.types & NUMMASK_INTGR)) &&
+        !(isIntVar(loop->bound) && loop->bound != loop->iv))
+        return false;
+
+    _Bool is_incr = iter->nodetype == UNOP_TYPE && iter->unop.op == PLUSPLUS &&
+                    iter->unop.expr == loop->iv;
+    if (iter->nodetype == ASS_TYPE && iter->assignment.left == loop->iv) {
+        astnode *right = iter->assignment.right;
+        is_incr = right->nodetype == BINOP_TYPE && right->binop.op == '+' &&
+                  right->binop.left == loop->iv && right->binop.right->nodetype == NUM_TYPE &&
+                  right->binop.right->num.val == 1;
+    }
+    if (!is_incr)
+        return false;
+
+    // the body has to be made of assignments only
+    if (body->nodetype == ASS_TYPE)
+        loop->stmts[loop->stmt_count++] = body;
+    else if (body->nodetype == COMPOUND_STMT) {
+        for (AstnodeLinkedListNode *cur = body->compound_stmt.astnode_ll->first; cur; cur = cur->next) {
+            if (!cur->node)
+                continue;
+            if (cur->node->nodetype != ASS_TYPE || loop->stmt_count == MAX_VECTOR_STMTS)
+                return false;
+            loop->stmts[loop->stmt_count++] = cur->node;
+        }
+    }
+    if (!loop->stmt_count)
+        return false;
+
+    /* each assignment stores into a[i] or is a reduction. The reduction
+    variables are found first, as nothing else may read them */
+    for (int i = 0; i < loop->stmt_count; ++i) {
+        astnode *stmt = loop->stmts[i], *base;
+        if ((base = accessBase(stmt->assignment.left, loop->iv))) {
+            if (!addBase(loop, base, true))
+                return false;
+        }
+        else if (sumAddend(stmt, loop->iv) && sumIndex(loop, stmt->assignment.left) == -1)
+            loop->sums[loop->sum_count++] = stmt->assignment.left;
+        else
+            return false;
+    }
+    if (sumIndex(loop, loop->bound) != -1)
+        return false;
+
+    for (int i = 0; i < loop->stmt_count; ++i) {
+        astnode *stmt = loop->stmts[i];
+        astnode *value = accessBase(stmt->assignment.left, loop->iv) ? stmt->assignment.right
+                                                                     : sumAddend(stmt, loop->iv);
+        if (!isVectorExpr(loop, value))
+            return false;
+    }
+
+    /* a store through a pointer could change any variable whose address
+    was taken, while the vector loop reads them only once per 4 iterations */
+    for (int i = 0; i < loop->base_count; ++i) {
+        if (!loop->stored[i] || loop->bases[i]->stable_entry.node->nodetype != PTR_TYPE)
+            continue;
+
+        if (!isPrivateVar(loop->iv, fnc) ||
+            (loop->bound->nodetype == STABLE_VAR && !isPrivateVar(loop->bound, fnc)))
+            return false;
+        for (int j = 0; j < loop->scalar_count; ++j)
+            if (!isPrivateVar(loop->scalars[j], fnc))
+                return false;
+        for (int j = 0; j < loop->sum_count; ++j)
+            if (!isPrivateVar(loop->sums[j], fnc))
+                return false;
+    }
+
+    int check_count = 0;
+    for (int i = 0; i < loop->base_count; ++i)
+        for (int j = i + 1; j < loop->base_count; ++j)
+            check_count += needsAliasCheck(loop, i, j);
+
+    return check_count <= MAX_ALIAS_CHECKS;
+}
+
+
+/**
+ * isAlignedAccess - Returns whether the accesses to a base are 16 byte
+ * aligned: global arrays are laid out 16 byte aligned, and i steps through
+ * them 4 ints at a time from a multiple of 4.
+ */
+static _Bool isAlignedAccess(VectorLoop *loop, astnode *base) {
+    return loop->aligned_start && base->stable_entry.var.storage_class == Extern &&
+           base->stable_entry.node->nodetype == ARRAY_TYPE &&
+           base->stable_entry.node->arr.size >= VECTOR_WIDTH;
+}
+
+
+/**
+ * newIntConstant - Creates an int constant node of the value val.
+ */
+static astnode *newIntConstant(int val) {
+    struct YYnum num_val;
+    num_val.val = val;
+    num_val.d_val = 0;
+    num_val.types = NUMMASK_INTGR | NUMMASK_INT;
+    return newNode_num(num_val);
+}
+
+
+/**
+ * newVectorSlot - Adds a 16 byte local variable to a function, which
+ * holds a vector across the iterations of the vector loop.
+ */
+static astnode *newVectorSlot(astnode *fnc) {
+    astnode *type = newNode_arr(VECTOR_WIDTH);
+    type->arr.ptr->ptr.pointee = newNode_scalarType(Int, true);
+    return newHiddenLocal(fnc, type, ".vec");
+}
+
+
+/**
+ * genVectorRvalue - Generates the quads computing an expression accepted
+ * by isVectorExpr for 4 iterations at once, returning the vector temp.
+ */
+static astnode *genVectorRvalue(VectorLoop *loop, astnode *node) {
+    astnode *target = newGenericTemp(), *base;
+
+    if (node->nodetype == NUM_TYPE || node->nodetype == STABLE_VAR)
+        emitQuad(VSPLAT, target, node, NULL);
+    else if (node->nodetype == DEREF_TYPE) {
+        base = accessBase(node, loop->iv);
+        astnode *addr = genRvalue(node->unop.expr, NULL);
+        emitQuad(isAlignedAccess(loop, base) ? VLOADA : VLOADU, target, addr, NULL);
+    }
+    else if (node->nodetype == UNOP_TYPE && node->unop.op == '+')
+        return genVectorRvalue(loop, node->unop.expr);
+    else if (node->nodetype == UNOP_TYPE) {
+        astnode *expr = genVectorRvalue(loop, node->unop.expr);
+        astnode *zero = newGenericTemp();
+        emitQuad(VZERO, zero, NULL, NULL);
+        emitQuad(VSUBD, target, zero, expr);
+    }
+    else {
+        astnode *left = genVectorRvalue(loop, node->binop.left);
+        astnode *right = genVectorRvalue(loop, node->binop.right);
+
+        enum QuadOpcode op;
+        switch (node->binop.op) {
+            case '-':   op = VSUBD;     break;
+            case '*':   op = VMULD;     break;
+            case '&':   op = VANDD;     break;
+            case '|':   op = VORD;      break;
+            case '^':   op = VXORD;     break;
+            default:    op = VADDD;     break;
+        }
+        emitQuad(op, target, left, right);
+    }
+    return target;
+}
+
+
+/**
+ * moveToBlock - Makes bb the basic block that the quads are appended to.
+ * The current block falls through into it.
+ */
+static void moveToBlock(BasicBlock *bb) {
+    cur_basic_block->next = bb;
+    cur_basic_block = bb;
+}
+
+
+/**
+ * genAliasCheck - Generates the quads that go on to the block ok when the
+ * bases a and b are at least a vector apart, and to the block fail if not.
+ * The distance is computed both ways around, as there are no unsigned
+ * compares in the quads.
+ */
+static void genAliasCheck(astnode *a, astnode *b, BasicBlock *ok, BasicBlock *fail) {
+    BasicBlock *other_way = newBasicBlock(NULL);
+    astnode *vector_size = newIntConstant(VECTOR_WIDTH*DATATYPE_INTEGER_SIZE);
+
+    for (int i = 0; i < 2; ++i) {
+        astnode *from = genRvalue(i ? b : a, NULL);
+        astnode *to = genRvalue(i ? a : b, NULL);
+        astnode *distance = newGenericTemp();
+        emitQuad(SUBL, distance, to, from);
+        emitQuad(CMP, NULL, distance, vector_size);
+        emitQuad(BRGE, NULL, newNode_bb(ok), newNode_bb(i ? fail : other_way));
+
+        if (!i)
+            moveToBlock(other_way);
+    }
+}
+
+
+/**
+ * vectorizeForLoopIR - Generates a vectorized copy of a for loop, if the
+ * loop is one that can be vectorized. It is called by generateForLoopIR
+ * after the initial clause, and the scalar loop it then generates runs the
+ * iterations left over. fnc is the function the loop is in.
+ */
+_Bool vectorizeForLoopIR(astnode *node, astnode *fnc) {
+    VectorLoop loop;
+    if (!be_flags.vectorize || !analyzeLoop(node, fnc, &loop))
+        return false;
+
+    BasicBlock *cond_bb = newBasicBlock(NULL);
+    BasicBlock *body_bb = newBasicBlock(NULL);
+    BasicBlock *epilogue_bb = newBasicBlock(NULL);
+
+    // the reductions are accumulated in vectors that start out as zeros
+    for (int i = 0; i < loop.sum_count; ++i) {
+        loop.slots[i] = newVectorSlot(fnc);
+        astnode *zero = newGenericTemp();
+        emitQuad(VZERO, zero, NULL, NULL);
+        emitQuad(VSTOREU, NULL, zero, loop.slots[i]);
+    }
+
+    // pointers that could overlap within a vector are left to the scalar loop
+    for (int i = 0; i < loop.base_count; ++i) {
+        for (int j = i + 1; j < loop.base_count; ++j) {
+            if (!needsAliasCheck(&loop, i, j))
+                continue;
+
+            BasicBlock *ok_bb = newBasicBlock(NULL);
+            genAliasCheck(loop.bases[i], loop.bases[j], ok_bb, epilogue_bb);
+            moveToBlock(ok_bb);
+        }
+    }
+
+    /* run vector iterations while there are at least 4 iterations left,
+    as i < n - 3 rather than i + 3 < n, which overflows for an i near the
+    largest int. n - 3 can't overflow once n >= 3 */
+    if (loop.bound->nodetype != NUM_TYPE || (long long) loop.bound->num.val < VECTOR_WIDTH - 1) {
+        emitQuad(CMP, NULL, genRvalue(loop.bound, NULL), newIntConstant(VECTOR_WIDTH - 1));
+        emitQuad(BRGE, NULL, newNode_bb(cond_bb), newNode_bb(epilogue_bb));
+    }
+    moveToBlock(cond_bb);
+    astnode *limit = newGenericTemp();
+    emitQuad(ADDL, limit, genRvalue(loop.bound, NULL), newIntConstant(1 - VECTOR_WIDTH));
+    emitQuad(CMP, NULL, genRvalue(loop.iv, NULL), limit);
+    emitQuad(BRLT, NULL, newNode_bb(body_bb), newNode_bb(epilogue_bb));
+
+    cur_basic_block = body_bb;
+    for (int i = 0; i < loop.stmt_count; ++i) {
+        astnode *stmt = loop.stmts[i], *base;
+
+        if ((base = accessBase(stmt->assignment.left, loop.iv))) {
+            astnode *value = genVectorRvalue(&loop, stmt->assignment.right);
+            astnode *addr = genRvalue(stmt->assignment.left->unop.expr, NULL);
+            emitQuad(isAlignedAccess(&loop, base) ? VSTOREA : VSTOREU, NULL, value, addr);
+        }
+        else {
+            astnode *slot = loop.slots[sumIndex(&loop, stmt->assignment.left)];
+            astnode *value = genVectorRvalue(&loop, sumAddend(stmt, loop.iv));
+            astnode *acc = newGenericTemp(), *new_acc = newGenericTemp();
+            emitQuad(VLOADU, acc, slot, NULL);
+            emitQuad(VADDD, new_acc, acc, value);
+            emitQuad(VSTOREU, NULL, new_acc, slot);
+        }
+    }
+    emitQuad(ADDL, loop.iv, genRvalue(loop.iv, NULL), newIntConstant(VECTOR_WIDTH));
+    emitQuad(BR, NULL, newNode_bb(cond_bb), NULL);
+    body_bb->next = epilogue_bb;
+
+    // add up the lanes of the accumulators
+    cur_basic_block = epilogue_bb;
+    for (int i = 0; i < loop.sum_count; ++i) {
+        astnode *acc = newGenericTemp(), *lanes_sum = newGenericTemp();
+        emitQuad(VLOADU, acc, loop.slots[i], NULL);
+        emitQuad(VHADDD, lanes_sum, acc, NULL);
+        emitQuad(ADDL, loop.sums[i], genRvalue(loop.sums[i], NULL), lanes_sum);
+    }
+
+    return true;
+}
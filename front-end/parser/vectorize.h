@@ -0,0 +1,43 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * vectorize.h - Declares the functions associated with
+ * loop vectorization: recognizing the simple counted for
+ * loops whose iterations are independent, and generating
+ * the quads that run four of their iterations at a time
+ * in the SSE registers.
+ */
+
+#ifndef VECTORIZE
+#define VECTORIZE
+
+struct astnode;
+
+
+/* how many ints fit in an SSE register, ie iterations per vector iteration */
+#define VECTOR_WIDTH 4
+
+/* limits on the loops that are vectorized, past which the loop stays scalar */
+#define MAX_VECTOR_STMTS 16     /* statements in the loop body */
+#define MAX_VECTOR_BASES 16     /* arrays and pointers the body accesses */
+#define MAX_ALIAS_CHECKS 8      /* pointer pairs checked for overlap at run time */
+
+
+/**
+ * vectorizeForLoopIR - Generates a vectorized copy of a for loop, if the
+ * loop is one that can be vectorized. It is called by generateForLoopIR
+ * after the initial clause, and the scalar loop it then generates runs the
+ * iterations left over. fnc is the function the loop is in.
+ *
+ * The loops vectorized are innermost loops of the form
+ *      for (i = init; i < n; i++)
+ * over int variables, whose body only assigns int expressions of a[i],
+ * b[i], ... and loop invariants to a[i] (element-wise and memset-like
+ * loops), or adds them to an int variable (sum reductions). Returns
+ * whether the loop was vectorized.
+ */
+_Bool vectorizeForLoopIR(struct astnode *node, struct astnode *fnc);
+
+
+#endif
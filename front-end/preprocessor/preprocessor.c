@@ -0,0 +1,1502 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * preprocessor.c - Implements the functions declared in
+ * the header file 'preprocessor.h'.
+ *
+ * A source file is read once, spliced and stripped of its comments,
+ * and split into logical lines of preprocessing tokens, which are kept
+ * for the rest of the run. Its lines are then expanded one at a time
+ * into the output, which carries '# line "file"' markers where the
+ * output leaves the lines of the file it came from, as gcc -E does.
+ *
+ * Macro expansion follows the usual hide set algorithm: each token
+ * remembers the macros whose expansion produced it, and never invokes
+ * them again, which keeps a self-referencing macro from expanding for
+ * ever.
+ */
+
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../front_end_header.h"
+#include "../parser/symbol_table.h"
+#include "../parser/pch.h"
+#include "./preprocessor.h"
+#include "../../back-end/back_end_header.h"
+
+
+/* the number of buckets in the macro and source file hash tables */
+#define PP_TABLE_SIZE 211
+
+/* the deepest that includes may nest, which stops a file including itself */
+#define MAX_INCLUDE_DEPTH 200
+
+/* a gap of up to this many lines in the output is filled with newlines,
+and a larger one with a line marker */
+#define MAX_LINE_GAP 8
+
+
+enum PPTokenKind { PP_IDENT, PP_NUMBER, PP_STRING, PP_PUNCT, PP_SPACE };
+
+/* the macros whose expansion produced a token */
+typedef struct HideSet {
+    struct Macro *macro;
+    struct HideSet *next;
+} HideSet;
+
+typedef struct PPToken {
+    enum PPTokenKind kind;
+    char *text;
+    HideSet *hide_set;
+} PPToken;
+
+typedef struct TokenList {
+    PPToken *tokens;
+    int count;
+    int capacity;
+} TokenList;
+
+/* a logical line of a source file, after backslash-newlines are spliced */
+typedef struct PPLine {
+    TokenList tokens;
+    int line_num;       /* the physical line that it begins on */
+} PPLine;
+
+typedef struct Macro {
+    char *name;
+    _Bool is_function;
+    _Bool is_variadic;  /* its last parameter is __VA_ARGS__ */
+    char **params;
+    int param_count;
+    TokenList body;
+    struct Macro *next;
+} Macro;
+
+typedef struct SourceFile {
+    char *path;         /* the full path, which it is cached by */
+    PPLine *lines;
+    int line_count;
+    char *guard;        /* the macro of its include guard, if it has one */
+    _Bool once;         /* it has a #pragma once */
+    _Bool included;
+    _Bool read;         /* its lines were read, rather than only its guard
+                        restored from a precompiled header */
+    struct SourceFile *next;
+} SourceFile;
+
+/* a conditional directive that is still open */
+typedef struct Conditional {
+    _Bool was_active;   /* whether the lines around it are */
+    _Bool taken;        /* whether one of its branches was */
+    _Bool seen_else;
+} Conditional;
+
+static Macro *macro_table[PP_TABLE_SIZE];
+static SourceFile *file_table[PP_TABLE_SIZE];
+static char **include_paths = NULL;
+static int include_path_count = 0;
+static int include_depth = 0;
+static int pp_error_count = 0;
+static char *cur_pp_file = "<command line>";
+static int cur_pp_line = 0;
+static _Bool predefined = false;
+static char *command_line_macros = NULL;   /* each -D definition, on a line */
+
+static char *system_include_paths[] = {"/usr/local/include", "/usr/include"};
+
+/* the punctuators of more than one character, longest first */
+static char *multi_char_puncts[] = {"...", "<<=", ">>=", "->", "++", "--", "<<", ">>", "<=", ">=",
+                                    "==", "!=", "&&", "||", "*=", "/=", "%=", "+=", "-=", "&=",
+                                    "^=", "|=", "##"};
+
+static _Bool expandTokens(TokenList *in, TokenList *out, _Bool whole_line);
+
+
+/**
+ * ppError - Reports an error at the current line of the file being
+ * preprocessed.
+ */
+static void ppError(char *err_str, char *arg) {
+    fprintf(stderr, "%s:%d Error: %s%s\n", cur_pp_file, cur_pp_line, err_str, arg ? arg : "");
+    ++pp_error_count;
+}
+
+
+/**
+ * appendToken - Appends a token to the end of a token list.
+ */
+static void appendToken(TokenList *list, PPToken tok) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? 2*list->capacity : 16;
+        list->tokens = realloc(list->tokens, sizeof(PPToken)*list->capacity);
+    }
+    list->tokens[list->count++] = tok;
+}
+
+
+/**
+ * newToken - Returns a token of the first length characters of text.
+ */
+static PPToken newToken(enum PPTokenKind kind, char *text, int length) {
+    PPToken tok = {kind, strndup(text, length), NULL};
+    return tok;
+}
+
+
+/**
+ * isPunct - Returns whether a token is the punctuator punct.
+ */
+static _Bool isPunct(PPToken *tok, char *punct) {
+    return tok->kind == PP_PUNCT && !strcmp(tok->text, punct);
+}
+
+
+/**
+ * nextToken - Returns the index of the first token at or after index i
+ * that isn't white space, or the list's count if there isn't one.
+ */
+static int nextToken(TokenList *list, int i) {
+    while (i < list->count && list->tokens[i].kind == PP_SPACE)
+        ++i;
+    return i;
+}
+
+
+/**
+ * spliceLines - Removes the backslash-newlines of a source, moving the
+ * newlines that they held to the end of the logical line, so that each
+ * line after it still starts on the line number that it did.
+ */
+static void spliceLines(char *src) {
+    char *out = src;
+    int spliced = 0;
+
+    for (char *c = src; *c; ++c) {
+        if (c[0] == '\\' && c[1] == '\n') {
+            ++c;
+            ++spliced;
+            continue;
+        }
+        if (c[0] == '\\' && c[1] == '\r' && c[2] == '\n') {
+            c += 2;
+            ++spliced;
+            continue;
+        }
+        *out++ = *c;
+        if (*c == '\n')
+            for (; spliced; --spliced)
+                *out++ = '\n';
+    }
+    *out = 0;
+}
+
+
+/**
+ * tokenizeSource - Splits a source into its logical lines of tokens,
+ * dropping the comments and the lines that are left empty.
+ */
+static void tokenizeSource(char *src, PPLine **lines, int *line_count) {
+    int capacity = 0, line_num = 1;
+    _Bool in_comment = false;
+    PPLine line = {{NULL, 0, 0}, 1};
+
+    spliceLines(src);
+    *lines = NULL;
+    *line_count = 0;
+
+    for (char *c = src; ; ) {
+        if (!*c || *c == '\n') {
+            if (nextToken(&line.tokens, 0) < line.tokens.count) {
+                if (*line_count == capacity) {
+                    capacity = capacity ? 2*capacity : 64;
+                    *lines = realloc(*lines, sizeof(PPLine)*capacity);
+                }
+                (*lines)[(*line_count)++] = line;
+            }
+            if (!*c)
+                return;
+
+            line = (PPLine) {{NULL, 0, 0}, ++line_num};
+            ++c;
+            continue;
+        }
+
+        /* a comment is a single space */
+        if (in_comment) {
+            if (c[0] == '*' && c[1] == '/') {
+                in_comment = false;
+                c += 2;
+            }
+            else
+                ++c;
+            continue;
+        }
+        if ((c[0] == '/' && (c[1] == '*' || c[1] == '/')) || isspace(*c)) {
+            if (c[0] == '/' && c[1] == '*') {
+                in_comment = true;
+                c += 2;
+            }
+            else if (c[0] == '/')
+                while (*c && *c != '\n')
+                    ++c;
+            else
+                ++c;
+
+            if (!line.tokens.count || line.tokens.tokens[line.tokens.count-1].kind != PP_SPACE)
+                appendToken(&line.tokens, newToken(PP_SPACE, " ", 1));
+            continue;
+        }
+
+        char *start = c;
+        enum PPTokenKind kind;
+
+        if (*c == '"' || *c == '\'' || (*c == 'L' && (c[1] == '"' || c[1] == '\''))) {
+            char quote = *c == 'L' ? *++c : *c;
+            for (++c; *c && *c != quote && *c != '\n'; ++c)
+                if (*c == '\\' && c[1] && c[1] != '\n')
+                    ++c;
+            if (*c == quote)
+                ++c;
+            kind = PP_STRING;
+        }
+        else if (isalpha(*c) || *c == '_') {
+            while (isalnum(*c) || *c == '_')
+                ++c;
+            kind = PP_IDENT;
+        }
+        else if (isdigit(*c) || (*c == '.' && isdigit(c[1]))) {
+            for (++c; isalnum(*c) || *c == '_' || *c == '.' ||
+                        ((*c == '+' || *c == '-') && strchr("eEpP", c[-1])); ++c)
+                ;
+            kind = PP_NUMBER;
+        }
+        else {
+            int length = 1;
+            for (size_t i = 0; i < sizeof(multi_char_puncts)/sizeof(char *); ++i)
+                if (!strncmp(c, multi_char_puncts[i], strlen(multi_char_puncts[i]))) {
+                    length = strlen(multi_char_puncts[i]);
+                    break;
+                }
+            c += length;
+            kind = PP_PUNCT;
+        }
+        appendToken(&line.tokens, newToken(kind, start, c - start));
+    }
+}
+
+
+/**
+ * readFile - Returns the whole of a file as a string of *size characters,
+ * or NULL if it can't be opened. A regular file is mapped into memory
+ * (privately, as splicing its lines writes to it) rather than read, unless
+ * it fills its last page, where the zeros past its end terminate it;
+ * anything else, such as a pipe, is read into a buffer.
+ */
+static char *readFile(char *path, size_t *size, _Bool *mapped) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    *mapped = false;
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size % sysconf(_SC_PAGESIZE)) {
+        char *src = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (src != MAP_FAILED) {
+            close(fd);
+            *size = st.st_size;
+            *mapped = true;
+            return src;
+        }
+    }
+
+    size_t capacity = 4096;
+    ssize_t read_count;
+    char *buffer = malloc(capacity + 1);
+
+    *size = 0;
+    while ((read_count = read(fd, buffer + *size, capacity - *size)) > 0) {
+        *size += read_count;
+        if (*size == capacity)
+            buffer = realloc(buffer, (capacity *= 2) + 1);
+    }
+    buffer[*size] = 0;
+    close(fd);
+    return buffer;
+}
+
+
+/**
+ * fileSlot - Returns the place in the source file table where the file at
+ * the full path path is, or would be added.
+ */
+static SourceFile **fileSlot(char *path) {
+    SourceFile **slot = &file_table[sTableHash(path, PP_TABLE_SIZE)];
+    while (*slot && strcmp((*slot)->path, path))
+        slot = &(*slot)->next;
+    return slot;
+}
+
+
+/**
+ * loadSourceFile - Returns the tokenized lines of the file at the full
+ * path path, reading and tokenizing it only the first time that it is
+ * asked for. Returns NULL if it can't be read.
+ */
+static SourceFile *loadSourceFile(char *path) {
+    SourceFile **slot = fileSlot(path);
+    if (*slot && (*slot)->read)
+        return *slot;
+
+    size_t size;
+    _Bool mapped;
+    char *src = readFile(path, &size, &mapped);
+    if (!src)
+        return NULL;
+
+    if (!*slot) {
+        *slot = calloc(1, sizeof(SourceFile));
+        (*slot)->path = strdup(path);
+    }
+    tokenizeSource(src, &(*slot)->lines, &(*slot)->line_count);
+    (*slot)->read = true;
+    if (mapped)
+        munmap(src, size);
+    else
+        free(src);
+    return *slot;
+}
+
+
+/**
+ * macroSlot - Returns the place in the macro table where the macro name
+ * is, or would be added.
+ */
+static Macro **macroSlot(char *name) {
+    Macro **slot = &macro_table[sTableHash(name, PP_TABLE_SIZE)];
+    while (*slot && strcmp((*slot)->name, name))
+        slot = &(*slot)->next;
+    return slot;
+}
+
+
+/**
+ * lookupMacro - Returns the macro called name, or NULL if there isn't one.
+ */
+static Macro *lookupMacro(char *name) {
+    return *macroSlot(name);
+}
+
+
+/**
+ * parseDefine - Defines the macro of a #define directive, whose name is
+ * at index i of its line.
+ */
+static void parseDefine(TokenList *line, int i) {
+    i = nextToken(line, i);
+    if (i == line->count || line->tokens[i].kind != PP_IDENT) {
+        ppError("macro names must be identifiers", NULL);
+        return;
+    }
+
+    Macro *macro = calloc(1, sizeof(Macro));
+    macro->name = line->tokens[i++].text;
+
+    /* a function-like macro's parameters follow its name without a space */
+    if (i < line->count && isPunct(&line->tokens[i], "(")) {
+        macro->is_function = true;
+        macro->params = malloc(sizeof(char *)*line->count);
+
+        for (i = nextToken(line, i+1); i < line->count && !isPunct(&line->tokens[i], ")"); ) {
+            PPToken *tok = &line->tokens[i];
+
+            if (isPunct(tok, "...")) {
+                macro->is_variadic = true;
+                macro->params[macro->param_count++] = "__VA_ARGS__";
+            }
+            else if (tok->kind == PP_IDENT)
+                macro->params[macro->param_count++] = tok->text;
+            else {
+                ppError("invalid parameter list of macro ", macro->name);
+                return;
+            }
+
+            i = nextToken(line, i+1);
+            if (i < line->count && isPunct(&line->tokens[i], ","))
+                i = nextToken(line, i+1);
+        }
+        if (i == line->count) {
+            ppError("missing ')' in the parameter list of macro ", macro->name);
+            return;
+        }
+        ++i;
+    }
+
+    /* the body, without the white space around it */
+    int end = line->count;
+    while (end > i && line->tokens[end-1].kind == PP_SPACE)
+        --end;
+    for (i = nextToken(line, i); i < end; ++i)
+        appendToken(&macro->body, line->tokens[i]);
+
+    Macro **slot = macroSlot(macro->name);
+    if (*slot)
+        macro->next = (*slot)->next;
+    *slot = macro;
+}
+
+
+/**
+ * undefineMacro - Removes the macro of an #undef directive, whose name is
+ * at index i of its line.
+ */
+static void undefineMacro(TokenList *line, int i) {
+    i = nextToken(line, i);
+    if (i == line->count || line->tokens[i].kind != PP_IDENT) {
+        ppError("macro names must be identifiers", NULL);
+        return;
+    }
+
+    Macro **slot = macroSlot(line->tokens[i].text);
+    if (*slot)
+        *slot = (*slot)->next;
+}
+
+
+/**
+ * inHideSet - Returns whether a macro is in a hide set.
+ */
+static _Bool inHideSet(HideSet *hide_set, Macro *macro) {
+    for (; hide_set; hide_set = hide_set->next)
+        if (hide_set->macro == macro)
+            return true;
+    return false;
+}
+
+
+/**
+ * joinHideSets - Returns the union of two hide sets.
+ */
+static HideSet *joinHideSets(HideSet *first, HideSet *second) {
+    for (; first; first = first->next) {
+        if (inHideSet(second, first->macro))
+            continue;
+
+        HideSet *joined = malloc(sizeof(HideSet));
+        joined->macro = first->macro;
+        joined->next = second;
+        second = joined;
+    }
+    return second;
+}
+
+
+/**
+ * paramIndex - Returns the index of the parameter of a function-like
+ * macro that tok names, or -1 if it doesn't name one.
+ */
+static int paramIndex(Macro *macro, PPToken *tok) {
+    if (!macro->is_function || tok->kind != PP_IDENT)
+        return -1;
+    for (int i = 0; i < macro->param_count; ++i)
+        if (!strcmp(macro->params[i], tok->text))
+            return i;
+    return -1;
+}
+
+
+/**
+ * stringize - Returns the string literal token that the # operator
+ * makes of a macro argument.
+ */
+static PPToken stringize(TokenList *arg) {
+    int length = 3;
+    for (int i = 0; i < arg->count; ++i)
+        length += 2*strlen(arg->tokens[i].text);
+
+    char *str = malloc(length), *c = str;
+    *c++ = '"';
+    for (int i = 0; i < arg->count; ++i) {
+        for (char *t = arg->tokens[i].text; *t; ++t) {
+            if (arg->tokens[i].kind == PP_STRING && (*t == '"' || *t == '\\'))
+                *c++ = '\\';
+            *c++ = *t;
+        }
+    }
+    *c++ = '"';
+    *c = 0;
+
+    PPToken tok = {PP_STRING, str, NULL};
+    return tok;
+}
+
+
+/**
+ * pasteTokens - Returns the token that the ## operator makes of the
+ * tokens on either side of it.
+ */
+static PPToken pasteTokens(PPToken *left, PPToken *right) {
+    char *text = malloc(strlen(left->text) + strlen(right->text) + 1);
+    sprintf(text, "%s%s", left->text, right->text);
+
+    PPToken tok = {PP_PUNCT, text, NULL};
+    if (isalpha(*text) || *text == '_')
+        tok.kind = PP_IDENT;
+    else if (isdigit(*text) || *text == '.')
+        tok.kind = PP_NUMBER;
+    else if (*text == '"' || *text == '\'')
+        tok.kind = PP_STRING;
+    return tok;
+}
+
+
+/**
+ * appendPasted - Appends the tokens of right to a substitution, pasting
+ * the first of them onto the last token already in it.
+ */
+static void appendPasted(TokenList *result, TokenList *right) {
+    while (result->count && result->tokens[result->count-1].kind == PP_SPACE)
+        --result->count;
+
+    int i = nextToken(right, 0);
+    if (i == right->count)
+        return;
+    if (!result->count) {
+        for (; i < right->count; ++i)
+            appendToken(result, right->tokens[i]);
+        return;
+    }
+
+    result->tokens[result->count-1] = pasteTokens(&result->tokens[result->count-1], &right->tokens[i]);
+    for (++i; i < right->count; ++i)
+        appendToken(result, right->tokens[i]);
+}
+
+
+/**
+ * substitute - Returns the replacement of an invocation of a macro, its
+ * body with its parameters replaced by their arguments (args), and each
+ * token's hide set joined with hide_set.
+ */
+static TokenList substitute(Macro *macro, TokenList *args, HideSet *hide_set) {
+    TokenList result = {NULL, 0, 0};
+    TokenList *body = &macro->body;
+
+    for (int i = 0; i < body->count; ++i) {
+        PPToken *tok = &body->tokens[i];
+        int next = nextToken(body, i+1);
+        int param;
+
+        /* # param turns the argument into a string */
+        if (macro->is_function && isPunct(tok, "#") && next < body->count &&
+                (param = paramIndex(macro, &body->tokens[next])) >= 0) {
+            appendToken(&result, stringize(&args[param]));
+            i = next;
+            continue;
+        }
+
+        /* ## pastes together the tokens on either side of it */
+        if (isPunct(tok, "##") && next < body->count) {
+            TokenList right = {&body->tokens[next], 1, 1};
+            if ((param = paramIndex(macro, &body->tokens[next])) >= 0)
+                right = args[param];
+            appendPasted(&result, &right);
+            i = next;
+            continue;
+        }
+
+        if ((param = paramIndex(macro, tok)) >= 0) {
+            /* an argument is macro expanded first, unless it is pasted */
+            if (next < body->count && isPunct(&body->tokens[next], "##"))
+                for (int j = 0; j < args[param].count; ++j)
+                    appendToken(&result, args[param].tokens[j]);
+            else
+                expandTokens(&args[param], &result, false);
+            continue;
+        }
+        appendToken(&result, *tok);
+    }
+
+    for (int i = 0; i < result.count; ++i)
+        result.tokens[i].hide_set = joinHideSets(result.tokens[i].hide_set, hide_set);
+    return result;
+}
+
+
+/**
+ * collectArgs - Collects the arguments of an invocation of a function-like
+ * macro off of the pending tokens (kept in reverse order), whose ( is at
+ * index open. Returns the index of the invocation's ) or -1 if it runs past
+ * the end of the tokens, and the arguments in args.
+ */
+static int collectArgs(Macro *macro, TokenList *pending, int open, TokenList **args, int *arg_count) {
+    int depth = 0;
+
+    *args = calloc(macro->param_count + 1, sizeof(TokenList));
+    *arg_count = 1;
+
+    for (int i = open - 1; i >= 0; --i) {
+        PPToken *tok = &pending->tokens[i];
+        TokenList *arg = &(*args)[*arg_count - 1];
+
+        if (isPunct(tok, "("))
+            ++depth;
+        else if ((isPunct(tok, ")") && !depth) ||
+                 (isPunct(tok, ",") && !depth && (!macro->is_variadic || *arg_count < macro->param_count))) {
+            /* trim the white space around the argument */
+            while (arg->count && arg->tokens[arg->count-1].kind == PP_SPACE)
+                --arg->count;
+            int lead = nextToken(arg, 0);
+            arg->tokens += lead;
+            arg->count -= lead;
+
+            if (isPunct(tok, ")"))
+                return i;
+            if (*arg_count == macro->param_count + 1) {
+                ppError("too many arguments to macro ", macro->name);
+                return i;
+            }
+            ++*arg_count;
+            continue;
+        }
+        else if (isPunct(tok, ")"))
+            --depth;
+        appendToken(arg, *tok);
+    }
+    return -1;
+}
+
+
+/**
+ * expandBuiltin - Replaces a __LINE__ or __FILE__ token with the line or
+ * file being preprocessed. Returns whether the token was one of them.
+ */
+static _Bool expandBuiltin(PPToken *tok) {
+    char buffer[32];
+
+    if (!strcmp(tok->text, "__LINE__")) {
+        sprintf(buffer, "%d", cur_pp_line);
+        *tok = newToken(PP_NUMBER, buffer, strlen(buffer));
+        return true;
+    }
+    if (!strcmp(tok->text, "__FILE__")) {
+        char *text = malloc(strlen(cur_pp_file) + 3);
+        sprintf(text, "\"%s\"", cur_pp_file);
+        tok->kind = PP_STRING;
+        tok->text = text;
+        return true;
+    }
+    return false;
+}
+
+
+/**
+ * expandTokens - Appends the macro expansion of the tokens in to out. An
+ * invocation of a function-like macro may have its arguments on the lines
+ * that follow: if whole_line is set, and one runs past the end of the
+ * tokens, false is returned for the caller to try again with the next
+ * line joined on. Otherwise the invocation is left unexpanded.
+ */
+static _Bool expandTokens(TokenList *in, TokenList *out, _Bool whole_line) {
+    /* the tokens left to expand, last first */
+    TokenList pending = {NULL, 0, 0};
+    for (int i = in->count - 1; i >= 0; --i)
+        appendToken(&pending, in->tokens[i]);
+
+    while (pending.count) {
+        PPToken tok = pending.tokens[--pending.count];
+        Macro *macro = tok.kind == PP_IDENT ? lookupMacro(tok.text) : NULL;
+
+        if (!macro || inHideSet(tok.hide_set, macro)) {
+            if (tok.kind == PP_IDENT)
+                expandBuiltin(&tok);
+            appendToken(out, tok);
+            continue;
+        }
+
+        if (!macro->is_function) {
+            TokenList result = substitute(macro, NULL, joinHideSets(&(HideSet) {macro, NULL},
+                                            tok.hide_set));
+            for (int i = result.count - 1; i >= 0; --i)
+                appendToken(&pending, result.tokens[i]);
+            continue;
+        }
+
+        /* a function-like macro's name is only an invocation when a ( follows it */
+        int open = pending.count - 1;
+        while (open >= 0 && pending.tokens[open].kind == PP_SPACE)
+            --open;
+        if (open < 0 && whole_line)
+            return false;
+        if (open < 0 || !isPunct(&pending.tokens[open], "(")) {
+            appendToken(out, tok);
+            continue;
+        }
+
+        TokenList *args;
+        int arg_count;
+        int close = collectArgs(macro, &pending, open, &args, &arg_count);
+
+        if (close < 0 && whole_line)
+            return false;
+        if (close < 0) {
+            appendToken(out, tok);
+            continue;
+        }
+
+        /* a macro of no parameters takes a single empty argument, and a
+        variadic one may be left without its variable arguments */
+        if (arg_count == 1 && !macro->param_count && !args[0].count)
+            arg_count = 0;
+        if (macro->is_variadic && arg_count == macro->param_count - 1)
+            ++arg_count;
+        if (arg_count != macro->param_count) {
+            ppError("wrong number of arguments to macro ", macro->name);
+            appendToken(out, tok);
+            continue;
+        }
+
+        pending.count = close;
+        TokenList result = substitute(macro, args, joinHideSets(&(HideSet) {macro, NULL},
+                                        tok.hide_set));
+        for (int i = result.count - 1; i >= 0; --i)
+            appendToken(&pending, result.tokens[i]);
+    }
+    return true;
+}
+
+
+/**
+ * evaluateTernary - Evaluates the expression of an #if directive, at index
+ * *pos of its tokens (which no longer have white space or macros in them).
+ */
+static long long evaluateTernary(TokenList *expr, int *pos);
+
+
+/**
+ * evaluateUnary - Evaluates a unary expression of an #if directive.
+ */
+static long long evaluateUnary(TokenList *expr, int *pos) {
+    if (*pos == expr->count) {
+        ppError("#if with no expression", NULL);
+        return 0;
+    }
+
+    PPToken *tok = &expr->tokens[(*pos)++];
+
+    if (isPunct(tok, "-"))
+        return -evaluateUnary(expr, pos);
+    if (isPunct(tok, "+"))
+        return evaluateUnary(expr, pos);
+    if (isPunct(tok, "!"))
+        return !evaluateUnary(expr, pos);
+    if (isPunct(tok, "~"))
+        return ~evaluateUnary(expr, pos);
+
+    if (isPunct(tok, "(")) {
+        long long val = evaluateTernary(expr, pos);
+        if (*pos < expr->count && isPunct(&expr->tokens[*pos], ")"))
+            ++*pos;
+        else
+            ppError("missing ')' in #if expression", NULL);
+        return val;
+    }
+
+    if (tok->kind == PP_NUMBER)
+        return strtoull(tok->text, NULL, 0);
+
+    if (tok->kind == PP_STRING && *tok->text == '\'') {
+        char *c = tok->text + 1;
+        if (*c != '\\')
+            return *c;
+        switch (c[1]) {
+            case 'n':  return '\n';
+            case 't':  return '\t';
+            case 'r':  return '\r';
+            case '0':  return strtol(c+1, NULL, 8);
+            case 'x':  return strtol(c+2, NULL, 16);
+            default:   return c[1];
+        }
+    }
+
+    /* an identifier that is left after expanding the macros is 0 */
+    if (tok->kind == PP_IDENT)
+        return 0;
+
+    ppError("invalid token in #if expression: ", tok->text);
+    return 0;
+}
+
+
+/**
+ * binaryPrecedence - Returns the precedence of a binary operator of an
+ * #if expression, or 0 if the token isn't one.
+ */
+static int binaryPrecedence(PPToken *tok) {
+    static char *operators[][4] = {{"||"}, {"&&"}, {"|"}, {"^"}, {"&"}, {"==", "!="},
+                                   {"<", ">", "<=", ">="}, {"<<", ">>"}, {"+", "-"}, {"*", "/", "%"}};
+
+    if (tok->kind != PP_PUNCT)
+        return 0;
+    for (int prec = 0; prec < (int) (sizeof(operators)/sizeof(operators[0])); ++prec)
+        for (int i = 0; i < 4 && operators[prec][i]; ++i)
+            if (!strcmp(tok->text, operators[prec][i]))
+                return prec + 1;
+    return 0;
+}
+
+
+/**
+ * evaluateBinary - Evaluates the binary operators of an #if expression
+ * that are of at least the precedence min_prec.
+ */
+static long long evaluateBinary(TokenList *expr, int *pos, int min_prec) {
+    long long left = evaluateUnary(expr, pos);
+    int prec;
+
+    while (*pos < expr->count && (prec = binaryPrecedence(&expr->tokens[*pos])) >= min_prec) {
+        char *op = expr->tokens[(*pos)++].text;
+        long long right = evaluateBinary(expr, pos, prec + 1);
+
+        if ((!strcmp(op, "/") || !strcmp(op, "%")) && !right) {
+            ppError("division by zero in #if", NULL);
+            return 0;
+        }
+
+        if      (!strcmp(op, "||")) left = left || right;
+        else if (!strcmp(op, "&&")) left = left && right;
+        else if (!strcmp(op, "|"))  left = left | right;
+        else if (!strcmp(op, "^"))  left = left ^ right;
+        else if (!strcmp(op, "&"))  left = left & right;
+        else if (!strcmp(op, "==")) left = left == right;
+        else if (!strcmp(op, "!=")) left = left != right;
+        else if (!strcmp(op, "<"))  left = left < right;
+        else if (!strcmp(op, ">"))  left = left > right;
+        else if (!strcmp(op, "<=")) left = left <= right;
+        else if (!strcmp(op, ">=")) left = left >= right;
+        else if (!strcmp(op, "<<")) left = left << right;
+        else if (!strcmp(op, ">>")) left = left >> right;
+        else if (!strcmp(op, "+"))  left = left + right;
+        else if (!strcmp(op, "-"))  left = left - right;
+        else if (!strcmp(op, "*"))  left = left * right;
+        else if (!strcmp(op, "/"))  left = left / right;
+        else                        left = left % right;
+    }
+    return left;
+}
+
+
+static long long evaluateTernary(TokenList *expr, int *pos) {
+    long long cond = evaluateBinary(expr, pos, 1);
+
+    if (*pos == expr->count || !isPunct(&expr->tokens[*pos], "?"))
+        return cond;
+
+    ++*pos;
+    long long if_true = evaluateTernary(expr, pos);
+    if (*pos == expr->count || !isPunct(&expr->tokens[*pos], ":")) {
+        ppError("missing ':' in #if expression", NULL);
+        return 0;
+    }
+    ++*pos;
+    long long if_false = evaluateTernary(expr, pos);
+    return cond ? if_true : if_false;
+}
+
+
+/**
+ * evaluateCondition - Evaluates the expression of an #if or #elif
+ * directive, starting at index i of its line.
+ */
+static long long evaluateCondition(TokenList *line, int i) {
+    TokenList replaced = {NULL, 0, 0}, expanded = {NULL, 0, 0}, expr = {NULL, 0, 0};
+
+    /* defined NAME and defined(NAME) are replaced before expanding the macros */
+    for (; i < line->count; ++i) {
+        if (line->tokens[i].kind != PP_IDENT || strcmp(line->tokens[i].text, "defined")) {
+            appendToken(&replaced, line->tokens[i]);
+            continue;
+        }
+
+        int name = nextToken(line, i+1);
+        _Bool paren = name < line->count && isPunct(&line->tokens[name], "(");
+        if (paren)
+            name = nextToken(line, name+1);
+        if (name == line->count || line->tokens[name].kind != PP_IDENT) {
+            ppError("operator 'defined' requires an identifier", NULL);
+            return 0;
+        }
+
+        i = name;
+        if (paren) {
+            i = nextToken(line, name+1);
+            if (i == line->count || !isPunct(&line->tokens[i], ")")) {
+                ppError("missing ')' after 'defined'", NULL);
+                return 0;
+            }
+        }
+        char *val = lookupMacro(line->tokens[name].text) ? "1" : "0";
+        appendToken(&replaced, newToken(PP_NUMBER, val, 1));
+    }
+
+    expandTokens(&replaced, &expanded, false);
+    for (int j = 0; j < expanded.count; ++j)
+        if (expanded.tokens[j].kind != PP_SPACE)
+            appendToken(&expr, expanded.tokens[j]);
+
+    int pos = 0;
+    long long val = evaluateTernary(&expr, &pos);
+    if (pos < expr.count)
+        ppError("missing binary operator before token ", expr.tokens[pos].text);
+    return val;
+}
+
+
+/**
+ * guardOf - Returns the macro that a directive opening a conditional tests
+ * to be undefined, for '#ifndef NAME', '#if !defined NAME' and
+ * '#if !defined(NAME)', or NULL if it doesn't.
+ */
+static char *guardOf(TokenList *line, int i, char *directive) {
+    int name = nextToken(line, i);
+
+    if (!strcmp(directive, "if")) {
+        if (name == line->count || !isPunct(&line->tokens[name], "!"))
+            return NULL;
+        i = nextToken(line, name+1);
+        if (i == line->count || strcmp(line->tokens[i].text, "defined"))
+            return NULL;
+        name = nextToken(line, i+1);
+        if (name < line->count && isPunct(&line->tokens[name], "("))
+            name = nextToken(line, name+1);
+    }
+    else if (strcmp(directive, "ifndef"))
+        return NULL;
+
+    if (name == line->count || line->tokens[name].kind != PP_IDENT)
+        return NULL;
+    return line->tokens[name].text;
+}
+
+
+/**
+ * fileExists - Returns the full path of dir/name if it is a file that can
+ * be read, or NULL if it isn't.
+ */
+static char *fileExists(char *dir, char *name) {
+    char *path = malloc(strlen(dir) + strlen(name) + 2);
+    sprintf(path, "%s/%s", dir, name);
+
+    char *full_path = access(path, R_OK) ? NULL : realpath(path, NULL);
+    free(path);
+    return full_path;
+}
+
+
+/**
+ * findInclude - Returns the full path of the file that an include of name
+ * refers to, looking in the directory of the including file first if the
+ * name was quoted. Returns NULL if there is no such file.
+ */
+static char *findInclude(char *name, _Bool quoted, char *including_path) {
+    char *found = NULL;
+
+    if (*name == '/')
+        return access(name, R_OK) ? NULL : realpath(name, NULL);
+
+    if (quoted) {
+        char *dir = strdup(including_path);
+        char *slash = strrchr(dir, '/');
+        if (slash)
+            *slash = 0;
+        found = fileExists(slash ? dir : ".", name);
+        free(dir);
+    }
+
+    for (int i = 0; !found && i < include_path_count; ++i)
+        found = fileExists(include_paths[i], name);
+    for (size_t i = 0; !found && i < sizeof(system_include_paths)/sizeof(char *); ++i)
+        found = fileExists(system_include_paths[i], name);
+    return found;
+}
+
+
+/**
+ * syncLine - Brings the line of the output up to line_num of the file at
+ * path, with newlines or with a line marker.
+ */
+static void syncLine(FILE *out, int *out_line, int line_num, char *path) {
+    if (line_num < *out_line || line_num - *out_line > MAX_LINE_GAP)
+        fprintf(out, "# %d \"%s\"\n", line_num, path);
+    else
+        for (; *out_line < line_num; ++*out_line)
+            fputc('\n', out);
+    *out_line = line_num;
+}
+
+
+/**
+ * needsSpace - Returns whether two tokens would be lexed as one if they
+ * were written next to each other.
+ */
+static _Bool needsSpace(PPToken *prev, PPToken *tok) {
+    if (prev->kind != PP_PUNCT && tok->kind != PP_PUNCT)
+        return true;
+    if (prev->kind != PP_PUNCT || tok->kind != PP_PUNCT)
+        return prev->kind == PP_NUMBER && *tok->text == '.';
+
+    char pair[3] = {prev->text[strlen(prev->text)-1], tok->text[0], 0};
+    for (size_t i = 0; i < sizeof(multi_char_puncts)/sizeof(char *); ++i)
+        if (!strncmp(multi_char_puncts[i], pair, 2))
+            return true;
+    return !strcmp(pair, "/*") || !strcmp(pair, "//");
+}
+
+
+/**
+ * writeTokens - Writes a line of expanded tokens to the output, with a
+ * space between two tokens that would otherwise be lexed as one.
+ */
+static void writeTokens(TokenList *tokens, FILE *out) {
+    PPToken *prev = NULL;
+
+    for (int i = 0; i < tokens->count; ++i) {
+        PPToken *tok = &tokens->tokens[i];
+
+        if (tok->kind == PP_SPACE) {
+            if (prev)
+                fputc(' ', out);
+            prev = NULL;
+            continue;
+        }
+        if (prev && needsSpace(prev, tok))
+            fputc(' ', out);
+        fputs(tok->text, out);
+        prev = tok;
+    }
+    fputc('\n', out);
+}
+
+
+static void processFile(SourceFile *file, FILE *out);
+
+
+/**
+ * includeFile - Processes the file named by an #include directive, whose
+ * name is at index i of its line in the file from, which is the first line
+ * of the main file if first_line is set. Returns whether any of it was
+ * written to the output.
+ */
+static _Bool includeFile(TokenList *line, int i, SourceFile *from, _Bool first_line, FILE *out) {
+    TokenList expanded = {NULL, 0, 0};
+    char *name = NULL;
+    _Bool quoted = false;
+
+    i = nextToken(line, i);
+
+    /* an include of anything other than "name" or <name> is macro expanded first */
+    if (i < line->count && line->tokens[i].kind != PP_STRING && !isPunct(&line->tokens[i], "<")) {
+        TokenList rest = {line->tokens + i, line->count - i, line->count - i};
+        expandTokens(&rest, &expanded, false);
+        line = &expanded;
+        i = nextToken(line, 0);
+    }
+
+    if (i < line->count && line->tokens[i].kind == PP_STRING && *line->tokens[i].text == '"') {
+        name = strdup(line->tokens[i].text + 1);
+        name[strlen(name) - 1] = 0;
+        quoted = true;
+    }
+    else if (i < line->count && isPunct(&line->tokens[i], "<")) {
+        name = calloc(1, LINESIZE);
+        for (++i; i < line->count && !isPunct(&line->tokens[i], ">"); ++i)
+            if (strlen(name) + strlen(line->tokens[i].text) < LINESIZE)
+                strcat(name, line->tokens[i].text);
+        if (i == line->count)
+            name = NULL;
+    }
+    if (!name) {
+        ppError("#include expects \"FILENAME\" or <FILENAME>", NULL);
+        return false;
+    }
+
+    char *path = findInclude(name, quoted, from->path);
+    if (!path) {
+        ppError("no such file to include: ", name);
+        return false;
+    }
+
+    /* a header that was already included is skipped without going over its
+    lines, if it has a #pragma once or its include guard is still defined */
+    SourceFile *file = *fileSlot(path);
+    if (file && ((file->once && file->included) || (file->guard && lookupMacro(file->guard))))
+        return false;
+
+    /* the first include of the main file may be of a precompiled header */
+    char *pch_path = malloc(strlen(path) + 5);
+    sprintf(pch_path, "%s.pch", path);
+    _Bool precompiled = first_line && !access(pch_path, R_OK) && loadPrecompiledHeader(pch_path);
+    free(pch_path);
+    if (precompiled)
+        return false;
+
+    if (!(file = loadSourceFile(path))) {
+        ppError("no such file to include: ", name);
+        return false;
+    }
+
+    if (include_depth == MAX_INCLUDE_DEPTH) {
+        ppError("#include nested too deeply: ", name);
+        return false;
+    }
+
+    ++include_depth;
+    file->included = true;
+    processFile(file, out);
+    --include_depth;
+    return true;
+}
+
+
+/**
+ * processFile - Writes the preprocessed lines of a source file to out.
+ */
+static void processFile(SourceFile *file, FILE *out) {
+    Conditional *conds = malloc(sizeof(Conditional)*(file->line_count + 1));
+    int cond_count = 0, out_line = 1;
+    _Bool active = true;
+
+    /* the file has an include guard if the first thing in it opens a conditional
+    on a macro being undefined, and that conditional closes at the very end */
+    char *guard = NULL;
+    _Bool guard_possible = true, guard_closed = false;
+
+    fprintf(out, "# 1 \"%s\"\n", file->path);
+
+    for (int i = 0; i < file->line_count; ++i) {
+        TokenList *line = &file->lines[i].tokens;
+        cur_pp_file = file->path;
+        cur_pp_line = file->lines[i].line_num;
+
+        if (guard_closed)
+            guard_possible = false;
+
+        int hash = nextToken(line, 0);
+        if (!isPunct(&line->tokens[hash], "#")) {
+            if (!cond_count)
+                guard_possible = false;
+            if (!active)
+                continue;
+
+            /* the arguments of a macro invocation may go on over the next lines */
+            TokenList joined = *line, expanded = {NULL, 0, 0};
+            int last = i;
+
+            while (!expandTokens(&joined, &expanded, true)) {
+                expanded.count = 0;
+                if (last + 1 == file->line_count ||
+                        isPunct(&file->lines[last+1].tokens.tokens[nextToken(&file->lines[last+1].tokens, 0)], "#")) {
+                    expandTokens(&joined, &expanded, false);
+                    break;
+                }
+
+                if (joined.tokens == line->tokens) {
+                    joined = (TokenList) {NULL, 0, 0};
+                    for (int j = 0; j < line->count; ++j)
+                        appendToken(&joined, line->tokens[j]);
+                }
+                ++last;
+                appendToken(&joined, newToken(PP_SPACE, " ", 1));
+                for (int j = 0; j < file->lines[last].tokens.count; ++j)
+                    appendToken(&joined, file->lines[last].tokens.tokens[j]);
+            }
+
+            syncLine(out, &out_line, cur_pp_line, file->path);
+            writeTokens(&expanded, out);
+            ++out_line;
+            i = last;
+            continue;
+        }
+
+        int d = nextToken(line, hash+1);
+        if (d == line->count)
+            continue;
+        char *directive = line->tokens[d].text;
+
+        /* the conditionals are followed even where lines are skipped */
+        if (!strcmp(directive, "if") || !strcmp(directive, "ifdef") || !strcmp(directive, "ifndef")) {
+            if (!cond_count && guard_possible)
+                guard_possible = (guard = guardOf(line, d+1, directive)) != NULL;
+
+            _Bool val = false;
+            if (active && !strcmp(directive, "if"))
+                val = evaluateCondition(line, d+1) != 0;
+            else if (active) {
+                int name = nextToken(line, d+1);
+                if (name == line->count || line->tokens[name].kind != PP_IDENT)
+                    ppError("macro names must be identifiers", NULL);
+                else
+                    val = (lookupMacro(line->tokens[name].text) != NULL) == !strcmp(directive, "ifdef");
+            }
+
+            conds[cond_count++] = (Conditional) {active, val, false};
+            active = active && val;
+            continue;
+        }
+        if (!strcmp(directive, "elif") || !strcmp(directive, "else") || !strcmp(directive, "endif")) {
+            if (!cond_count) {
+                ppError("unmatched #", directive);
+                continue;
+            }
+
+            Conditional *cond = &conds[cond_count-1];
+            if (cond_count == 1 && guard && strcmp(directive, "endif"))
+                guard_possible = false;
+
+            if (!strcmp(directive, "endif")) {
+                active = cond->was_active;
+                if (!--cond_count && guard)
+                    guard_closed = true;
+            }
+            else if (cond->seen_else)
+                ppError("#else after #else, or #elif after #else", NULL);
+            else if (!strcmp(directive, "else")) {
+                active = cond->was_active && !cond->taken;
+                cond->taken = cond->seen_else = true;
+            }
+            else {
+                active = cond->was_active && !cond->taken && evaluateCondition(line, d+1);
+                cond->taken |= active;
+            }
+            continue;
+        }
+
+        if (!active)
+            continue;
+        if (!cond_count)
+            guard_possible = false;
+
+        if (!strcmp(directive, "define"))
+            parseDefine(line, d+1);
+        else if (!strcmp(directive, "undef"))
+            undefineMacro(line, d+1);
+        else if (!strcmp(directive, "include")) {
+            if (includeFile(line, d+1, file, !include_depth && !i, out)) {
+                out_line = file->lines[i].line_num + 1;
+                fprintf(out, "# %d \"%s\"\n", out_line, file->path);
+            }
+        }
+        else if (!strcmp(directive, "pragma")) {
+            int name = nextToken(line, d+1);
+            if (name < line->count && !strcmp(line->tokens[name].text, "once"))
+                file->once = true;
+        }
+        else if (!strcmp(directive, "error")) {
+            TokenList message = {line->tokens + d + 1, line->count - d - 1, 0};
+            fprintf(stderr, "%s:%d Error: #error ", cur_pp_file, cur_pp_line);
+            writeTokens(&message, stderr);
+            ++pp_error_count;
+        }
+        else if (!strcmp(directive, "warning")) {
+            TokenList message = {line->tokens + d + 1, line->count - d - 1, 0};
+            fprintf(stderr, "%s:%d Warning: #warning ", cur_pp_file, cur_pp_line);
+            writeTokens(&message, stderr);
+        }
+        else if (strcmp(directive, "line") && strcmp(directive, "ident"))
+            ppError("invalid preprocessing directive #", directive);
+    }
+
+    if (cond_count)
+        ppError("unterminated conditional directive", NULL);
+    if (guard && guard_possible && guard_closed)
+        file->guard = guard;
+    free(conds);
+}
+
+
+void addIncludePath(char *dir) {
+    include_paths = realloc(include_paths, sizeof(char *)*(include_path_count + 1));
+    include_paths[include_path_count++] = dir;
+}
+
+
+/**
+ * defineMacroText - Defines a macro from a definition as -D gives it.
+ */
+static void defineMacroText(char *definition) {
+    char *src = malloc(strlen(definition) + 3);
+    char *eq = strchr(definition, '=');
+    PPLine *lines;
+    int line_count;
+
+    if (eq)
+        sprintf(src, "%.*s %s", (int) (eq - definition), definition, eq + 1);
+    else
+        sprintf(src, "%s 1", definition);
+
+    tokenizeSource(src, &lines, &line_count);
+    if (line_count)
+        parseDefine(&lines[0].tokens, 0);
+    free(src);
+}
+
+
+/**
+ * definePredefinedMacros - Defines the macros that are defined before
+ * any source is read, the target's __x86_64__ or __i386__ among them, as
+ * gcc defines them.
+ */
+static void definePredefinedMacros() {
+    if (predefined)
+        return;
+    predefined = true;
+    defineMacroText("__STDC__");
+    defineMacroText("__STDC_VERSION__=199901L");
+    defineMacroText("__GUYCC__");
+    defineMacroText(TARGET_IS_64 ? "__x86_64__" : "__i386__");
+}
+
+
+void defineMacro(char *definition) {
+    int len = command_line_macros ? strlen(command_line_macros) : 0;
+
+    /* remembered for precompiled headers, which are only used with the same ones */
+    command_line_macros = realloc(command_line_macros, len + strlen(definition) + 2);
+    sprintf(command_line_macros + len, "%s\n", definition);
+
+    definePredefinedMacros();
+    defineMacroText(definition);
+}
+
+
+char *preprocessFile(char *file_name, size_t *size) {
+    char *path = realpath(file_name, NULL);
+    SourceFile *file = path ? loadSourceFile(path) : NULL;
+    char *buffer;
+
+    if (!file) {
+        fprintf(stderr, "%s: Error: cannot read the source file\n", file_name);
+        return NULL;
+    }
+
+    definePredefinedMacros();
+
+    FILE *out = open_memstream(&buffer, size);
+    file->included = true;
+    processFile(file, out);
+
+    /* the two characters that end a buffer that flex scans in place */
+    fputc(0, out);
+    fputc(0, out);
+    fclose(out);
+
+    if (pp_error_count)
+        return NULL;
+    return buffer;
+}
+
+/**
+ * fileStamp - Returns when a file was last modified, in nanoseconds.
+ */
+static long long fileStamp(struct stat *st) {
+    return st->st_mtim.tv_sec*1000000000LL + st->st_mtim.tv_nsec;
+}
+
+
+void writePreprocessorState(FILE *out) {
+    struct stat st;
+
+    fprintf(out, "defines %zu\n%s", command_line_macros ? strlen(command_line_macros) : 0,
+                    command_line_macros ? command_line_macros : "");
+
+    for (int i = 0; i < PP_TABLE_SIZE; ++i)
+        for (SourceFile *file = file_table[i]; file; file = file->next)
+            if (!stat(file->path, &st))
+                fprintf(out, "file %d %lld %lld %s %s\n", file->once, fileStamp(&st), (long long) st.st_size,
+                                    file->guard ? file->guard : "-", file->path);
+
+    for (int i = 0; i < PP_TABLE_SIZE; ++i)
+        for (Macro *macro = macro_table[i]; macro; macro = macro->next) {
+            fprintf(out, "#define %s", macro->name);
+            if (macro->is_function) {
+                fputc('(', out);
+                for (int p = 0; p < macro->param_count; ++p)
+                    fprintf(out, "%s%s", p ? ", " : "",
+                            macro->is_variadic && p == macro->param_count - 1 ? "..." : macro->params[p]);
+                fputc(')', out);
+            }
+            fputc(' ', out);
+            writeTokens(&macro->body, out);
+        }
+}
+
+
+_Bool restorePreprocessorState(char *state) {
+    char *cur_macros = command_line_macros ? command_line_macros : "";
+    size_t macros_size;
+    int macros_start;
+
+    /* the header may have been read differently with other -D macros */
+    if (sscanf(state, "defines %zu\n%n", &macros_size, &macros_start) != 1 ||
+            macros_size != strlen(cur_macros) || strncmp(state + macros_start, cur_macros, macros_size))
+        return false;
+    state += macros_start + macros_size;
+
+    char *copy = strdup(state), *guard = malloc(strlen(state) + 1);
+    int once, path_start;
+    long long stamp, size;
+    struct stat st;
+
+    /* the state is stale if any of the files it was read from has changed */
+    for (char *line = strtok(copy, "\n"); line; line = strtok(NULL, "\n"))
+        if (sscanf(line, "file %d %lld %lld %s %n", &once, &stamp, &size, guard, &path_start) == 4 &&
+                (stat(line + path_start, &st) || fileStamp(&st) != stamp || st.st_size != size)) {
+            free(copy);
+            free(guard);
+            return false;
+        }
+
+    /* the files that are skipped when included again are known to be, without
+    reading them, and the macros are defined again from their #define lines */
+    char *defines = malloc(strlen(state) + 1), *end = defines;
+    strcpy(copy, state);
+    for (char *line = strtok(copy, "\n"); line; line = strtok(NULL, "\n")) {
+        if (*line == '#')
+            end += sprintf(end, "%s\n", line);
+        else if (sscanf(line, "file %d %lld %lld %s %n", &once, &stamp, &size, guard, &path_start) == 4 &&
+                    (once || strcmp(guard, "-"))) {
+            SourceFile **slot = fileSlot(line + path_start);
+            if (!*slot) {
+                *slot = calloc(1, sizeof(SourceFile));
+                (*slot)->path = strdup(line + path_start);
+            }
+            (*slot)->once = once;
+            (*slot)->included = true;
+            if (strcmp(guard, "-"))
+                (*slot)->guard = strdup(guard);
+        }
+    }
+    *end = 0;
+    free(guard);
+
+    PPLine *lines;
+    int line_count;
+
+    tokenizeSource(defines, &lines, &line_count);
+    for (int i = 0; i < line_count; ++i) {
+        TokenList *line = &lines[i].tokens;
+        parseDefine(line, nextToken(line, nextToken(line, 0) + 1) + 1);
+    }
+    free(defines);
+    free(copy);
+    return true;
+}
@@ -0,0 +1,68 @@
+/*
+ * ECE:466 Compilers
+ * By: Guy Bar Yosef
+ *
+ * preprocessor.h - Declares the functions of the integrated
+ * preprocessor, which expands the includes, macros and
+ * conditionals of a source file into the stream that the
+ * lexer reads, in place of piping in the output of a
+ * separate 'gcc -E'.
+ */
+
+#ifndef PREPROCESSOR
+#define PREPROCESSOR
+
+#include <stdio.h>
+
+
+/**
+ * addIncludePath - Adds a directory (the -I flag) to the ones searched
+ * for included files, after the directory of the including file for a
+ * quoted name, and before the system ones.
+ */
+void addIncludePath(char *dir);
+
+
+/**
+ * defineMacro - Defines a macro from the command line, as the -D flag
+ * does: 'NAME' defines it as 1, and 'NAME=value' as value. The target has
+ * to be picked before, as the macros predefined ahead of it depend on it.
+ */
+void defineMacro(char *definition);
+
+
+/**
+ * preprocessFile - Preprocesses the source file file_name, returning its
+ * expanded text, with the line markers that the lexer tracks file names
+ * and line numbers by, and *size its length. The text ends in the two NUL
+ * characters that flex's yy_scan_buffer expects (counted in *size), so
+ * that the lexer scans it in place. Returns NULL if the file could not be
+ * read or had preprocessing errors.
+ *
+ * Every file read is kept tokenized for the rest of the run, along with
+ * the macro guarding it (or whether it is '#pragma once'), so that an
+ * included header is only read once, and one whose guard is already
+ * defined is skipped without looking at it again.
+ */
+char *preprocessFile(char *file_name, size_t *size);
+
+
+/**
+ * writePreprocessorState - Writes what a precompiled header keeps of the
+ * preprocessor, as text: the -D macros it was run with, the files read so
+ * far, with when they were last
+ * modified and what skips them when included again, and a #define line
+ * for each macro.
+ */
+void writePreprocessorState(FILE *out);
+
+
+/**
+ * restorePreprocessorState - Restores a state written by
+ * writePreprocessorState, unless it was run with other -D macros, or one
+ * of its files has changed since. Returns whether it did.
+ */
+_Bool restorePreprocessorState(char *state);
+
+
+#endif
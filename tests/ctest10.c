@@ -0,0 +1,79 @@
+
+
+/**
+ * A series of tests, specifically targeting functions without
+ * a frame pointer: leaf functions without any locals, locals
+ * used around calls, deep expressions that take %ebp as a
+ * scratch register, and recursion through all of them.
+ */
+
+int g, calls;
+
+int leaf() {
+    return g * 3;
+}
+
+int twice() {
+    int first, second;
+
+    first = leaf();
+    second = leaf();
+    return first + second;
+}
+
+int countdown() {
+    int mine, below;
+
+    mine = g;
+    calls = calls + 1;
+    if (g > 0) {
+        g = g + -1;
+        below = countdown();
+        mine = mine + below;
+    }
+    return mine;
+}
+
+int main() {
+    int a, b, c, d, e, f, h;
+
+    // a function without locals or a frame
+    g = 5;
+    if (leaf() == 15)
+        printf("T10: test 1 passed\n");
+    else
+        printf("T10: test 1 failed\n");
+
+    // locals used around and in between calls
+    a = 1;
+    b = 2;
+    c = 3;
+    d = 4;
+    e = twice();
+    f = leaf();
+    f = f + a + b;
+    if (e == 30 && f == 18 && c * d == 12)
+        printf("T10: test 2 passed\n");
+    else
+        printf("T10: test 2 failed\n");
+
+    // enough values live at once to need every register, %ebp included
+    // (too many for the registers left next to a frame pointer)
+    e = 5;
+    f = 6;
+    h = 7;
+    if ((a * b + (c * d + (e * f + h * a))) == 51)
+        printf("T10: test 3 passed\n");
+    else
+        printf("T10: test 3 failed\n");
+
+    // the locals of each frame of a recursion stay apart
+    g = 4;
+    calls = 0;
+    if (countdown() == 10 && calls == 5 && a == 1 && h == 7)
+        printf("T10: test 4 passed\n");
+    else
+        printf("T10: test 4 failed\n");
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+
+
+/**
+ * A series of tests, specifically targeting the registers
+ * that live across calls: values in the caller-saved registers
+ * that a call clobbers, and values in the callee-saved ones that
+ * the called function has to hand back untouched.
+ */
+
+int g;
+
+int three() {
+    return 3;
+}
+
+// a function needing enough registers to take the callee-saved ones
+int busy() {
+    int a, b, c, d;
+
+    a = g;
+    b = g + 1;
+    c = g + 2;
+    d = g + 3;
+    return a * b + (c * d + a * c);
+}
+
+#ifdef __x86_64__
+// one needing more registers than x86-64 has caller-saved ones (x86-32
+// doesn't have that many registers at all)
+int wide() {
+    int a, b, c, d, e, f, h, i, j, k, m;
+
+    a = g; b = g + 1; c = g + 2; d = g + 3; e = g + 4; f = g + 5;
+    h = g + 6; i = g + 7; j = g + 8; k = g + 9; m = g + 10;
+    return a + (b + (c + (d + (e + (f + (h + (i + (j + (k + m)))))))));
+}
+
+// and one holding that many values across a call to it
+int deep() {
+    int a, b, c, d, e, f, h, i, j, k;
+
+    a = g; b = g + 1; c = g + 2; d = g + 3; e = g + 4;
+    f = g + 5; h = g + 6; i = g + 7; j = g + 8; k = g + 9;
+    return a + (b + (c + (d + (e + (f + (h + (i + (j + (k + wide())))))))));
+}
+#endif
+
+int nested() {
+    return three() * three() + three();
+}
+
+int main() {
+    int x, y;
+
+    x = 4;
+    y = 5;
+
+    // a value computed before a call, added to its result
+    if (x + three() == 7 && x * y + three() == 23)
+        printf("T11: test 1 passed\n");
+    else
+        printf("T11: test 1 failed\n");
+
+    // the results of two calls in one expression
+    if (three() + three() * three() == 12 && nested() == 12)
+        printf("T11: test 2 passed\n");
+    else
+        printf("T11: test 2 failed\n");
+
+    // a function using the callee-saved registers called mid-expression
+    g = 1;
+    if (x * y + (x + busy()) == 41)
+        printf("T11: test 3 passed\n");
+    else
+        printf("T11: test 3 failed\n");
+
+    // two of its results in one expression
+    g = 2;
+    if (busy() + busy() == 68 && x == 4 && y == 5)
+        printf("T11: test 4 passed\n");
+    else
+        printf("T11: test 4 failed\n");
+
+#ifdef __x86_64__
+    // the callee-saved registers, handed back by a function that used them
+    g = 1;
+    if (wide() == 66 && deep() == 121 && x * y + deep() == 141)
+        printf("T11: test 5 passed\n");
+    else
+        printf("T11: test 5 failed\n");
+#endif
+
+    return 0;
+}
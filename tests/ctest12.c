@@ -0,0 +1,79 @@
+
+
+/**
+ * A series of tests, specifically targeting calls to static
+ * functions, which only save the registers that the function
+ * called actually writes to: values live across such calls,
+ * static functions calling each other, recursion, and a static
+ * function whose address is taken.
+ */
+
+int g;
+
+static int square() {
+    return g * g;
+}
+
+static int twice() {
+    int s;
+
+    s = square();
+    return s + s;
+}
+
+static int countdown() {
+    int here, below;
+
+    here = g;
+    below = 0;
+    if (g > 0) {
+        g = g + -1;
+        below = countdown();
+    }
+    return here + below;
+}
+
+static int seven() {
+    return 7;
+}
+
+int outer() {
+    return seven() + square();
+}
+
+int main() {
+    int x, y;
+
+    x = 3;
+    y = 4;
+    g = 5;
+
+    // a value live across a call to a static function
+    if (x * y + square() == 37 && x + (y + twice()) == 57)
+        printf("T12: test 1 passed\n");
+    else
+        printf("T12: test 1 failed\n");
+
+    // the results of several calls in one expression
+    g = 2;
+    if (square() * twice() + square() == 36)
+        printf("T12: test 2 passed\n");
+    else
+        printf("T12: test 2 failed\n");
+
+    // a recursive static function
+    g = 4;
+    if (x * (y + countdown()) == 42)
+        printf("T12: test 3 passed\n");
+    else
+        printf("T12: test 3 failed\n");
+
+    // an extern function calling static ones
+    g = 3;
+    if (x * y + (x + seven()) == 22 && y * outer() == 64)
+        printf("T12: test 4 passed\n");
+    else
+        printf("T12: test 4 failed\n");
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+
+
+/**
+ * A series of tests, specifically targeting the arguments of
+ * calls stored into the outgoing argument area of the frame:
+ * calls with several arguments, calls nested in the arguments
+ * of other calls, and values live across them.
+ */
+
+int main() {
+    char word[8], copy[8];
+    int n, m;
+
+    word[0] = 103;
+    word[1] = 117;
+    word[2] = 121;
+    word[3] = 0;
+
+    // a call with its arguments stored rather than pushed
+    memset(copy, 0, 8);
+    memcpy(copy, word, 4);
+    if (strcmp(copy, word) == 0 && strlen(copy) == 3)
+        printf("T13: test 1 passed\n");
+    else
+        printf("T13: test 1 failed\n");
+
+    // a call nested in the arguments of another, both before and after them
+    memset(copy, 0, 8);
+    memcpy(copy, word, strlen(word) + 1);
+    n = strlen(copy);
+    memset(copy, 120, strlen(word));
+    if (n == 3 && strlen(copy) == 3 && copy[2] == 120)
+        printf("T13: test 2 passed\n");
+    else
+        printf("T13: test 2 failed\n");
+
+    // values live across calls, and calls in the middle of expressions
+    n = 4;
+    m = n * 5 + strlen(word) * 2;
+    if (m == 26 && n + strlen(word) + strlen(copy) == 10)
+        printf("T13: test 3 passed\n");
+    else
+        printf("T13: test 3 failed\n");
+
+    // the same call, many times over, in a loop
+    m = 0;
+    for (n = 0; n < 10; n++)
+        m = m + strcmp(word, word) + strlen(word);
+    if (m == 30)
+        printf("T13: test 4 passed\n");
+    else
+        printf("T13: test 4 failed\n");
+
+    return 0;
+}
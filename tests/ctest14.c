@@ -0,0 +1,77 @@
+/**
+ * A series of tests, specifically targeting the block moves:
+ * struct assignments of small, 16 byte and large structs,
+ * through pointers as well, and memcpy and memset calls of a
+ * constant size, which are expanded inline.
+ */
+
+struct pt { int x; char c; int y; int z; };
+struct tag { char a; char b; char c; };
+struct big { int v[30]; char t; };
+
+struct pt gp;
+struct big gb;
+
+int main() {
+    struct pt a, b;
+    struct tag t, u;
+    struct big lb;
+    struct pt *p;
+    int *q;
+    int n;
+
+    // a 16 byte struct, padded after its char, copied between locals and globals
+    q = &a;
+    q[0] = 3;
+    q[2] = 5;
+    q[3] = 7;
+    b = a;
+    gp = b;
+    q = &gp;
+    if (sizeof(a) == 16 && q[0] == 3 && q[2] == 5 && q[3] == 7)
+        printf("T14: test 1 passed\n");
+    else
+        printf("T14: test 1 failed\n");
+
+    // a struct of 3 chars, copied a byte at a time, and one through a pointer
+    memset(&t, 65, 3);
+    u = t;
+    p = &b;
+    q = &a;
+    q[3] = 9;
+    *p = a;
+    q = &u;
+    n = q[0] & 16777215;
+    q = &b;
+    if (sizeof(t) == 3 && n == 4276545 && q[3] == 9 && q[0] == 3)
+        printf("T14: test 2 passed\n");
+    else
+        printf("T14: test 2 failed\n");
+
+    // a struct too large to unroll, copied by a rep movs
+    q = &gb;
+    for (n = 0; n < 30; n++)
+        q[n] = n * 2;
+    lb = gb;
+    q = &lb;
+    if (sizeof(lb) == 124 && q[0] == 0 && q[17] == 34 && q[29] == 58)
+        printf("T14: test 3 passed\n");
+    else
+        printf("T14: test 3 failed\n");
+
+    // memset and memcpy of constant sizes, small and large
+    memset(&lb, 0, sizeof(lb));
+    memset(&a, 1, 13);
+    q = &b;
+    q[1] = 0;
+    memcpy(&b, &a, 7);
+    q = &lb;
+    n = q[0] + q[17] + q[29];
+    q = &b;
+    if (n == 0 && q[0] == 16843009 && q[1] == 65793)
+        printf("T14: test 4 passed\n");
+    else
+        printf("T14: test 4 failed\n");
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * A series of tests, specifically targeting the integrated
+ * preprocessor: headers included twice behind an include guard
+ * and a '#pragma once', object and function-like macros, nested
+ * and self-referencing ones, # and ##, and conditionals.
+ */
+
+#include "ctest15.h"
+#include "ctest15_once.h"
+#include "ctest15.h"
+#include "ctest15_once.h"
+
+#define LIMIT 10
+#define ADD(a, b) ((a) + (b))
+#define TWICE(x) ADD(x, x)
+#define CAT(a, b) a ## b
+#define STR(x) #x
+#define SUM3(a, b, c) \
+    ((a) +            \
+     (b) + (c))
+#define total total
+
+int main() {
+    int value, total, n;
+
+    // the headers' functions and macros, which are only defined once
+    n = fromHeader() + fromOnce();
+    if (n == 12 && SQUARE(n - 9) == 9 && MAX(n, LIMIT) == 12)
+        printf("T15: test 1 passed\n");
+    else
+        printf("T15: test 1 failed\n");
+
+    // nested macros, and a macro that names itself expanding only once
+    CAT(val, ue) = TWICE(LIMIT + 1);
+    total = 3;
+    n = total;
+    if (value == 22 && n == 3 && strlen(STR(a + b)) == 5)
+        printf("T15: test 2 passed\n");
+    else
+        printf("T15: test 2 failed\n");
+
+    // an invocation whose arguments go on over several lines
+    n = SUM3(1,
+             ADD(2, 3),
+             4);
+    if (n == 10)
+        printf("T15: test 3 passed\n");
+    else
+        printf("T15: test 3 failed\n");
+
+    // conditionals on macros being defined and on their values
+#if defined(LIMIT) && LIMIT * 2 > 15 && !defined UNDEFINED
+    n = 1;
+#elif LIMIT
+    n = 2;
+#else
+    n = 3;
+#endif
+#ifdef CTEST15_H
+    n = n + 10;
+#endif
+#undef LIMIT
+#ifndef LIMIT
+    n = n + 100;
+#endif
+    if (n == 111)
+        printf("T15: test 4 passed\n");
+    else
+        printf("T15: test 4 failed\n");
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+/**
+ * The header of ctest15.c, which it includes twice: the
+ * include guard keeps its definitions from being repeated.
+ */
+
+#ifndef CTEST15_H
+#define CTEST15_H
+
+#define SQUARE(x) ((x) * (x))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+int fromHeader() {
+    return 7;
+}
+
+#endif
@@ -0,0 +1,10 @@
+/**
+ * A header of ctest15.c, which it includes twice: the
+ * '#pragma once' keeps its definitions from being repeated.
+ */
+
+#pragma once
+
+int fromOnce() {
+    return 5;
+}
@@ -0,0 +1,67 @@
+/**
+ * A series of tests, specifically targeting precompiled headers:
+ * the struct tags, globals, prototypes and macros of
+ * ctest16.h, which the Makefile precompiles first, used as though
+ * the header was parsed, with the layouts of the target it is
+ * compiled for.
+ */
+
+#include "ctest16.h"
+#include "ctest16.h"
+
+int scaled() {
+    calls = calls + 1;
+    return MUL(arg, SCALE);
+}
+
+int sumTable() {
+    int i, sum;
+    sum = 0;
+    for (i = 0; i < 8; i++)
+        sum = sum + table[i];
+    return sum;
+}
+
+int main() {
+    int n;
+    struct point p;
+    int *q;
+
+    // the prototypes and macros of the header
+    arg = 4;
+    n = scaled();
+    arg = 5;
+    n = n + scaled();
+    if (n == 27 && calls == 2 && strcmp("pch", "pch") == 0)
+        printf("T16: test 1 passed\n");
+    else
+        printf("T16: test 1 failed\n");
+
+    // its struct tag and a global of it
+    q = &p;
+    q[0] = 1;
+    q[2] = 5;
+    q = &origin;
+    q[1] = 2;
+    if (sizeof(p) == 12 && sizeof(struct point) == 12 && sizeof(origin) == 12 && q[1] == 2)
+        printf("T16: test 2 passed\n");
+    else
+        printf("T16: test 2 failed\n");
+
+    // and its global array
+    for (n = 0; n < 8; n++)
+        table[n] = n;
+    if (sumTable() == 28 && sizeof(table) == 32)
+        printf("T16: test 3 passed\n");
+    else
+        printf("T16: test 3 failed\n");
+
+    // a struct and an array of pointers, whose sizes depend on the target
+    n = sizeof(int *);
+    if (sizeof(struct link) == 3 * n && sizeof(head) == 3 * n && sizeof(slots) == 4 * n)
+        printf("T16: test 4 passed\n");
+    else
+        printf("T16: test 4 failed\n");
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+/**
+ * The header of ctest16.c, which is precompiled before it is
+ * compiled: its declarations and macros are loaded from
+ * ctest16.h.pch instead of being parsed again.
+ */
+
+#ifndef CTEST16_H
+#define CTEST16_H
+
+#define SCALE 3
+#define MUL(a, b) ((a) * (b))
+
+struct point { int x; int y; int z; };
+
+struct link { int val; int *next; int tag; };
+
+struct point origin;
+struct link head;
+int *slots[4];
+int calls, arg;
+int table[8];
+
+int strcmp();
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ * A series of tests, specifically targeting string literals:
+ * the same literal used many times, which is pooled into one,
+ * literals with a NUL inside of them, which can't be merged, escapes,
+ * wide literals, adjacent literals and literals longer than 2 KB.
+ */
+
+char *first;
+
+char *greeting() {
+    return "pooled";
+}
+
+int main() {
+    char *s, *t, *u;
+    char c, d, e, f;
+
+    // every occurrence of a literal shares its contents
+    first = "pooled";
+    if (strcmp(greeting(), first) == 0 && strcmp("pooled", "pooled") == 0)
+        printf("T17: test 1 passed\n");
+    else
+        printf("T17: test 1 failed\n");
+
+    // what follows an embedded NUL stays where it was written
+    s = "a\0b";
+    t = "x\0yz";
+    if (strcmp(s + 2, "b") == 0 && strcmp(t + 2, "yz") == 0 && strlen(s) == 1)
+        printf("T17: test 2 passed\n");
+    else
+        printf("T17: test 2 failed\n");
+
+    // escapes, whether kept as they are or turned into their character
+    s = "tab\there\n";
+    t = "q\"u\\o it's\x21";
+    u = "\x41\102C\x7e";
+    c = '\n';
+    d = '\'';
+    e = '\101';
+    f = 'x';
+    if (strchr(s, 9) == s + 3 && strchr(s, 10) == s + 8 && strlen(s) == 9
+            && strchr(t, 34) == t + 1 && strchr(t, 92) == t + 3 && strchr(t, 39) == t + 8 && strcmp(t + 10, "!") == 0
+            && strcmp(u, "ABC~") == 0 && c == 10 && d == 39 && e == 65 && f == 120)
+        printf("T17: test 3 passed\n");
+    else
+        printf("T17: test 3 failed\n");
+
+    // a wide literal is read as a plain one, and adjacent literals are one literal
+    s = L"wide";
+    t = "con" "cat"
+        "enated";
+    u = "a\x41" "b\n" "\0" "1";
+    if (strcmp(s, "wide") == 0 && strcmp(t, "concatenated") == 0 && strcmp(u, "aAb\n") == 0
+            && strlen(u) == 4 && strcmp(u + 5, "1") == 0)
+        printf("T17: test 4 passed\n");
+    else
+        printf("T17: test 4 failed\n");
+
+    // a literal longer than 2 KB is kept whole, with and without escapes
+    s = "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789";
+    t = "0123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789\x41";
+    if (strlen(s) == 2200 && strcmp(s + 2190, "0123456789") == 0 && strlen(t) == 2201 && strcmp(t + 2190, "0123456789A") == 0)
+        printf("T17: test 5 passed\n");
+    else
+        printf("T17: test 5 failed\n");
+
+    return 0;
+}
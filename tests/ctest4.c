@@ -0,0 +1,68 @@
+
+/**
+ * A series of tests, specifically targeting floating
+ * point arithmetic: float and double expressions, the
+ * conversions between them and the integers, comparisons
+ * and functions returning floating point values.
+ */
+
+double d;
+
+double half() {
+    return 0.5;
+}
+
+float third() {
+    float f;
+    f = 1;
+    return f / 3;
+}
+
+int main() {
+    double a, b;
+    float f;
+    int i;
+
+    // arithmetic and an integer converted in a double expression
+    a = 1.5;
+    b = 2;
+    d = a * b + 0.25;
+    if (d == 3.25)
+        printf("T4: test 1 passed\n");
+    else
+        printf("T4: test 1 failed\n");
+
+    // float arithmetic
+    f = 2.5f;
+    f = f * f - 0.25f;
+    if (f == 6)
+        printf("T4: test 2 passed\n");
+    else
+        printf("T4: test 2 failed\n");
+
+    // conversion to an integer truncates towards zero
+    i = -d;
+    if (i == -3)
+        printf("T4: test 3 passed\n");
+    else
+        printf("T4: test 3 failed\n");
+
+    // comparisons, as a branch and as a value
+    i = a < b;
+    if (a < b && b <= d && !(a > b) && i == 1)
+        printf("T4: test 4 passed\n");
+    else
+        printf("T4: test 4 failed\n");
+
+    // functions returning floating point values
+    a = half() + third();
+    if (a > 0.83 && a < 0.84)
+        printf("T4: test 5 passed\n");
+    else
+        printf("T4: test 5 failed\n");
+
+    // doubles passed to a variadic function
+    printf("T4: %f %d %f\n", d, i, f);
+
+    return 0;
+}
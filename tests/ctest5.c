@@ -0,0 +1,97 @@
+
+/**
+ * A series of tests, specifically targeting the loops
+ * that -ftree-vectorize runs 4 iterations at a time:
+ * element-wise, memset-like and sum loops, with trip
+ * counts that leave iterations to the scalar loop or
+ * are too small for a single vector iteration, and
+ * pointers that do and do not overlap.
+ */
+
+int a[103];
+int b[103];
+int c[103];
+int d[64];
+
+int main() {
+    int i, n, s, k;
+    int *p, *q;
+
+    for (i = 0; i < 103; i++) {
+        a[i] = i;
+        b[i] = i * 2;
+    }
+
+    // element-wise arithmetic
+    for (i = 0; i < 103; i++)
+        c[i] = a[i] + b[i] * 2 + 1;
+    if (c[0] == 1 && c[50] == 251 && c[101] == 506 && c[102] == 511)
+        printf("T5: test 1 passed\n");
+    else
+        printf("T5: test 1 failed\n");
+
+    // memset-like, up to a variable bound and not from a multiple of 4
+    n = 61;
+    for (i = 1; i < n; ++i)
+        d[i] = 7;
+    if (d[0] == 0 && d[1] == 7 && d[60] == 7 && d[61] == 0)
+        printf("T5: test 2 passed\n");
+    else
+        printf("T5: test 2 failed\n");
+
+    // sum reduction
+    s = 5;
+    for (i = 0; i < 103; i++)
+        s += a[i];
+    if (s == 5258)
+        printf("T5: test 3 passed\n");
+    else
+        printf("T5: test 3 failed\n");
+
+    // multiplication, negation and a bitwise operator with a loop invariant
+    k = -3;
+    for (i = 0; i < 103; i++) {
+        c[i] = a[i] * a[i] + k;
+        b[i] = -(a[i] & 6) + k;
+    }
+    if (c[10] == 97 && c[101] == 10198 && b[7] == -9 && b[102] == -9)
+        printf("T5: test 4 passed\n");
+    else
+        printf("T5: test 4 failed\n");
+
+    // pointers into the same array, less than 4 ints apart
+    a[0] = 1;
+    p = a;
+    q = a + 1;
+    for (i = 0; i < 20; i++)
+        q[i] = p[i] * 2;
+    if (a[5] == 32 && a[20] == 1048576)
+        printf("T5: test 5 passed\n");
+    else
+        printf("T5: test 5 failed\n");
+
+    // pointers into different arrays
+    p = c;
+    q = d;
+    for (i = 0; i < 64; i++)
+        q[i] = p[i] + 3;
+    if (d[0] == 0 && d[10] == 100 && d[63] == 3969)
+        printf("T5: test 6 passed\n");
+    else
+        printf("T5: test 6 failed\n");
+
+    // bounds too small for a vector iteration, or for any iteration at all
+    n = 2;
+    for (i = 0; i < n; i++)
+        d[i] = 9;
+    s = 0;
+    n = -5;
+    for (i = 0; i < n; i++)
+        s += a[i];
+    if (d[0] == 9 && d[1] == 9 && d[2] == 4 && s == 0)
+        printf("T5: test 7 passed\n");
+    else
+        printf("T5: test 7 failed\n");
+
+    return 0;
+}
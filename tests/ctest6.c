@@ -0,0 +1,74 @@
+
+/**
+ * A series of tests, specifically targeting the
+ * multiplications, divisions and modulos by constants
+ * that are generated as shifts, lea's and multiplies by
+ * magic numbers: powers of two, other divisors, and
+ * negative dividends rounding towards zero, along with
+ * negative divisors, divisors too large to be reduced,
+ * and divisors that aren't constants.
+ */
+
+int main() {
+    int a, n, big, h, d, e;
+
+    a = 100;
+    n = -100;
+    big = 2147483647;
+
+    // multiplications by powers of two, by 3/5/9 times them, and by others
+    if (a * 8 == 800 && a * 3 == 300 && 5 * a == 500 && a * 40 == 4000 &&
+        a * 7 == 700 && n * 72 == -7200 && a * 1 == 100 && a * 0 == 0)
+        printf("T6: test 1 passed\n");
+    else
+        printf("T6: test 1 failed\n");
+
+    // division by powers of two rounds towards zero
+    if (a / 4 == 25 && n / 4 == -25 && n / 8 == -12 && n / 2 == -50 && a / 1 == 100)
+        printf("T6: test 2 passed\n");
+    else
+        printf("T6: test 2 failed\n");
+
+    // modulo by powers of two keeps the dividend's sign
+    if (a % 8 == 4 && n % 8 == -4 && n % 2 == 0 && a % 64 == 36 && n % 1 == 0)
+        printf("T6: test 3 passed\n");
+    else
+        printf("T6: test 3 failed\n");
+
+    // division by other constants
+    if (a / 7 == 14 && n / 7 == -14 && a / 3 == 33 && n / 10 == -10 &&
+        big / 10 == 214748364 && big / 641 == 3350208)
+        printf("T6: test 4 passed\n");
+    else
+        printf("T6: test 4 failed\n");
+
+    // modulo by other constants, as in a hash table's bucket
+    h = big % 13;
+    if (a % 7 == 2 && n % 7 == -2 && a % 3 == 1 && h == 10 && n % 101 == -100)
+        printf("T6: test 5 passed\n");
+    else
+        printf("T6: test 5 failed\n");
+
+    // divisors too large for the magic numbers are divided by
+    if (a / 2147483648 == 0 && a % 3000000000 == 100)
+        printf("T6: test 6 passed\n");
+    else
+        printf("T6: test 6 failed\n");
+
+    // negative divisors are reduced as well
+    if (a / -1 == -100 && n / -1 == 100 && n / -3 == 33 && a / -4 == -25 &&
+        n % -4 == 0 && n % -7 == -2 && a % -3 == 1)
+        printf("T6: test 7 passed\n");
+    else
+        printf("T6: test 7 failed\n");
+
+    // division by a variable sign extends the dividend
+    d = 7;
+    e = -3;
+    if (n / d == -14 && n % d == -2 && a / e == -33 && n % e == -1 && n / e == 33)
+        printf("T6: test 8 passed\n");
+    else
+        printf("T6: test 8 failed\n");
+
+    return 0;
+}
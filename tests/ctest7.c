@@ -0,0 +1,72 @@
+
+/**
+ * A series of tests, specifically targeting conditions:
+ * && and || as branch chains that stop at the first test
+ * deciding them, in if statements and loops, ! inside of
+ * conditions, and conditions used as values.
+ */
+
+int a, b, calls;
+
+int countA() {
+    calls = calls + 1;
+    return a;
+}
+
+int countB() {
+    calls = calls + 1;
+    return b;
+}
+
+int main() {
+    int i, n, v;
+
+    a = 3;
+    b = 0;
+
+    // the right side is only evaluated when the left one doesn't decide
+    calls = 0;
+    if (countB() && countA())
+        printf("T7: test 1 failed\n");
+    else if ((countA() || countB()) && calls == 2)
+        printf("T7: test 1 passed\n");
+    else
+        printf("T7: test 1 failed\n");
+
+    // && and || in loop conditions, with ! in them
+    n = 0;
+    i = 0;
+    while (i < 10 && !(i == 7 || a == 0)) {
+        n = n + i;
+        i++;
+    }
+    if (n == 21 && i == 7)
+        printf("T7: test 2 passed\n");
+    else
+        printf("T7: test 2 failed\n");
+
+    // nested && and || with an else
+    if ((a > 1 && b > 1) || (a < 1 || !(b < 1)))
+        printf("T7: test 3 failed\n");
+    else
+        printf("T7: test 3 passed\n");
+
+    // conditions as values
+    v = a > 2 && b == 0;
+    n = (a + 1 < 2) || !a;
+    i = !b + (a >= 3);
+    if (v == 1 && n == 0 && i == 2)
+        printf("T7: test 4 passed\n");
+    else
+        printf("T7: test 4 failed\n");
+
+    // a condition's value is computed once, stopping at its first test
+    calls = 0;
+    v = countA() || countB();
+    if (v == 1 && calls == 1)
+        printf("T7: test 5 passed\n");
+    else
+        printf("T7: test 5 failed\n");
+
+    return 0;
+}
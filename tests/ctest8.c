@@ -0,0 +1,107 @@
+
+
+/**
+ * A series of tests, specifically targeting if-conversion:
+ * ?: expressions and if statements picking a variable's value,
+ * both the cheap ones that become conditional moves and the
+ * ones that still have to branch, inside and outside of loops.
+ */
+
+int a, b, calls;
+
+int count() {
+    calls = calls + 1;
+    return a;
+}
+
+int bump() {
+    a = a + 1;
+    return a;
+}
+
+int main() {
+    int i, n, v, m;
+    double d;
+
+    a = 5;
+    b = -3;
+
+    // ?: on cheap values, both ways
+    v = a > b ? a : b;
+    m = a < b ? a : b;
+    n = !b ? 1 : a + 3;
+    if (v == 5 && m == -3 && n == 8)
+        printf("T8: test 1 passed\n");
+    else
+        printf("T8: test 1 failed\n");
+
+    // if statements that only pick a value, with and without an else
+    if (b < 0)
+        v = -b;
+    else
+        v = b;
+    m = 0;
+    if (a == 5) {
+        m = a * 2 + 1;
+    }
+    n = 4;
+    if (a != 5)
+        n = 7;
+    if (v == 3 && m == 11 && n == 4)
+        printf("T8: test 2 passed\n");
+    else
+        printf("T8: test 2 failed\n");
+
+    // only the picked value may call a function
+    calls = 0;
+    v = b > 0 ? count() : a + 1;
+    m = b < 0 ? count() : 0;
+    if (v == 6 && m == 5 && calls == 1)
+        printf("T8: test 3 passed\n");
+    else
+        printf("T8: test 3 failed\n");
+
+    // data dependent picks in a loop: the sum of the absolute values and a max
+    n = 0;
+    m = -100;
+    for (i = -4; i < 5; i++) {
+        n = n + (i < 0 ? -i : i);
+        if (i * i + -3 * i > m)
+            m = i * i + -3 * i;
+    }
+    if (n == 20 && m == 28)
+        printf("T8: test 4 passed\n");
+    else
+        printf("T8: test 4 failed\n");
+
+    // ?: on floating point values and in conditions
+    d = a > 0 ? 2.5 : 1;
+    if ((a > b ? d : 0.0) > 2.0 && (b > 0 ? 0 : 1))
+        printf("T8: test 5 passed\n");
+    else
+        printf("T8: test 5 failed\n");
+
+    // conditions with side effects, which the picked value has to see
+    if (bump() > 5)
+        m = a;
+    else
+        m = 0;
+    n = 0;
+    i = (n++ == 0) ? n : 0;
+    if (m == 6 && i == 1 && n == 1)
+        printf("T8: test 6 passed\n");
+    else
+        printf("T8: test 6 failed\n");
+
+    // a condition with a modulo in it, on top of an arm's values
+    m = 2;
+    n = 1;
+    if (n <= (6 % 4))
+        m = m * 7 + n;
+    if (m == 15)
+        printf("T8: test 7 passed\n");
+    else
+        printf("T8: test 7 failed\n");
+
+    return 0;
+}
@@ -0,0 +1,108 @@
+
+
+/**
+ * A series of tests, specifically targeting the layout of
+ * the stack frame: variables declared in nested blocks, the
+ * blocks that share their slots, the alignment of doubles
+ * and arrays, and recursion through a frame with all of them.
+ */
+
+int depth, total;
+
+int recurse() {
+    int here;
+
+    here = depth;
+    if (depth > 0) {
+        int below;
+        depth = depth + -1;
+        below = recurse();
+        here = here + below;
+    }
+    else {
+        double d;
+        d = 0.5;
+        total = total + 1;
+        if (d * 2 > 0.9)
+            here = here + 1;
+    }
+    return here;
+}
+
+int main() {
+    int a, n;
+    char c;
+    double x;
+
+    a = 7;
+    c = 1;
+
+    // variables of nested blocks keep their own values
+    if (a > 0) {
+        int b, e;
+        b = a * 2;
+        e = b + 1;
+        if (b > 10) {
+            int f;
+            f = e + b;
+            a = f;
+        }
+    }
+    if (a == 29)
+        printf("T9: test 1 passed\n");
+    else
+        printf("T9: test 1 failed\n");
+
+    // the else block shares the if block's slots, neither clobbers the outer variables
+    n = 0;
+    if (a < 0) {
+        int u[4];
+        u[0] = 1;
+        n = u[0];
+    }
+    else {
+        int v, w;
+        v = 3;
+        w = 4;
+        n = v * w;
+    }
+    if (n == 12 && a == 29 && c == 1)
+        printf("T9: test 2 passed\n");
+    else
+        printf("T9: test 2 failed\n");
+
+    // loop bodies with their own variables
+    n = 0;
+    while (n < 20) {
+        int step;
+        step = 3;
+        n = n + step;
+    }
+    if (n == 21)
+        printf("T9: test 3 passed\n");
+    else
+        printf("T9: test 3 failed\n");
+
+    // a double is 8 byte aligned, even next to a char
+    {
+        double y;
+        int addr;
+        addr = &y;
+        x = 2.5;
+        y = x * 2;
+        if (addr % 8 == 0 && y == 5.0)
+            printf("T9: test 4 passed\n");
+        else
+            printf("T9: test 4 failed\n");
+    }
+
+    // recursion through frames with nested block variables
+    depth = 4;
+    total = 0;
+    if (recurse() == 11 && total == 1)
+        printf("T9: test 5 passed\n");
+    else
+        printf("T9: test 5 failed\n");
+
+    return 0;
+}